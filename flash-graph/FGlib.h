@@ -53,6 +53,7 @@ class FG_graph
 	std::string index_file;
 	std::shared_ptr<in_mem_graph> graph_data;
 	std::shared_ptr<vertex_index> index_data;
+	std::shared_ptr<graph_delta> delta;
 	config_map::ptr configs;
 
 	// In this case, the graph file is kept in SAFS and the index is read to
@@ -116,6 +117,22 @@ public:
 	std::shared_ptr<in_mem_graph> get_graph_data() const;
 	std::shared_ptr<vertex_index> get_index_data() const;
 
+/**
+  * \brief Attach a delta store to the graph. The graph engines created
+  *        afterwards merge the edges in the delta store with the edge
+  *        lists of the graph image.
+  *
+  * \param delta The delta store created for the graph.
+  *
+*/
+	void set_delta(std::shared_ptr<graph_delta> delta) {
+		this->delta = delta;
+	}
+
+	std::shared_ptr<graph_delta> get_delta() const {
+		return delta;
+	}
+
 	graph_engine::ptr create_engine(graph_index::ptr index);
 
 	/**
@@ -231,6 +248,82 @@ fm::vector::ptr compute_directed_triangles_fast(FG_graph::ptr fg,
 */
 fm::vector::ptr compute_undirected_triangles(FG_graph::ptr fg);
 
+/**
+  * \brief The result of approximate triangle counting.
+  */
+struct approx_triangle_result
+{
+	/**
+	  * \brief The estimated number of triangles in the graph.
+	  */
+	double num_triangles;
+	/**
+	  * \brief The confidence interval of the number of triangles.
+	  */
+	double lower, upper;
+	/**
+	  * \brief The estimated global clustering coefficient (transitivity).
+	  */
+	double transitivity;
+	/**
+	  * \brief The number of wedges (paths of length 2) in the graph.
+	  */
+	double num_wedges;
+	/**
+	  * \brief The number of sampled edges or wedges.
+	  */
+	size_t num_samples;
+	/**
+	  * \brief The number of edge lists read by the algorithm.
+	  */
+	size_t num_reads;
+	/**
+	  * \brief The estimated local clustering coefficient of each vertex
+	  *        if it's requested.
+	  */
+	fm::vector::ptr local_clustering;
+
+	approx_triangle_result() {
+		num_triangles = 0;
+		lower = upper = 0;
+		transitivity = 0;
+		num_wedges = 0;
+		num_samples = 0;
+		num_reads = 0;
+	}
+};
+
+/**
+  * \brief Estimate the number of triangles in an undirected graph with
+  *        DOULION, which counts the triangles in a graph whose edges are
+  *        sampled with probability `p'. Only the edge lists of the vertices
+  *        on the sampled edges are read.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param p The probability of sampling an edge.
+  * \param local Whether to estimate the local clustering coefficients.
+  * \param confidence The confidence level of the interval.
+  * \return The estimated number of triangles and its confidence interval.
+  *
+*/
+approx_triangle_result compute_doulion_triangles(FG_graph::ptr fg, double p,
+		bool local = false, double confidence = 0.95);
+
+/**
+  * \brief Estimate the number of triangles and the transitivity of
+  *        an undirected graph by sampling wedges uniformly and checking
+  *        whether they're closed.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param num_wedges The number of wedges sampled for the global estimate.
+  * \param num_local The number of wedges sampled on each vertex for its
+  *        local clustering coefficient. The wedges of a vertex with fewer
+  *        wedges are all checked. 0 means no local clustering coefficients.
+  * \param confidence The confidence level of the interval.
+  * \return The estimated number of triangles and its confidence interval.
+  *
+*/
+approx_triangle_result compute_wedge_sampling_triangles(FG_graph::ptr fg,
+		size_t num_wedges, size_t num_local = 0, double confidence = 0.95);
+
 /**
   * \brief Compute the per-vertex local Scan Statistic 
   * \param fg The FlashGraph graph object for which you want to compute.
@@ -256,11 +349,191 @@ FG_vector<std::pair<vertex_id_t, size_t> >::ptr compute_topK_scan(
 /**
   * \brief Compute the diameter estimation for a graph. 
   * \param fg The FlashGraph graph object for which you want to compute.
+  * \param num_bfs The number of BFS in a sweep. Multiple BFS run together
+  *        in a bit-parallel multi-source BFS, so it can't exceed 512.
+  * \param directed Whether to respect the direction of edges.
   * \return The diameter estimate value.
   *
 */
 size_t estimate_diameter(FG_graph::ptr fg, int num_bfs, bool directed);
 
+/**
+  * \brief Compute the closeness centrality of vertices with
+  *        bit-parallel multi-source BFS. The BFS from `width' vertices
+  *        share the reads of edge lists. The closeness of a vertex that
+  *        reaches r other vertices with the sum of distances d is
+  *        (r / d) * (r / (n - 1)) (Wasserman and Faust), so it's
+  *        comparable on graphs that aren't connected.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param ids The vertices whose closeness is computed.
+  * \param traverse_e The type of edges to traverse.
+  * \param width The number of BFS that run together: 64, 256 or 512.
+  * \return A vector with the closeness of each vertex in `ids'.
+  *
+*/
+fm::vector::ptr compute_closeness_centrality(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &ids, edge_type traverse_e,
+		size_t width = 256);
+
+/**
+  * \brief Compute the distribution of the distances from sampled source
+  *        vertices to all vertices with bit-parallel multi-source BFS.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param sources The sampled source vertices.
+  * \param traverse_e The type of edges to traverse.
+  * \param width The number of BFS that run together: 64, 256 or 512.
+  * \return The number of pairs of a source and a vertex it reaches at
+  *         each distance. Unreachable pairs aren't counted.
+  *
+*/
+std::vector<size_t> compute_sampled_distances(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &sources, edge_type traverse_e,
+		size_t width = 256);
+
+/**
+  * \brief The result of HyperANF.
+  */
+struct hyper_anf_result
+{
+	/**
+	  * The estimated number of pairs of vertices within distance t
+	  * for each t, until no counter changes.
+	  */
+	std::vector<double> nf;
+	/**
+	  * The estimated harmonic centrality of each vertex, i.e., the sum of
+	  * 1 / dist over the vertices it reaches.
+	  */
+	fm::vector::ptr harmonic;
+	/**
+	  * The estimated number of vertices each vertex reaches,
+	  * including itself.
+	  */
+	fm::vector::ptr reach;
+
+	/**
+	  * \brief The distance within which `alpha' of the reachable pairs are,
+	  *        interpolated between two distances.
+	  */
+	double get_effective_diameter(double alpha = 0.9) const;
+	/**
+	  * \brief The average distance between the pairs of distinct vertices
+	  *        that reach each other.
+	  */
+	double get_average_distance() const;
+};
+
+/**
+  * \brief Estimate the neighbourhood function of a graph with HyperANF.
+  *        Each vertex keeps a HyperLogLog counter of the vertices it
+  *        reaches, and a level merges the counters of the neighbors of
+  *        a vertex into its counter. Only the vertices whose counters
+  *        change are active in the next level.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param traverse_e The type of edges to traverse.
+  * \param log2m The log of the number of registers in a counter, in [4, 10].
+  *        The relative error of a counter is about 1.04 / sqrt(2^log2m)
+  *        and a counter takes 2^log2m bytes.
+  * \return The neighbourhood function and the harmonic centrality of
+  *         all vertices.
+  *
+*/
+hyper_anf_result compute_hyper_anf(FG_graph::ptr fg, edge_type traverse_e,
+		int log2m = 6);
+
+/**
+  * \brief Traverse a graph in the breadth-first order. Every level expands
+  *        the frontier top-down.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param start_vertex The vertex where the BFS starts.
+  * \param traverse_e The type of edges to traverse.
+  * \return The number of vertices visited by the BFS.
+  *
+*/
+size_t bfs(FG_graph::ptr fg, vertex_id_t start_vertex, edge_type traverse_e);
+
+/**
+  * \brief Traverse a graph in the breadth-first order with the
+  *        direction-optimizing BFS. When the frontier is large, unvisited
+  *        vertices search for a parent in the frontier through the edges
+  *        in the opposite direction (bottom-up), which reads far fewer
+  *        edges on low-diameter graphs.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param start_vertex The vertex where the BFS starts.
+  * \param traverse_e The type of edges to traverse.
+  * \return The number of vertices visited by the BFS.
+  *
+*/
+size_t direction_opt_bfs(FG_graph::ptr fg, vertex_id_t start_vertex,
+		edge_type traverse_e);
+
+/**
+  * \brief Compute the shortest distances from a source vertex to all
+  *        vertices with delta-stepping. Vertices are processed in buckets
+  *        of width `delta' in the order of their tentative distances.
+  *        A small delta does less redundant work, while a large delta
+  *        processes more vertices in parallel. An infinite delta turns
+  *        it into Bellman-Ford.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param source The source vertex.
+  * \param delta The width of a bucket.
+  * \param weight_type The type of the edge weights stored as edge data.
+  *        The weights have to be non-negative. If it's NULL, all edges
+  *        have weight 1.
+  * \param async Whether to process the vertices in a bucket
+  *        asynchronously in the order of their tentative distances.
+  * \return A vector with the distance of each vertex from the source.
+  *         Unreachable vertices have an infinite distance. It returns
+  *         NULL if a negative weight is found on a reachable edge.
+  *
+*/
+fm::vector::ptr compute_sssp(FG_graph::ptr fg, vertex_id_t source,
+		double delta, const fm::scalar_type *weight_type = NULL,
+		bool async = false);
+
+/**
+  * \brief Compute the shortest distances from multiple sources.
+  *        Up to 64 sources are processed together in a batch, so
+  *        the edge lists of a vertex are read once for all of them.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param sources The source vertices.
+  * \param delta The width of a bucket.
+  * \param weight_type The type of the edge weights stored as edge data.
+  * \param async Whether to run in the asynchronous mode.
+  * \return A vector of distances for each source. It's empty if
+  *         a negative weight is found on a reachable edge.
+  *
+*/
+std::vector<fm::vector::ptr> compute_multi_sssp(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &sources, double delta,
+		const fm::scalar_type *weight_type = NULL, bool async = false);
+
+/**
+  * \brief Generate random walks for DeepWalk and node2vec. Walkers advance
+  *        in batches, and the walkers on the same vertex share a read of
+  *        its edge list in each step. A walk follows out-edges and ends early
+  *        at a vertex without out-edges. The walks are written to a file:
+  *        each walk is the number of vertices in it as a 32-bit integer
+  *        followed by the vertex IDs.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param out_file The file where the walks are written.
+  * \param num_walks_per_vertex The number of walks that start from
+  *        each vertex.
+  * \param walk_length The max number of vertices in a walk.
+  * \param p The return parameter of node2vec.
+  * \param q The in-out parameter of node2vec. The walks are first-order
+  *        if both p and q are 1.
+  * \param weight_type The type of the edge weights stored as edge data.
+  *        If it's NULL, all edges have weight 1.
+  * \param batch_size The number of walkers in a batch.
+  * \return The number of walks written to the file.
+  *
+*/
+size_t generate_random_walks(FG_graph::ptr fg, const std::string &out_file,
+		size_t num_walks_per_vertex, size_t walk_length, double p = 1,
+		double q = 1, const fm::scalar_type *weight_type = NULL,
+		size_t batch_size = 1 << 20);
+
 /**
   * \brief Compute the PageRank of a graph using the pull method
   *       where vertices request the data from all their neighbors
@@ -293,6 +566,51 @@ fm::vector::ptr compute_pagerank(FG_graph::ptr fg, int num_iters,
 fm::vector::ptr compute_pagerank2(FG_graph::ptr, int num_iters,
 		float damping_factor);
 
+/**
+  * \brief Compute the PageRank of a graph with PageRank-delta, where
+  *       a vertex pushes the PageRank it has accumulated to its
+  *       out-neighbors only when it exceeds the tolerance. It runs
+  *       until no vertex has more than the tolerance to push.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param tolerance The PageRank a vertex accumulates before pushing it.
+  * \param damping_factor The damping factor. Originally .85.
+  * \param async Whether to run in the asynchronous mode, where the vertex
+  *        with the most PageRank to push is processed first.
+  *
+  * \return A vector with an entry for each vertex in the graph's
+  *         PageRank value.
+  *
+*/
+fm::vector::ptr compute_pagerank_delta(FG_graph::ptr fg, float tolerance,
+		float damping_factor, bool async = false);
+
+/**
+  * \brief Compute personalized PageRank for many seed sets with forward
+  *       push and return the vertices with the largest PageRank for each
+  *       seed set. Up to 64 seed sets run together, so the edge list of
+  *       a vertex is read once per level for all of them, and a vertex
+  *       only keeps the state of the seed sets that reach it.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param seeds The seed sets. A random surfer jumps to a vertex in
+  *        the seed set uniformly at random.
+  * \param epsilons The residual threshold of each seed set, or a single
+  *        threshold for all seed sets. The PageRank of a vertex is never
+  *        overestimated. In an undirected graph, it's underestimated by
+  *        at most the threshold times the degree of the vertex.
+  * \param k The number of vertices returned for each seed set.
+  * \param damping_factor The damping factor. Originally .85.
+  *
+  * \return The top-k vertices and their PageRank for each seed set,
+  *         in descending order of PageRank.
+  *
+*/
+std::vector<std::vector<std::pair<vertex_id_t, float> > > compute_ppr_topk(
+		FG_graph::ptr fg, const std::vector<std::vector<vertex_id_t> > &seeds,
+		const std::vector<double> &epsilons, size_t k,
+		float damping_factor = 0.85);
+
 fm::vector::ptr compute_sstsg(FG_graph::ptr fg, time_t start_time,
 		time_t interval, int num_intervals);
 
@@ -310,6 +628,18 @@ fm::vector::ptr compute_sstsg(FG_graph::ptr fg, time_t start_time,
  */
 fm::vector::ptr compute_kcore(FG_graph::ptr fg, size_t k, size_t kmax=0);
 
+/**
+ * \brief Compute the coreness of every vertex in one run by peeling
+ *        vertices in the order of their degrees. The degrees are
+ *        initialized from the vertex index and a vertex reads its edge
+ *        list only when it is peeled.
+ * \param fg The FlashGraph graph object for which you want to compute.
+ * \return An `FG_vector` containing the coreness of each vertex.
+ *        The degree of a vertex in a directed graph is the sum of
+ *        its in-degree and out-degree.
+ */
+fm::vector::ptr compute_core_decomposition(FG_graph::ptr fg);
+
 /**
  * \brief Get the degree of all vertices in the graph.
  * \param fg The FlashGraph graph object for which you want to compute.
@@ -338,6 +668,47 @@ fm::vector::ptr compute_transitivity(FG_graph::ptr fg);
 fm::vector::ptr compute_betweenness_centrality(FG_graph::ptr fg,
 		const std::vector<vertex_id_t>& vids);
 
+/**
+  * \brief The result of the approximate betweenness centrality.
+  */
+struct approx_betweenness_result
+{
+	/**
+	  * The estimated fraction of the shortest paths between all ordered
+	  * pairs of distinct vertices that pass through each vertex. Multiply
+	  * it by n(n-1) to get the betweenness centrality.
+	  */
+	fm::vector::ptr btwn;
+	/**
+	  * The error bound of the estimate of each vertex. All bounds hold
+	  * together with probability 1 - delta.
+	  */
+	fm::vector::ptr err;
+	/** The number of sampled paths. */
+	size_t num_samples;
+	/** The number of samples that guarantees the target accuracy. */
+	size_t max_samples;
+};
+
+/**
+  * \brief Approximate the betweenness centrality of a graph by sampling
+  *        shortest paths. The samples run in batches, and the BFS of all
+  *        samples in a batch share the reads of edge lists. It stops early
+  *        when the error bounds of all vertices are below `epsilon'.
+  *        In an undirected graph, the number of samples is bounded with
+  *        the length of shortest paths, which is estimated by BFS from
+  *        a vertex of each large connected component. In a directed graph,
+  *        the bound uses the number of vertices.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param epsilon The max error of the normalized betweenness.
+  * \param delta The probability that the error exceeds `epsilon'.
+  * \param width The number of samples in a batch, at most 64.
+  * \return The estimates and their error bounds.
+*/
+approx_betweenness_result compute_approx_betweenness(FG_graph::ptr fg,
+		double epsilon, double delta = 0.1, size_t width = 64);
+
 /**
  * \brief Get the degree of all vertices in a specified time interval in
  *        a time-series graph.
@@ -368,11 +739,107 @@ void compute_overlap(FG_graph::ptr fg, const std::vector<vertex_id_t> &vids,
 		std::vector<std::vector<double> > &overlap_matrix);
 
 /**
- * \brief Compute louvain clustering for a graph.
- * \param fg The FlashGraph graph object for which you want to compute.
- * \param levels The number of levels of the hierarchy to do.
- */
-void compute_louvain(FG_graph::ptr fg, const uint32_t levels);
+  * \brief The result of Louvain community detection.
+  */
+struct louvain_result
+{
+	/**
+	  * \brief The community of each vertex. Communities are numbered from 0.
+	  */
+	fm::vector::ptr communities;
+	/**
+	  * \brief The modularity of the communities found in each level.
+	  */
+	std::vector<double> modularity;
+	/**
+	  * \brief The number of communities found in each level.
+	  */
+	std::vector<size_t> num_communities;
+	/**
+	  * \brief The runtime of each level in seconds.
+	  */
+	std::vector<double> runtimes;
+};
+
+/**
+  * \brief Compute communities of an undirected graph with parallel Louvain.
+  *        Vertices move between communities in parallel without locks.
+  *        Each level aggregates the communities into a weighted graph in
+  *        memory, on which the next level runs.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param levels The max number of levels of the hierarchy.
+  * \param refine Whether to refine the communities as Leiden does before
+  *        aggregation, which keeps the communities connected.
+  * \param weight_type The type of edge weights. NULL means all edges have
+  *        weight 1.
+  * \return The communities of the last level, and the modularity, the number
+  *         of communities and the runtime of each level.
+  *
+*/
+louvain_result compute_louvain(FG_graph::ptr fg, uint32_t levels,
+		bool refine = true, const fm::scalar_type *weight_type = NULL);
+
+/**
+  * \brief An edge in the minimum spanning forest.
+  */
+struct msf_edge
+{
+	vertex_id_t from;
+	vertex_id_t to;
+	double weight;
+
+	msf_edge() {
+		from = INVALID_VERTEX_ID;
+		to = INVALID_VERTEX_ID;
+		weight = 0;
+	}
+
+	msf_edge(vertex_id_t from, vertex_id_t to, double weight) {
+		this->from = from;
+		this->to = to;
+		this->weight = weight;
+	}
+};
+
+/**
+  * \brief The result of the minimum spanning forest.
+  */
+struct msf_result
+{
+	/**
+	  * \brief The total weight of the edges in the forest.
+	  */
+	double total_weight;
+	/**
+	  * \brief The number of trees in the forest, i.e., the number of
+	  *        connected components in the graph.
+	  */
+	size_t num_trees;
+	/**
+	  * \brief The edges in the forest.
+	  */
+	std::vector<msf_edge> edges;
+
+	msf_result() {
+		total_weight = 0;
+		num_trees = 0;
+	}
+};
+
+/**
+  * \brief Compute the minimum spanning forest of an undirected graph with
+  *        Borůvka's algorithm. Components find their lightest edges by
+  *        scanning edge lists and merge in a lock-free union-find. Once
+  *        the edges between components fit in memory, the contracted graph
+  *        is processed in memory.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param weight_type The type of edge weights. NULL means all edges have
+  *        weight 1.
+  * \return The total weight and the edges of the forest.
+  *
+*/
+msf_result compute_msf(FG_graph::ptr fg,
+		const fm::scalar_type *weight_type = NULL);
 
 std::shared_ptr<fm::sparse_matrix> create_sparse_matrix(fg::FG_graph::ptr fg,
 		const fm::scalar_type *entry_type);
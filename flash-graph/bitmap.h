@@ -232,6 +232,31 @@ public:
 		return v.size() - orig_size;
 	}
 
+	/*
+	 * This is the same as get_reset_set_bits(), but it works on a range of
+	 * longs and doesn't update the number of set bits. Therefore, multiple
+	 * threads can collect the bits in disjoint ranges in parallel.
+	 * reset_num_set_bits() needs to be called after all bits are collected.
+	 */
+	template<class T>
+	size_t get_reset_set_bits_in_longs(size_t long_begin, size_t long_end,
+			std::vector<T> &v) {
+		if (long_end > get_num_longs())
+			long_end = get_num_longs();
+		size_t orig_size = v.size();
+		for (size_t i = long_begin; i < long_end; i++) {
+			if (ptr[i]) {
+				get_set_bits_long(ptr[i], i, v);
+				ptr[i] = 0;
+			}
+		}
+		return v.size() - orig_size;
+	}
+
+	void reset_num_set_bits() {
+		num_set_bits = 0;
+	}
+
 	void copy_to(bitmap &map) const {
 		assert(max_num_bits == map.max_num_bits);
 		map.num_set_bits = num_set_bits;
@@ -301,6 +326,25 @@ public:
 		for (size_t i = 0; i < num_longs; i++)
 			new (ptr + i) std::atomic_ulong();
 	}
+
+	/*
+	 * This method collects all bits that have been set to 1.
+	 * It shouldn't run while other threads are modifying the bitmap.
+	 */
+	template<class T>
+	size_t get_set_bits(std::vector<T> &v) const {
+		size_t orig_size = v.size();
+		size_t num_longs = ROUNDUP(max_num_bits, NUM_BITS_LONG) / NUM_BITS_LONG;
+		for (size_t i = 0; i < num_longs; i++) {
+			unsigned long value = ptr[i].load(std::memory_order_relaxed);
+			while (value) {
+				int off = __builtin_ctzl(value);
+				v.push_back(i * NUM_BITS_LONG + off);
+				value &= value - 1;
+			}
+		}
+		return v.size() - orig_size;
+	}
 };
 
 #endif
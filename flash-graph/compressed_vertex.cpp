@@ -0,0 +1,206 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#include <new>
+
+#include "compressed_vertex.h"
+
+namespace fg
+{
+
+copied_byte_array::deleter copied_byte_array::arr_deleter;
+
+static inline int get_num_bytes(uint32_t v)
+{
+	if (v < (1U << 8))
+		return 1;
+	else if (v < (1U << 16))
+		return 2;
+	else if (v < (1U << 24))
+		return 3;
+	else
+		return 4;
+}
+
+/*
+ * The number of data bytes of a group of 4 integers and the shuffle mask
+ * to decode them, indexed by the control byte.
+ */
+class stream_vbyte_tables
+{
+public:
+	uint8_t lengths[256];
+	uint8_t shuffles[256][16];
+
+	stream_vbyte_tables() {
+		for (int c = 0; c < 256; c++) {
+			int off = 0;
+			for (int i = 0; i < 4; i++) {
+				int len = ((c >> (2 * i)) & 0x3) + 1;
+				for (int j = 0; j < 4; j++)
+					// The highest bit makes the shuffle output 0.
+					shuffles[c][i * 4 + j] = j < len ? off + j : 0x80;
+				off += len;
+			}
+			lengths[c] = off;
+		}
+	}
+};
+
+static const stream_vbyte_tables svb_tables;
+
+size_t stream_vbyte_delta_encode(const uint32_t in[], size_t num,
+		uint8_t out[])
+{
+	uint8_t *ctrl = out;
+	uint8_t *data = out + (num + 3) / 4;
+	uint32_t prev = 0;
+	for (size_t i = 0; i < num; i += 4) {
+		uint8_t c = 0;
+		for (size_t j = 0; j < 4 && i + j < num; j++) {
+			// The neighbor list may not be sorted, so the difference may
+			// wrap around. It's still decoded correctly.
+			uint32_t delta = in[i + j] - prev;
+			prev = in[i + j];
+			int len = get_num_bytes(delta);
+			c |= (len - 1) << (2 * j);
+			memcpy(data, &delta, len);
+			data += len;
+		}
+		*ctrl++ = c;
+	}
+	return data - out;
+}
+
+size_t stream_vbyte_delta_decode(const uint8_t in[], size_t in_size,
+		size_t num, uint32_t out[])
+{
+	const uint8_t *ctrl = in;
+	const uint8_t *data = in + (num + 3) / 4;
+	const uint8_t *end = in + in_size;
+	uint32_t prev = 0;
+	size_t i = 0;
+#ifdef __SSSE3__
+	__m128i prev_vec = _mm_setzero_si128();
+	// We always load 16 bytes, so we can only use SIMD instructions
+	// for a group when it's far enough from the end of the input.
+	for (; i + 4 <= num && data + 16 <= end; i += 4) {
+		uint8_t c = *ctrl++;
+		__m128i vals = _mm_loadu_si128((const __m128i *) data);
+		vals = _mm_shuffle_epi8(vals,
+				_mm_loadu_si128((const __m128i *) svb_tables.shuffles[c]));
+		// Compute the prefix sum of the 4 deltas.
+		vals = _mm_add_epi32(vals, _mm_slli_si128(vals, 4));
+		vals = _mm_add_epi32(vals, _mm_slli_si128(vals, 8));
+		vals = _mm_add_epi32(vals, prev_vec);
+		_mm_storeu_si128((__m128i *) (out + i), vals);
+		prev_vec = _mm_shuffle_epi32(vals, 0xFF);
+		data += svb_tables.lengths[c];
+	}
+	if (i > 0)
+		prev = out[i - 1];
+#endif
+	for (; i < num; i += 4) {
+		uint8_t c = *ctrl++;
+		for (size_t j = 0; j < 4 && i + j < num; j++) {
+			int len = ((c >> (2 * j)) & 0x3) + 1;
+			uint32_t delta = 0;
+			memcpy(&delta, data, len);
+			data += len;
+			prev += delta;
+			out[i + j] = prev;
+		}
+	}
+	assert(data <= end);
+	return data - in;
+}
+
+size_t ext_mem_compressed_vertex::compress(const ext_mem_undirected_vertex &v,
+		char *buf, size_t size)
+{
+	assert(size >= get_max_size(v.get_num_edges(), v.get_edge_data_size()));
+	ext_mem_compressed_vertex *cv = new (buf) ext_mem_compressed_vertex();
+	cv->id = v.get_id();
+	cv->edge_data_size = v.get_edge_data_size();
+	cv->num_edges = v.get_num_edges();
+
+	std::vector<uint32_t> neighs(v.get_num_edges());
+	for (size_t i = 0; i < neighs.size(); i++)
+		neighs[i] = v.get_neighbor(i);
+	cv->num_bytes = stream_vbyte_delta_encode(neighs.data(), neighs.size(),
+			cv->data);
+
+	// Clear the padding, so the file doesn't contain garbage.
+	size_t edge_off = cv->get_edge_data_offset();
+	memset(buf + get_header_size() + cv->num_bytes, 0,
+			cv->get_size() - get_header_size() - cv->num_bytes);
+	if (v.has_edge_data() && v.get_num_edges() > 0)
+		memcpy(buf + edge_off, v.get_raw_edge_data(0),
+				v.get_num_edges() * v.get_edge_data_size());
+	return cv->get_size();
+}
+
+void ext_mem_compressed_vertex::decompress(char *buf, size_t size) const
+{
+	assert(size >= get_decompressed_size());
+	ext_mem_undirected_vertex *v = new (buf) ext_mem_undirected_vertex(id,
+			num_edges, edge_data_size);
+	stream_vbyte_delta_decode(data, num_bytes, num_edges,
+			(uint32_t *) (buf + ext_mem_undirected_vertex::get_header_size()));
+	if (edge_data_size > 0 && num_edges > 0)
+		memcpy(v->get_raw_edge_data(0), ((const char *) this)
+				+ get_edge_data_offset(), num_edges * edge_data_size);
+}
+
+void decompressed_byte_array::init(const safs::page_byte_array &arr,
+		std::vector<char> &buf)
+{
+	ext_mem_compressed_vertex header
+		= arr.get<ext_mem_compressed_vertex>(0);
+	this->off = arr.get_offset();
+	this->size = header.get_decompressed_size();
+	this->compressed_size = header.get_size();
+	assert(arr.get_size() >= compressed_size);
+
+	// If the compressed vertex crosses the page boundary, we need to copy
+	// it to contiguous memory first. We keep it behind the decompressed
+	// vertex.
+	off_t off_in_page = arr.get_offset_in_first_page();
+	const ext_mem_compressed_vertex *cv;
+	if (off_in_page + compressed_size <= (size_t) safs::PAGE_SIZE) {
+		buf.resize(size);
+		cv = (const ext_mem_compressed_vertex *) (arr.get_page(0)
+				+ off_in_page);
+	}
+	else {
+		buf.resize(size + compressed_size);
+		arr.memcpy(0, buf.data() + size, compressed_size);
+		cv = (const ext_mem_compressed_vertex *) (buf.data() + size);
+	}
+	cv->decompress(buf.data(), size);
+	this->buf = buf.data();
+}
+
+}
@@ -0,0 +1,275 @@
+#ifndef __COMPRESSED_VERTEX_H__
+#define __COMPRESSED_VERTEX_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+#include "cache.h"
+#include "vertex.h"
+
+namespace fg
+{
+
+/*
+ * These functions encode and decode a list of integers with the StreamVByte
+ * format. Integers are stored in groups of 4. Each group has a control byte,
+ * in which every 2 bits indicate the number of bytes (1-4) of an integer.
+ * All control bytes are stored in front of the data bytes, so a group can be
+ * decoded with a single byte shuffle.
+ * The integers are delta encoded first. The neighbor lists are sorted, so
+ * the differences between neighbors are usually small.
+ */
+
+/*
+ * The max number of bytes to encode `num' integers.
+ */
+static inline size_t stream_vbyte_max_size(size_t num)
+{
+	return (num + 3) / 4 + num * sizeof(uint32_t);
+}
+
+/*
+ * Encode the integers to the buffer. It returns the number of bytes used.
+ */
+size_t stream_vbyte_delta_encode(const uint32_t in[], size_t num,
+		uint8_t out[]);
+/*
+ * Decode `num' integers from the buffer. It returns the number of bytes
+ * consumed.
+ */
+size_t stream_vbyte_delta_decode(const uint8_t in[], size_t in_size,
+		size_t num, uint32_t out[]);
+
+/*
+ * This vertex represents an undirected vertex (or a part of a directed
+ * vertex) in an adjacency list file with compressed edge lists.
+ * It starts with the same fields as ext_mem_undirected_vertex, so we can
+ * read the vertex ID and the number of edges the same way.
+ * The encoded neighbor list follows the header and the edge data list
+ * is stored uncompressed behind the neighbor list.
+ */
+class ext_mem_compressed_vertex
+{
+	vertex_id_t id;
+	uint32_t edge_data_size;
+	vsize_t num_edges;
+	// The number of bytes of the encoded neighbor list.
+	uint32_t num_bytes;
+	uint8_t data[0];
+
+	size_t get_edge_data_offset() const {
+		size_t off = get_header_size() + num_bytes;
+		if (edge_data_size > 0)
+			return ROUNDUP(off, edge_data_size);
+		else
+			return off;
+	}
+public:
+	static size_t get_header_size() {
+		return offsetof(ext_mem_compressed_vertex, data);
+	}
+
+	/*
+	 * The max size of a compressed vertex with the specified number of edges.
+	 */
+	static size_t get_max_size(vsize_t num_edges, uint32_t edge_data_size) {
+		return ROUNDUP(get_header_size() + stream_vbyte_max_size(num_edges)
+				+ edge_data_size + (size_t) num_edges * edge_data_size,
+				sizeof(vertex_id_t));
+	}
+
+	/*
+	 * Compress a vertex to the buffer. It returns the size of the compressed
+	 * vertex.
+	 */
+	static size_t compress(const ext_mem_undirected_vertex &v, char *buf,
+			size_t size);
+
+	ext_mem_compressed_vertex() {
+		id = 0;
+		edge_data_size = 0;
+		num_edges = 0;
+		num_bytes = 0;
+	}
+
+	vertex_id_t get_id() const {
+		return id;
+	}
+
+	size_t get_num_edges() const {
+		return num_edges;
+	}
+
+	size_t get_edge_data_size() const {
+		return edge_data_size;
+	}
+
+	/*
+	 * The size of the vertex in the adjacency list file.
+	 */
+	size_t get_size() const {
+		return ROUNDUP(get_edge_data_offset()
+				+ (size_t) num_edges * edge_data_size, sizeof(vertex_id_t));
+	}
+
+	/*
+	 * The size of the vertex in the format of ext_mem_undirected_vertex.
+	 */
+	size_t get_decompressed_size() const {
+		return ext_mem_undirected_vertex::num_edges2vsize(num_edges,
+				edge_data_size);
+	}
+
+	/*
+	 * Decompress the vertex to the format of ext_mem_undirected_vertex.
+	 * The compressed vertex has to be stored in contiguous memory.
+	 */
+	void decompress(char *buf, size_t size) const;
+};
+
+/*
+ * This byte array owns a copy of a vertex stored in contiguous memory.
+ * It's the clone of a byte array whose buffer is reused for other vertices,
+ * so it can be kept after the byte array is used for another vertex.
+ */
+class copied_byte_array: public safs::page_byte_array
+{
+	class deleter: public safs::byte_array_allocator
+	{
+	public:
+		virtual page_byte_array *alloc() {
+			// A copied byte array is only created by clone().
+			assert(0);
+			return NULL;
+		}
+
+		virtual void free(page_byte_array *arr) {
+			delete arr;
+		}
+	};
+	static deleter arr_deleter;
+
+	off_t off;
+	std::vector<char> buf;
+public:
+	copied_byte_array(off_t off, const char *buf,
+			size_t size): page_byte_array(arr_deleter), buf(buf, buf + size) {
+		this->off = off;
+	}
+
+	virtual void lock() {
+	}
+
+	virtual void unlock() {
+	}
+
+	virtual size_t get_size() const {
+		return buf.size();
+	}
+
+	virtual page_byte_array *clone() {
+		return new copied_byte_array(off, buf.data(), buf.size());
+	}
+
+	virtual off_t get_offset() const {
+		return off;
+	}
+
+	virtual off_t get_offset_in_first_page() const {
+		return 0;
+	}
+
+	virtual const char *get_page(int idx) const {
+		return buf.data() + ((size_t) idx) * safs::PAGE_SIZE;
+	}
+};
+
+/*
+ * This byte array contains a vertex decompressed from a byte array that
+ * starts with a compressed vertex. It reports the same offset as
+ * the original byte array, so the graph engine can still tell whether it's
+ * the in-part or the out-part of a directed vertex.
+ */
+class decompressed_byte_array: public safs::page_byte_array
+{
+	off_t off;
+	size_t size;
+	size_t compressed_size;
+	const char *buf;
+public:
+	decompressed_byte_array() {
+		off = 0;
+		size = 0;
+		compressed_size = 0;
+		buf = NULL;
+	}
+
+	/*
+	 * Decompress the vertex in `arr'. The decompressed vertex is stored
+	 * in `buf', which can be reused for another vertex after this byte
+	 * array is no longer used.
+	 */
+	void init(const safs::page_byte_array &arr, std::vector<char> &buf);
+
+	/*
+	 * The size of the compressed vertex in the original byte array.
+	 */
+	size_t get_compressed_size() const {
+		return compressed_size;
+	}
+
+	virtual void lock() {
+	}
+
+	virtual void unlock() {
+	}
+
+	virtual size_t get_size() const {
+		return size;
+	}
+
+	/*
+	 * The decompressed vertex is copied, because `buf' is reused for
+	 * other vertices. The clone is freed by page_byte_array::destroy().
+	 */
+	virtual page_byte_array *clone() {
+		return new copied_byte_array(off, buf, size);
+	}
+
+	virtual off_t get_offset() const {
+		return off;
+	}
+
+	virtual off_t get_offset_in_first_page() const {
+		return 0;
+	}
+
+	virtual const char *get_page(int idx) const {
+		return buf + ((size_t) idx) * safs::PAGE_SIZE;
+	}
+};
+
+}
+
+#endif
@@ -19,6 +19,7 @@
 
 #include "fg_utils.h"
 #include "in_mem_storage.h"
+#include "compressed_vertex.h"
 
 #include "factor.h"
 #include "generic_type.h"
@@ -760,6 +761,118 @@ fg::FG_graph::ptr create_fg_graph(const std::string &graph_name,
 	return construct_FG_graph(res, graph_name);
 }
 
+bool export_compressed_graph(fg::FG_graph::ptr graph,
+		const std::string &adj_file, const std::string &index_file)
+{
+	if (!graph->is_in_mem()) {
+		BOOST_LOG_TRIVIAL(error) << "only an in-memory graph can be compressed";
+		return false;
+	}
+	const fg::graph_header &orig_header = graph->get_graph_header();
+	if (orig_header.has_compressed_edges()) {
+		BOOST_LOG_TRIVIAL(error) << "the edge lists are already compressed";
+		return false;
+	}
+	fg::graph_header header(orig_header.get_graph_type(),
+			orig_header.get_num_vertices(), orig_header.get_num_edges(),
+			orig_header.get_edge_data_size(),
+			orig_header.get_max_num_timestamps());
+	header.set_edge_list_format(fg::COMPRESSED_EDGE_LIST);
+
+	FILE *f = fopen(adj_file.c_str(), "w");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to open %1%: %2%")
+			% adj_file % strerror(errno);
+		return false;
+	}
+	BOOST_VERIFY(fwrite(&header, sizeof(header), 1, f));
+
+	auto vindex = graph->get_index_data();
+	const safs::NUMA_buffer &data = graph->get_graph_data()->get_data();
+	size_t num_vertices = vindex->get_num_vertices();
+	off_t off = sizeof(header);
+	std::vector<char> raw_buf;
+	std::vector<char> comp_buf;
+	// Compress the in-edge lists or the out-edge lists and get the locations
+	// of the compressed vertices.
+	auto compress_part = [&](const std::vector<off_t> &offs,
+			std::vector<off_t> &new_offs, std::vector<fg::vsize_t> &num_edges) {
+		for (size_t i = 0; i < num_vertices; i++) {
+			size_t size = offs[i + 1] - offs[i];
+			raw_buf.resize(size);
+			data.copy_to(raw_buf.data(), size, offs[i]);
+			const fg::ext_mem_undirected_vertex *v
+				= (const fg::ext_mem_undirected_vertex *) raw_buf.data();
+			comp_buf.resize(fg::ext_mem_compressed_vertex::get_max_size(
+						v->get_num_edges(), v->get_edge_data_size()));
+			size_t comp_size = fg::ext_mem_compressed_vertex::compress(*v,
+					comp_buf.data(), comp_buf.size());
+			BOOST_VERIFY(fwrite(comp_buf.data(), comp_size, 1, f));
+			new_offs[i] = off;
+			num_edges.push_back(v->get_num_edges());
+			off += comp_size;
+		}
+		new_offs[num_vertices] = off;
+	};
+
+	std::vector<fg::vsize_t> num_edges;
+	std::vector<off_t> out_offs(num_vertices + 1);
+	std::vector<off_t> new_out_offs(num_vertices + 1);
+	init_out_offs(vindex, out_offs);
+	if (header.is_directed_graph()) {
+		std::vector<off_t> in_offs(num_vertices + 1);
+		std::vector<off_t> new_in_offs(num_vertices + 1);
+		init_in_offs(vindex, in_offs);
+		compress_part(in_offs, new_in_offs, num_edges);
+		compress_part(out_offs, new_out_offs, num_edges);
+		std::vector<fg::directed_vertex_entry> entries(num_vertices + 1);
+		for (size_t i = 0; i <= num_vertices; i++)
+			entries[i] = fg::directed_vertex_entry(new_in_offs[i],
+					new_out_offs[i]);
+		fg::directed_vertex_index::dump(index_file, header, entries, num_edges);
+	}
+	else {
+		compress_part(out_offs, new_out_offs, num_edges);
+		std::vector<fg::vertex_offset> entries(num_vertices + 1);
+		for (size_t i = 0; i <= num_vertices; i++)
+			entries[i] = fg::vertex_offset(new_out_offs[i]);
+		fg::undirected_vertex_index::dump(index_file, header, entries,
+				num_edges);
+	}
+	fclose(f);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"compress the edge lists from %1% bytes to %2% bytes")
+		% data.get_length() % off;
+	return true;
+}
+
+/*
+ * Decompress the vertices whose locations are in `offs'. `offs' is changed
+ * to the locations of the vertices in the returned buffer.
+ */
+static detail::smp_vec_store::ptr decompress_vertices(const char *data,
+		std::vector<off_t> &offs)
+{
+	size_t num_vertices = offs.size() - 1;
+	std::vector<off_t> new_offs(offs.size());
+	new_offs[0] = 0;
+	for (size_t i = 0; i < num_vertices; i++) {
+		const fg::ext_mem_compressed_vertex *v
+			= (const fg::ext_mem_compressed_vertex *) (data + offs[i]);
+		new_offs[i + 1] = new_offs[i] + v->get_decompressed_size();
+	}
+	detail::smp_vec_store::ptr vec = detail::smp_vec_store::create(
+			new_offs[num_vertices], get_scalar_type<char>());
+	for (size_t i = 0; i < num_vertices; i++) {
+		const fg::ext_mem_compressed_vertex *v
+			= (const fg::ext_mem_compressed_vertex *) (data + offs[i]);
+		v->decompress(vec->get_raw_arr() + new_offs[i],
+				new_offs[i + 1] - new_offs[i]);
+	}
+	offs = new_offs;
+	return vec;
+}
+
 static vector_vector::ptr conv_fg2vv(fg::FG_graph::ptr graph, bool is_out_edge)
 {
 	auto vindex = graph->get_index_data();
@@ -775,8 +888,14 @@ static vector_vector::ptr conv_fg2vv(fg::FG_graph::ptr graph, bool is_out_edge)
 		detail::smp_vec_store::ptr mem_vec = detail::smp_vec_store::create(
 				len, get_scalar_type<char>());
 		graph_data->get_data().copy_to(mem_vec->get_raw_arr(), len, 0);
+		if (graph->get_graph_header().has_compressed_edges())
+			mem_vec = decompress_vertices(mem_vec->get_raw_arr(), offs);
 		return vector_vector::create(detail::mem_vv_store::create(offs, mem_vec));
 	}
+	else if (graph->get_graph_header().has_compressed_edges()) {
+		fprintf(stderr, "compressed edge lists have to be loaded to memory\n");
+		return vector_vector::ptr();
+	}
 	else {
 		safs::file_io_factory::shared_ptr factory = graph->get_graph_io_factory(
 				safs::REMOTE_ACCESS);
@@ -152,6 +152,13 @@ std::pair<fm::vector_vector::ptr, size_t> create_1d_matrix(edge_list::ptr el);
 fg::FG_graph::ptr create_fg_graph(const std::string &graph_name,
 		edge_list::ptr el);
 
+/*
+ * This writes a graph stored in memory to an adjacency list file with
+ * compressed edge lists and its vertex index.
+ */
+bool export_compressed_graph(fg::FG_graph::ptr graph,
+		const std::string &adj_file, const std::string &index_file);
+
 /*
  * This prints a graph into an edge list format.
  */
@@ -40,10 +40,11 @@ void graph_config::print_help()
 	printf("\tmax_processing_vertices: the max number of vertices being processed\n");
 	printf("\tenable_elevator: enable the elevator algorithm for scheduling vertices\n");
 	printf("\tpart_range_size_log: the log2 of the range size in range partitioning\n");
+	printf("\tedge_balanced_part: partition vertices into contiguous ranges with balanced edges\n");
 	printf("\tpreload: preload the graph data to the page cache\n");
 	printf("\tindex_file_weight: the weight for the graph index file\n");
 	printf("\tin_mem_graph: indicate whether to load the entire graph to memory in advance\n");
-	printf("\tnum_vparts: the number of vertical partitions\n");
+	printf("\tnum_vparts: the number of vertical partitions (chosen from the degree distribution by default, 1 disables it)\n");
 	printf("\tmin_vpart_degree: the min degree of a vertex to perform vertical partitioning\n");
 	printf("\tserial_run: run the user code on a vertex in serial\n");
 	printf("\tvertex_merge_gap: the gap size allowed when merging two vertex requests\n");
@@ -58,11 +59,13 @@ void graph_config::print()
 	BOOST_LOG_TRIVIAL(info) << "\tmax_processing_vertices: " << max_processing_vertices;
 	BOOST_LOG_TRIVIAL(info) << "\tenable_elevator: " << enable_elevator;
 	BOOST_LOG_TRIVIAL(info) << "\tpart_range_size_log: " << part_range_size_log;
+	BOOST_LOG_TRIVIAL(info) << "\tedge_balanced_part: " << edge_balanced_part;
 	BOOST_LOG_TRIVIAL(info) << "\tpreload: " << _preload;
 	BOOST_LOG_TRIVIAL(info) << "\tindex_file_weight: " << index_file_weight;
 	BOOST_LOG_TRIVIAL(info) << "\tin_mem_graph: " << _in_mem_graph;
 	BOOST_LOG_TRIVIAL(info) << "\tnum_vparts: " << num_vparts;
 	BOOST_LOG_TRIVIAL(info) << "\tmin_vpart_degree: " << min_vpart_degree;
+	BOOST_LOG_TRIVIAL(info) << "\tauto_vparts: " << auto_vparts;
 	BOOST_LOG_TRIVIAL(info) << "\tserial_run: " << serial_run;
 	BOOST_LOG_TRIVIAL(info) << "\tvertex_merge_gap: " << vertex_merge_gap;
 }
@@ -87,11 +90,15 @@ void graph_config::init(config_map::ptr map)
 	map->read_option_int("max_processing_vertices", max_processing_vertices);
 	map->read_option_bool("enable_elevator", enable_elevator);
 	map->read_option_int("part_range_size_log", part_range_size_log);
+	map->read_option_bool("edge_balanced_part", edge_balanced_part);
 	map->read_option_bool("preload", _preload);
 	map->read_option_int("index_file_weight", index_file_weight);
 	map->read_option_bool("in_mem_graph", _in_mem_graph);
 	map->read_option_int("num_vparts", num_vparts);
 	map->read_option_int("min_vpart_degree", min_vpart_degree);
+	// Users have chosen vertical partitioning themselves.
+	if (map->has_option("num_vparts") || map->has_option("min_vpart_degree"))
+		auto_vparts = false;
 	map->read_option_bool("serial_run", serial_run);
 	map->read_option_int("vertex_merge_gap", vertex_merge_gap);
 }
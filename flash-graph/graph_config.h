@@ -40,11 +40,18 @@ class graph_config
 	int max_processing_vertices;
 	bool enable_elevator;
 	int part_range_size_log;
+	// Indicate whether to partition vertices into contiguous ranges
+	// with balanced numbers of edges.
+	bool edge_balanced_part;
 	bool _preload;
 	int index_file_weight;
 	bool _in_mem_graph;
 	int num_vparts;
 	int min_vpart_degree;
+	// Indicate whether the graph engine chooses vertical partitioning
+	// automatically. It only applies when neither num_vparts nor
+	// min_vpart_degree is specified.
+	bool auto_vparts;
 	bool serial_run;
 	// in pages.
 	int vertex_merge_gap;
@@ -58,11 +65,13 @@ public:
 		max_processing_vertices = 2000;
 		enable_elevator = false;
 		part_range_size_log = 10;
+		edge_balanced_part = false;
 		_preload = false;
 		index_file_weight = 10;
 		_in_mem_graph = false;
 		num_vparts = 1;
 		min_vpart_degree = std::numeric_limits<int>::max();
+		auto_vparts = true;
 		serial_run = false;
 		// When the gap is 0, it means two vertices either in the same page
 		// or two adjacent pages.
@@ -134,6 +143,16 @@ public:
 		return part_range_size_log;
 	}
 
+	/**
+	 * \brief Determine whether to partition vertices into contiguous
+	 * ranges with about the same number of edges, instead of small ranges
+	 * assigned to threads in a round-robin fashion.
+	 * \return true if the edge-balanced partitioning is used.
+	 */
+	bool use_edge_balanced_part() const {
+		return edge_balanced_part;
+	}
+
 	/**
 	 * \brief Determine whether to preload the graph data to the page cache.
 	 * \return true if the graph is preloaded; else false.
@@ -186,6 +205,16 @@ public:
 		return min_vpart_degree;
 	}
 
+	/**
+	 * \brief Determine whether the graph engine chooses the number of
+	 * vertical partitions and the min degree of a vertex to perform
+	 * vertical partitioning automatically.
+	 * \return true if vertical partitioning is chosen automatically.
+	 */
+	bool use_auto_vparts() const {
+		return auto_vparts;
+	}
+
 	/**
 	 * \brief Get the size of a gap that is allowed when merging two vertex
 	 * requests.
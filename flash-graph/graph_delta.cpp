@@ -0,0 +1,716 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "log.h"
+#include "common.h"
+#include "io_interface.h"
+
+#include "graph_delta.h"
+#include "FGlib.h"
+#include "vertex_index.h"
+#include "compressed_vertex.h"
+#include "fg_utils.h"
+
+using namespace safs;
+
+namespace fg
+{
+
+void delta_snapshot::add_neighbor(delta_update_t &updates, vertex_id_t id,
+		vertex_id_t neigh, const char *data, size_t edge_data_size)
+{
+	vertex_delta &update = updates[id];
+	update.neighs.push_back(neigh);
+	if (edge_data_size > 0)
+		update.data.insert(update.data.end(), data, data + edge_data_size);
+}
+
+/*
+ * Merge the new edges with the edge lists in the map. Each edge list
+ * that gets new edges is copied, so the edge lists in the old snapshots
+ * don't change. Among the edges with the same neighbor, the edges added
+ * earlier come first.
+ */
+void delta_snapshot::seal(delta_map_t &map, const delta_update_t &updates,
+		size_t edge_data_size)
+{
+	std::vector<size_t> order;
+	for (delta_update_t::const_iterator it = updates.begin();
+			it != updates.end(); it++) {
+		const vertex_delta &update = it->second;
+		size_t num_new = update.neighs.size();
+		order.resize(num_new);
+		for (size_t i = 0; i < num_new; i++)
+			order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+				return update.neighs[a] < update.neighs[b];
+				});
+
+		std::shared_ptr<const vertex_delta> &delta = map[it->first];
+		size_t num_old = delta ? delta->neighs.size() : 0;
+		vertex_delta *merged = new vertex_delta();
+		merged->neighs.reserve(num_old + num_new);
+		merged->data.reserve((num_old + num_new) * edge_data_size);
+		size_t i = 0, j = 0;
+		while (i < num_old || j < num_new) {
+			const vertex_delta *src;
+			size_t idx;
+			if (j == num_new || (i < num_old
+						&& delta->neighs[i] <= update.neighs[order[j]])) {
+				src = delta.get();
+				idx = i++;
+			}
+			else {
+				src = &update;
+				idx = order[j++];
+			}
+			merged->neighs.push_back(src->neighs[idx]);
+			if (edge_data_size > 0)
+				merged->data.insert(merged->data.end(),
+						src->data.begin() + idx * edge_data_size,
+						src->data.begin() + (idx + 1) * edge_data_size);
+		}
+		delta = std::shared_ptr<const vertex_delta>(merged);
+	}
+}
+
+class compaction_thread: public thread
+{
+	graph_delta &delta;
+public:
+	compaction_thread(graph_delta &_delta): thread("compaction-thread",
+			-1), delta(_delta) {
+	}
+
+	void run() {
+		delta.run_compaction();
+		this->stop();
+	}
+};
+
+graph_delta::graph_delta(const graph_header &header,
+		const std::string &log_file)
+{
+	this->directed = header.is_directed_graph();
+	this->num_vertices = header.get_num_vertices();
+	this->edge_data_size = header.get_edge_data_size();
+	this->log_file = log_file;
+	this->log = NULL;
+	this->snapshot = delta_snapshot::ptr(new delta_snapshot(directed,
+				edge_data_size));
+	this->compact_thread = NULL;
+	this->compact_succeed = false;
+}
+
+graph_delta::~graph_delta()
+{
+	if (compact_thread) {
+		compact_thread->join();
+		delete compact_thread;
+	}
+	if (log)
+		fclose(log);
+}
+
+graph_delta::ptr graph_delta::create(const graph_header &header,
+		const std::string &log_file)
+{
+	if (header.get_graph_type() != graph_type::DIRECTED
+			&& header.get_graph_type() != graph_type::UNDIRECTED) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "a delta store only supports directed and undirected graphs";
+		return ptr();
+	}
+
+	ptr delta(new graph_delta(header, log_file));
+	struct stat st;
+	if (stat(log_file.c_str(), &st) == 0) {
+		if (!delta->replay())
+			return ptr();
+	}
+	else {
+		FILE *f = fopen(log_file.c_str(), "w");
+		if (f == NULL) {
+			BOOST_LOG_TRIVIAL(error) << boost::format("fail to create %1%: %2%")
+				% log_file % strerror(errno);
+			return ptr();
+		}
+		log_header lheader;
+		lheader.magic = LOG_MAGIC;
+		lheader.edge_data_size = delta->edge_data_size;
+		lheader.directed = delta->directed;
+		BOOST_VERIFY(fwrite(&lheader, sizeof(lheader), 1, f) == 1);
+		fclose(f);
+	}
+	delta->log = fopen(log_file.c_str(), "a");
+	if (delta->log == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to open %1%: %2%")
+			% log_file % strerror(errno);
+		return ptr();
+	}
+	return delta;
+}
+
+bool graph_delta::replay()
+{
+	FILE *f = fopen(log_file.c_str(), "r");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to open %1%: %2%")
+			% log_file % strerror(errno);
+		return false;
+	}
+	log_header lheader;
+	if (fread(&lheader, sizeof(lheader), 1, f) != 1
+			|| lheader.magic != LOG_MAGIC) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("%1% isn't a delta log")
+			% log_file;
+		fclose(f);
+		return false;
+	}
+	if (lheader.edge_data_size != edge_data_size
+			|| (bool) lheader.directed != directed) {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"the delta log %1% doesn't match the graph") % log_file;
+		fclose(f);
+		return false;
+	}
+
+	size_t record_size = sizeof(vertex_id_t) * 2 + edge_data_size;
+	std::vector<char> record(record_size);
+	size_t num_edges = 0;
+	while (fread(record.data(), record_size, 1, f) == 1) {
+		vertex_id_t src = *(vertex_id_t *) record.data();
+		vertex_id_t dst = *(vertex_id_t *) (record.data() + sizeof(vertex_id_t));
+		if (src >= num_vertices || dst >= num_vertices) {
+			BOOST_LOG_TRIVIAL(error) << boost::format(
+					"the delta log %1% has an invalid edge (%2%, %3%)")
+				% log_file % src % dst;
+			fclose(f);
+			return false;
+		}
+		add_edge_locked(src, dst, record.data() + sizeof(vertex_id_t) * 2);
+		num_edges++;
+	}
+	fclose(f);
+
+	// A crash may leave a partially written record at the end of the log.
+	// We remove it, so new records are appended behind the valid ones.
+	off_t valid_size = sizeof(lheader) + num_edges * record_size;
+	if (truncate(log_file.c_str(), valid_size) < 0) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to truncate %1%: %2%")
+			% log_file % strerror(errno);
+		return false;
+	}
+	BOOST_LOG_TRIVIAL(info) << boost::format("replay %1% edges from %2%")
+		% num_edges % log_file;
+	return true;
+}
+
+void graph_delta::add_edge_locked(vertex_id_t src, vertex_id_t dst,
+		const char *data)
+{
+	delta_edge e;
+	e.src = src;
+	e.dst = dst;
+	e.data_off = pending_data.size();
+	pending.push_back(e);
+	if (edge_data_size > 0)
+		pending_data.insert(pending_data.end(), data, data + edge_data_size);
+}
+
+bool graph_delta::write_log(FILE *f, const std::vector<delta_edge> &edges,
+		const char *data) const
+{
+	for (size_t i = 0; i < edges.size(); i++) {
+		if (fwrite(&edges[i].src, sizeof(vertex_id_t), 1, f) != 1
+				|| fwrite(&edges[i].dst, sizeof(vertex_id_t), 1, f) != 1)
+			return false;
+		if (edge_data_size > 0 && fwrite(data + edges[i].data_off,
+					edge_data_size, 1, f) != 1)
+			return false;
+	}
+	return true;
+}
+
+bool graph_delta::add_edges(
+		const std::vector<std::pair<vertex_id_t, vertex_id_t> > &edges,
+		const char *data)
+{
+	if (edge_data_size > 0 && data == NULL) {
+		BOOST_LOG_TRIVIAL(error) << "the edges need edge data";
+		return false;
+	}
+	std::vector<delta_edge> new_edges(edges.size());
+	for (size_t i = 0; i < edges.size(); i++) {
+		if (edges[i].first >= num_vertices || edges[i].second >= num_vertices) {
+			BOOST_LOG_TRIVIAL(error) << boost::format(
+					"can't add edge (%1%, %2%): the vertex doesn't exist")
+				% edges[i].first % edges[i].second;
+			return false;
+		}
+		new_edges[i].src = edges[i].first;
+		new_edges[i].dst = edges[i].second;
+		new_edges[i].data_off = i * edge_data_size;
+	}
+
+	std::lock_guard<std::mutex> guard(lock);
+	if (!write_log(log, new_edges, data)) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to write %1%: %2%")
+			% log_file % strerror(errno);
+		return false;
+	}
+	for (size_t i = 0; i < new_edges.size(); i++)
+		add_edge_locked(new_edges[i].src, new_edges[i].dst,
+				data + new_edges[i].data_off);
+	return true;
+}
+
+bool graph_delta::add_edge(vertex_id_t src, vertex_id_t dst, const void *data)
+{
+	std::vector<std::pair<vertex_id_t, vertex_id_t> > edges(1,
+			std::pair<vertex_id_t, vertex_id_t>(src, dst));
+	return add_edges(edges, (const char *) data);
+}
+
+bool graph_delta::flush()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (fflush(log) != 0 || fsync(fileno(log)) < 0) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to flush %1%: %2%")
+			% log_file % strerror(errno);
+		return false;
+	}
+	return true;
+}
+
+delta_snapshot::ptr graph_delta::get_snapshot()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (pending.empty())
+		return snapshot;
+
+	// Snapshots are shared by running algorithms, so we never modify
+	// a snapshot. Instead, we copy the latest snapshot, which shares
+	// the edge lists with it, and only the edge lists that get pending
+	// edges are copied. The pending edges of an edge list are sorted
+	// once when they are merged with the edge list.
+	delta_snapshot *new_snapshot = new delta_snapshot(*snapshot);
+	delta_snapshot::delta_update_t in_updates;
+	delta_snapshot::delta_update_t out_updates;
+	for (size_t i = 0; i < pending.size(); i++) {
+		const delta_edge &e = pending[i];
+		const char *data = pending_data.data() + e.data_off;
+		delta_snapshot::add_neighbor(out_updates, e.src, e.dst,
+				data, edge_data_size);
+		if (directed)
+			delta_snapshot::add_neighbor(in_updates, e.dst, e.src,
+					data, edge_data_size);
+		else
+			delta_snapshot::add_neighbor(out_updates, e.dst, e.src,
+					data, edge_data_size);
+	}
+	delta_snapshot::seal(new_snapshot->out_deltas, out_updates,
+			edge_data_size);
+	delta_snapshot::seal(new_snapshot->in_deltas, in_updates, edge_data_size);
+	new_snapshot->num_edges += pending.size();
+	pending.clear();
+	pending_data.clear();
+	snapshot = delta_snapshot::ptr(new_snapshot);
+	return snapshot;
+}
+
+size_t graph_delta::get_num_edges()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return snapshot->get_num_edges() + pending.size();
+}
+
+bool graph_delta::start_compaction(FG_graph::ptr graph,
+		const std::string &adj_file, const std::string &index_file)
+{
+	if (compact_thread) {
+		BOOST_LOG_TRIVIAL(error) << "a compaction is running";
+		return false;
+	}
+	if (graph->get_delta().get() != this) {
+		BOOST_LOG_TRIVIAL(error) << "the delta store isn't attached to the graph";
+		return false;
+	}
+	compact_graph = graph;
+	compact_snapshot = get_snapshot();
+	compact_adj_file = adj_file;
+	compact_index_file = index_file;
+	compact_succeed = false;
+	compact_thread = new compaction_thread(*this);
+	compact_thread->start();
+	return true;
+}
+
+void graph_delta::run_compaction()
+{
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	compact_succeed = merge_graph_delta(compact_graph, compact_snapshot,
+			compact_adj_file, compact_index_file);
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"It takes %1% seconds to merge %2% edges to the graph image")
+		% time_diff(start, end) % compact_snapshot->get_num_edges();
+}
+
+FG_graph::ptr graph_delta::finish_compaction()
+{
+	if (compact_thread == NULL) {
+		BOOST_LOG_TRIVIAL(error) << "no compaction is running";
+		return FG_graph::ptr();
+	}
+	compact_thread->join();
+	delete compact_thread;
+	compact_thread = NULL;
+	FG_graph::ptr old_graph = compact_graph;
+	compact_graph = FG_graph::ptr();
+	if (!compact_succeed)
+		return FG_graph::ptr();
+
+	FG_graph::ptr new_graph = FG_graph::create(compact_adj_file,
+			compact_index_file, old_graph->get_configs());
+
+	std::lock_guard<std::mutex> guard(lock);
+	// Find the edges added after the compaction started. They are behind
+	// the merged edges in the log.
+	std::vector<delta_edge> remain;
+	std::vector<char> remain_data;
+	fflush(log);
+	FILE *f = fopen(log_file.c_str(), "r");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to open %1%: %2%")
+			% log_file % strerror(errno);
+		return FG_graph::ptr();
+	}
+	size_t record_size = sizeof(vertex_id_t) * 2 + edge_data_size;
+	fseek(f, sizeof(log_header) + compact_snapshot->get_num_edges() * record_size,
+			SEEK_SET);
+	std::vector<char> record(record_size);
+	while (fread(record.data(), record_size, 1, f) == 1) {
+		delta_edge e;
+		e.src = *(vertex_id_t *) record.data();
+		e.dst = *(vertex_id_t *) (record.data() + sizeof(vertex_id_t));
+		e.data_off = remain_data.size();
+		remain.push_back(e);
+		remain_data.insert(remain_data.end(),
+				record.begin() + sizeof(vertex_id_t) * 2, record.end());
+	}
+	fclose(f);
+
+	// Replace the log with a new one that only has the remaining edges.
+	std::string tmp_file = log_file + ".tmp";
+	f = fopen(tmp_file.c_str(), "w");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to create %1%: %2%")
+			% tmp_file % strerror(errno);
+		return FG_graph::ptr();
+	}
+	log_header lheader;
+	lheader.magic = LOG_MAGIC;
+	lheader.edge_data_size = edge_data_size;
+	lheader.directed = directed;
+	bool succeed = fwrite(&lheader, sizeof(lheader), 1, f) == 1
+		&& write_log(f, remain, remain_data.data())
+		&& fflush(f) == 0 && fsync(fileno(f)) == 0;
+	fclose(f);
+	if (!succeed || rename(tmp_file.c_str(), log_file.c_str()) < 0) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to write %1%: %2%")
+			% tmp_file % strerror(errno);
+		return FG_graph::ptr();
+	}
+	fclose(log);
+	log = fopen(log_file.c_str(), "a");
+	assert(log);
+
+	snapshot = delta_snapshot::ptr(new delta_snapshot(directed,
+				edge_data_size));
+	pending.swap(remain);
+	pending_data.swap(remain_data);
+	compact_snapshot = delta_snapshot::ptr();
+
+	new_graph->set_delta(old_graph->get_delta());
+	old_graph->set_delta(graph_delta::ptr());
+	return new_graph;
+}
+
+namespace
+{
+
+/*
+ * This reads the vertices in the graph image in the order of their
+ * location in large chunks. A graph image is merged with its delta
+ * in a single pass, so we don't use the page cache.
+ */
+class seq_vertex_reader
+{
+	static const size_t CHUNK_SIZE = 64 * 1024 * 1024;
+
+	io_interface::ptr io;
+	int file_id;
+	size_t file_size;
+	bool compressed;
+	char *buf;
+	size_t buf_capacity;
+	off_t buf_off;
+	size_t buf_size;
+	std::vector<char> dec_buf;
+
+	void fetch(off_t off, size_t size);
+public:
+	seq_vertex_reader(FG_graph::ptr graph) {
+		file_io_factory::shared_ptr factory = graph->get_graph_io_factory(
+				REMOTE_ACCESS);
+		io = create_io(factory, thread::get_curr_thread());
+		file_id = factory->get_file_id();
+		file_size = factory->get_file_size();
+		compressed = graph->get_graph_header().has_compressed_edges();
+		buf = NULL;
+		buf_capacity = 0;
+		buf_off = 0;
+		buf_size = 0;
+	}
+
+	~seq_vertex_reader() {
+		free(buf);
+	}
+
+	/*
+	 * The returned vertex is only valid until the next read.
+	 */
+	const ext_mem_undirected_vertex &read(off_t off, size_t size) {
+		if (off < buf_off || off + size > buf_off + buf_size)
+			fetch(off, size);
+		const char *addr = buf + (off - buf_off);
+		if (!compressed)
+			return *(const ext_mem_undirected_vertex *) addr;
+
+		const ext_mem_compressed_vertex *cv
+			= (const ext_mem_compressed_vertex *) addr;
+		dec_buf.resize(cv->get_decompressed_size());
+		cv->decompress(dec_buf.data(), dec_buf.size());
+		return *(const ext_mem_undirected_vertex *) dec_buf.data();
+	}
+};
+
+void seq_vertex_reader::fetch(off_t off, size_t size)
+{
+	off_t start = ROUND_PAGE(off);
+	off_t end = ROUNDUP_PAGE(std::max(off + size, std::min(start + CHUNK_SIZE,
+					(size_t) file_size)));
+	size_t read_size = end - start;
+	if (read_size > buf_capacity) {
+		free(buf);
+		buf = NULL;
+		int ret = posix_memalign((void **) &buf, PAGE_SIZE, read_size);
+		if (ret != 0)
+			throw oom_exception("can't allocate memory for merging the graph");
+		buf_capacity = read_size;
+	}
+	data_loc_t loc(file_id, start);
+	io_request req(buf, loc, read_size, READ);
+	io->access(&req, 1);
+	io->wait4complete(1);
+	buf_off = start;
+	buf_size = read_size;
+}
+
+/*
+ * Merge the edges in `delta' with the vertex. Both neighbor lists are
+ * sorted, so the merged neighbor list is also sorted.
+ */
+const ext_mem_undirected_vertex &merge_vertex(const ext_mem_undirected_vertex &v,
+		const vertex_delta *delta, std::vector<char> &buf)
+{
+	size_t edge_data_size = v.get_edge_data_size();
+	size_t num_edges = v.get_num_edges() + (delta ? delta->neighs.size() : 0);
+	buf.resize(ext_mem_undirected_vertex::num_edges2vsize(num_edges,
+				edge_data_size));
+	memset(buf.data(), 0, buf.size());
+	ext_mem_undirected_vertex *new_v = new (buf.data())
+		ext_mem_undirected_vertex(v.get_id(), num_edges, edge_data_size);
+	size_t i = 0, j = 0;
+	for (size_t k = 0; k < num_edges; k++) {
+		const char *data;
+		if (delta == NULL || (i < v.get_num_edges() && j < delta->neighs.size()
+					&& v.get_neighbor(i) <= delta->neighs[j])
+				|| j == delta->neighs.size()) {
+			new_v->set_neighbor(k, v.get_neighbor(i));
+			data = v.get_raw_edge_data(i);
+			i++;
+		}
+		else {
+			new_v->set_neighbor(k, delta->neighs[j]);
+			data = delta->data.data() + j * edge_data_size;
+			j++;
+		}
+		if (edge_data_size > 0)
+			memcpy(new_v->get_raw_edge_data(k), data, edge_data_size);
+	}
+	return *new_v;
+}
+
+}
+
+bool merge_graph_delta(FG_graph::ptr graph, delta_snapshot::ptr delta,
+		const std::string &adj_file, const std::string &index_file)
+{
+	const graph_header &orig_header = graph->get_graph_header();
+	size_t num_vertices = orig_header.get_num_vertices();
+	graph_header header(orig_header.get_graph_type(), num_vertices,
+			orig_header.get_num_edges() + delta->get_num_edges(),
+			orig_header.get_edge_data_size(),
+			orig_header.get_max_num_timestamps());
+	bool compress = orig_header.has_compressed_edges();
+	if (compress)
+		header.set_edge_list_format(COMPRESSED_EDGE_LIST);
+
+	FILE *f = fopen(adj_file.c_str(), "w");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to open %1%: %2%")
+			% adj_file % strerror(errno);
+		return false;
+	}
+	BOOST_VERIFY(fwrite(&header, sizeof(header), 1, f));
+
+	vertex_index::ptr vindex = graph->get_index_data();
+	seq_vertex_reader reader(graph);
+	off_t off = sizeof(header);
+	std::vector<char> merge_buf;
+	std::vector<char> comp_buf;
+	bool succeed = true;
+	auto write_part = [&](const std::vector<off_t> &offs, edge_type type,
+			std::vector<off_t> &new_offs, std::vector<vsize_t> &num_edges) {
+		for (size_t i = 0; i < num_vertices && succeed; i++) {
+			const ext_mem_undirected_vertex &v = merge_vertex(
+					reader.read(offs[i], offs[i + 1] - offs[i]),
+					delta->get_delta(i, type), merge_buf);
+			size_t size;
+			if (compress) {
+				comp_buf.resize(ext_mem_compressed_vertex::get_max_size(
+							v.get_num_edges(), v.get_edge_data_size()));
+				size = ext_mem_compressed_vertex::compress(v, comp_buf.data(),
+						comp_buf.size());
+				succeed = fwrite(comp_buf.data(), size, 1, f) == 1;
+				num_edges.push_back(v.get_num_edges());
+			}
+			else {
+				size = v.get_size();
+				succeed = fwrite(merge_buf.data(), size, 1, f) == 1;
+			}
+			new_offs[i] = off;
+			off += size;
+		}
+		new_offs[num_vertices] = off;
+	};
+
+	std::vector<vsize_t> num_edges;
+	std::vector<off_t> out_offs(num_vertices + 1);
+	std::vector<off_t> new_out_offs(num_vertices + 1);
+	init_out_offs(vindex, out_offs);
+	if (header.is_directed_graph()) {
+		std::vector<off_t> in_offs(num_vertices + 1);
+		std::vector<off_t> new_in_offs(num_vertices + 1);
+		init_in_offs(vindex, in_offs);
+		write_part(in_offs, edge_type::IN_EDGE, new_in_offs, num_edges);
+		write_part(out_offs, edge_type::OUT_EDGE, new_out_offs, num_edges);
+		if (succeed) {
+			std::vector<directed_vertex_entry> entries(num_vertices + 1);
+			for (size_t i = 0; i <= num_vertices; i++)
+				entries[i] = directed_vertex_entry(new_in_offs[i],
+						new_out_offs[i]);
+			directed_vertex_index::dump(index_file, header, entries, num_edges);
+		}
+	}
+	else {
+		write_part(out_offs, edge_type::OUT_EDGE, new_out_offs, num_edges);
+		if (succeed) {
+			std::vector<vertex_offset> entries(num_vertices + 1);
+			for (size_t i = 0; i <= num_vertices; i++)
+				entries[i] = vertex_offset(new_out_offs[i]);
+			undirected_vertex_index::dump(index_file, header, entries,
+					num_edges);
+		}
+	}
+	if (fclose(f) != 0 || !succeed) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to write %1%: %2%")
+			% adj_file % strerror(errno);
+		return false;
+	}
+	return true;
+}
+
+void merged_byte_array::init(const page_byte_array &arr,
+		const vertex_delta &delta, size_t edge_data_size,
+		std::vector<char> &buf)
+{
+	ext_mem_undirected_vertex header = arr.get<ext_mem_undirected_vertex>(0);
+	size_t num_orig_edges = header.get_num_edges();
+	size_t num_edges = num_orig_edges + delta.neighs.size();
+	this->off = arr.get_offset();
+	this->size = ext_mem_undirected_vertex::num_edges2vsize(num_edges,
+			edge_data_size);
+	buf.resize(size);
+	ext_mem_undirected_vertex *v = new (buf.data()) ext_mem_undirected_vertex(
+			header.get_id(), num_edges, edge_data_size);
+
+	size_t header_size = ext_mem_undirected_vertex::get_header_size();
+	page_byte_array::seq_const_iterator<vertex_id_t> it
+		= arr.get_seq_iterator<vertex_id_t>(header_size,
+				header_size + num_orig_edges * sizeof(vertex_id_t));
+	off_t data_off = ext_mem_undirected_vertex::get_edge_data_offset(
+			num_orig_edges, edge_data_size);
+	size_t i = 0, j = 0;
+	for (size_t k = 0; k < num_edges; k++) {
+		if (i < num_orig_edges && (j == delta.neighs.size()
+					|| it.curr() <= delta.neighs[j])) {
+			// curr() moves the iterator to the next page if necessary.
+			v->set_neighbor(k, it.curr());
+			it.next();
+			if (edge_data_size > 0)
+				arr.memcpy(data_off + i * edge_data_size,
+						v->get_raw_edge_data(k), edge_data_size);
+			i++;
+		}
+		else {
+			v->set_neighbor(k, delta.neighs[j]);
+			if (edge_data_size > 0)
+				::memcpy(v->get_raw_edge_data(k),
+						delta.data.data() + j * edge_data_size, edge_data_size);
+			j++;
+		}
+	}
+	this->buf = buf.data();
+}
+
+}
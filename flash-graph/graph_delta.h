@@ -0,0 +1,313 @@
+#ifndef __GRAPH_DELTA_H__
+#define __GRAPH_DELTA_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+#include "thread.h"
+
+#include "vertex.h"
+#include "graph_file_header.h"
+#include "compressed_vertex.h"
+
+namespace fg
+{
+
+class FG_graph;
+class compaction_thread;
+
+/*
+ * The edges added to one edge list of a vertex after the graph image
+ * was built. The neighbors are sorted, and the edge data of the i-th
+ * neighbor is stored at `data[i * edge_data_size]'.
+ */
+struct vertex_delta
+{
+	std::vector<vertex_id_t> neighs;
+	std::vector<char> data;
+};
+
+/*
+ * An immutable view of the delta store at some point of time.
+ * The graph engine takes a snapshot when it starts to run an algorithm,
+ * so the algorithm sees the same graph in all iterations even if edges
+ * are added during the run.
+ */
+class delta_snapshot
+{
+	// The edge lists are shared by snapshots and are copied when new edges
+	// are added to them, so a new snapshot only copies the pointers.
+	typedef std::unordered_map<vertex_id_t,
+			std::shared_ptr<const vertex_delta> > delta_map_t;
+	// The new edges of the edge lists, in the order of being added.
+	typedef std::unordered_map<vertex_id_t, vertex_delta> delta_update_t;
+
+	bool directed;
+	size_t edge_data_size;
+	// The number of edges in the log covered by the snapshot.
+	size_t num_edges;
+	// An undirected graph only uses the out-edge map.
+	delta_map_t in_deltas;
+	delta_map_t out_deltas;
+
+	const delta_map_t &get_map(edge_type type) const {
+		return directed && type == edge_type::IN_EDGE ? in_deltas : out_deltas;
+	}
+
+	delta_snapshot(bool directed, size_t edge_data_size) {
+		this->directed = directed;
+		this->edge_data_size = edge_data_size;
+		this->num_edges = 0;
+	}
+
+	static void add_neighbor(delta_update_t &updates, vertex_id_t id,
+			vertex_id_t neigh, const char *data, size_t edge_data_size);
+	static void seal(delta_map_t &map, const delta_update_t &updates,
+			size_t edge_data_size);
+
+	friend class graph_delta;
+public:
+	typedef std::shared_ptr<const delta_snapshot> ptr;
+
+	size_t get_num_edges() const {
+		return num_edges;
+	}
+
+	size_t get_edge_data_size() const {
+		return edge_data_size;
+	}
+
+	bool is_directed() const {
+		return directed;
+	}
+
+	bool empty() const {
+		return num_edges == 0;
+	}
+
+	/*
+	 * Get the edges added to an edge list of a vertex. The edge type is
+	 * ignored in an undirected graph. It returns NULL if no edges are
+	 * added to the edge list.
+	 */
+	const vertex_delta *get_delta(vertex_id_t id, edge_type type) const {
+		const delta_map_t &map = get_map(type);
+		delta_map_t::const_iterator it = map.find(id);
+		if (it == map.end())
+			return NULL;
+		else
+			return it->second.get();
+	}
+
+	vsize_t get_num_edges(vertex_id_t id, edge_type type) const {
+		if (empty())
+			return 0;
+		if (directed && type == edge_type::BOTH_EDGES)
+			return get_num_edges(id, edge_type::IN_EDGE)
+				+ get_num_edges(id, edge_type::OUT_EDGE);
+		const vertex_delta *delta = get_delta(id, type);
+		return delta ? delta->neighs.size() : 0;
+	}
+};
+
+/*
+ * This is a mutable layer on top of an immutable FlashGraph image.
+ * New edges are appended to a log file and kept in memory. The graph
+ * engine merges them with the edge lists read from SSDs, so the graph
+ * algorithms see the updated graph. A compaction merges the edges into
+ * a new graph image in the background.
+ *
+ * The log file starts with a header and each record has the source vertex,
+ * the destination vertex and the edge data. A partially written record
+ * at the end of the log is ignored when the log is replayed.
+ */
+class graph_delta
+{
+	struct log_header
+	{
+		uint64_t magic;
+		uint32_t edge_data_size;
+		uint32_t directed;
+	};
+	static const uint64_t LOG_MAGIC = 0x4647444c544131ULL;
+
+	struct delta_edge
+	{
+		vertex_id_t src;
+		vertex_id_t dst;
+		size_t data_off;
+	};
+
+	bool directed;
+	size_t num_vertices;
+	size_t edge_data_size;
+	std::string log_file;
+	FILE *log;
+
+	std::mutex lock;
+	// The edges added after the latest snapshot was taken.
+	std::vector<delta_edge> pending;
+	std::vector<char> pending_data;
+	delta_snapshot::ptr snapshot;
+
+	// The state of the compaction in the background.
+	compaction_thread *compact_thread;
+	std::shared_ptr<FG_graph> compact_graph;
+	delta_snapshot::ptr compact_snapshot;
+	std::string compact_adj_file;
+	std::string compact_index_file;
+	bool compact_succeed;
+
+	graph_delta(const graph_header &header, const std::string &log_file);
+
+	bool replay();
+	bool write_log(FILE *f, const std::vector<delta_edge> &edges,
+			const char *data) const;
+	void add_edge_locked(vertex_id_t src, vertex_id_t dst, const char *data);
+	void run_compaction();
+
+	friend class compaction_thread;
+public:
+	typedef std::shared_ptr<graph_delta> ptr;
+
+	/*
+	 * Create the delta store of a graph. If the log file exists, the edges
+	 * in the log are loaded to memory; otherwise, a new log is created.
+	 */
+	static ptr create(const graph_header &header, const std::string &log_file);
+
+	~graph_delta();
+
+	/*
+	 * Add an edge to the graph. The source and the destination have to
+	 * be vertices of the graph image. `data' points to the edge data if
+	 * the graph has edge data. Edges are durable after flush() is called.
+	 */
+	bool add_edge(vertex_id_t src, vertex_id_t dst, const void *data = NULL);
+	bool add_edges(const std::vector<std::pair<vertex_id_t, vertex_id_t> > &edges,
+			const char *data = NULL);
+	bool flush();
+
+	/*
+	 * Get a snapshot that contains all edges added so far.
+	 */
+	delta_snapshot::ptr get_snapshot();
+
+	/*
+	 * The number of edges added to the graph.
+	 */
+	size_t get_num_edges();
+
+	const std::string &get_log_file() const {
+		return log_file;
+	}
+
+	/*
+	 * Merge the edges added so far with the graph image and write a new
+	 * graph image in the background. The edges added during the compaction
+	 * stay in the delta store.
+	 */
+	bool start_compaction(std::shared_ptr<FG_graph> graph,
+			const std::string &adj_file, const std::string &index_file);
+
+	/*
+	 * Wait for the compaction to complete, and switch to the new graph image.
+	 * The merged edges are removed from the delta store and the log file,
+	 * and the delta store is attached to the new graph, which is returned.
+	 * The old graph shouldn't be used to run new algorithms afterwards.
+	 */
+	std::shared_ptr<FG_graph> finish_compaction();
+};
+
+/*
+ * Write a new graph image, in which the edges in `delta' are merged with
+ * the edge lists of `graph'. The edge lists keep the format (compressed
+ * or not) of the original graph image.
+ */
+bool merge_graph_delta(std::shared_ptr<FG_graph> graph,
+		delta_snapshot::ptr delta, const std::string &adj_file,
+		const std::string &index_file);
+
+/*
+ * This byte array contains a vertex whose edge list is merged with the
+ * edges in the delta store. Like decompressed_byte_array, it reports
+ * the offset of the original byte array.
+ */
+class merged_byte_array: public safs::page_byte_array
+{
+	off_t off;
+	size_t size;
+	const char *buf;
+public:
+	merged_byte_array() {
+		off = 0;
+		size = 0;
+		buf = NULL;
+	}
+
+	/*
+	 * Merge the vertex in `arr' with `delta'. The vertex in `arr' has to
+	 * be in the format of ext_mem_undirected_vertex. The merged vertex is
+	 * stored in `buf'.
+	 */
+	void init(const safs::page_byte_array &arr, const vertex_delta &delta,
+			size_t edge_data_size, std::vector<char> &buf);
+
+	virtual void lock() {
+	}
+
+	virtual void unlock() {
+	}
+
+	virtual size_t get_size() const {
+		return size;
+	}
+
+	/*
+	 * The merged vertex is copied, because `buf' is reused for other
+	 * vertices. The clone is freed by page_byte_array::destroy().
+	 */
+	virtual page_byte_array *clone() {
+		return new copied_byte_array(off, buf, size);
+	}
+
+	virtual off_t get_offset() const {
+		return off;
+	}
+
+	virtual off_t get_offset_in_first_page() const {
+		return 0;
+	}
+
+	virtual const char *get_page(int idx) const {
+		return buf + ((size_t) idx) * safs::PAGE_SIZE;
+	}
+};
+
+}
+
+#endif
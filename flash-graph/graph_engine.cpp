@@ -28,6 +28,8 @@
 #include "graph_engine.h"
 #include "messaging.h"
 #include "worker_thread.h"
+#include "load_balancer.h"
+#include "message_processor.h"
 #include "vertex_compute.h"
 #include "vertex_request.h"
 #include "vertex_index_reader.h"
@@ -214,6 +216,11 @@ bool request_self(vertex_id_t ids[], size_t num, vertex_id_t self)
 
 bool request_self(directed_vertex_request reqs[], size_t num, vertex_id_t self)
 {
+	// Only the vertex compute can read a range of edges.
+	for (size_t i = 0; i < num; i++) {
+		if (reqs[i].has_range())
+			return false;
+	}
 	if (num == 1)
 		return reqs[0].get_id() == self;
 	// If there are two requests, we should make sure that they request
@@ -282,10 +289,38 @@ void compute_directed_vertex::request_partial_vertices(
 	}
 }
 
+/*
+ * The edge list is split evenly among all vertical partitions, and each
+ * vertical partition gets a multiple of the edges in a page.
+ */
+static void get_vpart_edge_range(int part_id, vsize_t num_edges,
+		vsize_t &start, vsize_t &end)
+{
+	const size_t edges_per_page = PAGE_SIZE / sizeof(vertex_id_t);
+	worker_thread *curr = (worker_thread *) thread::get_curr_thread();
+	size_t num_parts = curr->get_graph().get_num_vparts();
+	size_t part_size = ROUNDUP((num_edges + num_parts - 1) / num_parts,
+			edges_per_page);
+	start = std::min(part_size * part_id, (size_t) num_edges);
+	end = std::min(part_size * (part_id + 1), (size_t) num_edges);
+}
+
+void part_compute_vertex::get_edge_range(vsize_t num_edges, vsize_t &start,
+		vsize_t &end) const
+{
+	get_vpart_edge_range(part_id, num_edges, start, end);
+}
+
+void part_compute_directed_vertex::get_edge_range(vsize_t num_edges,
+		vsize_t &start, vsize_t &end) const
+{
+	get_vpart_edge_range(part_id, num_edges, start, end);
+}
+
 void part_compute_vertex::broadcast_vpart(const vertex_message &msg)
 {
 	worker_thread *curr = (worker_thread *) thread::get_curr_thread();
-	std::vector<compute_vertex_pointer> ps(graph_conf.get_num_vparts());
+	std::vector<compute_vertex_pointer> ps(curr->get_graph().get_num_vparts());
 	vertex_id_t id = curr->get_vertex_program(true).get_vertex_id(*this);
 	int ret = curr->get_graph().get_graph_index().get_vpart_vertices(id,
 			ps.data(), ps.size());
@@ -385,14 +420,16 @@ bool vpart_index_compute::run(vertex_id_t start_vid, index_iterator &it)
 	vertex_id_t vid = start_vid;
 	while (it.has_next()) {
 		if (graph.is_directed()) {
-			vsize_t num_edges = graph.cal_num_edges(it.get_curr_size())
-				+ graph.cal_num_edges(it.get_curr_out_size());
-			if (num_edges >= (vsize_t) graph_conf.get_min_vpart_degree())
+			vsize_t num_edges = graph.cal_num_edges(vid, it.get_curr_size(),
+					edge_type::IN_EDGE) + graph.cal_num_edges(vid,
+					it.get_curr_out_size(), edge_type::OUT_EDGE);
+			if (num_edges >= (vsize_t) graph.get_min_vpart_degree())
 				large_degree_ids->push_back(vid);
 		}
 		else {
-			vsize_t num_edges = graph.cal_num_edges(it.get_curr_size());
-			if (num_edges >= (vsize_t) graph_conf.get_min_vpart_degree())
+			vsize_t num_edges = graph.cal_num_edges(vid, it.get_curr_size(),
+					edge_type::IN_EDGE);
+			if (num_edges >= (vsize_t) graph.get_min_vpart_degree())
 				large_degree_ids->push_back(vid);
 		}
 
@@ -535,10 +572,32 @@ void init_vpart_thread::run()
 	}
 	while (index_reader->get_num_pending_tasks() > 0)
 		index_reader->wait4complete(1);
-	index->init_vparts(hpart_id, graph_conf.get_num_vparts(), large_degree_ids);
+	index->init_vparts(hpart_id, graph.get_num_vparts(), large_degree_ids);
 	this->stop();
 }
 
+/*
+ * This gets the number of edges of a vertex stored in the graph file.
+ * A directed vertex has both in-edges and out-edges.
+ */
+class file_degree_func
+{
+	const in_mem_query_vertex_index &vindex;
+	bool directed;
+public:
+	file_degree_func(const in_mem_query_vertex_index &_vindex,
+			bool directed): vindex(_vindex) {
+		this->directed = directed;
+	}
+
+	size_t operator()(vertex_id_t id) const {
+		size_t degree = vindex.get_num_edges(id, edge_type::IN_EDGE);
+		if (directed)
+			degree += vindex.get_num_edges(id, edge_type::OUT_EDGE);
+		return degree;
+	}
+};
+
 }
 
 void graph_engine::init(graph_index::ptr index)
@@ -547,10 +606,16 @@ void graph_engine::init(graph_index::ptr index)
 	this->num_nodes = params.get_num_nodes();
 
 	// Construct the vertex states.
-	index->init(num_threads, num_nodes);
+	index->init(num_threads, num_nodes, create_partitioner(num_threads));
+	// Computing the statistics scans the degrees of all vertices, so we
+	// only do it to show how well the edge-balanced partitioning works.
+	if (graph_conf.use_edge_balanced_part())
+		print_part_stats(*index);
 
 	max_processing_vertices = graph_conf.get_max_processing_vertices();
 	is_complete = false;
+	async = false;
+	async_complete = false;
 	this->vertices = index;
 
 	pthread_mutex_init(&lock, NULL);
@@ -576,8 +641,14 @@ void graph_engine::init(graph_index::ptr index)
 		preload_graph();
 #endif
 
-	// If we need to perform vertical partitioning on the graph.
-	if (graph_conf.get_num_vparts() > 1) {
+	num_vparts = graph_conf.get_num_vparts();
+	min_vpart_degree = graph_conf.get_min_vpart_degree();
+	if (graph_conf.use_auto_vparts())
+		choose_vparts(*index);
+	// If we need to perform vertical partitioning on the graph or
+	// to schedule the large vertices first.
+	if (num_vparts > 1
+			|| min_vpart_degree < std::numeric_limits<int>::max()) {
 		std::vector<init_vpart_thread *> threads(num_threads);
 		for (int i = 0; i < num_threads; i++) {
 			threads[i] = new init_vpart_thread(index, *this, i, i % num_nodes);
@@ -590,6 +661,113 @@ void graph_engine::init(graph_index::ptr index)
 	}
 }
 
+graph_partitioner::ptr graph_engine::create_partitioner(int num_threads) const
+{
+	if (!graph_conf.use_edge_balanced_part())
+		return graph_partitioner::ptr(new range_graph_partitioner(num_threads));
+
+	return graph_partitioner::ptr(new edge_balanced_graph_partitioner(
+				num_threads, num_nodes, header.get_num_vertices(),
+				file_degree_func(*vindex, is_directed())));
+}
+
+/*
+ * Report the number of vertices and edges owned by each thread, so users
+ * can see how well the partitioning balances the work.
+ */
+void graph_engine::print_part_stats(const graph_index &index) const
+{
+	const graph_partitioner &partitioner = index.get_partitioner();
+	int num_parts = partitioner.get_num_partitions();
+	std::vector<size_t> num_edges(num_parts);
+	file_degree_func get_degree(*vindex, is_directed());
+	for (vertex_id_t id = 0; id < header.get_num_vertices(); id++)
+		num_edges[partitioner.map(id)] += get_degree(id);
+
+	size_t tot_edges = 0;
+	size_t max_edges = 0;
+	for (int i = 0; i < num_parts; i++) {
+		BOOST_LOG_TRIVIAL(info) << boost::format(
+				"thread %1% on node %2% owns %3% vertices and %4% edges")
+			% i % (i % num_nodes)
+			% partitioner.get_part_size(i, header.get_num_vertices())
+			% num_edges[i];
+		tot_edges += num_edges[i];
+		max_edges = std::max(max_edges, num_edges[i]);
+	}
+	if (tot_edges > 0)
+		BOOST_LOG_TRIVIAL(info) << boost::format(
+				"the max number of edges in a thread is %1% of the average")
+			% ((double) max_edges * num_parts / tot_edges);
+}
+
+/*
+ * A vertex whose edge list is a large fraction of the edges processed by
+ * a thread in a level serializes the tail of the level. We choose
+ * the min degree of vertical partitioning from the degree distribution,
+ * and split the largest vertex into partitions of about the min degree,
+ * up to the number of threads. If the graph algorithm doesn't define
+ * vertices for vertical partitions, the large vertices aren't split but
+ * are scheduled before the other vertices in a level.
+ */
+void graph_engine::choose_vparts(const graph_index &index)
+{
+	// A vertex is large if it has more edges than a thread processes
+	// in a level divided by this value.
+	static const size_t VPART_LOAD_FRAC = 4;
+	// A vertical partition has at least this number of pages of edges.
+	static const size_t MIN_VPART_PAGES = 2;
+
+	int num_threads = graph_conf.get_num_threads();
+	num_vparts = 1;
+	min_vpart_degree = std::numeric_limits<int>::max();
+	if (num_threads <= 1)
+		return;
+
+	// Only the vertices with at least this number of edges can be large.
+	size_t min_part_size = MIN_VPART_PAGES * PAGE_SIZE / sizeof(vertex_id_t);
+	size_t tot_degree = 0;
+	size_t max_degree = 0;
+	std::vector<size_t> large_degrees;
+	file_degree_func get_degree(*vindex, is_directed());
+	for (vertex_id_t id = 0; id < header.get_num_vertices(); id++) {
+		size_t degree = get_degree(id);
+		tot_degree += degree;
+		max_degree = std::max(max_degree, degree);
+		if (degree >= min_part_size)
+			large_degrees.push_back(degree);
+	}
+	size_t min_degree = std::max(min_part_size,
+			tot_degree / (num_threads * VPART_LOAD_FRAC));
+	min_degree = std::min(min_degree,
+			(size_t) std::numeric_limits<int>::max());
+	if (max_degree < min_degree)
+		return;
+
+	size_t num_large = 0;
+	BOOST_FOREACH(size_t degree, large_degrees) {
+		if (degree >= min_degree)
+			num_large++;
+	}
+	if (!index.has_part_vertices()) {
+		min_vpart_degree = min_degree;
+		BOOST_LOG_TRIVIAL(info) << boost::format(
+				"%1% vertices with at least %2% edges are scheduled first")
+			% num_large % min_degree;
+		return;
+	}
+
+	size_t num_parts = std::min((size_t) num_threads,
+			(max_degree + min_degree - 1) / min_degree);
+	if (num_parts < 2)
+		return;
+	num_vparts = num_parts;
+	min_vpart_degree = min_degree;
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"%1% vertices with at least %2% edges are split into %3% vertical partitions")
+		% num_large % min_degree % num_parts;
+}
+
 graph_engine::graph_engine(FG_graph &graph, graph_index::ptr index)
 {
 	struct timeval init_start, init_end;
@@ -597,11 +775,15 @@ graph_engine::graph_engine(FG_graph &graph, graph_index::ptr index)
 
 	// Init graph data.
 	graph_factory = graph.get_graph_io_factory(GLOBAL_CACHE_ACCESS);
-	// Construct the in-memory compressed vertex index.
+	// Construct the in-memory compressed vertex index. The index isn't
+	// compressed if the edge lists are compressed.
 	vindex = in_mem_query_vertex_index::create(graph.get_index_data(), true);
 
 	header = graph.get_graph_header();
 	header.verify();
+	delta = graph.get_delta();
+	if (delta)
+		curr_delta = delta->get_snapshot();
 	out_part_off = 0;
 	if (header.is_directed_graph()) {
 		assert(sizeof(vertex_index) == sizeof(header));
@@ -632,6 +814,10 @@ static inline int get_node_id(int thread_idx, int num_nodes)
 
 void graph_engine::init_threads(vertex_program_creater::ptr creater)
 {
+	// All iterations of an algorithm see the same graph.
+	if (delta)
+		curr_delta = delta->get_snapshot();
+	async_complete = false;
 	std::vector<std::shared_ptr<slab_allocator> > msg_allocs(num_nodes);
 	std::vector<std::shared_ptr<slab_allocator> > flush_msg_allocs(num_nodes);
 	// It turns out that it's important to respect the NUMA effect here.
@@ -737,8 +923,10 @@ bool graph_engine::progress_first_level()
 	// If all threads have reached here.
 	if (num_threads.inc(1) == get_num_threads()) {
 		assert(num_remaining_vertices_in_level.get() == 0);
-		num_remaining_vertices_in_level = atomic_number<size_t>(
-				tot_num_activates.get());
+		// There are no levels in the asynchronous mode.
+		if (!async)
+			num_remaining_vertices_in_level = atomic_number<size_t>(
+					tot_num_activates.get());
 		// If there aren't more activated vertices.
 		is_complete = tot_num_activates.get() == 0;
 		tot_num_activates = 0;
@@ -778,6 +966,40 @@ bool graph_engine::progress_next_level()
 				% (level.get() - 1) % time_diff(iter_start, curr)
 				% tot_num_activates.get() % level.get();
 		iter_start = curr;
+		// All threads have flushed their messages in this level.
+		size_t num_sent = 0;
+		size_t num_combined = 0;
+		for (size_t i = 0; i < vprograms.size(); i++) {
+			size_t sent, combined;
+			vprograms[i]->get_combine_stats(sent, combined);
+			vprograms[i]->reset_combine_stats();
+			num_sent += sent;
+			num_combined += combined;
+		}
+		if (num_sent > 0)
+			BOOST_LOG_TRIVIAL(info)
+				<< boost::format("Iter %1%: %2% messages are sent and %3% of them are combined")
+				% (level.get() - 1) % num_sent % num_combined;
+		// All threads have finished stealing vertices in this level.
+		size_t num_steals = 0;
+		size_t num_stolen = 0;
+		size_t num_remote_stolen = 0;
+		size_t num_returned = 0;
+		for (int i = 0; i < get_num_threads(); i++) {
+			size_t steals, stolen, remote_stolen, returned;
+			load_balancer &balancer = worker_threads[i]->get_load_balancer();
+			balancer.get_stats(steals, stolen, remote_stolen, returned);
+			balancer.reset_stats();
+			num_steals += steals;
+			num_stolen += stolen;
+			num_remote_stolen += remote_stolen;
+			num_returned += returned;
+		}
+		if (num_steals > 0)
+			BOOST_LOG_TRIVIAL(info)
+				<< boost::format("Iter %1%: %2% vertices (%3% from other NUMA nodes) are stolen in %4% steals and %5% are returned")
+				% (level.get() - 1) % num_stolen % num_remote_stolen
+				% num_steals % num_returned;
 		assert(num_remaining_vertices_in_level.get() == 0);
 		num_remaining_vertices_in_level = atomic_number<size_t>(
 				tot_num_activates.get());
@@ -798,8 +1020,11 @@ bool graph_engine::progress_next_level()
 
 void graph_engine::wait4complete()
 {
-	for (unsigned i = 0; i < worker_threads.size(); i++) {
+	for (unsigned i = 0; i < worker_threads.size(); i++)
 		worker_threads[i]->join();
+	// In the asynchronous mode, a thread may still be checking other threads
+	// after they stop, so we can only delete the threads after all stop.
+	for (unsigned i = 0; i < worker_threads.size(); i++) {
 		delete worker_threads[i];
 		worker_threads[i] = NULL;
 	}
@@ -815,6 +1040,78 @@ void graph_engine::set_vertex_scheduler(vertex_scheduler::ptr scheduler)
 	this->scheduler = scheduler;
 }
 
+void graph_engine::set_async(bool async, vertex_priority::ptr priority)
+{
+	if (async && num_vparts > 1) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "The asynchronous mode doesn't support vertical partitioning";
+		return;
+	}
+	this->async = async;
+	this->priority = priority;
+}
+
+/*
+ * The state of a worker thread that the termination detection needs.
+ */
+struct async_thread_state
+{
+	bool idle;
+	bool has_vertices;
+	size_t num_wakeups;
+
+	bool operator==(const async_thread_state &state) const {
+		return idle == state.idle && has_vertices == state.has_vertices
+			&& num_wakeups == state.num_wakeups;
+	}
+};
+
+/*
+ * We can't get the state of all threads atomically, so we scan the state
+ * of all threads twice. A thread increases its wakeup count whenever it
+ * leaves the idle state, so if all threads are idle in both scans and
+ * nothing changes between the two scans, all threads have been idle
+ * since the first scan. No thread can be woken up afterwards if the number
+ * of messages added to the message queues is the same as the number of
+ * messages fetched from them.
+ */
+bool graph_engine::check_async_complete()
+{
+	if (async_complete.load())
+		return true;
+
+	std::vector<async_thread_state> states[2];
+	size_t num_added[2];
+	size_t num_fetched[2];
+	for (int i = 0; i < 2; i++) {
+		states[i].resize(worker_threads.size());
+		for (size_t j = 0; j < worker_threads.size(); j++) {
+			worker_thread *t = worker_threads[j];
+			states[i][j].idle = t->is_async_idle();
+			// A busy thread will check the termination later.
+			if (!states[i][j].idle)
+				return false;
+			states[i][j].num_wakeups = t->get_num_wakeups();
+			states[i][j].has_vertices = t->get_activates() > 0;
+			if (states[i][j].has_vertices)
+				return false;
+		}
+		num_added[i] = 0;
+		num_fetched[i] = 0;
+		for (size_t j = 0; j < worker_threads.size(); j++) {
+			msg_queue &q = worker_threads[j]->get_msg_processor().get_msg_queue();
+			num_fetched[i] += q.get_num_fetched();
+			num_added[i] += q.get_num_added();
+		}
+		if (num_added[i] != num_fetched[i])
+			return false;
+	}
+	if (states[0] != states[1] || num_added[0] != num_added[1])
+		return false;
+	async_complete = true;
+	return true;
+}
+
 #if 0
 void graph_engine::preload_graph()
 {
@@ -31,6 +31,7 @@
 #include "graph_config.h"
 #include "vertex_request.h"
 #include "vertex_program.h"
+#include "graph_delta.h"
 
 namespace safs
 {
@@ -132,6 +133,17 @@ public:
 
 	void request_vertices(vertex_id_t ids[], size_t num);
 
+	/**
+	 * \brief Get the range of edges this vertical partition processes.
+	 *        The edge list is split among the vertical partitions in
+	 *        page-sized blocks of edges, so different vertical partitions
+	 *        don't access the same pages of the edge list.
+	 * \param num_edges The number of edges of the vertex.
+	 * \param start The first edge in the range.
+	 * \param end The end of the range (excluded).
+	 */
+	void get_edge_range(vsize_t num_edges, vsize_t &start, vsize_t &end) const;
+
 	void broadcast_vpart(const vertex_message &msg);
 
 	void run_on_message(vertex_program &vprog, const vertex_message &msg) {
@@ -226,6 +238,13 @@ public:
 	void request_vertices(vertex_id_t ids[], size_t num);
 	void request_partial_vertices(directed_vertex_request reqs[], size_t num);
 
+	/**
+	 * \brief Get the range of edges this vertical partition processes.
+	 *        It's the same as part_compute_vertex::get_edge_range().
+	 *        The range can be read with a ranged directed_vertex_request.
+	 */
+	void get_edge_range(vsize_t num_edges, vsize_t &start, vsize_t &end) const;
+
 	void run_on_message(vertex_program &vprog, const vertex_message &msg) {
 		throw unsupported_exception("run_on_message");
 	}
@@ -250,6 +269,26 @@ public:
 			std::vector<compute_vertex_pointer> &vertices) = 0;
 };
 
+/**
+ * \brief This decides the order of processing active vertices in
+ *        the asynchronous mode.
+ */
+class vertex_priority
+{
+public:
+	typedef std::shared_ptr<vertex_priority> ptr; /** Smart pointer for object access.*/
+
+	/**
+	 * \brief Get the priority of an active vertex. It's called when
+	 *        the vertex is activated, and a vertex with a smaller value
+	 *        is processed first.
+	 *  \param prog The vertex program of the thread that owns the vertex.
+	 *  \param v The activated vertex.
+	 */
+	virtual float get_priority(vertex_program &prog,
+			const compute_vertex &v) const = 0;
+};
+
 /**
  * \brief When the graph engine starts, a user can use this filter to decide
  * what vertices are activated for the first time.
@@ -341,6 +380,15 @@ class graph_engine
 	in_mem_query_vertex_index::ptr vindex;
 	std::shared_ptr<in_mem_graph> graph_data;
 	vertex_scheduler::ptr scheduler;
+	// In the asynchronous mode, there are no levels and the activated
+	// vertices are processed in the order of their priorities.
+	bool async;
+	vertex_priority::ptr priority;
+	std::atomic<bool> async_complete;
+	// The edges added to the graph image. The engine takes a snapshot
+	// of the delta store whenever it starts to run an algorithm.
+	graph_delta::ptr delta;
+	delta_snapshot::ptr curr_delta;
 
 	// The number of activated vertices that haven't been processed
 	// in the current level.
@@ -360,11 +408,18 @@ class graph_engine
 	trace_logger::ptr logger;
 	std::shared_ptr<safs::file_io_factory> graph_factory;
 	int max_processing_vertices;
+	// The vertical partitioning used by this engine. It comes from
+	// the configuration or is chosen from the degree distribution.
+	int num_vparts;
+	int min_vpart_degree;
 
 	// The time when the current iteration starts.
 	struct timeval start_time, iter_start;
 
 	void init_threads(vertex_program_creater::ptr creater);
+	graph_partitioner::ptr create_partitioner(int num_threads) const;
+	void print_part_stats(const graph_index &index) const;
+	void choose_vparts(const graph_index &index);
 protected:
 	graph_engine(FG_graph &graph, graph_index::ptr index);
 	void init(graph_index::ptr index);
@@ -470,6 +525,32 @@ public:
      * \param scheduler The user-defined vertex scheduler.
      */
 	void set_vertex_scheduler(vertex_scheduler::ptr scheduler);
+
+	/**
+	 * \brief Run algorithms in the asynchronous mode or in the default
+	 *        level-synchronous mode. In the asynchronous mode, there are
+	 *        no levels or barriers. A vertex activated by a message is put
+	 *        in the priority queue of its owner thread immediately and can be
+	 *        processed while other vertices are still being processed.
+	 *        Idle threads steal vertices from other threads, and the engine
+	 *        stops when all threads are idle and no messages are in flight.
+	 *        The level is always 0, and the notification of the end of
+	 *        an iteration and vertical partitioning aren't supported.
+	 * \param async Whether to run in the asynchronous mode.
+	 * \param priority Decides the order of processing active vertices.
+	 *        If it isn't provided, active vertices are processed in
+	 *        an arbitrary order.
+	 */
+	void set_async(bool async,
+			vertex_priority::ptr priority = vertex_priority::ptr());
+
+	bool is_async() const {
+		return async;
+	}
+
+	vertex_priority::ptr get_vertex_priority() const {
+		return priority;
+	}
     
     /**
      * \brief Start the graph engine and begin computation on a subset of vertices.
@@ -560,7 +641,10 @@ public:
 
 	vsize_t get_num_edges(vertex_id_t id,
 			edge_type type = edge_type::BOTH_EDGES) const {
-		return vindex->get_num_edges(id, type);
+		vsize_t num_edges = vindex->get_num_edges(id, type);
+		if (curr_delta)
+			num_edges += curr_delta->get_num_edges(id, type);
+		return num_edges;
 	}
 
 	/**
@@ -574,6 +658,17 @@ public:
 	 */
 	bool progress_next_level();
 	bool progress_first_level();
+
+	/**
+	 * \internal
+	 * In the asynchronous mode, an idle thread checks whether all threads
+	 * are idle and all messages have been processed. It returns true if
+	 * the algorithm has completed.
+	 */
+	bool check_async_complete();
+	bool is_async_complete() const {
+		return async_complete.load();
+	}
     
     /** \internal*/
 	trace_logger::ptr get_logger() const {
@@ -596,6 +691,16 @@ public:
 		return worker_threads.size();
 	}
     
+    /**\internal */
+	int get_num_vparts() const {
+		return num_vparts;
+	}
+
+    /**\internal */
+	int get_min_vpart_degree() const {
+		return min_vpart_degree;
+	}
+    
     /**\internal */
 	worker_thread *get_thread(int idx) const {
 		return worker_threads[idx];
@@ -643,9 +748,37 @@ public:
 		return out_part_off;
 	}
 
-	vsize_t cal_num_edges(vsize_t vertex_size) const {
-		return ext_mem_undirected_vertex::vsize2num_edges(vertex_size,
-				header.get_edge_data_size());
+	bool has_compressed_edges() const {
+		return header.has_compressed_edges();
+	}
+
+	/*
+	 * The snapshot of the delta store used by the current run.
+	 * It returns NULL if no edges have been added to the graph image.
+	 */
+	const delta_snapshot *get_delta_snapshot() const {
+		if (curr_delta == NULL || curr_delta->empty())
+			return NULL;
+		return curr_delta.get();
+	}
+
+	/*
+	 * Compute the number of edges of a vertex from its size in the adjacency
+	 * list file. When the edge lists are compressed, the number of edges is
+	 * stored in the vertex index instead. The edges in the delta store
+	 * are included.
+	 */
+	vsize_t cal_num_edges(vertex_id_t id, vsize_t vertex_size,
+			edge_type type) const {
+		vsize_t num_edges;
+		if (header.has_compressed_edges())
+			num_edges = vindex->get_num_edges(id, type);
+		else
+			num_edges = ext_mem_undirected_vertex::vsize2num_edges(vertex_size,
+					header.get_edge_data_size());
+		if (curr_delta)
+			num_edges += curr_delta->get_num_edges(id, type);
+		return num_edges;
 	}
 };
 
@@ -30,7 +30,10 @@ namespace fg
 {
 
 const int64_t MAGIC_NUMBER = 0x123456789ABCDEFL;
-const int CURR_VERSION = 4;
+const int CURR_VERSION = 5;
+// The oldest version we can still read. A version 4 graph has the same
+// layout as version 5, but its edge lists are never compressed.
+const int MIN_VERSION = 4;
 
 enum graph_type {
 	DIRECTED,
@@ -39,11 +42,25 @@ enum graph_type {
 	TS_UNDIRECTED,
 };
 
+/*
+ * The format of the edge lists in the adjacency list file.
+ */
+enum edge_list_format {
+	// The neighbors are stored as an array of vertex IDs.
+	RAW_EDGE_LIST,
+	// The neighbors are delta encoded and stored with the StreamVByte format.
+	// See ext_mem_compressed_vertex.
+	COMPRESSED_EDGE_LIST,
+};
+
 struct graph_header_struct
 {
 	int64_t magic_number;
 	int version_number;
-	graph_type type;
+	// A version 4 graph stores the graph type in 4 bytes. The upper half
+	// is always 0, which means a version 4 graph has raw edge lists.
+	uint16_t type;
+	uint16_t edge_format;
 	size_t num_vertices;
 	size_t num_edges;
 	int edge_data_size;
@@ -73,6 +90,7 @@ public:
 		data.magic_number = MAGIC_NUMBER;
 		data.version_number = CURR_VERSION;
 		data.type = DIRECTED;
+		data.edge_format = RAW_EDGE_LIST;
 		data.num_vertices = 0;
 		data.num_edges = 0;
 		data.edge_data_size = 0;
@@ -92,6 +110,7 @@ public:
 		h.data.magic_number = MAGIC_NUMBER;
 		h.data.version_number = CURR_VERSION;
 		h.data.type = type;
+		h.data.edge_format = RAW_EDGE_LIST;
 		h.data.num_vertices = num_vertices;
 		h.data.num_edges = num_edges;
 		h.data.edge_data_size = edge_data_size;
@@ -103,7 +122,8 @@ public:
 	}
 
 	bool is_right_version() const {
-		return h.data.version_number == CURR_VERSION;
+		return h.data.version_number >= MIN_VERSION
+			&& h.data.version_number <= CURR_VERSION;
 	}
 
 	bool is_directed_graph() const {
@@ -112,7 +132,19 @@ public:
 	}
 
 	graph_type get_graph_type() const {
-		return h.data.type;
+		return (graph_type) h.data.type;
+	}
+
+	edge_list_format get_edge_list_format() const {
+		return (edge_list_format) h.data.edge_format;
+	}
+
+	bool has_compressed_edges() const {
+		return h.data.edge_format == COMPRESSED_EDGE_LIST;
+	}
+
+	void set_edge_list_format(edge_list_format format) {
+		h.data.edge_format = format;
 	}
 
 	size_t get_num_vertices() const {
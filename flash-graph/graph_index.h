@@ -21,6 +21,7 @@
  */
 
 #include <algorithm>
+#include <type_traits>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
 
@@ -38,6 +39,7 @@ namespace fg
 
 class compute_vertex;
 class part_compute_vertex;
+class empty_part_compute_vertex;
 
 /*
  * A pointer to the vertically partitioned vertices in the graph index.
@@ -86,7 +88,8 @@ public:
 	virtual ~graph_index() {
 	}
 
-	virtual void init(int num_threads, int num_nodes) {
+	virtual void init(int num_threads, int num_nodes,
+			graph_partitioner::ptr partitioner) {
 	}
 	virtual void init_vparts(int hpart_id, int num_vparts,
 			std::vector<vertex_id_t> &ids) = 0;
@@ -120,12 +123,23 @@ public:
 
 	virtual vertex_program::ptr create_def_vertex_program() const = 0;
 	virtual vertex_program::ptr create_def_part_vertex_program() const = 0;
+	/*
+	 * Indicate whether the graph algorithm defines its own vertices for
+	 * vertical partitions.
+	 */
+	virtual bool has_part_vertices() const = 0;
 
 	virtual local_vid_t get_local_id(int part_id, const compute_vertex &v) const = 0;
 	virtual vertex_id_t get_vertex_id(int part_id, const compute_vertex &v) const = 0;
 	virtual vertex_id_t get_vertex_id(int part_id, compute_vertex_pointer v) const = 0;
 	virtual vertex_id_t get_vertex_id(const compute_vertex &v) const = 0;
 	virtual bool belong2part(const compute_vertex &v, int part_id) const = 0;
+	/*
+	 * Get the partition that owns the compute vertex. The owner is found
+	 * from the address of the vertex, so there is no need to record
+	 * the owner of a vertex when it's moved to another thread.
+	 */
+	virtual int get_part_id(const compute_vertex &v) const = 0;
 };
 
 template<class vertex_type, class part_vertex_type>
@@ -197,14 +211,15 @@ public:
 
 	/*
 	 * This method is to initialize the vertical partitions inside
-	 * the horizontal partition.
+	 * the horizontal partition. With a single vertical partition,
+	 * the vertices are only recorded so that they are scheduled first.
 	 */
 	void init_vparts(int num_parts, std::vector<vertex_id_t> &ids) {
 		if (ids.empty())
 			return;
 
 		assert(std::is_sorted(ids.begin(), ids.end()));
-		assert(num_parts > 1);
+		assert(num_parts > 0);
 		part_vertex_arrs.resize(num_parts);
 		for (int i = 0; i < num_parts; i++) {
 			part_vertex_arrs[i].first = ids.size();
@@ -318,7 +333,7 @@ class NUMA_graph_index: public graph_index
 	graph_header header;
 	vertex_id_t max_vertex_id;
 	vertex_id_t min_vertex_id;
-	std::unique_ptr<range_graph_partitioner> partitioner;
+	graph_partitioner::ptr partitioner;
 	// A graph index per thread
 	std::vector<std::unique_ptr<graph_local_partition<vertex_type, part_vertex_type> > > index_arr;
 
@@ -344,9 +359,10 @@ public:
 		return graph_index::ptr(index);
 	}
 
-	void init(int num_threads, int num_nodes) {
-		partitioner = std::unique_ptr<range_graph_partitioner>(
-				new range_graph_partitioner(num_threads));
+	void init(int num_threads, int num_nodes,
+			graph_partitioner::ptr partitioner) {
+		assert(partitioner->get_num_partitions() == num_threads);
+		this->partitioner = partitioner;
 
 		// Construct the indices.
 		for (int i = 0; i < num_threads; i++) {
@@ -491,6 +507,18 @@ public:
 		// TODO there might be a more light-weight implementation.
 		return get_vertex_id(part_id, v) != INVALID_VERTEX_ID;
 	}
+
+	virtual bool has_part_vertices() const {
+		return !std::is_same<part_vertex_type, empty_part_compute_vertex>::value;
+	}
+
+	virtual int get_part_id(const compute_vertex &v) const {
+		for (size_t i = 0; i < index_arr.size(); i++) {
+			if (index_arr[i]->get_vertex_id(v) != INVALID_VERTEX_ID)
+				return i;
+		}
+		return -1;
+	}
 };
 
 #if 0
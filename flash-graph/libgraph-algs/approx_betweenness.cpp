@@ -0,0 +1,670 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <new>
+#include <vector>
+#include <unordered_map>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+#include "mem_vec_store.h"
+
+/*
+ * This approximates betweenness centrality by sampling shortest paths
+ * (Riondato and Kornaropoulos). A sample is a pair of distinct vertices
+ * (s, t) and a shortest path from s to t chosen uniformly at random.
+ * The estimated betweenness of a vertex is the fraction of the sampled
+ * paths that pass through it.
+ *
+ * We run a batch of samples together. In the forward pass, the BFS from
+ * all sources of a batch run concurrently: a vertex reads its edge list
+ * once and sends the path counts of all sources in its frontier in
+ * a single message. The BFS of a source stops after it reaches its target.
+ * In the backward pass, a token walks from each target to its source,
+ * choosing a predecessor with the probability proportional to the number
+ * of shortest paths to the predecessor. A vertex reads its edge list once
+ * for all tokens it holds.
+ *
+ * We stop when an empirical Bernstein bound on the error of every vertex
+ * is below the target accuracy (an adaptive stopping rule in the spirit of
+ * KADABRA), or when we reach the number of samples that Riondato and
+ * Kornaropoulos prove to be enough.
+ */
+
+using namespace fg;
+
+namespace
+{
+
+const uint16_t UNVISITED = std::numeric_limits<uint16_t>::max();
+// The BFS that bound the length of shortest paths run in batches.
+const size_t DIAMETER_BATCH_SIZE = 64;
+const size_t MAX_DIAMETER_BATCHES = 16;
+
+enum btwn_phase
+{
+	FORWARD,
+	BACKWARD,
+};
+
+btwn_phase phase;
+bool directed;
+// The number of samples in a batch. It's at most 64.
+size_t batch_width;
+std::vector<vertex_id_t> sources;
+std::vector<vertex_id_t> targets;
+
+/*
+ * The distance and the number of shortest paths from each source of
+ * the current batch to each vertex, stored contiguously per vertex.
+ * A vertex only updates its own entries in the forward pass. The backward
+ * pass only reads them. We assume shortest paths have fewer than 65535 edges.
+ */
+std::vector<uint16_t> dists;
+std::vector<double> sigmas;
+
+uint16_t &get_dist(vertex_id_t id, size_t src)
+{
+	return dists[id * batch_width + src];
+}
+
+double &get_sigma(vertex_id_t id, size_t src)
+{
+	return sigmas[id * batch_width + src];
+}
+
+template<class Func>
+void for_each_bit(uint64_t word, Func func)
+{
+	while (word) {
+		func(__builtin_ctzl(word));
+		word &= word - 1;
+	}
+}
+
+/*
+ * The frontier of some sources and the number of shortest paths from
+ * each of them. The path counts are stored in the order of the sources.
+ */
+class path_count_message: public vertex_message
+{
+	uint64_t srcs;
+	double sigmas[0];
+public:
+	static size_t get_size(uint64_t srcs) {
+		return sizeof(path_count_message)
+			+ sizeof(double) * __builtin_popcountl(srcs);
+	}
+
+	path_count_message(uint64_t srcs): vertex_message(get_size(srcs), true) {
+		this->srcs = srcs;
+	}
+
+	uint64_t get_srcs() const {
+		return srcs;
+	}
+
+	double *get_sigmas() {
+		return sigmas;
+	}
+
+	const double *get_sigmas() const {
+		return sigmas;
+	}
+};
+
+/*
+ * A sampled path passes through the receiver.
+ */
+class token_message: public vertex_message
+{
+	int sample;
+public:
+	token_message(int sample): vertex_message(sizeof(token_message), true) {
+		this->sample = sample;
+	}
+
+	int get_sample() const {
+		return sample;
+	}
+};
+
+class approx_btwn_vertex: public compute_directed_vertex
+{
+	// The sources whose frontier has the vertex in the current level and
+	// the sources that reach the vertex in the current level.
+	uint64_t visit;
+	uint64_t next;
+	// The tokens that have arrived and the tokens that are walking away.
+	uint64_t tokens;
+	uint64_t walking;
+	// The number of sampled paths that pass through the vertex.
+	uint32_t count;
+public:
+	approx_btwn_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		visit = 0;
+		next = 0;
+		tokens = 0;
+		walking = 0;
+		count = 0;
+	}
+
+	void init_forward(uint64_t srcs) {
+		visit = srcs;
+		next = 0;
+	}
+
+	void init_backward(uint64_t tokens) {
+		this->tokens = tokens;
+		walking = 0;
+	}
+
+	uint32_t get_count() const {
+		return count;
+	}
+
+	void run(vertex_program &prog);
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		if (phase == FORWARD)
+			run_forward(prog, vertex);
+		else
+			run_backward(prog, vertex);
+	}
+
+	void run_forward(vertex_program &prog, const page_vertex &vertex);
+
+	void run_backward(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg);
+
+	void notify_iteration_end(vertex_program &prog) {
+		visit = next;
+		next = 0;
+	}
+};
+
+class approx_btwn_vertex_program: public vertex_program_impl<approx_btwn_vertex>
+{
+	unsigned int seed;
+	int done_level;
+	uint64_t done_srcs;
+public:
+	approx_btwn_vertex_program(unsigned int seed) {
+		this->seed = seed;
+		done_level = -1;
+		done_srcs = 0;
+	}
+
+	double rand_uniform() {
+		return rand_r(&seed) / (RAND_MAX + 1.0);
+	}
+
+	/*
+	 * The sources whose BFS has stopped. The BFS of a source stops once
+	 * the distance to its target is known, so the target was reached in
+	 * a previous level. A target reached in the current level has
+	 * a distance larger than the current level, so it doesn't matter
+	 * whether we see its distance.
+	 */
+	uint64_t get_done_srcs() {
+		int level = get_graph().get_curr_level();
+		if (level != done_level) {
+			done_srcs = 0;
+			for (size_t i = 0; i < targets.size(); i++) {
+				uint16_t dist = get_dist(targets[i], i);
+				if (dist != UNVISITED && dist <= level)
+					done_srcs |= 1UL << i;
+			}
+			done_level = level;
+		}
+		return done_srcs;
+	}
+};
+
+class approx_btwn_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new approx_btwn_vertex_program(random()));
+	}
+};
+
+void approx_btwn_vertex::run(vertex_program &prog)
+{
+	if (phase == FORWARD) {
+		visit &= ~((approx_btwn_vertex_program &) prog).get_done_srcs();
+		if (visit == 0)
+			return;
+	}
+	else {
+		walking = tokens;
+		tokens = 0;
+		if (walking == 0)
+			return;
+	}
+
+	vertex_id_t id = prog.get_vertex_id(*this);
+	if (!directed)
+		request_vertices(&id, 1);
+	else {
+		// The forward pass follows out-edges and the backward pass goes
+		// back along in-edges.
+		directed_vertex_request req(id, phase == FORWARD
+				? edge_type::OUT_EDGE : edge_type::IN_EDGE);
+		request_partial_vertices(&req, 1);
+	}
+}
+
+void approx_btwn_vertex::run_forward(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	uint64_t srcs = visit;
+	visit = 0;
+	if (vertex.get_num_edges(edge_type::OUT_EDGE) == 0)
+		return;
+
+	vertex_id_t id = prog.get_vertex_id(*this);
+	stack_array<char, 256> buf(path_count_message::get_size(srcs));
+	path_count_message *msg = new (buf.data()) path_count_message(srcs);
+	double *msg_sigmas = msg->get_sigmas();
+	for_each_bit(srcs, [&](int src) {
+			*msg_sigmas++ = get_sigma(id, src);
+		});
+	edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+	prog.multicast_msg(it, *msg);
+}
+
+void approx_btwn_vertex::run_backward(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	uint64_t samples = walking;
+	walking = 0;
+	edge_type type = directed ? edge_type::IN_EDGE : edge_type::OUT_EDGE;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	approx_btwn_vertex_program &btwn_prog = (approx_btwn_vertex_program &) prog;
+	for_each_bit(samples, [&](int sample) {
+			uint16_t dist = get_dist(id, sample);
+			// The predecessor is the source, which isn't on the path.
+			if (dist <= 1)
+				return;
+
+			// Choose a predecessor with the probability proportional
+			// to its path count in a single pass.
+			double total = 0;
+			vertex_id_t pred = INVALID_VERTEX_ID;
+			edge_iterator it = vertex.get_neigh_begin(type);
+			edge_iterator end = vertex.get_neigh_end(type);
+			for (; it != end; ++it) {
+				vertex_id_t neigh = *it;
+				if (get_dist(neigh, sample) != dist - 1)
+					continue;
+				double sigma = get_sigma(neigh, sample);
+				total += sigma;
+				if (btwn_prog.rand_uniform() * total < sigma)
+					pred = neigh;
+			}
+			assert(pred != INVALID_VERTEX_ID);
+			token_message msg(sample);
+			prog.send_msg(pred, msg);
+		});
+}
+
+void approx_btwn_vertex::run_on_message(vertex_program &prog,
+		const vertex_message &msg1)
+{
+	if (phase == BACKWARD) {
+		tokens |= 1UL << ((const token_message &) msg1).get_sample();
+		count++;
+		return;
+	}
+
+	const path_count_message &msg = (const path_count_message &) msg1;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	uint16_t new_dist = prog.get_graph().get_curr_level() + 1;
+	const double *msg_sigmas = msg.get_sigmas();
+	uint64_t old_next = next;
+	for_each_bit(msg.get_srcs(), [&](int src) {
+			uint16_t &dist = get_dist(id, src);
+			double sigma = *msg_sigmas++;
+			if (dist == UNVISITED) {
+				dist = new_dist;
+				get_sigma(id, src) = sigma;
+				next |= 1UL << src;
+			}
+			else if (dist == new_dist)
+				get_sigma(id, src) += sigma;
+		});
+	if (next != old_next)
+		prog.request_notify_iter_end(*this);
+}
+
+class approx_btwn_initializer: public vertex_initializer
+{
+	graph_engine &graph;
+	const std::unordered_map<vertex_id_t, uint64_t> &bits;
+public:
+	approx_btwn_initializer(graph_engine &_graph,
+			const std::unordered_map<vertex_id_t, uint64_t> &_bits): graph(
+				_graph), bits(_bits) {
+	}
+
+	void init(compute_vertex &v) {
+		approx_btwn_vertex &bv = (approx_btwn_vertex &) v;
+		auto it = bits.find(graph.get_graph_index().get_vertex_id(v));
+		uint64_t vbits = it == bits.end() ? 0 : it->second;
+		if (phase == FORWARD)
+			bv.init_forward(vbits);
+		else
+			bv.init_backward(vbits);
+	}
+};
+
+/*
+ * The empirical Bernstein bound (Maurer and Pontil) on the deviation of
+ * the mean of `num' samples of a variable in [0, 1], `count' of which are 1.
+ * It holds with probability 1 - delta, where log_term = log(2 / delta).
+ */
+double bernstein_bound(size_t count, size_t num, double log_term)
+{
+	if (num < 2)
+		return std::numeric_limits<double>::infinity();
+	double mean = ((double) count) / num;
+	double var = mean * (1 - mean) * num / (num - 1);
+	return sqrt(2 * var * log_term / num) + 7 * log_term / (3 * (num - 1));
+}
+
+class max_error_query: public vertex_query
+{
+	size_t num_samples;
+	double log_term;
+	double max_err;
+public:
+	max_error_query(size_t num_samples, double log_term) {
+		this->num_samples = num_samples;
+		this->log_term = log_term;
+		max_err = 0;
+	}
+
+	virtual void run(graph_engine &graph, compute_vertex &v) {
+		approx_btwn_vertex &bv = (approx_btwn_vertex &) v;
+		max_err = std::max(max_err, bernstein_bound(bv.get_count(),
+					num_samples, log_term));
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+		max_err = std::max(max_err, ((max_error_query *) q.get())->max_err);
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new max_error_query(num_samples, log_term));
+	}
+
+	double get_max_err() const {
+		return max_err;
+	}
+};
+
+class approx_btwn_save_query: public vertex_query
+{
+	fm::detail::mem_vec_store::ptr btwn;
+	fm::detail::mem_vec_store::ptr err;
+	size_t num_samples;
+	double log_term;
+	double max_err;
+public:
+	approx_btwn_save_query(fm::detail::mem_vec_store::ptr btwn,
+			fm::detail::mem_vec_store::ptr err, size_t num_samples,
+			double log_term, double max_err) {
+		this->btwn = btwn;
+		this->err = err;
+		this->num_samples = num_samples;
+		this->log_term = log_term;
+		this->max_err = max_err;
+	}
+
+	virtual void run(graph_engine &graph, compute_vertex &v) {
+		approx_btwn_vertex &bv = (approx_btwn_vertex &) v;
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		btwn->set<double>(id, ((double) bv.get_count()) / num_samples);
+		err->set<double>(id, std::min(max_err, bernstein_bound(bv.get_count(),
+						num_samples, log_term)));
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new approx_btwn_save_query(btwn, err,
+					num_samples, log_term, max_err));
+	}
+};
+
+/*
+ * An upper bound on the number of vertices in a shortest path.
+ * In an undirected graph, a shortest path stays in a component, and it has
+ * at most min(s, 2 * ecc + 1) vertices in a component with s vertices,
+ * where ecc is the eccentricity of any vertex in the component.
+ * Randomly sampled vertices may miss a component with longer paths, so we
+ * find the components and run BFS from a vertex of each component, starting
+ * from the largest one, until the remaining components are smaller than
+ * the bound. After MAX_DIAMETER_BATCHES batches of BFS, the size of
+ * the largest remaining component bounds the rest.
+ * We don't have a cheap bound for a directed graph, so we use the number
+ * of vertices.
+ */
+size_t estimate_vertex_diameter(FG_graph::ptr fg)
+{
+	size_t num_vertices = fg->get_num_vertices();
+	if (directed)
+		return num_vertices;
+
+	fm::vector::ptr comp_ids = compute_cc(fg);
+	if (comp_ids == NULL)
+		return num_vertices;
+	fm::detail::mem_vec_store::const_ptr store
+		= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
+				comp_ids->get_raw_store());
+	// A component is identified by its smallest vertex, and we run BFS
+	// from it. Isolated vertices don't have a component.
+	std::unordered_map<vertex_id_t, size_t> comp_sizes;
+	for (size_t i = 0; i < store->get_length(); i++) {
+		vertex_id_t comp_id = store->get<vertex_id_t>(i);
+		if (comp_id != INVALID_VERTEX_ID)
+			comp_sizes[comp_id]++;
+	}
+	std::vector<std::pair<size_t, vertex_id_t> > comps;
+	for (auto it = comp_sizes.begin(); it != comp_sizes.end(); it++)
+		comps.push_back(std::pair<size_t, vertex_id_t>(it->second, it->first));
+	std::sort(comps.begin(), comps.end(),
+			std::greater<std::pair<size_t, vertex_id_t> >());
+
+	size_t vd = 1;
+	size_t idx = 0;
+	for (size_t num_batches = 0; idx < comps.size() && comps[idx].first > vd
+			&& num_batches < MAX_DIAMETER_BATCHES; num_batches++) {
+		size_t max_size = comps[idx].first;
+		std::vector<vertex_id_t> roots;
+		for (; idx < comps.size() && comps[idx].first > vd
+				&& roots.size() < DIAMETER_BATCH_SIZE; idx++)
+			roots.push_back(comps[idx].second);
+		std::vector<size_t> counts = compute_sampled_distances(fg, roots,
+				edge_type::OUT_EDGE, DIAMETER_BATCH_SIZE);
+		vd = std::max(vd, std::min(max_size, 2 * (counts.size() - 1) + 1));
+	}
+	if (idx < comps.size())
+		vd = std::max(vd, comps[idx].first);
+	return std::min(num_vertices, vd);
+}
+
+}
+
+namespace fg
+{
+
+approx_betweenness_result compute_approx_betweenness(FG_graph::ptr fg,
+		double epsilon, double delta, size_t width)
+{
+	approx_betweenness_result res;
+	res.num_samples = 0;
+	res.max_samples = 0;
+	if (epsilon <= 0 || epsilon >= 1 || delta <= 0 || delta >= 1) {
+		BOOST_LOG_TRIVIAL(error) << "epsilon and delta have to be in (0, 1)";
+		return res;
+	}
+	if (width == 0 || width > 64) {
+		BOOST_LOG_TRIVIAL(error) << "the batch width has to be in [1, 64]";
+		return res;
+	}
+	size_t num_vertices = fg->get_num_vertices();
+	if (num_vertices < 2) {
+		BOOST_LOG_TRIVIAL(error) << "the graph needs at least two vertices";
+		return res;
+	}
+
+	directed = fg->get_graph_header().is_directed_graph();
+	batch_width = width;
+
+	// Riondato and Kornaropoulos show that this many samples give
+	// an error of at most epsilon for all vertices with probability
+	// 1 - delta / 2.
+	size_t vd = estimate_vertex_diameter(fg);
+	double log_vd = vd > 2 ? floor(log2(vd - 2)) : 0;
+	res.max_samples = ceil(0.5 / (epsilon * epsilon)
+			* (log_vd + 1 + log(2 / delta)));
+	// The other delta / 2 is shared by the stopping checks of all
+	// vertices after every batch.
+	size_t num_checks = (res.max_samples + width - 1) / width;
+	double log_term = log(4.0 * num_vertices * num_checks / delta);
+
+	graph_index::ptr index = NUMA_graph_index<approx_btwn_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"approximate betweenness takes at most %1% samples")
+		% res.max_samples;
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	dists.resize(num_vertices * width);
+	sigmas.resize(num_vertices * width);
+	double max_err = std::numeric_limits<double>::infinity();
+	while (res.num_samples < res.max_samples) {
+		size_t num = std::min(width, res.max_samples - res.num_samples);
+		sources.resize(num);
+		targets.resize(num);
+		std::unordered_map<vertex_id_t, uint64_t> src_bits;
+		for (size_t i = 0; i < num; i++) {
+			sources[i] = random() % num_vertices;
+			targets[i] = random() % (num_vertices - 1);
+			if (targets[i] >= sources[i])
+				targets[i]++;
+			src_bits[sources[i]] |= 1UL << i;
+		}
+
+		std::fill(dists.begin(), dists.end(), UNVISITED);
+		std::fill(sigmas.begin(), sigmas.end(), 0);
+		for (size_t i = 0; i < num; i++) {
+			get_dist(sources[i], i) = 0;
+			get_sigma(sources[i], i) = 1;
+		}
+		std::vector<vertex_id_t> start_ids;
+		for (auto it = src_bits.begin(); it != src_bits.end(); it++)
+			start_ids.push_back(it->first);
+		phase = FORWARD;
+		graph->init_all_vertices(vertex_initializer::ptr(
+					new approx_btwn_initializer(*graph, src_bits)));
+		graph->start(start_ids.data(), start_ids.size(),
+				vertex_initializer::ptr(), vertex_program_creater::ptr(
+					new approx_btwn_vertex_program_creater()));
+		graph->wait4complete();
+
+		// A token starts from each target that its source reaches.
+		std::unordered_map<vertex_id_t, uint64_t> token_bits;
+		for (size_t i = 0; i < num; i++)
+			if (get_dist(targets[i], i) != UNVISITED)
+				token_bits[targets[i]] |= 1UL << i;
+		if (!token_bits.empty()) {
+			start_ids.clear();
+			for (auto it = token_bits.begin(); it != token_bits.end(); it++)
+				start_ids.push_back(it->first);
+			phase = BACKWARD;
+			graph->init_all_vertices(vertex_initializer::ptr(
+						new approx_btwn_initializer(*graph, token_bits)));
+			graph->start(start_ids.data(), start_ids.size(),
+					vertex_initializer::ptr(), vertex_program_creater::ptr(
+						new approx_btwn_vertex_program_creater()));
+			graph->wait4complete();
+		}
+		res.num_samples += num;
+
+		max_error_query *query = new max_error_query(res.num_samples,
+				log_term);
+		vertex_query::ptr q(query);
+		graph->query_on_all(q);
+		max_err = query->get_max_err();
+		BOOST_LOG_TRIVIAL(info) << boost::format(
+				"%1% samples, the max error bound is %2%")
+			% res.num_samples % max_err;
+		if (max_err <= epsilon)
+			break;
+	}
+	if (res.num_samples >= res.max_samples)
+		max_err = std::min(max_err, epsilon);
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"approximate betweenness takes %1% seconds and %2% samples")
+		% time_diff(start, end) % res.num_samples;
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	fm::detail::mem_vec_store::ptr btwn = fm::detail::mem_vec_store::create(
+			num_vertices, safs::params.get_num_nodes(),
+			fm::get_scalar_type<double>());
+	fm::detail::mem_vec_store::ptr err = fm::detail::mem_vec_store::create(
+			num_vertices, safs::params.get_num_nodes(),
+			fm::get_scalar_type<double>());
+	graph->query_on_all(vertex_query::ptr(new approx_btwn_save_query(btwn,
+					err, res.num_samples, log_term, max_err)));
+	res.btwn = fm::vector::create(btwn);
+	res.err = fm::vector::create(err);
+
+	dists.clear();
+	dists.shrink_to_fit();
+	sigmas.clear();
+	sigmas.shrink_to_fit();
+	return res;
+}
+
+}
@@ -0,0 +1,803 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <math.h>
+
+#include <vector>
+
+#include <boost/math/distributions/normal.hpp>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "set_intersection.h"
+#include "FGlib.h"
+
+/*
+ * This estimates the number of triangles and the clustering coefficients
+ * of an undirected graph by sampling, so that it reads much fewer edge lists
+ * than the exact triangle counting.
+ *
+ * DOULION keeps each edge with probability p and counts the triangles in
+ * the sampled graph. Whether an edge is sampled is decided by a hash of
+ * its endpoints, so both endpoints agree without communication. A vertex
+ * reads its own edge list and then only the edge lists of the neighbors
+ * on its sampled edges. For each sampled edge, we count the sampled
+ * triangles on the edge, which gives the number of triangles as well as
+ * the number of pairs of triangles sharing an edge, from which we estimate
+ * the variance.
+ *
+ * Wedge sampling picks the centers of wedges in proportion to the number
+ * of wedges on them, which only needs the degrees in the vertex index,
+ * and picks two random neighbors of a center. A wedge is closed if the two
+ * neighbors are connected, which is checked in the edge list of one of
+ * them. Only the sampled centers and one endpoint of each sampled wedge
+ * read their edge lists.
+ */
+
+using namespace fg;
+
+namespace
+{
+
+// The edges whose hashes are smaller than this are sampled in DOULION.
+uint64_t sample_threshold;
+bool sample_all;
+uint64_t sample_seed;
+bool compute_local;
+
+// The number of wedges sampled for the global estimate on each vertex.
+std::vector<uint32_t> wedge_counts;
+// The max number of wedges sampled on a vertex for its local clustering
+// coefficient.
+size_t num_local_wedges;
+
+uint64_t hash64(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdUL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53UL;
+	key ^= key >> 33;
+	return key;
+}
+
+bool is_sampled(vertex_id_t v1, vertex_id_t v2)
+{
+	if (sample_all)
+		return true;
+	uint64_t key = v1 < v2 ? ((uint64_t) v1 << 32) | v2
+		: ((uint64_t) v2 << 32) | v1;
+	return hash64(key ^ sample_seed) < sample_threshold;
+}
+
+/*
+ * The edge list of the vertex in the lower-degree endpoint of an edge
+ * is read by the other endpoint, so the hubs don't read all of their
+ * neighbors' edge lists.
+ */
+bool read_by(vertex_program &prog, vertex_id_t id, vsize_t degree,
+		vertex_id_t neigh)
+{
+	vsize_t neigh_degree = prog.get_num_edges(neigh);
+	return neigh_degree < degree || (neigh_degree == degree && neigh < id);
+}
+
+/*
+ * Read the neighbors of a vertex without self-loops and duplicated edges.
+ */
+template<class Pred>
+void read_neighbors(vertex_id_t id, const page_vertex &vertex,
+		std::vector<vertex_id_t> &neighs, Pred pred)
+{
+	neighs.clear();
+	edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE, 0,
+			vertex.get_num_edges(edge_type::OUT_EDGE));
+	while (it.has_next()) {
+		vertex_id_t neigh = it.next();
+		if (neigh != id && (neighs.empty() || neighs.back() != neigh)
+				&& pred(neigh))
+			neighs.push_back(neigh);
+	}
+}
+
+bool has_edge(const page_vertex &vertex, vertex_id_t id)
+{
+	edge_iterator begin = vertex.get_neigh_begin(edge_type::OUT_EDGE);
+	size_t num_edges = vertex.get_num_edges(edge_type::OUT_EDGE);
+	size_t lo = 0;
+	size_t hi = num_edges;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (*(begin + mid) < id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < num_edges && *(begin + lo) == id;
+}
+
+class count_message: public vertex_message
+{
+	size_t num;
+public:
+	count_message(size_t num): vertex_message(sizeof(count_message), false) {
+		this->num = num;
+	}
+
+	size_t get_num() const {
+		return num;
+	}
+};
+
+class sampling_vertex_program_base
+{
+protected:
+	size_t num_reads;
+	size_t num_samples;
+	std::vector<vertex_id_t> neighs;
+public:
+	sampling_vertex_program_base() {
+		num_reads = 0;
+		num_samples = 0;
+	}
+
+	void add_reads(size_t num) {
+		num_reads += num;
+	}
+
+	size_t get_num_reads() const {
+		return num_reads;
+	}
+
+	void add_samples(size_t num) {
+		num_samples += num;
+	}
+
+	size_t get_num_samples() const {
+		return num_samples;
+	}
+
+	std::vector<vertex_id_t> &get_neigh_buf() {
+		return neighs;
+	}
+};
+
+/*
+ * DOULION
+ */
+
+class doulion_vertex: public compute_vertex
+{
+	// The sampled neighbors in ascending order. They're kept until
+	// the vertex has read the edge lists of its neighbors.
+	vertex_id_t *sampled;
+	vsize_t num_sampled;
+	vsize_t num_pending;
+	// The number of sampled triangles on the sampled edges of the vertex,
+	// so each triangle on the vertex is counted twice.
+	size_t num_edge_triangles;
+
+	void run_on_itself(vertex_program &prog, const page_vertex &vertex);
+	void run_on_neighbor(vertex_program &prog, const page_vertex &vertex);
+public:
+	doulion_vertex(vertex_id_t id): compute_vertex(id) {
+		sampled = NULL;
+		num_sampled = 0;
+		num_pending = 0;
+		num_edge_triangles = 0;
+	}
+
+	size_t get_num_edge_triangles() const {
+		return num_edge_triangles;
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		if (vertex.get_id() == prog.get_vertex_id(*this))
+			run_on_itself(prog, vertex);
+		else
+			run_on_neighbor(prog, vertex);
+	}
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+		num_edge_triangles += ((const count_message &) msg).get_num();
+	}
+};
+
+class doulion_vertex_program: public vertex_program_impl<doulion_vertex>,
+	public sampling_vertex_program_base
+{
+	// The sum of the sampled triangles on each sampled edge.
+	size_t num_edge_triangles;
+	// The number of pairs of sampled triangles sharing a sampled edge.
+	size_t num_triangle_pairs;
+	std::vector<uint32_t> idxs;
+	std::vector<uint32_t> counts;
+public:
+	typedef std::shared_ptr<doulion_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<doulion_vertex_program, vertex_program>(
+				prog);
+	}
+
+	doulion_vertex_program() {
+		num_edge_triangles = 0;
+		num_triangle_pairs = 0;
+	}
+
+	size_t intersect(const vertex_id_t *sampled, size_t num_sampled,
+			const std::vector<vertex_id_t> &neighs) {
+		size_t num = std::min(num_sampled, neighs.size());
+		if (idxs.size() < num) {
+			idxs.resize(num);
+			counts.resize(num);
+		}
+		return intersect_sorted(sampled, num_sampled, neighs.data(),
+				neighs.size(), idxs.data(), counts.data());
+	}
+
+	void add_edge_triangles(size_t num) {
+		num_edge_triangles += num;
+		num_triangle_pairs += num * (num - 1) / 2;
+	}
+
+	size_t get_num_edge_triangles() const {
+		return num_edge_triangles;
+	}
+
+	size_t get_num_triangle_pairs() const {
+		return num_triangle_pairs;
+	}
+};
+
+class doulion_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new doulion_vertex_program());
+	}
+};
+
+void doulion_vertex::run_on_itself(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	doulion_vertex_program &dprog = (doulion_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	dprog.add_reads(1);
+	std::vector<vertex_id_t> &neighs = dprog.get_neigh_buf();
+	read_neighbors(id, vertex, neighs, [id](vertex_id_t neigh) {
+			return is_sampled(id, neigh);
+		});
+	size_t num_samples = 0;
+	for (size_t i = 0; i < neighs.size(); i++)
+		if (neighs[i] > id)
+			num_samples++;
+	dprog.add_samples(num_samples);
+	// There are no sampled triangles on the vertex.
+	if (neighs.size() < 2)
+		return;
+
+	vsize_t degree = vertex.get_num_edges(edge_type::OUT_EDGE);
+	std::vector<vertex_id_t> reqs;
+	for (size_t i = 0; i < neighs.size(); i++)
+		if (read_by(prog, id, degree, neighs[i]))
+			reqs.push_back(neighs[i]);
+	if (reqs.empty())
+		return;
+
+	num_sampled = neighs.size();
+	sampled = new vertex_id_t[num_sampled];
+	memcpy(sampled, neighs.data(), sizeof(sampled[0]) * num_sampled);
+	num_pending = reqs.size();
+	dprog.add_reads(reqs.size());
+	request_vertices(reqs.data(), reqs.size());
+}
+
+void doulion_vertex::run_on_neighbor(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	doulion_vertex_program &dprog = (doulion_vertex_program &) prog;
+	vertex_id_t neigh_id = vertex.get_id();
+	std::vector<vertex_id_t> &neighs = dprog.get_neigh_buf();
+	read_neighbors(neigh_id, vertex, neighs, [neigh_id](vertex_id_t neigh) {
+			return is_sampled(neigh_id, neigh);
+		});
+	size_t num = dprog.intersect(sampled, num_sampled, neighs);
+	dprog.add_edge_triangles(num);
+	if (compute_local && num > 0) {
+		num_edge_triangles += num;
+		count_message msg(num);
+		prog.send_msg(neigh_id, msg);
+	}
+
+	num_pending--;
+	if (num_pending == 0) {
+		delete [] sampled;
+		sampled = NULL;
+		num_sampled = 0;
+	}
+}
+
+/*
+ * Wedge sampling
+ */
+
+struct wedge_check
+{
+	// The vertex whose edge list is read.
+	vertex_id_t read;
+	// The vertex searched for in the edge list.
+	vertex_id_t target;
+	bool local;
+
+	bool operator<(const wedge_check &check) const {
+		return read < check.read;
+	}
+};
+
+class wedge_vertex: public compute_vertex
+{
+	// The wedges to check, sorted by the vertices whose edge lists are read.
+	// They're kept until the vertex has read the edge lists.
+	wedge_check *checks;
+	uint32_t num_checks;
+	uint32_t num_pending;
+	// The wedges sampled for the local clustering coefficient.
+	uint32_t num_local;
+	uint32_t num_local_closed;
+
+	void run_on_itself(vertex_program &prog, const page_vertex &vertex);
+	void run_on_neighbor(vertex_program &prog, const page_vertex &vertex);
+public:
+	wedge_vertex(vertex_id_t id): compute_vertex(id) {
+		checks = NULL;
+		num_checks = 0;
+		num_pending = 0;
+		num_local = 0;
+		num_local_closed = 0;
+	}
+
+	double get_local_clustering() const {
+		return num_local > 0 ? ((double) num_local_closed) / num_local : 0;
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (wedge_counts[id] > 0 || num_local_wedges > 0)
+			request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		if (vertex.get_id() == prog.get_vertex_id(*this))
+			run_on_itself(prog, vertex);
+		else
+			run_on_neighbor(prog, vertex);
+	}
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+	}
+};
+
+class wedge_vertex_program: public vertex_program_impl<wedge_vertex>,
+	public sampling_vertex_program_base
+{
+	unsigned int seed;
+	size_t num_closed;
+	std::vector<wedge_check> checks;
+public:
+	typedef std::shared_ptr<wedge_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<wedge_vertex_program, vertex_program>(
+				prog);
+	}
+
+	wedge_vertex_program(unsigned int seed) {
+		this->seed = seed;
+		num_closed = 0;
+	}
+
+	/*
+	 * Pick two distinct neighbors at random.
+	 */
+	std::pair<size_t, size_t> rand_pair(size_t num) {
+		size_t i = rand_r(&seed) % num;
+		size_t j = rand_r(&seed) % (num - 1);
+		if (j >= i)
+			j++;
+		return std::pair<size_t, size_t>(i, j);
+	}
+
+	std::vector<wedge_check> &get_check_buf() {
+		return checks;
+	}
+
+	void add_closed() {
+		num_closed++;
+	}
+
+	size_t get_num_closed() const {
+		return num_closed;
+	}
+};
+
+class wedge_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new wedge_vertex_program(random()));
+	}
+};
+
+void wedge_vertex::run_on_itself(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	wedge_vertex_program &wprog = (wedge_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	wprog.add_reads(1);
+	std::vector<vertex_id_t> &neighs = wprog.get_neigh_buf();
+	read_neighbors(id, vertex, neighs, [](vertex_id_t) {
+			return true;
+		});
+	size_t degree = neighs.size();
+	if (degree < 2)
+		return;
+
+	std::vector<wedge_check> &buf = wprog.get_check_buf();
+	buf.clear();
+	vsize_t num_edges = vertex.get_num_edges(edge_type::OUT_EDGE);
+	auto add_check = [&](vertex_id_t v1, vertex_id_t v2, bool local) {
+		wedge_check check;
+		if (read_by(prog, v2, prog.get_num_edges(v2), v1)) {
+			check.read = v1;
+			check.target = v2;
+		}
+		else {
+			check.read = v2;
+			check.target = v1;
+		}
+		check.local = local;
+		buf.push_back(check);
+	};
+	for (uint32_t i = 0; i < wedge_counts[id]; i++) {
+		std::pair<size_t, size_t> pair = wprog.rand_pair(degree);
+		add_check(neighs[pair.first], neighs[pair.second], false);
+	}
+	wprog.add_samples(wedge_counts[id]);
+	// We check all wedges of a vertex with few wedges.
+	if (degree * (degree - 1) / 2 <= num_local_wedges) {
+		for (size_t i = 0; i < degree; i++)
+			for (size_t j = i + 1; j < degree; j++)
+				add_check(neighs[i], neighs[j], true);
+	}
+	else {
+		for (size_t i = 0; i < num_local_wedges; i++) {
+			std::pair<size_t, size_t> pair = wprog.rand_pair(degree);
+			add_check(neighs[pair.first], neighs[pair.second], true);
+		}
+	}
+	num_local = buf.size() - wedge_counts[id];
+
+	std::sort(buf.begin(), buf.end());
+	std::vector<vertex_id_t> reqs;
+	for (size_t i = 0; i < buf.size(); i++)
+		if (reqs.empty() || reqs.back() != buf[i].read)
+			reqs.push_back(buf[i].read);
+	num_checks = buf.size();
+	checks = new wedge_check[num_checks];
+	std::copy(buf.begin(), buf.end(), checks);
+	num_pending = reqs.size();
+	wprog.add_reads(reqs.size());
+	request_vertices(reqs.data(), reqs.size());
+}
+
+void wedge_vertex::run_on_neighbor(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	wedge_vertex_program &wprog = (wedge_vertex_program &) prog;
+	wedge_check key;
+	key.read = vertex.get_id();
+	std::pair<wedge_check *, wedge_check *> range = std::equal_range(checks,
+			checks + num_checks, key);
+	for (wedge_check *check = range.first; check != range.second; check++) {
+		if (!has_edge(vertex, check->target))
+			continue;
+		if (check->local)
+			num_local_closed++;
+		else
+			wprog.add_closed();
+	}
+
+	num_pending--;
+	if (num_pending == 0) {
+		delete [] checks;
+		checks = NULL;
+		num_checks = 0;
+	}
+}
+
+/*
+ * Compute the local clustering coefficients from the sampled triangles
+ * on each vertex.
+ */
+class doulion_local_query: public vertex_query
+{
+	fm::detail::mem_vec_store::ptr res;
+	double scale;
+public:
+	doulion_local_query(fm::detail::mem_vec_store::ptr res, double scale) {
+		this->res = res;
+		this->scale = scale;
+	}
+
+	virtual void run(graph_engine &graph, compute_vertex &v) {
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		double degree = graph.get_num_edges(id, edge_type::OUT_EDGE);
+		double num_triangles = ((doulion_vertex &) v).get_num_edge_triangles()
+			/ 2.0 * scale;
+		double cc = degree < 2 ? 0 : num_triangles / (degree * (degree - 1) / 2);
+		res->set<double>(id, std::min(cc, 1.0));
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new doulion_local_query(res, scale));
+	}
+};
+
+class wedge_local_query: public vertex_query
+{
+	fm::detail::mem_vec_store::ptr res;
+public:
+	wedge_local_query(fm::detail::mem_vec_store::ptr res) {
+		this->res = res;
+	}
+
+	virtual void run(graph_engine &graph, compute_vertex &v) {
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		res->set<double>(id, ((wedge_vertex &) v).get_local_clustering());
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new wedge_local_query(res));
+	}
+};
+
+double get_num_wedges(graph_engine &graph, size_t num_vertices)
+{
+	double num_wedges = 0;
+	for (vertex_id_t id = 0; id < num_vertices; id++) {
+		double degree = graph.get_num_edges(id, edge_type::OUT_EDGE);
+		num_wedges += degree * (degree - 1) / 2;
+	}
+	return num_wedges;
+}
+
+bool check_args(FG_graph::ptr fg, double confidence)
+{
+	if (fg->get_graph_header().is_directed_graph()) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "This algorithm counts triangles in an undirected graph";
+		return false;
+	}
+	if (confidence <= 0 || confidence >= 1) {
+		BOOST_LOG_TRIVIAL(error) << "the confidence has to be in (0, 1)";
+		return false;
+	}
+	return true;
+}
+
+double get_z(double confidence)
+{
+	boost::math::normal dist;
+	return boost::math::quantile(dist, 1 - (1 - confidence) / 2);
+}
+
+}
+
+namespace fg
+{
+
+approx_triangle_result compute_doulion_triangles(FG_graph::ptr fg, double p,
+		bool local, double confidence)
+{
+	approx_triangle_result res;
+	if (!check_args(fg, confidence))
+		return res;
+	if (p <= 0 || p > 1) {
+		BOOST_LOG_TRIVIAL(error) << "the sampling probability has to be in (0, 1]";
+		return res;
+	}
+	sample_all = p == 1;
+	sample_threshold = p * 18446744073709551616.0;
+	sample_seed = hash64(((uint64_t) random() << 31) | random());
+	compute_local = local;
+
+	graph_index::ptr index = NUMA_graph_index<doulion_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"DOULION triangle counting with probability %1%") % p;
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new doulion_vertex_program_creater()));
+	graph->wait4complete();
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	double num_edge_triangles = 0;
+	double num_triangle_pairs = 0;
+	for (size_t i = 0; i < vprogs.size(); i++) {
+		doulion_vertex_program::ptr dprog = doulion_vertex_program::cast2(
+				vprogs[i]);
+		num_edge_triangles += dprog->get_num_edge_triangles();
+		num_triangle_pairs += dprog->get_num_triangle_pairs();
+		res.num_samples += dprog->get_num_samples();
+		res.num_reads += dprog->get_num_reads();
+	}
+
+	// A triangle in the sample exists with probability p^3 and a pair of
+	// triangles sharing an edge exists with probability p^5. Each pair
+	// appears twice in the covariance, so the variance of the estimate is
+	// T * (1 / p^3 - 1) + 2 * pairs * (1 / p - 1).
+	double p3 = p * p * p;
+	res.num_triangles = num_edge_triangles / 3 / p3;
+	double num_pairs = num_triangle_pairs / (p3 * p * p);
+	double var = res.num_triangles * (1 / p3 - 1) + 2 * num_pairs * (1 / p - 1);
+	double z = get_z(confidence);
+	res.lower = std::max(0.0, res.num_triangles - z * sqrt(var));
+	res.upper = res.num_triangles + z * sqrt(var);
+	res.num_wedges = get_num_wedges(*graph, fg->get_num_vertices());
+	if (res.num_wedges > 0)
+		res.transitivity = 3 * res.num_triangles / res.num_wedges;
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"DOULION estimates %1% triangles in [%2%, %3%] from %4% edges, reading %5% edge lists in %6% seconds")
+		% res.num_triangles % res.lower % res.upper % res.num_samples
+		% res.num_reads % time_diff(start, end);
+
+	if (local) {
+		fm::detail::mem_vec_store::ptr res_store
+			= fm::detail::mem_vec_store::create(fg->get_num_vertices(),
+					safs::params.get_num_nodes(), fm::get_scalar_type<double>());
+		graph->query_on_all(vertex_query::ptr(new doulion_local_query(
+						res_store, 1 / p3)));
+		res.local_clustering = fm::vector::create(res_store);
+	}
+	return res;
+}
+
+approx_triangle_result compute_wedge_sampling_triangles(FG_graph::ptr fg,
+		size_t num_wedges, size_t num_local, double confidence)
+{
+	approx_triangle_result res;
+	if (!check_args(fg, confidence))
+		return res;
+	if (num_wedges == 0) {
+		BOOST_LOG_TRIVIAL(error) << "wedge sampling needs samples";
+		return res;
+	}
+
+	graph_index::ptr index = NUMA_graph_index<wedge_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	size_t num_vertices = fg->get_num_vertices();
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"wedge sampling with %1% wedges") % num_wedges;
+
+	// The centers of wedges are picked in proportion to the number of
+	// wedges on them, so we walk through the degrees with sorted random
+	// numbers.
+	res.num_wedges = get_num_wedges(*graph, num_vertices);
+	if (res.num_wedges == 0)
+		return res;
+	std::vector<double> rands(num_wedges);
+	for (size_t i = 0; i < num_wedges; i++)
+		rands[i] = (((double) random()) * (1UL << 31) + random())
+			/ (1UL << 62) * res.num_wedges;
+	std::sort(rands.begin(), rands.end());
+	wedge_counts.assign(num_vertices, 0);
+	double prefix = 0;
+	size_t rand_idx = 0;
+	for (vertex_id_t id = 0; id < num_vertices && rand_idx < num_wedges;
+			id++) {
+		double degree = graph->get_num_edges(id, edge_type::OUT_EDGE);
+		prefix += degree * (degree - 1) / 2;
+		for (; rand_idx < num_wedges && rands[rand_idx] < prefix; rand_idx++)
+			wedge_counts[id]++;
+	}
+	num_local_wedges = num_local;
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new wedge_vertex_program_creater()));
+	graph->wait4complete();
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	size_t num_closed = 0;
+	for (size_t i = 0; i < vprogs.size(); i++) {
+		wedge_vertex_program::ptr wprog = wedge_vertex_program::cast2(
+				vprogs[i]);
+		num_closed += wprog->get_num_closed();
+		res.num_samples += wprog->get_num_samples();
+		res.num_reads += wprog->get_num_reads();
+	}
+
+	// The Wilson score interval of the fraction of closed wedges.
+	double k = res.num_samples;
+	double frac = num_closed / k;
+	double z = get_z(confidence);
+	double center = (frac + z * z / (2 * k)) / (1 + z * z / k);
+	double half = z / (1 + z * z / k) * sqrt(frac * (1 - frac) / k
+			+ z * z / (4 * k * k));
+	res.transitivity = frac;
+	res.num_triangles = frac * res.num_wedges / 3;
+	res.lower = std::max(0.0, center - half) * res.num_wedges / 3;
+	res.upper = std::min(1.0, center + half) * res.num_wedges / 3;
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"wedge sampling estimates %1% triangles in [%2%, %3%] from %4% wedges, reading %5% edge lists in %6% seconds")
+		% res.num_triangles % res.lower % res.upper % res.num_samples
+		% res.num_reads % time_diff(start, end);
+
+	if (num_local > 0) {
+		fm::detail::mem_vec_store::ptr res_store
+			= fm::detail::mem_vec_store::create(num_vertices,
+					safs::params.get_num_nodes(), fm::get_scalar_type<double>());
+		graph->query_on_all(vertex_query::ptr(new wedge_local_query(res_store)));
+		res.local_clustering = fm::vector::create(res_store);
+	}
+	wedge_counts.clear();
+	return res;
+}
+
+}
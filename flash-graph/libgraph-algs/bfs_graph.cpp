@@ -26,6 +26,7 @@
 
 #include "graph_engine.h"
 #include "graph_config.h"
+#include "bitmap.h"
 #include "FGlib.h"
 
 using namespace safs;
@@ -172,6 +173,140 @@ public:
 	}
 };
 
+/*
+ * The state of direction-optimizing BFS shared by all threads.
+ * The current frontier doesn't change in a level, so it can be tested
+ * without synchronization. The visited bitmap and the next frontier are
+ * set atomically. Two threads may add the same vertex to the next frontier
+ * in the top-down step, which is harmless.
+ */
+std::unique_ptr<thread_safe_bitmap> visited_map;
+std::unique_ptr<thread_safe_bitmap> frontier_map;
+std::unique_ptr<thread_safe_bitmap> next_frontier_map;
+bool bottom_up = false;
+
+edge_type reverse_edge(edge_type e)
+{
+	if (e == edge_type::IN_EDGE)
+		return edge_type::OUT_EDGE;
+	else if (e == edge_type::OUT_EDGE)
+		return edge_type::IN_EDGE;
+	else
+		return e;
+}
+
+/*
+ * In the top-down step, a vertex in the frontier adds its unvisited
+ * neighbors to the next frontier.
+ */
+void expand_frontier(const page_vertex &vertex, edge_type type)
+{
+	edge_seq_iterator it = vertex.get_neigh_seq_it(type, 0,
+			vertex.get_num_edges(type));
+	while (it.has_next()) {
+		vertex_id_t id = it.next();
+		if (!visited_map->get(id)) {
+			visited_map->set(id);
+			next_frontier_map->set(id);
+		}
+	}
+}
+
+/*
+ * In the bottom-up step, an unvisited vertex searches for a parent in
+ * the current frontier. It stops as soon as it finds one.
+ */
+bool find_parent(const page_vertex &vertex, edge_type type)
+{
+	edge_seq_iterator it = vertex.get_neigh_seq_it(type, 0,
+			vertex.get_num_edges(type));
+	while (it.has_next())
+		if (frontier_map->get(it.next()))
+			return true;
+	return false;
+}
+
+void run_do_bfs(vertex_id_t id, const page_vertex &vertex, bool directed)
+{
+	edge_type type = bottom_up ? reverse_edge(traverse_edge) : traverse_edge;
+	// A directed vertex stores its in-edges and out-edges separately.
+	std::vector<edge_type> types;
+	if (directed && type == edge_type::BOTH_EDGES) {
+		types.push_back(edge_type::IN_EDGE);
+		types.push_back(edge_type::OUT_EDGE);
+	}
+	else
+		types.push_back(type);
+
+	for (size_t i = 0; i < types.size(); i++) {
+		if (!bottom_up)
+			expand_frontier(vertex, types[i]);
+		else if (find_parent(vertex, types[i])) {
+			visited_map->set(id);
+			next_frontier_map->set(id);
+			return;
+		}
+	}
+}
+
+/*
+ * Vertex program for direction-optimizing BFS on a directed graph.
+ * A vertex is activated once in every level that it participates in,
+ * so it doesn't keep any state.
+ */
+class do_bfs_dvertex: public compute_directed_vertex
+{
+public:
+	do_bfs_dvertex(vertex_id_t id): compute_directed_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		edge_type type = bottom_up ? reverse_edge(traverse_edge) : traverse_edge;
+		directed_vertex_request req(prog.get_vertex_id(*this), type);
+		request_partial_vertices(&req, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		run_do_bfs(prog.get_vertex_id(*this), vertex, true);
+	}
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+	}
+};
+
+/*
+ * Vertex program for direction-optimizing BFS on an undirected graph.
+ */
+class do_bfs_uvertex: public compute_vertex
+{
+public:
+	do_bfs_uvertex(vertex_id_t id): compute_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		run_do_bfs(prog.get_vertex_id(*this), vertex, false);
+	}
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+	}
+};
+
+/*
+ * All unvisited vertices participate in a bottom-up step.
+ */
+class unvisited_filter: public vertex_filter
+{
+public:
+	bool keep(vertex_program &prog, compute_vertex &v) {
+		return !visited_map->get(prog.get_vertex_id(v));
+	}
+};
+
 }
 
 size_t bfs(FG_graph::ptr fg, vertex_id_t start_vertex, edge_type traverse_e)
@@ -213,3 +348,87 @@ size_t bfs(FG_graph::ptr fg, vertex_id_t start_vertex, edge_type traverse_e)
 #endif
 	return num_visited;
 }
+
+size_t direction_opt_bfs(FG_graph::ptr fg, vertex_id_t start_vertex,
+		edge_type traverse_e)
+{
+	// The parameters of the heuristics in Beamer's direction-optimizing BFS.
+	const size_t alpha = 14;
+	const size_t beta = 24;
+
+	bool directed = fg->get_graph_header().is_directed_graph();
+	graph_index::ptr index;
+	if (directed)
+		index = NUMA_graph_index<do_bfs_dvertex>::create(fg->get_graph_header());
+	else
+		index = NUMA_graph_index<do_bfs_uvertex>::create(fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+
+	traverse_edge = directed ? traverse_e : edge_type::BOTH_EDGES;
+	edge_type parent_edge = reverse_edge(traverse_edge);
+	size_t num_vertices = fg->get_num_vertices();
+	visited_map = std::unique_ptr<thread_safe_bitmap>(
+			new thread_safe_bitmap(num_vertices, 0));
+	frontier_map = std::unique_ptr<thread_safe_bitmap>(
+			new thread_safe_bitmap(num_vertices, 0));
+	next_frontier_map = std::unique_ptr<thread_safe_bitmap>(
+			new thread_safe_bitmap(num_vertices, 0));
+	bottom_up = false;
+
+	// The number of edges that the unvisited vertices have to scan
+	// in a bottom-up step.
+	size_t num_unexplored_edges = 0;
+	for (size_t i = 0; i < num_vertices; i++)
+		num_unexplored_edges += graph->get_num_edges(i, parent_edge);
+
+	printf("direction-optimizing BFS starts\n");
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	std::vector<vertex_id_t> frontier(1, start_vertex);
+	visited_map->set(start_vertex);
+	frontier_map->set(start_vertex);
+	size_t num_visited = 0;
+	size_t prev_frontier_size = 0;
+	for (int level = 0; !frontier.empty(); level++) {
+		size_t num_frontier_edges = 0;
+		for (size_t i = 0; i < frontier.size(); i++) {
+			num_frontier_edges += graph->get_num_edges(frontier[i],
+					traverse_edge);
+			num_unexplored_edges -= graph->get_num_edges(frontier[i],
+					parent_edge);
+		}
+		num_visited += frontier.size();
+
+		if (!bottom_up)
+			bottom_up = num_frontier_edges > num_unexplored_edges / alpha;
+		else
+			bottom_up = frontier.size() >= num_vertices / beta
+				|| frontier.size() >= prev_frontier_size;
+		printf("level %d: %ld vertices in the frontier, %s\n", level,
+				frontier.size(), bottom_up ? "bottom-up" : "top-down");
+
+		if (bottom_up)
+			graph->start(std::shared_ptr<vertex_filter>(new unvisited_filter()));
+		else
+			graph->start(frontier.data(), frontier.size());
+		graph->wait4complete();
+
+		frontier_map.swap(next_frontier_map);
+		next_frontier_map->clear();
+		prev_frontier_size = frontier.size();
+		frontier.clear();
+		frontier_map->get_set_bits(frontier);
+	}
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	visited_map.reset();
+	frontier_map.reset();
+	next_frontier_map.reset();
+	return num_visited;
+}
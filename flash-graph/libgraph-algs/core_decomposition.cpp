@@ -0,0 +1,333 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <atomic>
+#include <vector>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+
+/*
+ * This computes the coreness of every vertex in one run by peeling
+ * the vertices in the order of their degrees.
+ *
+ * The degrees are initialized from the vertex index, so no edge lists are
+ * read to get them. We peel the vertices whose degrees are no larger than
+ * the current k. A peeled vertex reads its edge list and puts its neighbors
+ * in a buffer of the thread. At the end of an iteration (or when the buffer
+ * is full), a thread sorts the buffer and decrements the degree of each
+ * neighbor once by the number of times it appears in the buffer. The
+ * neighbors whose degrees drop to k are peeled in the next iteration.
+ * The other neighbors move to the buckets of their new degrees.
+ *
+ * Each thread has its own buckets so the threads move vertices between
+ * buckets without locking. Only a window of buckets is kept open, and
+ * the remaining vertices are put in the buckets again when all open
+ * buckets are used up. A vertex may be in multiple buckets, so we ignore
+ * the vertices that have been peeled when we open a bucket.
+ */
+
+using namespace fg;
+
+namespace
+{
+
+const size_t NUM_OPEN_BUCKETS = 128;
+const size_t MAX_BUF_SIZE = 1024 * 1024;
+const size_t INVALID_CORE = std::numeric_limits<size_t>::max();
+
+std::unique_ptr<std::atomic<vsize_t>[]> degrees;
+std::vector<size_t> cores;
+vsize_t curr_k;
+// The degree of the first open bucket.
+vsize_t bucket_base;
+bool directed;
+
+typedef std::vector<std::vector<vertex_id_t> > bucket_set;
+// The open buckets of each thread.
+std::vector<bucket_set> part_buckets;
+
+class peel_vertex: public compute_vertex
+{
+public:
+	peel_vertex(vertex_id_t id): compute_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		// All neighbors have been peeled.
+		if (degrees[id].load(std::memory_order_relaxed) == 0)
+			return;
+		request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+	}
+};
+
+class peel_vertex_program: public vertex_program_impl<peel_vertex>
+{
+	// The neighbors of the peeled vertices, whose degrees haven't been
+	// decremented.
+	std::vector<vertex_id_t> buf;
+	std::vector<vertex_id_t> peeled;
+	bucket_set *buckets;
+	size_t num_peeled;
+	size_t num_reads;
+public:
+	typedef std::shared_ptr<peel_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<peel_vertex_program, vertex_program>(
+				prog);
+	}
+
+	peel_vertex_program() {
+		buckets = NULL;
+		num_peeled = 0;
+		num_reads = 0;
+	}
+
+	virtual void run_on_engine_start() {
+		buckets = &part_buckets[get_partition_id()];
+	}
+
+	virtual void run_on_iteration_end() {
+		flush();
+	}
+
+	void add_neighbors(const page_vertex &vertex, edge_type type) {
+		edge_seq_iterator it = vertex.get_neigh_seq_it(type, 0,
+				vertex.get_num_edges(type));
+		while (it.has_next())
+			buf.push_back(it.next());
+	}
+
+	void add_reads() {
+		num_reads++;
+		if (buf.size() >= MAX_BUF_SIZE)
+			flush();
+	}
+
+	void flush();
+
+	size_t get_num_peeled() const {
+		return num_peeled;
+	}
+
+	size_t get_num_reads() const {
+		return num_reads;
+	}
+};
+
+class peel_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new peel_vertex_program());
+	}
+};
+
+void peel_vertex_program::flush()
+{
+	if (buf.empty())
+		return;
+
+	std::sort(buf.begin(), buf.end());
+	vsize_t bucket_end = bucket_base + NUM_OPEN_BUCKETS;
+	for (size_t i = 0; i < buf.size();) {
+		vertex_id_t id = buf[i];
+		size_t j = i + 1;
+		for (; j < buf.size() && buf[j] == id; j++);
+		vsize_t num = j - i;
+		i = j;
+
+		// A peeled vertex has a degree no larger than the current k,
+		// so we don't need to check whether the vertex has been peeled.
+		vsize_t old_degree = degrees[id].fetch_sub(num);
+		vsize_t new_degree = old_degree - num;
+		if (old_degree > curr_k && new_degree <= curr_k) {
+			cores[id] = curr_k;
+			peeled.push_back(id);
+		}
+		else if (new_degree > curr_k && new_degree < bucket_end)
+			(*buckets)[new_degree - bucket_base].push_back(id);
+	}
+	buf.clear();
+
+	num_peeled += peeled.size();
+	activate_vertices(peeled.data(), peeled.size());
+	peeled.clear();
+}
+
+void peel_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	peel_vertex_program &pprog = (peel_vertex_program &) prog;
+	if (directed) {
+		pprog.add_neighbors(vertex, edge_type::IN_EDGE);
+		pprog.add_neighbors(vertex, edge_type::OUT_EDGE);
+	}
+	else
+		pprog.add_neighbors(vertex, edge_type::OUT_EDGE);
+	pprog.add_reads();
+}
+
+/*
+ * Put the remaining vertices in the buckets of their degrees.
+ * The smallest degree becomes the degree of the first open bucket.
+ */
+void fill_buckets(size_t num_vertices)
+{
+	for (size_t i = 0; i < part_buckets.size(); i++)
+		for (size_t j = 0; j < NUM_OPEN_BUCKETS; j++)
+			part_buckets[i][j].clear();
+
+	vsize_t min_degree = std::numeric_limits<vsize_t>::max();
+	for (vertex_id_t id = 0; id < num_vertices; id++)
+		if (cores[id] == INVALID_CORE)
+			min_degree = std::min(min_degree, degrees[id].load());
+	bucket_base = min_degree;
+	for (vertex_id_t id = 0; id < num_vertices; id++) {
+		if (cores[id] != INVALID_CORE)
+			continue;
+		vsize_t degree = degrees[id].load();
+		if (degree < bucket_base + NUM_OPEN_BUCKETS)
+			part_buckets[id % part_buckets.size()][degree - bucket_base].push_back(
+					id);
+	}
+}
+
+/*
+ * Get the remaining vertices in the bucket of the current k from all
+ * threads. They're peeled.
+ */
+void open_bucket(std::vector<vertex_id_t> &vertices)
+{
+	vertices.clear();
+	for (size_t i = 0; i < part_buckets.size(); i++) {
+		std::vector<vertex_id_t> &bucket = part_buckets[i][curr_k - bucket_base];
+		for (size_t j = 0; j < bucket.size(); j++) {
+			vertex_id_t id = bucket[j];
+			if (cores[id] == INVALID_CORE) {
+				cores[id] = curr_k;
+				vertices.push_back(id);
+			}
+		}
+		std::vector<vertex_id_t>().swap(bucket);
+	}
+}
+
+}
+
+namespace fg
+{
+
+fm::vector::ptr compute_core_decomposition(FG_graph::ptr fg)
+{
+	graph_index::ptr index = NUMA_graph_index<peel_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	size_t num_vertices = fg->get_num_vertices();
+	directed = fg->get_graph_header().is_directed_graph();
+	edge_type type = directed ? edge_type::BOTH_EDGES : edge_type::OUT_EDGE;
+
+	BOOST_LOG_TRIVIAL(info) << "core decomposition starts";
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+
+	degrees = std::unique_ptr<std::atomic<vsize_t>[]>(
+			new std::atomic<vsize_t>[num_vertices]);
+	for (vertex_id_t id = 0; id < num_vertices; id++)
+		degrees[id] = graph->get_num_edges(id, type);
+	cores.assign(num_vertices, INVALID_CORE);
+	part_buckets.assign(graph->get_num_threads(),
+			bucket_set(NUM_OPEN_BUCKETS));
+
+	size_t num_remaining = num_vertices;
+	size_t num_runs = 0;
+	size_t num_reads = 0;
+	std::vector<vertex_id_t> vertices;
+	fill_buckets(num_vertices);
+	curr_k = bucket_base;
+	while (num_remaining > 0) {
+		if (curr_k >= bucket_base + NUM_OPEN_BUCKETS) {
+			fill_buckets(num_vertices);
+			curr_k = bucket_base;
+		}
+		open_bucket(vertices);
+		if (vertices.empty()) {
+			curr_k++;
+			continue;
+		}
+
+		num_remaining -= vertices.size();
+		graph->start(vertices.data(), vertices.size(), vertex_initializer::ptr(),
+				vertex_program_creater::ptr(new peel_vertex_program_creater()));
+		graph->wait4complete();
+		num_runs++;
+
+		std::vector<vertex_program::ptr> vprogs;
+		graph->get_vertex_programs(vprogs);
+		for (size_t i = 0; i < vprogs.size(); i++) {
+			peel_vertex_program::ptr pprog = peel_vertex_program::cast2(
+					vprogs[i]);
+			num_remaining -= pprog->get_num_peeled();
+			num_reads += pprog->get_num_reads();
+		}
+		BOOST_LOG_TRIVIAL(debug) << boost::format(
+				"%1%-core has %2% vertices") % (curr_k + 1) % num_remaining;
+		curr_k++;
+	}
+
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	fm::detail::mem_vec_store::ptr res_store = fm::detail::mem_vec_store::create(
+			num_vertices, safs::params.get_num_nodes(),
+			fm::get_scalar_type<size_t>());
+	size_t max_core = 0;
+	for (vertex_id_t id = 0; id < num_vertices; id++) {
+		res_store->set<size_t>(id, cores[id]);
+		max_core = std::max(max_core, cores[id]);
+	}
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"core decomposition takes %1% seconds: the max core is %2%, %3% runs of the engine, %4% edge lists read")
+		% time_diff(start, end) % max_core % num_runs % num_reads;
+
+	degrees.reset();
+	std::vector<size_t>().swap(cores);
+	part_buckets.clear();
+	return fm::vector::create(res_store);
+}
+
+}
@@ -21,12 +21,14 @@
 #endif
 
 #include <vector>
+#include <deque>
 #include <set>
 #include <unordered_map>
 
 #include "graph_engine.h"
 #include "graph_config.h"
 #include "FGlib.h"
+#include "ms_bfs.h"
 
 using namespace fg;
 
@@ -35,121 +37,19 @@ namespace {
 size_t num_bfs = 1;
 edge_type traverse_edge = edge_type::OUT_EDGE;
 
-template<class T>
-class embedded_bitmap
-{
-	T map;
-public:
-	embedded_bitmap() {
-		map = 0;
-	}
-
-	void set(int idx) {
-		assert((size_t) idx < sizeof(T) * 8);
-		map |= ((T) 1) << idx;
-	}
-
-	void clear() {
-		map = 0;
-	}
-
-	bool merge(const embedded_bitmap<T> &map) {
-		bool old = this->map;
-		this->map |= map.map;
-		return old != map.map;
-	}
-
-	bool operator!=(const embedded_bitmap<T> &map) {
-		return this->map != map.map;
-	}
-
-	T get_value() const {
-		return map;
-	}
-};
-
-class diameter_message: public vertex_message
-{
-	embedded_bitmap<uint64_t> bfs_ids;
-public:
-	diameter_message(embedded_bitmap<uint64_t> bfs_ids): vertex_message(
-			sizeof(diameter_message), true) {
-		this->bfs_ids = bfs_ids;
-	}
-
-	embedded_bitmap<uint64_t> get_bfs_ids() const {
-		return bfs_ids;
-	}
-};
-
-class diameter_vertex: public compute_directed_vertex
-{
-	embedded_bitmap<uint64_t> bfs_ids;
-	embedded_bitmap<uint64_t> new_bfs_ids;
-	// The largest distance from a start vertex among the BFS.
-	short max_dist;
-	bool updated;
-public:
-	diameter_vertex(vertex_id_t id): compute_directed_vertex(id) {
-		updated = false;
-		max_dist = 0;
-	}
-
-	short get_max_dist() const {
-		return max_dist;
-	}
-
-	void init(int bfs_id) {
-		max_dist = 0;
-		bfs_ids.clear();
-		bfs_ids.set(bfs_id);
-		new_bfs_ids = bfs_ids;
-		updated = true;
-	}
-
-	void reset() {
-		max_dist = 0;
-		updated = false;
-		bfs_ids.clear();
-		new_bfs_ids.clear();
-	}
-
-	void run(vertex_program &prog) {
-		if (updated) {
-			updated = false;
-			directed_vertex_request req(prog.get_vertex_id(*this), traverse_edge);
-			request_partial_vertices(&req, 1);
-		}
-	}
-
-	void run(vertex_program &prog, const page_vertex &vertex);
-
-	void run_on_message(vertex_program &vprog, const vertex_message &msg) {
-		const diameter_message &dmsg = (const diameter_message &) msg;
-		if (new_bfs_ids.merge(dmsg.get_bfs_ids()))
-			vprog.request_notify_iter_end(*this);
-	}
-
-	void notify_iteration_end(vertex_program &vprog);
-};
-
 typedef std::pair<vertex_id_t, int> vertex_dist_t;
 
-template<class vertex_type>
-class diameter_vertex_program: public vertex_program_impl<vertex_type>
+/*
+ * It keeps the vertices with the largest distances from the start vertices.
+ * The vertices have to be added in ascending order of their distances.
+ */
+class farthest_vertices
 {
 	int curr_iter;
 	std::vector<vertex_dist_t> curr_vertices;
 	std::deque<vertex_dist_t> prev_vertices;
 public:
-	typedef std::shared_ptr<diameter_vertex_program<vertex_type> > ptr;
-
-	static ptr cast2(vertex_program::ptr prog) {
-		return std::static_pointer_cast<diameter_vertex_program<vertex_type>,
-			   vertex_program>(prog);
-	}
-
-	diameter_vertex_program() {
+	farthest_vertices() {
 		curr_iter = 0;
 	}
 
@@ -181,38 +81,53 @@ public:
 	}
 };
 
-void diameter_vertex::run(vertex_program &prog, const page_vertex &vertex)
+template<class vertex_type>
+class diameter_vertex_program: public vertex_program_impl<vertex_type>
 {
-	int num_dests = vertex.get_num_edges(traverse_edge);
-	if (num_dests == 0)
-		return;
-
-	// We need to add the neighbors of the vertex to the queue of
-	// the next level.
-	diameter_message msg(bfs_ids);
-	if (traverse_edge == BOTH_EDGES) {
-		edge_seq_iterator it = vertex.get_neigh_seq_it(IN_EDGE);
-		prog.multicast_msg(it, msg);
-		it = vertex.get_neigh_seq_it(OUT_EDGE);
-		prog.multicast_msg(it, msg);
+	farthest_vertices farthest;
+public:
+	typedef std::shared_ptr<diameter_vertex_program<vertex_type> > ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<diameter_vertex_program<vertex_type>,
+			   vertex_program>(prog);
 	}
-	else {
-		edge_seq_iterator it = vertex.get_neigh_seq_it(traverse_edge);
-		prog.multicast_msg(it, msg);
+
+	void set_max_dist(vertex_id_t id, int iter_no) {
+		farthest.set_max_dist(id, iter_no);
 	}
-}
 
-void diameter_vertex::notify_iteration_end(vertex_program &vprog)
+	void get_max_dist_vertices(std::vector<vertex_dist_t> &vertices) const {
+		farthest.get_max_dist_vertices(vertices);
+	}
+};
+
+/*
+ * It collects the farthest vertices in multi-source BFS.
+ */
+class diameter_visitor: public ms_bfs_visitor
 {
-	if (bfs_ids != new_bfs_ids) {
-		updated = true;
-		int iter_no = vprog.get_graph().get_curr_level() + 1;
-		max_dist = max(iter_no, max_dist);
-		((diameter_vertex_program<diameter_vertex> &) vprog).set_max_dist(
-			vprog.get_vertex_id(*this), iter_no);
+	farthest_vertices farthest;
+	std::vector<vertex_dist_t> max_dist_vertices;
+public:
+	virtual void visit(vertex_id_t id, int dist, const bfs_source_set &srcs) {
+		if (dist > 0)
+			farthest.set_max_dist(id, dist);
 	}
-	bfs_ids = new_bfs_ids;
-}
+
+	virtual ptr clone() const {
+		return ptr(new diameter_visitor());
+	}
+
+	virtual void merge(const ms_bfs_visitor &visitor) {
+		((const diameter_visitor &) visitor).farthest.get_max_dist_vertices(
+				max_dist_vertices);
+	}
+
+	const std::vector<vertex_dist_t> &get_max_dist_vertices() const {
+		return max_dist_vertices;
+	}
+};
 
 class dist_compare
 {
@@ -342,6 +257,14 @@ std::vector<vertex_dist_t> estimate_diameter_1sweep(graph_engine::ptr graph,
 	return max_dist_vertices;
 }
 
+std::vector<vertex_dist_t> estimate_diameter_ms_bfs(ms_bfs_engine::ptr engine,
+		const std::vector<vertex_id_t> &start_vertices)
+{
+	diameter_visitor visitor;
+	engine->run(start_vertices, traverse_edge, visitor);
+	return visitor.get_max_dist_vertices();
+}
+
 }
 
 namespace fg
@@ -349,25 +272,32 @@ namespace fg
 
 size_t estimate_diameter(FG_graph::ptr fg, int num_para_bfs, bool directed)
 {
-	if (!fg->get_graph_header().is_directed_graph()) {
-		BOOST_LOG_TRIVIAL(error)
-			<< "we can't estimate diameter on an undirected graph currently";
+	if (num_para_bfs <= 0) {
+		BOOST_LOG_TRIVIAL(error) << "we need at least one BFS in a sweep";
 		return 0;
 	}
 	num_bfs = num_para_bfs;
-	if (!directed)
+	bool directed_graph = fg->get_graph_header().is_directed_graph();
+	if (!directed && directed_graph)
 		traverse_edge = edge_type::BOTH_EDGES;
 	else
 		traverse_edge = edge_type::OUT_EDGE;
 
-	graph_index::ptr index;
-	if (num_bfs == 1)
-		index = NUMA_graph_index<simple_diameter_vertex>::create(
+	// A single BFS on a directed graph only needs to activate vertices.
+	// Otherwise, all BFS in a sweep run together in a multi-source BFS.
+	graph_engine::ptr graph;
+	ms_bfs_engine::ptr ms_engine;
+	if (num_bfs == 1 && directed_graph) {
+		graph_index::ptr index = NUMA_graph_index<simple_diameter_vertex>::create(
 				fg->get_graph_header());
-	else
-		index = NUMA_graph_index<diameter_vertex>::create(
-				fg->get_graph_header());
-	graph_engine::ptr graph = fg->create_engine(index);
+		graph = fg->create_engine(index);
+	}
+	else {
+		ms_engine = ms_bfs_engine::create(fg, num_bfs);
+		if (ms_engine == NULL)
+			return 0;
+	}
+	vertex_id_t max_vertex_id = fg->get_num_vertices() - 1;
 
 	BOOST_LOG_TRIVIAL(info) << "diameter estimation starts";
 	BOOST_LOG_TRIVIAL(info)
@@ -383,7 +313,7 @@ size_t estimate_diameter(FG_graph::ptr fg, int num_para_bfs, bool directed)
 	gettimeofday(&start, NULL);
 	std::vector<vertex_id_t> start_vertices;
 	while (start_vertices.size() < num_bfs) {
-		vertex_id_t id = random() % graph->get_max_vertex_id();
+		vertex_id_t id = random() % max_vertex_id;
 		start_vertices.push_back(id);
 	}
 
@@ -397,18 +327,18 @@ size_t estimate_diameter(FG_graph::ptr fg, int num_para_bfs, bool directed)
 		}
 
 		std::vector<vertex_dist_t> max_dist_vertices;
-		if (start_vertices.size() == 1)
+		if (graph)
 			max_dist_vertices = estimate_diameter_1sweep<simple_diameter_vertex>(
 					graph, start_vertices);
 		else
-			max_dist_vertices = estimate_diameter_1sweep<diameter_vertex>(
-					graph, start_vertices);
+			max_dist_vertices = estimate_diameter_ms_bfs(ms_engine,
+					start_vertices);
 
 		if (max_dist_vertices.empty()) {
 			size_t num_bfs = start_vertices.size();
 			start_vertices.clear();
 			while (start_vertices.size() < num_bfs) {
-				vertex_id_t id = random() % graph->get_max_vertex_id();
+				vertex_id_t id = random() % max_vertex_id;
 				start_vertices.push_back(id);
 			}
 		}
@@ -434,7 +364,7 @@ size_t estimate_diameter(FG_graph::ptr fg, int num_para_bfs, bool directed)
 				size_t num_bfs = start_vertices.size();
 				start_vertices.clear();
 				while (start_vertices.size() < num_bfs) {
-					vertex_id_t id = random() % graph->get_max_vertex_id();
+					vertex_id_t id = random() % max_vertex_id;
 					start_vertices.push_back(id);
 				}
 			}
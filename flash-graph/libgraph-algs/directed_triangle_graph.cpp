@@ -175,90 +175,18 @@ size_t directed_runtime_data_t::count_triangles(vertex_program &prog,
 		compute_directed_vertex &directed_v, const page_vertex &v)
 {
 	vertex_id_t id = prog.get_vertex_id(directed_v);
-	size_t num_local_triangles = 0;
 	assert(v.get_id() != id);
 
 	if (v.get_num_edges(edge_type::OUT_EDGE) == 0)
 		return 0;
 
 	/*
-	 * We search for triangles with two different ways:
-	 * binary search if two adjacency lists have very different sizes,
-	 * scan otherwise.
-	 *
-	 * when binary search for multiple neighbors, we can reduce binary search
-	 * overhead by using the new end in the search range. We can further reduce
-	 * overhead by searching in a reverse order (start from the largest neighbor).
-	 * Since vertices of smaller ID has more neighbors, it's more likely
-	 * that a neighbor is in the beginning of the adjacency list, and
-	 * the search range will be narrowed faster.
+	 * The intersection chooses the method based on the sizes of the two
+	 * lists. See runtime_data_t::count_triangles().
 	 */
-
-	if (this->edge_set.size() > 0
-			&& this->edges.size() > HASH_SEARCH_RATIO * v.get_num_edges(
-				edge_type::OUT_EDGE)) {
-		edge_iterator other_it = v.get_neigh_begin(edge_type::OUT_EDGE);
-		edge_iterator other_end = v.get_neigh_end(edge_type::OUT_EDGE);
-		for (; other_it != other_end; ++other_it) {
-			vertex_id_t neigh_neighbor = *other_it;
-			runtime_data_t::edge_set_t::const_iterator it
-				= this->edge_set.find(neigh_neighbor);
-			if (it != this->edge_set.end()) {
-				if (neigh_neighbor != v.get_id() && neigh_neighbor != id) {
-					num_local_triangles++;
-					int idx = (*it).get_idx();
-					this->triangles[idx]++;
-				}
-			}
-		}
-	}
-	// If the neighbor vertex has way more edges than this vertex.
-	else if (v.get_num_edges(edge_type::OUT_EDGE) / this->edges.size(
-				) > BIN_SEARCH_RATIO) {
-		edge_iterator other_it = v.get_neigh_begin(edge_type::OUT_EDGE);
-		edge_iterator other_end = v.get_neigh_end(edge_type::OUT_EDGE);
-		for (int i = this->edges.size() - 1; i >= 0; i--) {
-			vertex_id_t this_neighbor = this->edges.at(i);
-			// We need to skip loops.
-			if (this_neighbor != v.get_id() && this_neighbor != id) {
-				edge_iterator first = std::lower_bound(other_it, other_end,
-						this_neighbor);
-				if (first != other_end && this_neighbor == *first) {
-					num_local_triangles++;
-					this->triangles[i]++;
-				}
-				other_end = first;
-			}
-		}
-	}
-	else {
-		std::vector<vertex_id_t>::const_iterator this_it = this->edges.begin();
-		std::vector<int>::iterator count_it = this->triangles.begin();
-		std::vector<vertex_id_t>::const_iterator this_end = this->edges.end();
-		edge_seq_iterator other_it = v.get_neigh_seq_it(edge_type::OUT_EDGE, 0,
-					v.get_num_edges(edge_type::OUT_EDGE));
-		while (this_it != this_end && other_it.has_next()) {
-			vertex_id_t this_neighbor = *this_it;
-			vertex_id_t neigh_neighbor = other_it.curr();
-			if (this_neighbor == neigh_neighbor) {
-				// skip loop
-				if (neigh_neighbor != v.get_id() && neigh_neighbor != id) {
-					num_local_triangles++;
-					(*count_it)++;
-				}
-				++this_it;
-				other_it.next();
-				++count_it;
-			}
-			else if (this_neighbor < neigh_neighbor) {
-				++this_it;
-				++count_it;
-			}
-			else
-				other_it.next();
-		}
-	}
-	return num_local_triangles;
+	return runtime_data_t::count_triangles(
+			v.get_neigh_begin(edge_type::OUT_EDGE),
+			v.get_neigh_end(edge_type::OUT_EDGE), v.get_id(), id);
 }
 
 class directed_triangle_vertex: public compute_directed_vertex
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "edge_weight.h"
+
+namespace fg
+{
+
+bool get_weight_kind(FG_graph::ptr fg, const fm::scalar_type *type,
+		weight_kind &kind)
+{
+	if (type == NULL) {
+		kind = UNIT_WEIGHT;
+		return true;
+	}
+	if (*type == fm::get_scalar_type<int>())
+		kind = INT_WEIGHT;
+	else if (*type == fm::get_scalar_type<long>())
+		kind = LONG_WEIGHT;
+	else if (*type == fm::get_scalar_type<float>())
+		kind = FLOAT_WEIGHT;
+	else if (*type == fm::get_scalar_type<double>())
+		kind = DOUBLE_WEIGHT;
+	else {
+		BOOST_LOG_TRIVIAL(error) << "unsupported edge weight type";
+		return false;
+	}
+	if ((size_t) fg->get_graph_header().get_edge_data_size()
+			!= type->get_size()) {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"edge weights have %1% bytes, but the graph has %2% bytes of edge data")
+			% type->get_size() % fg->get_graph_header().get_edge_data_size();
+		return false;
+	}
+	return true;
+}
+
+}
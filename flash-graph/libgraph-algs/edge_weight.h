@@ -0,0 +1,109 @@
+#ifndef __EDGE_WEIGHT_H__
+#define __EDGE_WEIGHT_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "graph_engine.h"
+#include "FGlib.h"
+
+/*
+ * This helps the graph algorithms that read edge weights of different
+ * types. An algorithm gets the kind of the weights once before it runs and
+ * dispatches to the code instantiated for the C++ type of the weights when
+ * it processes an edge list.
+ */
+
+namespace fg
+{
+
+enum weight_kind
+{
+	UNIT_WEIGHT,
+	INT_WEIGHT,
+	LONG_WEIGHT,
+	FLOAT_WEIGHT,
+	DOUBLE_WEIGHT,
+};
+
+/*
+ * Get the kind of edge weights from the type given by users. A NULL type
+ * means all edges have a weight of 1. It returns false if the type isn't
+ * supported or doesn't match the size of the edge data in the graph.
+ */
+bool get_weight_kind(FG_graph::ptr fg, const fm::scalar_type *type,
+		weight_kind &kind);
+
+/*
+ * Invoke `func.run<weight_t>()' with the C++ type of the weights.
+ * With unit weights, weight_t is char and no edge data should be read.
+ */
+template<class Func>
+void dispatch_weight(weight_kind kind, Func &func)
+{
+	switch (kind) {
+		case INT_WEIGHT:
+			func.template run<int>();
+			break;
+		case LONG_WEIGHT:
+			func.template run<long>();
+			break;
+		case FLOAT_WEIGHT:
+			func.template run<float>();
+			break;
+		case DOUBLE_WEIGHT:
+			func.template run<double>();
+			break;
+		default:
+			func.template run<char>();
+	}
+}
+
+/*
+ * Invoke `func(neighbor, weight)' on the out-edges of a vertex in
+ * an undirected graph. Self-loops are skipped.
+ */
+template<class weight_t, class Func>
+void for_each_weighted_edge(weight_kind kind, vertex_id_t id,
+		const page_vertex &vertex, Func func)
+{
+	edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE, 0,
+			vertex.get_num_edges(edge_type::OUT_EDGE));
+	if (kind == UNIT_WEIGHT) {
+		while (it.has_next()) {
+			vertex_id_t neigh = it.next();
+			if (neigh != id)
+				func(neigh, 1.0);
+		}
+		return;
+	}
+
+	safs::page_byte_array::seq_const_iterator<weight_t> data_it
+		= ((const page_undirected_vertex &) vertex).get_data_seq_it<weight_t>();
+	while (it.has_next()) {
+		vertex_id_t neigh = it.next();
+		weight_t w = data_it.next();
+		if (neigh != id)
+			func(neigh, (double) w);
+	}
+}
+
+}
+
+#endif
@@ -81,17 +81,16 @@ public:
 	}
 };
 
-runtime_data_t *construct_runtime(vertex_program &prog, const page_vertex &vertex,
-		size_t num_local_edges, std::vector<vertex_id_t> &neighbors,
-		vertex_id_t id_start, vertex_id_t id_end)
+/*
+ * Select the neighbors whose edges we need to read. The page vertex may
+ * only contain a range of the edges.
+ */
+void select_neighbors(vertex_program &prog, const page_vertex &vertex,
+		size_t num_local_edges, std::vector<vertex_id_t> &neighbors)
 {
-	std::vector<vertex_id_t> in_mem_edges;
-
 	edge_seq_iterator it = vertex.get_neigh_seq_it(neigh_edge_type, 0,
 				vertex.get_num_edges(neigh_edge_type));
 	PAGE_FOREACH(vertex_id_t, id, it) {
-		if (id < id_start || id >= id_end)
-			continue;
 		size_t num_local_edges1 = prog.get_num_edges(id);
 		if ((num_local_edges1 < num_local_edges && id != vertex.get_id())
 				|| (num_local_edges1 == num_local_edges
@@ -99,17 +98,26 @@ runtime_data_t *construct_runtime(vertex_program &prog, const page_vertex &verte
 			neighbors.push_back(id);
 		}
 	} PAGE_FOREACH_END
-	if (neighbors.empty()) {
 #ifdef DEBUG
+	if (neighbors.empty()) {
 		long ret = num_completed_vertices.inc(1);
 		if (ret % 100000 == 0)
 			BOOST_LOG_TRIVIAL(debug)
 				<< boost::format("%1% completed vertices") % ret;
-#endif
-		return NULL;
 	}
+#endif
+}
+
+/*
+ * Construct the runtime data from the edges kept in memory. The neighbors
+ * have been selected.
+ */
+runtime_data_t *construct_runtime(vertex_program &prog, const page_vertex &vertex,
+		size_t num_local_edges, const std::vector<vertex_id_t> &neighbors)
+{
+	std::vector<vertex_id_t> in_mem_edges;
 
-	it = vertex.get_neigh_seq_it(in_mem_edge_type, 0,
+	edge_seq_iterator it = vertex.get_neigh_seq_it(in_mem_edge_type, 0,
 			vertex.get_num_edges(in_mem_edge_type));
 	PAGE_FOREACH(vertex_id_t, id, it) {
 		size_t num_local_edges1 = prog.get_num_edges(id);
@@ -140,92 +148,17 @@ runtime_data_t *construct_runtime(vertex_program &prog, const page_vertex &verte
 size_t count_triangles(runtime_data_t *data, const page_vertex &v,
 		vertex_id_t this_id)
 {
-	size_t num_local_triangles = 0;
-
 	if (v.get_num_edges(neigh_edge_type) == 0)
 		return 0;
 
 	/*
-	 * We search for triangles with two different ways:
-	 * binary search if two adjacency lists have very different sizes,
-	 * scan otherwise.
-	 *
-	 * when binary search for multiple neighbors, we can reduce binary search
-	 * overhead by using the new end in the search range. We can further reduce
-	 * overhead by searching in a reverse order (start from the largest neighbor).
-	 * Since vertices of smaller ID has more neighbors, it's more likely
-	 * that a neighbor is in the beginning of the adjacency list, and
-	 * the search range will be narrowed faster.
+	 * The intersection chooses the method based on the sizes of the two
+	 * lists: it looks up the neighbor's edges in the index of a hub vertex,
+	 * gallops in the neighbor's edge list if the neighbor has way more
+	 * edges, and merges the two lists with SIMD instructions otherwise.
 	 */
-
-	if (data->edge_set.size() > 0
-			&& data->edges.size() > HASH_SEARCH_RATIO * v.get_num_edges(
-				neigh_edge_type)) {
-		edge_iterator other_it = v.get_neigh_begin(neigh_edge_type);
-		edge_iterator other_end = v.get_neigh_end(neigh_edge_type);
-		for (; other_it != other_end; ++other_it) {
-			vertex_id_t neigh_neighbor = *other_it;
-			runtime_data_t::edge_set_t::const_iterator it
-				= data->edge_set.find(neigh_neighbor);
-			if (it != data->edge_set.end()) {
-				if (neigh_neighbor != v.get_id()
-						&& neigh_neighbor != this_id) {
-					num_local_triangles++;
-					int idx = (*it).get_idx();
-					data->triangles[idx]++;
-				}
-			}
-		}
-	}
-	// If the neighbor vertex has way more edges than this vertex.
-	else if (v.get_num_edges(neigh_edge_type) / data->edges.size(
-				) > BIN_SEARCH_RATIO) {
-		edge_iterator other_it = v.get_neigh_begin(neigh_edge_type);
-		edge_iterator other_end = v.get_neigh_end(neigh_edge_type);
-		for (int i = data->edges.size() - 1; i >= 0; i--) {
-			vertex_id_t this_neighbor = data->edges.at(i);
-			// We need to skip loops.
-			if (this_neighbor != v.get_id()
-					&& this_neighbor != this_id) {
-				edge_iterator first = std::lower_bound(other_it, other_end,
-						this_neighbor);
-				if (first != other_end && this_neighbor == *first) {
-					num_local_triangles++;
-					data->triangles[i]++;
-				}
-				other_end = first;
-			}
-		}
-	}
-	else {
-		std::vector<vertex_id_t>::const_iterator this_it = data->edges.begin();
-		std::vector<int>::iterator count_it = data->triangles.begin();
-		std::vector<vertex_id_t>::const_iterator this_end = data->edges.end();
-		edge_seq_iterator other_it = v.get_neigh_seq_it(neigh_edge_type, 0,
-					v.get_num_edges(neigh_edge_type));
-		while (this_it != this_end && other_it.has_next()) {
-			vertex_id_t this_neighbor = *this_it;
-			vertex_id_t neigh_neighbor = other_it.curr();
-			if (this_neighbor == neigh_neighbor) {
-				// skip loop
-				if (neigh_neighbor != v.get_id()
-						&& neigh_neighbor != this_id) {
-					num_local_triangles++;
-					(*count_it)++;
-				}
-				++this_it;
-				other_it.next();
-				++count_it;
-			}
-			else if (this_neighbor < neigh_neighbor) {
-				++this_it;
-				++count_it;
-			}
-			else
-				other_it.next();
-		}
-	}
-	return num_local_triangles;
+	return data->count_triangles(v.get_neigh_begin(neigh_edge_type),
+			v.get_neigh_end(neigh_edge_type), v.get_id(), this_id);
 }
 
 void directed_triangle_vertex::run_on_itself(vertex_program &prog,
@@ -254,9 +187,12 @@ void directed_triangle_vertex::run_on_itself(vertex_program &prog,
 	}
 
 	std::vector<vertex_id_t> selected_neighbors;
-	runtime_data_t *data = construct_runtime(prog, vertex,
-			prog.get_num_edges(vertex.get_id()), selected_neighbors, 0,
-			prog.get_graph().get_max_vertex_id() + 1);
+	size_t num_local_edges = prog.get_num_edges(vertex.get_id());
+	select_neighbors(prog, vertex, num_local_edges, selected_neighbors);
+	if (selected_neighbors.empty())
+		return;
+	runtime_data_t *data = construct_runtime(prog, vertex, num_local_edges,
+			selected_neighbors);
 	if (data == NULL)
 		return;
 
@@ -314,9 +250,16 @@ void directed_triangle_vertex::run_on_neighbor(vertex_program &prog,
 	}
 }
 
+/*
+ * A vertical partition of a large vertex only reads its range of in-edges
+ * and selects the neighbors in the range. It then reads the out-edges of
+ * the vertex to construct the runtime data.
+ */
 class part_directed_triangle_vertex: public part_compute_directed_vertex
 {
 	triangle_multi_func_value local_value;
+	// The neighbors selected from the range of in-edges.
+	std::vector<vertex_id_t> selected_neighbors;
 
 	void inc_num_triangles(size_t num) {
 		if (local_value.has_num_triangles())
@@ -329,24 +272,23 @@ public:
 			int part_id): part_compute_directed_vertex(id, part_id) {
 	}
 
-	void run(vertex_program &prog) {
-		vertex_id_t id = prog.get_vertex_id(*this);
-		request_vertices(&id, 1);
-	}
+	void run(vertex_program &prog);
 
 	void run(vertex_program &prog, const page_vertex &vertex) {
-		if (vertex.get_id() == prog.get_vertex_id(*this))
-			run_on_itself(prog, vertex);
-		else
+		if (vertex.get_id() != prog.get_vertex_id(*this))
 			run_on_neighbor(prog, vertex);
+		else if (((const page_directed_vertex &) vertex).has_in_part())
+			run_on_in_edges(prog, vertex);
+		else
+			run_on_out_edges(prog, vertex);
 	}
 
-	void run_on_itself(vertex_program &prog, const page_vertex &vertex);
+	void run_on_in_edges(vertex_program &prog, const page_vertex &vertex);
+	void run_on_out_edges(vertex_program &prog, const page_vertex &vertex);
 	void run_on_neighbor(vertex_program &prog, const page_vertex &vertex);
 };
 
-void part_directed_triangle_vertex::run_on_itself(vertex_program &prog,
-		const page_vertex &vertex)
+void part_directed_triangle_vertex::run(vertex_program &prog)
 {
 	assert(!local_value.has_runtime_data());
 
@@ -359,8 +301,10 @@ void part_directed_triangle_vertex::run_on_itself(vertex_program &prog,
 	// A vertex has to have in-edges and out-edges in order to form
 	// a triangle. so we can simply skip the vertices that don't have
 	// either of them.
-	if (vertex.get_num_edges(edge_type::OUT_EDGE) == 0
-			|| vertex.get_num_edges(edge_type::IN_EDGE) == 0) {
+	const graph_engine &graph = prog.get_graph();
+	vsize_t num_in_edges = graph.get_num_edges(get_id(), edge_type::IN_EDGE);
+	if (graph.get_num_edges(get_id(), edge_type::OUT_EDGE) == 0
+			|| num_in_edges == 0) {
 #ifdef DEBUG
 		long ret = num_completed_vertices.inc(1);
 		if (ret % 100000 == 0)
@@ -370,15 +314,34 @@ void part_directed_triangle_vertex::run_on_itself(vertex_program &prog,
 		return;
 	}
 
-	vertex_id_t max_id = prog.get_graph().get_max_vertex_id();
-	vsize_t part_range
-		= ceil(((double) max_id + 1) / graph_conf.get_num_vparts());
-	vertex_id_t id_start = part_range * this->get_part_id();
-	vertex_id_t id_end = id_start + part_range;
+	vsize_t start, end;
+	get_edge_range(num_in_edges, start, end);
+	if (start >= end)
+		return;
+	directed_vertex_request req(get_id(), neigh_edge_type, start, end);
+	request_partial_vertices(&req, 1);
+}
 
-	std::vector<vertex_id_t> selected_neighbors;
+void part_directed_triangle_vertex::run_on_in_edges(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	assert(selected_neighbors.empty());
+	select_neighbors(prog, vertex, prog.get_num_edges(get_id()),
+			selected_neighbors);
+	if (selected_neighbors.empty())
+		return;
+
+	directed_vertex_request req(get_id(), in_mem_edge_type);
+	request_partial_vertices(&req, 1);
+}
+
+void part_directed_triangle_vertex::run_on_out_edges(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	std::vector<vertex_id_t> neighbors;
+	neighbors.swap(selected_neighbors);
 	runtime_data_t *data = construct_runtime(prog, vertex,
-			prog.get_num_edges(get_id()), selected_neighbors, id_start, id_end);
+			prog.get_num_edges(get_id()), neighbors);
 	if (data == NULL)
 		return;
 
@@ -388,14 +351,9 @@ void part_directed_triangle_vertex::run_on_itself(vertex_program &prog,
 	// TODO Maybe I should avoid that.
 	assert(local_value.get_num_triangles() == 0);
 	local_value.set_runtime_data(data);
-	std::vector<directed_vertex_request> reqs;
-	for (size_t i = 0; i < selected_neighbors.size(); i++) {
-		vertex_id_t id = selected_neighbors[i];
-		assert(id >= id_start && id < id_end);
-		reqs.push_back(directed_vertex_request(id, neigh_edge_type));
-	}
-	assert(!reqs.empty());
-	data->num_required = reqs.size();
+	std::vector<directed_vertex_request> reqs(neighbors.size());
+	for (size_t i = 0; i < neighbors.size(); i++)
+		reqs[i] = directed_vertex_request(neighbors[i], neigh_edge_type);
 	request_partial_vertices(reqs.data(), reqs.size());
 }
 
@@ -0,0 +1,475 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <immintrin.h>
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <math.h>
+
+#include <new>
+#include <vector>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+#include "mem_vec_store.h"
+
+/*
+ * This is HyperANF (Boldi, Rosa and Vigna). Each vertex keeps
+ * a HyperLogLog counter of the vertices within distance t from it.
+ * In level t, a vertex whose counter changed in the previous level sends
+ * its counter to the vertices that reach it in one hop, and they take
+ * the register-wise max. The sum of the estimates of all counters after
+ * level t is the neighbourhood function N(t), the number of pairs of
+ * vertices within distance t.
+ */
+
+using namespace fg;
+
+namespace
+{
+
+int num_reg_bits;
+size_t num_regs;
+edge_type traverse_edge = edge_type::OUT_EDGE;
+bool directed;
+
+/*
+ * The registers of the counters of all vertices are stored contiguously
+ * in the order of vertex IDs. `curr_regs' holds the counters at the end
+ * of the previous level, which are sent to other vertices, and `next_regs'
+ * holds the counters being merged in the current level. A vertex only
+ * merges counters into its own registers in its owner thread, and only
+ * reads its own registers in `curr_regs'.
+ */
+std::vector<uint8_t> curr_regs;
+std::vector<uint8_t> next_regs;
+
+uint8_t *get_curr_regs(vertex_id_t id)
+{
+	return curr_regs.data() + id * num_regs;
+}
+
+uint8_t *get_next_regs(vertex_id_t id)
+{
+	return next_regs.data() + id * num_regs;
+}
+
+uint64_t hash_vertex(vertex_id_t id)
+{
+	// The finalizer of MurmurHash3.
+	uint64_t h = id + 0x9e3779b97f4a7c15UL;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdUL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53UL;
+	h ^= h >> 33;
+	return h;
+}
+
+void init_counter(vertex_id_t id, uint8_t regs[])
+{
+	memset(regs, 0, num_regs);
+	uint64_t h = hash_vertex(id);
+	size_t idx = h >> (64 - num_reg_bits);
+	// The rank is the position of the first 1 bit in the rest of the hash.
+	uint64_t rest = h << num_reg_bits;
+	int rank = rest ? __builtin_clzl(rest) + 1 : 64 - num_reg_bits + 1;
+	regs[idx] = rank;
+}
+
+/*
+ * Take the register-wise max of two counters. It returns true if any
+ * register in `regs' changes. The number of registers is a multiple of 16.
+ */
+bool merge_counter(uint8_t regs[], const uint8_t other[])
+{
+	bool changed = false;
+	size_t i = 0;
+#ifdef __AVX2__
+	for (; i + 32 <= num_regs; i += 32) {
+		__m256i v1 = _mm256_loadu_si256((const __m256i *) (regs + i));
+		__m256i v2 = _mm256_loadu_si256((const __m256i *) (other + i));
+		__m256i res = _mm256_max_epu8(v1, v2);
+		changed |= _mm256_movemask_epi8(_mm256_cmpeq_epi8(res, v1)) != -1;
+		_mm256_storeu_si256((__m256i *) (regs + i), res);
+	}
+#endif
+#ifdef __SSE2__
+	for (; i + 16 <= num_regs; i += 16) {
+		__m128i v1 = _mm_loadu_si128((const __m128i *) (regs + i));
+		__m128i v2 = _mm_loadu_si128((const __m128i *) (other + i));
+		__m128i res = _mm_max_epu8(v1, v2);
+		changed |= _mm_movemask_epi8(_mm_cmpeq_epi8(res, v1)) != 0xffff;
+		_mm_storeu_si128((__m128i *) (regs + i), res);
+	}
+#endif
+	for (; i < num_regs; i++) {
+		if (other[i] > regs[i]) {
+			regs[i] = other[i];
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+double estimate_counter(const uint8_t regs[])
+{
+	double m = num_regs;
+	double alpha;
+	if (num_regs == 16)
+		alpha = 0.673;
+	else if (num_regs == 32)
+		alpha = 0.697;
+	else if (num_regs == 64)
+		alpha = 0.709;
+	else
+		alpha = 0.7213 / (1 + 1.079 / m);
+	double sum = 0;
+	size_t num_zeros = 0;
+	for (size_t i = 0; i < num_regs; i++) {
+		sum += ldexp(1, -regs[i]);
+		num_zeros += regs[i] == 0;
+	}
+	double est = alpha * m * m / sum;
+	// Use linear counting for small cardinalities.
+	if (est <= 2.5 * m && num_zeros > 0)
+		est = m * log(m / num_zeros);
+	return est;
+}
+
+/*
+ * The message carries the registers of a counter after the header.
+ */
+class counter_message: public vertex_message
+{
+	uint8_t regs[0];
+public:
+	static size_t get_size() {
+		return sizeof(counter_message) + num_regs;
+	}
+
+	counter_message(): vertex_message(get_size(), true) {
+	}
+
+	uint8_t *get_regs() {
+		return regs;
+	}
+
+	const uint8_t *get_regs() const {
+		return regs;
+	}
+};
+
+class anf_vertex: public compute_directed_vertex
+{
+	// The estimated size of the ball of the vertex.
+	float size;
+	// The sum of 1 / dist over the vertices reached by the vertex.
+	float harmonic;
+	// Whether the counter changed in the previous level.
+	bool changed;
+public:
+	anf_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		size = 0;
+		harmonic = 0;
+		changed = false;
+	}
+
+	void init(vertex_id_t id) {
+		init_counter(id, get_curr_regs(id));
+		memcpy(get_next_regs(id), get_curr_regs(id), num_regs);
+		size = estimate_counter(get_curr_regs(id));
+		harmonic = 0;
+		changed = true;
+	}
+
+	float get_size() const {
+		return size;
+	}
+
+	float get_harmonic() const {
+		return harmonic;
+	}
+
+	void run(vertex_program &prog);
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (merge_counter(get_next_regs(id),
+					((const counter_message &) msg).get_regs()))
+			prog.request_notify_iter_end(*this);
+	}
+
+	void notify_iteration_end(vertex_program &prog);
+};
+
+class anf_vertex_program: public vertex_program_impl<anf_vertex>
+{
+	// The increase of the neighbourhood function in each level.
+	std::vector<double> nf_deltas;
+public:
+	typedef std::shared_ptr<anf_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<anf_vertex_program, vertex_program>(
+				prog);
+	}
+
+	void add_delta(int dist, double delta) {
+		if (nf_deltas.size() <= (size_t) dist)
+			nf_deltas.resize(dist + 1);
+		nf_deltas[dist] += delta;
+	}
+
+	const std::vector<double> &get_deltas() const {
+		return nf_deltas;
+	}
+};
+
+class anf_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new anf_vertex_program());
+	}
+};
+
+void anf_vertex::run(vertex_program &prog)
+{
+	if (!changed)
+		return;
+
+	// The counter of the vertex flows to the vertices that reach it,
+	// so we read the edges in the opposite direction of traversal.
+	vertex_id_t id = prog.get_vertex_id(*this);
+	if (!directed) {
+		request_vertices(&id, 1);
+		return;
+	}
+	edge_type type;
+	if (traverse_edge == edge_type::IN_EDGE)
+		type = edge_type::OUT_EDGE;
+	else if (traverse_edge == edge_type::OUT_EDGE)
+		type = edge_type::IN_EDGE;
+	else
+		type = edge_type::BOTH_EDGES;
+	directed_vertex_request req(id, type);
+	request_partial_vertices(&req, 1);
+}
+
+void anf_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	changed = false;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	stack_array<char, 1024> buf(counter_message::get_size());
+	counter_message *msg = new (buf.data()) counter_message();
+	memcpy(msg->get_regs(), get_curr_regs(id), num_regs);
+
+	std::vector<edge_type> types;
+	if (!directed)
+		types.push_back(edge_type::OUT_EDGE);
+	else if (traverse_edge == edge_type::IN_EDGE)
+		types.push_back(edge_type::OUT_EDGE);
+	else if (traverse_edge == edge_type::OUT_EDGE)
+		types.push_back(edge_type::IN_EDGE);
+	else {
+		types.push_back(edge_type::IN_EDGE);
+		types.push_back(edge_type::OUT_EDGE);
+	}
+	for (size_t i = 0; i < types.size(); i++) {
+		if (vertex.get_num_edges(types[i]) == 0)
+			continue;
+		edge_seq_iterator it = vertex.get_neigh_seq_it(types[i]);
+		prog.multicast_msg(it, *msg);
+	}
+}
+
+void anf_vertex::notify_iteration_end(vertex_program &prog)
+{
+	vertex_id_t id = prog.get_vertex_id(*this);
+	uint8_t *curr = get_curr_regs(id);
+	const uint8_t *next = get_next_regs(id);
+	memcpy(curr, next, num_regs);
+	// The vertices added to the ball in level t are at distance t + 1.
+	int dist = prog.get_graph().get_curr_level() + 1;
+	float new_size = estimate_counter(curr);
+	// HyperLogLog estimates aren't monotonic, so we ignore a decrease
+	// to keep the neighbourhood function monotonic.
+	if (new_size > size) {
+		harmonic += (new_size - size) / dist;
+		((anf_vertex_program &) prog).add_delta(dist, new_size - size);
+		size = new_size;
+	}
+	changed = true;
+}
+
+class anf_initializer: public vertex_initializer
+{
+	graph_engine &graph;
+public:
+	anf_initializer(graph_engine &_graph): graph(_graph) {
+	}
+
+	void init(compute_vertex &v) {
+		((anf_vertex &) v).init(graph.get_graph_index().get_vertex_id(v));
+	}
+};
+
+class anf_save_query: public vertex_query
+{
+	fm::detail::mem_vec_store::ptr harmonic;
+	fm::detail::mem_vec_store::ptr reach;
+public:
+	anf_save_query(fm::detail::mem_vec_store::ptr harmonic,
+			fm::detail::mem_vec_store::ptr reach) {
+		this->harmonic = harmonic;
+		this->reach = reach;
+	}
+
+	virtual void run(graph_engine &graph, compute_vertex &v1) {
+		anf_vertex &v = (anf_vertex &) v1;
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		harmonic->set<double>(id, v.get_harmonic());
+		reach->set<double>(id, v.get_size());
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new anf_save_query(harmonic, reach));
+	}
+};
+
+}
+
+namespace fg
+{
+
+double hyper_anf_result::get_effective_diameter(double alpha) const
+{
+	if (nf.empty())
+		return 0;
+	// We interpolate between the two distances around the threshold.
+	double threshold = nf.back() * alpha;
+	for (size_t t = 0; t < nf.size(); t++) {
+		if (nf[t] >= threshold) {
+			if (t == 0)
+				return 0;
+			return t - 1 + (threshold - nf[t - 1]) / (nf[t] - nf[t - 1]);
+		}
+	}
+	return nf.size() - 1;
+}
+
+double hyper_anf_result::get_average_distance() const
+{
+	if (nf.size() < 2 || nf.back() <= nf[0])
+		return 0;
+	double sum = 0;
+	for (size_t t = 1; t < nf.size(); t++)
+		sum += t * (nf[t] - nf[t - 1]);
+	return sum / (nf.back() - nf[0]);
+}
+
+hyper_anf_result compute_hyper_anf(FG_graph::ptr fg, edge_type traverse_e,
+		int log2m)
+{
+	hyper_anf_result res;
+	if (log2m < 4 || log2m > 10) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "the log of the number of registers has to be in [4, 10]";
+		return res;
+	}
+	num_reg_bits = log2m;
+	num_regs = 1UL << log2m;
+	traverse_edge = traverse_e;
+	directed = fg->get_graph_header().is_directed_graph();
+	size_t num_vertices = fg->get_num_vertices();
+	curr_regs.resize(num_vertices * num_regs);
+	next_regs.resize(num_vertices * num_regs);
+
+	graph_index::ptr index = NUMA_graph_index<anf_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"HyperANF starts with %1% registers per counter") % num_regs;
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	graph->init_all_vertices(vertex_initializer::ptr(
+				new anf_initializer(*graph)));
+	graph->start_all(vertex_initializer::ptr(),
+			vertex_program_creater::ptr(new anf_vertex_program_creater()));
+	graph->wait4complete();
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"HyperANF takes %1% seconds and %2% levels")
+		% time_diff(start, end) % graph->get_curr_level();
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	// All counters start with a single vertex, so they have
+	// the same estimate.
+	std::vector<uint8_t> regs(num_regs);
+	init_counter(0, regs.data());
+	res.nf.push_back(estimate_counter(regs.data()) * num_vertices);
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		const std::vector<double> &deltas
+			= anf_vertex_program::cast2(vprog)->get_deltas();
+		if (res.nf.size() < deltas.size())
+			res.nf.resize(deltas.size(), 0);
+		for (size_t t = 1; t < deltas.size(); t++)
+			res.nf[t] += deltas[t];
+	}
+	for (size_t t = 1; t < res.nf.size(); t++)
+		res.nf[t] += res.nf[t - 1];
+
+	fm::detail::mem_vec_store::ptr harmonic = fm::detail::mem_vec_store::create(
+			num_vertices, safs::params.get_num_nodes(),
+			fm::get_scalar_type<double>());
+	fm::detail::mem_vec_store::ptr reach = fm::detail::mem_vec_store::create(
+			num_vertices, safs::params.get_num_nodes(),
+			fm::get_scalar_type<double>());
+	graph->query_on_all(vertex_query::ptr(new anf_save_query(harmonic, reach)));
+	res.harmonic = fm::vector::create(harmonic);
+	res.reach = fm::vector::create(reach);
+
+	curr_regs.clear();
+	curr_regs.shrink_to_fit();
+	next_regs.clear();
+	next_regs.shrink_to_fit();
+	return res;
+}
+
+}
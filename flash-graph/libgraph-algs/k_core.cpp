@@ -98,8 +98,38 @@ class kcore_vertex: public compute_vertex
 // and activate them
 class deleted_message: public vertex_message
 {
+	// The number of deleted neighbors.
+	vsize_t num_deleted;
 	public:
 		deleted_message(): vertex_message(sizeof(deleted_message), true) {
+			num_deleted = 1;
+		}
+
+		vsize_t get_value() const {
+			return num_deleted;
+		}
+
+		void set_value(vsize_t num_deleted) {
+			this->num_deleted = num_deleted;
+		}
+};
+
+// The messages to the same vertex are combined into one that carries
+// the number of deleted neighbors.
+class kcore_vertex_program: public vertex_program_impl<kcore_vertex>
+{
+	public:
+		kcore_vertex_program() {
+			set_combiner(msg_combiner_impl<deleted_message,
+					sum_msg_op<deleted_message> >::create());
+		}
+};
+
+class kcore_vertex_program_creater: public vertex_program_creater
+{
+	public:
+		vertex_program::ptr create() const {
+			return vertex_program::ptr(new kcore_vertex_program());
 		}
 };
 
@@ -111,6 +141,7 @@ void multicast_delete_msg(vertex_program &prog,
 
 	// Doesn't matter who sent it, just --degree on reception 
 	deleted_message msg;
+	msg.set_combinable(true);
 	prog.multicast_msg(it, msg);
 }
 
@@ -149,12 +180,13 @@ void kcore_vertex::run(vertex_program &prog, const page_vertex &vertex) {
 	}
 }
 
-void kcore_vertex::run_on_message(vertex_program &prog, const vertex_message &msg) {
+void kcore_vertex::run_on_message(vertex_program &prog, const vertex_message &msg1) {
 	if (is_deleted()) {
 		return; // nothing to be done here
 	}
 	// else
-	degree--;
+	const deleted_message &msg = (const deleted_message &) msg1;
+	degree -= msg.get_value();
 }
 
 class count_vertex_query: public vertex_query
@@ -318,7 +350,8 @@ fm::vector::ptr compute_kcore(FG_graph::ptr fg, size_t k, size_t kmax)
 		std::shared_ptr<vertex_filter> filter
 			= std::shared_ptr<vertex_filter>(new activate_k_filter(CURRENT_K));
 
-		graph->start(filter, vertex_program_creater::ptr()); 
+		graph->start(filter, vertex_program_creater::ptr(
+					new kcore_vertex_program_creater()));
 		graph->wait4complete();
 
 		if (all_greater_than_core) { // There's a chance we can hop forward
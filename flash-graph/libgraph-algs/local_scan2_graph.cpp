@@ -24,6 +24,7 @@
 
 #include "vertex.h"
 #include "FGlib.h"
+#include "set_intersection.h"
 #include "save_result.h"
 
 using namespace fg;
@@ -37,6 +38,52 @@ enum scan2_stage_t
 	REQ_NEIGH2,
 };
 
+/*
+ * The vertices two hops away from a vertex. We collect them in a hash set
+ * first. Once all of them are collected, we sort them, so we can intersect
+ * them with the edge lists of the vertices.
+ */
+struct two_hop_neighbors
+{
+	std::unordered_set<vertex_id_t> set;
+	std::vector<vertex_id_t> ids;
+	sorted_id_list list;
+
+	void finalize() {
+		ids.assign(set.begin(), set.end());
+		std::unordered_set<vertex_id_t>().swap(set);
+		std::sort(ids.begin(), ids.end());
+		list = sorted_id_list(ids.data(), ids.size());
+		list.build_index();
+	}
+};
+
+/*
+ * This counts the edges between the vertices two hops away from a vertex.
+ */
+class two_hop_edge_counter
+{
+	const two_hop_neighbors &neighbors2;
+	vertex_id_t id;
+	size_t num_edges;
+public:
+	two_hop_edge_counter(const two_hop_neighbors &_neighbors2,
+			vertex_id_t id): neighbors2(_neighbors2) {
+		this->id = id;
+		num_edges = 0;
+	}
+
+	void operator()(uint32_t idx, uint32_t num) {
+		// We count each edge only once.
+		if (neighbors2.ids[idx] > id)
+			num_edges += num;
+	}
+
+	size_t get_num_edges() const {
+		return num_edges;
+	}
+};
+
 class local_scan2_vertex: public compute_vertex
 {
 	size_t local_scan2;
@@ -45,7 +92,7 @@ class local_scan2_vertex: public compute_vertex
 	// The direct neighbors.
 	std::unordered_set<vertex_id_t> *neighbors;
 	// The vertices reached in the second hop.
-	std::unordered_set<vertex_id_t> *neighbors2;
+	two_hop_neighbors *neighbors2;
 public:
 	local_scan2_vertex(vertex_id_t id): compute_vertex(id) {
 		neighbors2 = NULL;
@@ -95,7 +142,7 @@ void local_scan2_vertex::run_on_itself(vertex_program &prog,
 	vertex_id_t id = prog.get_vertex_id(*this);
 	neighbors->erase(id);
 
-	neighbors2 = new std::unordered_set<vertex_id_t>();
+	neighbors2 = new two_hop_neighbors();
 	num_fetched = 0;
 
 	// Here we request all direct neighbors.
@@ -137,7 +184,7 @@ void local_scan2_vertex::run_on_neighs_neigh_list(vertex_program &prog,
 			// However, if the vertex isn't the current vertex, it must be
 			// two hops away from the current vertex.
 			if (id != curr_id)
-				neighbors2->insert(id);
+				neighbors2->set.insert(id);
 		}
 	} PAGE_FOREACH_END
 }
@@ -160,18 +207,17 @@ void local_scan2_vertex::run_on_neighbor(vertex_program &prog,
 		// neighbors2 contain neighbors and the current vertex.
 		// We need to remove them from neighbors2.
 		BOOST_FOREACH(vertex_id_t id, *neighbors)
-			neighbors2->erase(id);
+			neighbors2->set.erase(id);
 		vertex_id_t curr_id = prog.get_vertex_id(*this);
-		neighbors2->erase(curr_id);
+		neighbors2->set.erase(curr_id);
 
-		if (neighbors2->empty()) {
+		if (neighbors2->set.empty()) {
 			delete neighbors2;
 			neighbors2 = NULL;
 		}
 		else {
-			std::vector<vertex_id_t> neigh_vec(neighbors2->begin(),
-					neighbors2->end());
-			request_vertices(neigh_vec.data(), neigh_vec.size());
+			neighbors2->finalize();
+			request_vertices(neighbors2->ids.data(), neighbors2->ids.size());
 		}
 		delete neighbors;
 		neighbors = NULL;
@@ -181,16 +227,12 @@ void local_scan2_vertex::run_on_neighbor(vertex_program &prog,
 void local_scan2_vertex::run_on_neighs2_neigh_list(vertex_program &prog,
 		const page_vertex &vertex, edge_type type)
 {
-	auto it = vertex.get_neigh_seq_it(type);
-	PAGE_FOREACH(vertex_id_t, id, it) {
-		auto it1 = neighbors2->find(id);
-		// If its neighbor is also two hops away from the current vertex,
-		// we count each edge only once.
-		if (it1 != neighbors2->end()) {
-			if (*it1 > vertex.get_id())
-				local_scan2++;
-		}
-	} PAGE_FOREACH_END
+	// If its neighbor is also two hops away from the current vertex,
+	// we count the edge.
+	two_hop_edge_counter counter(*neighbors2, vertex.get_id());
+	neighbors2->list.intersect(vertex.get_neigh_begin(type),
+			vertex.get_neigh_end(type), counter);
+	local_scan2 += counter.get_num_edges();
 }
 
 void local_scan2_vertex::run_on_neighbor2(vertex_program &prog,
@@ -200,7 +242,7 @@ void local_scan2_vertex::run_on_neighbor2(vertex_program &prog,
 	run_on_neighs2_neigh_list(prog, vertex, IN_EDGE);
 	run_on_neighs2_neigh_list(prog, vertex, OUT_EDGE);
 
-	if (num_fetched == neighbors2->size()) {
+	if (num_fetched == neighbors2->ids.size()) {
 		delete neighbors2;
 		neighbors2 = NULL;
 	}
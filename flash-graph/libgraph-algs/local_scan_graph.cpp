@@ -60,22 +60,20 @@ public:
 	size_t count_edges(const page_vertex *v);
 
 	off_t find_idx(vertex_id_t id) const {
-		edge_set_t::const_iterator it = neighbor_set->find(id);
-		if (it == neighbor_set->end())
+		uint32_t idx;
+		if (!id_set.find(id, idx))
 			return -1;
 		else {
-			size_t idx = (*it).get_idx();
 			assert(idx < id_list.size());
 			return idx;
 		}
 	}
 
 	attributed_neighbor find(vertex_id_t id) const {
-		edge_set_t::const_iterator it = neighbor_set->find(id);
-		if (it == neighbor_set->end())
+		uint32_t idx;
+		if (!id_set.find(id, idx))
 			return attributed_neighbor();
 		else {
-			size_t idx = (*it).get_idx();
 			assert(idx < id_list.size());
 			return at(idx);
 		}
@@ -0,0 +1,712 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "in_mem_storage.h"
+#include "utils.h"
+#include "FGlib.h"
+#include "edge_weight.h"
+
+/*
+ * This is a parallel Louvain community detection with an optional Leiden
+ * refinement. A level has three phases:
+ *
+ * Local moves: a vertex reads its edge list, sums the weights of its edges
+ * to each neighboring community in a hash table of its thread and moves to
+ * the community with the largest modularity gain. Moves take effect
+ * immediately: the community of a vertex is a global array and the total
+ * degrees of communities are updated with atomic operations, so there
+ * are no locks. Only the neighbors of the vertices that move are active
+ * in the next iteration.
+ *
+ * Refinement (Leiden): every vertex starts in its own refined community.
+ * A vertex still alone in its refined community joins the refined community
+ * in its Louvain community with the largest modularity gain, if the vertex
+ * is well connected to the Louvain community. This splits the Louvain
+ * communities that aren't connected.
+ *
+ * Aggregation: the (refined) communities become the vertices of a smaller
+ * weighted graph, which is stored in memory in the FlashGraph format, so
+ * the next level runs on it from memory. With refinement, a vertex of
+ * the smaller graph starts in the Louvain community of its members.
+ *
+ * The algorithm only works on undirected graphs.
+ */
+
+using namespace fg;
+
+namespace
+{
+
+// The max number of iterations of local moves in a level.
+const int MAX_MOVE_ITERS = 32;
+
+enum louvain_stage
+{
+	DEGREE,
+	MOVE,
+	REFINE,
+	AGGREGATE,
+};
+
+/*
+ * The state of the graph in the current level shared by all threads.
+ * A vertex only changes its own community, and the totals and sizes of
+ * communities are updated atomically.
+ */
+louvain_stage stage;
+weight_kind weight = UNIT_WEIGHT;
+// The sum of the weights of all edges.
+double tot_weight;
+// The weighted degree of each vertex, including its self-loop.
+std::vector<double> degrees;
+// The weight of the self-loop of each vertex, i.e., the weight of
+// the edges inside the vertex in the previous levels.
+std::vector<double> self_weights;
+std::vector<vertex_id_t> comms;
+std::unique_ptr<std::atomic<double>[]> comm_tots;
+std::unique_ptr<std::atomic<vsize_t>[]> comm_sizes;
+// The refined communities.
+std::vector<vertex_id_t> refined;
+std::unique_ptr<std::atomic<double>[]> refined_tots;
+std::unique_ptr<std::atomic<vsize_t>[]> refined_sizes;
+// The vertex in the next level that a vertex belongs to.
+std::vector<vertex_id_t> coarse_ids;
+
+void atomic_add(std::atomic<double> &v, double delta)
+{
+	double old = v.load();
+	while (!v.compare_exchange_weak(old, old + delta)) {
+	}
+}
+
+/*
+ * The modularity gain of adding a vertex with degree `degree' to
+ * a community with total degree `tot', to which the vertex has edges of
+ * weight `weight'. The part that doesn't depend on the community is
+ * dropped.
+ */
+double get_gain(double weight, double degree, double tot)
+{
+	return weight - degree * tot / (2 * tot_weight);
+}
+
+/*
+ * A hash table with open addressing that sums the weights of edges to
+ * each community. Each thread has one and reuses it for all vertices,
+ * so clearing it only resets the slots in use.
+ */
+class community_table
+{
+	std::vector<vertex_id_t> keys;
+	std::vector<double> weights;
+	std::vector<uint32_t> used;
+
+	size_t get_slot(vertex_id_t c) const {
+		size_t mask = keys.size() - 1;
+		size_t slot = (c * 0x9E3779B97F4A7C15UL) >> 32 & mask;
+		while (keys[slot] != c && keys[slot] != INVALID_VERTEX_ID)
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+
+	void grow() {
+		std::vector<vertex_id_t> old_keys;
+		std::vector<double> old_weights;
+		std::vector<uint32_t> old_used;
+		old_keys.swap(keys);
+		old_weights.swap(weights);
+		old_used.swap(used);
+		keys.resize(old_keys.size() * 2, INVALID_VERTEX_ID);
+		weights.resize(old_weights.size() * 2);
+		for (size_t i = 0; i < old_used.size(); i++)
+			add(old_keys[old_used[i]], old_weights[old_used[i]]);
+	}
+public:
+	community_table(): keys(1024, INVALID_VERTEX_ID), weights(1024) {
+	}
+
+	void add(vertex_id_t c, double w) {
+		if ((used.size() + 1) * 2 > keys.size())
+			grow();
+		size_t slot = get_slot(c);
+		if (keys[slot] == INVALID_VERTEX_ID) {
+			keys[slot] = c;
+			weights[slot] = 0;
+			used.push_back(slot);
+		}
+		weights[slot] += w;
+	}
+
+	double get(vertex_id_t c) const {
+		size_t slot = get_slot(c);
+		return keys[slot] == c ? weights[slot] : 0;
+	}
+
+	template<class Func>
+	void for_each(Func func) const {
+		for (size_t i = 0; i < used.size(); i++)
+			func(keys[used[i]], weights[used[i]]);
+	}
+
+	void clear() {
+		for (size_t i = 0; i < used.size(); i++)
+			keys[used[i]] = INVALID_VERTEX_ID;
+		used.clear();
+	}
+};
+
+struct coarse_edge
+{
+	vertex_id_t from;
+	vertex_id_t to;
+	double weight;
+
+	coarse_edge(vertex_id_t from, vertex_id_t to, double weight) {
+		this->from = from;
+		this->to = to;
+		this->weight = weight;
+	}
+};
+
+class louvain_vertex: public compute_vertex
+{
+	template<class weight_t>
+	void compute_degree(vertex_program &prog, const page_vertex &vertex);
+	template<class weight_t>
+	void move(vertex_program &prog, const page_vertex &vertex);
+	template<class weight_t>
+	void refine(vertex_program &prog, const page_vertex &vertex);
+	template<class weight_t>
+	void aggregate(vertex_program &prog, const page_vertex &vertex);
+
+	template<class weight_t>
+	void run_stage(vertex_program &prog, const page_vertex &vertex) {
+		switch (stage) {
+			case DEGREE:
+				compute_degree<weight_t>(prog, vertex);
+				break;
+			case MOVE:
+				move<weight_t>(prog, vertex);
+				break;
+			case REFINE:
+				refine<weight_t>(prog, vertex);
+				break;
+			case AGGREGATE:
+				aggregate<weight_t>(prog, vertex);
+				break;
+		}
+	}
+
+	class run_stage_func
+	{
+		louvain_vertex &v;
+		vertex_program &prog;
+		const page_vertex &vertex;
+	public:
+		run_stage_func(louvain_vertex &_v, vertex_program &_prog,
+				const page_vertex &_vertex): v(_v), prog(_prog), vertex(_vertex) {
+		}
+
+		template<class weight_t>
+		void run() {
+			v.run_stage<weight_t>(prog, vertex);
+		}
+	};
+public:
+	louvain_vertex(vertex_id_t id): compute_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		run_stage_func func(*this, prog, vertex);
+		dispatch_weight(weight, func);
+	}
+
+	void run_on_message(vertex_program &, const vertex_message &) {
+	}
+};
+
+class louvain_vertex_program: public vertex_program_impl<louvain_vertex>
+{
+	community_table table;
+	size_t num_moves;
+	// Twice the weight of the edges inside communities.
+	double inner_weight;
+	std::vector<coarse_edge> edges;
+public:
+	typedef std::shared_ptr<louvain_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<louvain_vertex_program, vertex_program>(
+				prog);
+	}
+
+	louvain_vertex_program() {
+		num_moves = 0;
+		inner_weight = 0;
+	}
+
+	community_table &get_table() {
+		table.clear();
+		return table;
+	}
+
+	void add_move() {
+		num_moves++;
+	}
+
+	size_t get_num_moves() const {
+		return num_moves;
+	}
+
+	void add_inner_weight(double w) {
+		inner_weight += w;
+	}
+
+	double get_inner_weight() const {
+		return inner_weight;
+	}
+
+	void add_edge(vertex_id_t from, vertex_id_t to, double w) {
+		edges.push_back(coarse_edge(from, to, w));
+	}
+
+	const std::vector<coarse_edge> &get_edges() const {
+		return edges;
+	}
+};
+
+class louvain_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new louvain_vertex_program());
+	}
+};
+
+template<class weight_t>
+void louvain_vertex::compute_degree(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	vertex_id_t id = prog.get_vertex_id(*this);
+	double degree = 2 * self_weights[id];
+	for_each_weighted_edge<weight_t>(weight, id, vertex,
+			[&](vertex_id_t neigh, double w) {
+			degree += w;
+		});
+	degrees[id] = degree;
+}
+
+template<class weight_t>
+void louvain_vertex::move(vertex_program &prog, const page_vertex &vertex)
+{
+	louvain_vertex_program &lprog = (louvain_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	community_table &table = lprog.get_table();
+	for_each_weighted_edge<weight_t>(weight, id, vertex,
+			[&](vertex_id_t neigh, double w) {
+			table.add(comms[neigh], w);
+		});
+
+	vertex_id_t curr = comms[id];
+	double degree = degrees[id];
+	vertex_id_t best = curr;
+	double best_gain = get_gain(table.get(curr), degree,
+			comm_tots[curr].load() - degree);
+	table.for_each([&](vertex_id_t c, double w) {
+			if (c == curr)
+				return;
+			double gain = get_gain(w, degree, comm_tots[c].load());
+			if (gain > best_gain || (gain == best_gain && c < best)) {
+				best = c;
+				best_gain = gain;
+			}
+		});
+	if (best == curr)
+		return;
+	// Two vertices alone in their communities may move to each other's
+	// community in parallel, so a vertex only joins a singleton community
+	// with a smaller ID.
+	if (comm_sizes[curr].load() == 1 && comm_sizes[best].load() == 1
+			&& best > curr)
+		return;
+
+	comms[id] = best;
+	atomic_add(comm_tots[curr], -degree);
+	atomic_add(comm_tots[best], degree);
+	comm_sizes[curr]--;
+	comm_sizes[best]++;
+	lprog.add_move();
+	if (prog.get_graph().get_curr_level() + 1 < MAX_MOVE_ITERS) {
+		edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE, 0,
+				vertex.get_num_edges(edge_type::OUT_EDGE));
+		prog.activate_vertices(it);
+	}
+}
+
+template<class weight_t>
+void louvain_vertex::refine(vertex_program &prog, const page_vertex &vertex)
+{
+	louvain_vertex_program &lprog = (louvain_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	vertex_id_t curr = refined[id];
+	if (refined_sizes[curr].load() != 1)
+		return;
+
+	vertex_id_t comm = comms[id];
+	double degree = degrees[id];
+	community_table &table = lprog.get_table();
+	double comm_weight = 0;
+	for_each_weighted_edge<weight_t>(weight, id, vertex,
+			[&](vertex_id_t neigh, double w) {
+			if (comms[neigh] == comm) {
+				table.add(refined[neigh], w);
+				comm_weight += w;
+			}
+		});
+	// The vertex has to be well connected to the rest of its community.
+	if (comm_weight < degree * (comm_tots[comm].load() - degree)
+			/ (2 * tot_weight))
+		return;
+
+	// Staying alone has no gain.
+	vertex_id_t best = curr;
+	double best_gain = 0;
+	table.for_each([&](vertex_id_t c, double w) {
+			double gain = get_gain(w, degree, refined_tots[c].load());
+			if (gain > best_gain) {
+				best = c;
+				best_gain = gain;
+			}
+		});
+	if (best == curr)
+		return;
+	// Another vertex may have joined the refined community of the vertex.
+	vsize_t one = 1;
+	if (!refined_sizes[curr].compare_exchange_strong(one, 0))
+		return;
+	refined[id] = best;
+	refined_sizes[best]++;
+	atomic_add(refined_tots[curr], -degree);
+	atomic_add(refined_tots[best], degree);
+	lprog.add_move();
+}
+
+template<class weight_t>
+void louvain_vertex::aggregate(vertex_program &prog, const page_vertex &vertex)
+{
+	louvain_vertex_program &lprog = (louvain_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	vertex_id_t comm = comms[id];
+	community_table &table = lprog.get_table();
+	double inner = 2 * self_weights[id];
+	for_each_weighted_edge<weight_t>(weight, id, vertex,
+			[&](vertex_id_t neigh, double w) {
+			if (comms[neigh] == comm)
+				inner += w;
+			if (!coarse_ids.empty())
+				table.add(coarse_ids[neigh], w);
+		});
+	lprog.add_inner_weight(inner);
+	if (coarse_ids.empty())
+		return;
+
+	vertex_id_t from = coarse_ids[id];
+	if (self_weights[id] > 0)
+		lprog.add_edge(from, from, 2 * self_weights[id]);
+	table.for_each([&](vertex_id_t to, double w) {
+			lprog.add_edge(from, to, w);
+		});
+}
+
+/*
+ * Number the groups of vertices from 0 and store the number of the group
+ * of each vertex in `ids'. It returns the number of groups.
+ */
+size_t number_groups(const std::vector<vertex_id_t> &groups,
+		std::vector<vertex_id_t> &ids)
+{
+	std::vector<vertex_id_t> map(groups.size(), INVALID_VERTEX_ID);
+	size_t num = 0;
+	ids.resize(groups.size());
+	for (size_t i = 0; i < groups.size(); i++) {
+		if (map[groups[i]] == INVALID_VERTEX_ID)
+			map[groups[i]] = num++;
+		ids[i] = map[groups[i]];
+	}
+	return num;
+}
+
+void init_communities(size_t num_vertices)
+{
+	comm_tots = std::unique_ptr<std::atomic<double>[]>(
+			new std::atomic<double>[num_vertices]);
+	comm_sizes = std::unique_ptr<std::atomic<vsize_t>[]>(
+			new std::atomic<vsize_t>[num_vertices]);
+	for (size_t i = 0; i < num_vertices; i++) {
+		comm_tots[i] = 0;
+		comm_sizes[i] = 0;
+	}
+	for (size_t i = 0; i < num_vertices; i++) {
+		comm_tots[comms[i]] = comm_tots[comms[i]] + degrees[i];
+		comm_sizes[comms[i]]++;
+	}
+}
+
+void init_refined(size_t num_vertices)
+{
+	refined.resize(num_vertices);
+	refined_tots = std::unique_ptr<std::atomic<double>[]>(
+			new std::atomic<double>[num_vertices]);
+	refined_sizes = std::unique_ptr<std::atomic<vsize_t>[]>(
+			new std::atomic<vsize_t>[num_vertices]);
+	for (size_t i = 0; i < num_vertices; i++) {
+		refined[i] = i;
+		refined_tots[i] = degrees[i];
+		refined_sizes[i] = 1;
+	}
+}
+
+/*
+ * Run a stage on all vertices and return the vertex programs of all threads.
+ */
+void run_stage(graph_engine::ptr graph, louvain_stage s,
+		std::vector<louvain_vertex_program::ptr> &lprogs)
+{
+	stage = s;
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new louvain_vertex_program_creater()));
+	graph->wait4complete();
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	lprogs.clear();
+	for (size_t i = 0; i < vprogs.size(); i++)
+		lprogs.push_back(louvain_vertex_program::cast2(vprogs[i]));
+}
+
+/*
+ * Build the graph of the next level from the edges between the vertices
+ * of the next level, and set up the state of its vertices.
+ */
+FG_graph::ptr build_coarse_graph(const std::vector<louvain_vertex_program::ptr> &lprogs,
+		size_t num_coarse, bool refine, int level, config_map::ptr configs)
+{
+	// Group the edges by their source vertices.
+	std::vector<size_t> offs(num_coarse + 1);
+	for (size_t i = 0; i < lprogs.size(); i++) {
+		const std::vector<coarse_edge> &edges = lprogs[i]->get_edges();
+		for (size_t j = 0; j < edges.size(); j++)
+			offs[edges[j].from + 1]++;
+	}
+	for (size_t i = 0; i < num_coarse; i++)
+		offs[i + 1] += offs[i];
+	std::vector<std::pair<vertex_id_t, double> > neighs(offs[num_coarse]);
+	std::vector<size_t> locs(offs.begin(), offs.end() - 1);
+	for (size_t i = 0; i < lprogs.size(); i++) {
+		const std::vector<coarse_edge> &edges = lprogs[i]->get_edges();
+		for (size_t j = 0; j < edges.size(); j++)
+			neighs[locs[edges[j].from]++] = std::pair<vertex_id_t, double>(
+					edges[j].to, edges[j].weight);
+	}
+
+	// In the next level, a vertex starts in the Louvain community of its
+	// members, which is named after a vertex in it.
+	std::vector<vertex_id_t> next_comms(num_coarse);
+	if (refine) {
+		std::vector<vertex_id_t> comm_names(comms.size(), INVALID_VERTEX_ID);
+		for (size_t i = 0; i < comms.size(); i++) {
+			if (comm_names[comms[i]] == INVALID_VERTEX_ID)
+				comm_names[comms[i]] = coarse_ids[i];
+			next_comms[coarse_ids[i]] = comm_names[comms[i]];
+		}
+	}
+	else {
+		for (size_t i = 0; i < num_coarse; i++)
+			next_comms[i] = i;
+	}
+
+	degrees.assign(num_coarse, 0);
+	self_weights.assign(num_coarse, 0);
+	utils::mem_serial_graph::ptr g = utils::mem_serial_graph::create(false,
+			sizeof(double));
+	for (size_t i = 0; i < num_coarse; i++) {
+		std::sort(neighs.begin() + offs[i], neighs.begin() + offs[i + 1]);
+		in_mem_undirected_vertex<double> v(i, true);
+		for (size_t j = offs[i]; j < offs[i + 1]; ) {
+			vertex_id_t neigh = neighs[j].first;
+			double w = 0;
+			for (; j < offs[i + 1] && neighs[j].first == neigh; j++)
+				w += neighs[j].second;
+			degrees[i] += w;
+			// An edge inside the vertex is seen from both of its endpoints.
+			if (neigh == i)
+				self_weights[i] += w / 2;
+			else
+				v.add_edge(edge<double>(i, neigh, w));
+		}
+		g->add_vertex(v);
+	}
+	comms.swap(next_comms);
+
+	std::string name = "louvain-level" + itoa(level + 1);
+	in_mem_graph::ptr graph_data = g->dump_graph(name);
+	vertex_index::ptr index = g->dump_index(true);
+	return FG_graph::create(graph_data, index, name, configs);
+}
+
+}
+
+namespace fg
+{
+
+louvain_result compute_louvain(FG_graph::ptr fg, uint32_t levels, bool refine,
+		const fm::scalar_type *weight_type)
+{
+	louvain_result res;
+	if (fg->get_graph_header().is_directed_graph()) {
+		BOOST_LOG_TRIVIAL(error) << "Louvain only works on undirected graphs";
+		return res;
+	}
+	if (!get_weight_kind(fg, weight_type, ::weight))
+		return res;
+
+	size_t num_vertices = fg->get_num_vertices();
+	// The vertex in the current level that each input vertex belongs to.
+	std::vector<vertex_id_t> members(num_vertices);
+	degrees.assign(num_vertices, 0);
+	self_weights.assign(num_vertices, 0);
+	comms.resize(num_vertices);
+	for (size_t i = 0; i < num_vertices; i++) {
+		members[i] = i;
+		comms[i] = i;
+	}
+
+	BOOST_LOG_TRIVIAL(info) << boost::format("%1% on %2% vertices")
+		% (refine ? "Leiden" : "Louvain") % num_vertices;
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	FG_graph::ptr curr_fg = fg;
+	std::vector<louvain_vertex_program::ptr> lprogs;
+	for (uint32_t level = 0; level < levels; level++) {
+		struct timeval start, end;
+		gettimeofday(&start, NULL);
+		graph_index::ptr index = NUMA_graph_index<louvain_vertex>::create(
+				curr_fg->get_graph_header());
+		graph_engine::ptr graph = curr_fg->create_engine(index);
+		size_t num_curr = curr_fg->get_num_vertices();
+		// The degrees in the next levels are computed in aggregation.
+		if (level == 0)
+			run_stage(graph, DEGREE, lprogs);
+		tot_weight = 0;
+		for (size_t i = 0; i < num_curr; i++)
+			tot_weight += degrees[i];
+		tot_weight /= 2;
+		if (tot_weight == 0)
+			break;
+
+		init_communities(num_curr);
+		run_stage(graph, MOVE, lprogs);
+		size_t num_moves = 0;
+		for (size_t i = 0; i < lprogs.size(); i++)
+			num_moves += lprogs[i]->get_num_moves();
+		if (refine) {
+			init_refined(num_curr);
+			run_stage(graph, REFINE, lprogs);
+		}
+
+		size_t num_coarse = number_groups(refine ? refined : comms, coarse_ids);
+		bool last = level + 1 == levels || (level > 0 && num_moves == 0)
+			|| num_coarse == num_curr;
+		if (last)
+			coarse_ids.clear();
+		// Aggregation also computes the modularity of the level.
+		run_stage(graph, AGGREGATE, lprogs);
+		double inner_weight = 0;
+		for (size_t i = 0; i < lprogs.size(); i++)
+			inner_weight += lprogs[i]->get_inner_weight();
+		double modularity = inner_weight / (2 * tot_weight);
+		size_t num_comms = 0;
+		for (size_t i = 0; i < num_curr; i++) {
+			double tot = comm_tots[i].load();
+			modularity -= tot * tot / (4 * tot_weight * tot_weight);
+			if (comm_sizes[i].load() > 0)
+				num_comms++;
+		}
+
+		if (!last) {
+			for (size_t i = 0; i < num_vertices; i++)
+				members[i] = coarse_ids[members[i]];
+			::weight = DOUBLE_WEIGHT;
+			curr_fg = build_coarse_graph(lprogs, num_coarse, refine, level,
+					fg->get_configs());
+		}
+		gettimeofday(&end, NULL);
+		res.modularity.push_back(modularity);
+		res.num_communities.push_back(num_comms);
+		res.runtimes.push_back(time_diff(start, end));
+		BOOST_LOG_TRIVIAL(info) << boost::format(
+				"level %1%: %2% vertices, %3% moves, %4% communities, modularity: %5%, %6% seconds")
+			% level % num_curr % num_moves % num_comms % modularity
+			% res.runtimes.back();
+		if (last)
+			break;
+	}
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	std::vector<vertex_id_t> comm_ids;
+	number_groups(comms, comm_ids);
+	fm::detail::mem_vec_store::ptr res_store = fm::detail::mem_vec_store::create(
+			num_vertices, safs::params.get_num_nodes(),
+			fm::get_scalar_type<vertex_id_t>());
+	for (size_t i = 0; i < num_vertices; i++)
+		res_store->set<vertex_id_t>(i, comm_ids[members[i]]);
+	res.communities = fm::vector::create(res_store);
+
+	degrees.clear();
+	self_weights.clear();
+	comms.clear();
+	refined.clear();
+	coarse_ids.clear();
+	comm_tots.reset();
+	comm_sizes.reset();
+	refined_tots.reset();
+	refined_sizes.reset();
+	return res;
+}
+
+}
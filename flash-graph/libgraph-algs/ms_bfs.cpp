@@ -0,0 +1,578 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <immintrin.h>
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <vector>
+#include <unordered_map>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+#include "mem_vec_store.h"
+#include "ms_bfs.h"
+
+using namespace fg;
+
+namespace
+{
+
+/*
+ * A bitmap with a bit for each source. The bitwise operations work on
+ * 256-bit or 128-bit SIMD words when the bitmap is large enough.
+ * The bitmaps are embedded in messages, which may not be aligned,
+ * so they are always loaded and stored unaligned.
+ */
+template<size_t NUM_WORDS>
+class source_bitmap
+{
+	uint64_t words[NUM_WORDS];
+public:
+	source_bitmap() {
+		clear();
+	}
+
+	void clear() {
+		for (size_t i = 0; i < NUM_WORDS; i++)
+			words[i] = 0;
+	}
+
+	void set(size_t idx) {
+		words[idx / 64] |= 1UL << (idx % 64);
+	}
+
+	bool any() const {
+		uint64_t res = 0;
+		for (size_t i = 0; i < NUM_WORDS; i++)
+			res |= words[i];
+		return res != 0;
+	}
+
+	bfs_source_set get_sources() const {
+		return bfs_source_set(words, NUM_WORDS);
+	}
+
+	/*
+	 * this |= map
+	 */
+	void merge(const source_bitmap<NUM_WORDS> &map);
+	/*
+	 * this = map & ~mask
+	 * It returns true if any bit is set.
+	 */
+	bool assign_diff(const source_bitmap<NUM_WORDS> &map,
+			const source_bitmap<NUM_WORDS> &mask);
+};
+
+template<size_t NUM_WORDS>
+void source_bitmap<NUM_WORDS>::merge(const source_bitmap<NUM_WORDS> &map)
+{
+	size_t i = 0;
+#if defined(__AVX__)
+	for (; i + 4 <= NUM_WORDS; i += 4) {
+		__m256d v1 = _mm256_loadu_pd((const double *) (words + i));
+		__m256d v2 = _mm256_loadu_pd((const double *) (map.words + i));
+		_mm256_storeu_pd((double *) (words + i), _mm256_or_pd(v1, v2));
+	}
+#elif defined(__SSE2__)
+	for (; i + 2 <= NUM_WORDS; i += 2) {
+		__m128i v1 = _mm_loadu_si128((const __m128i *) (words + i));
+		__m128i v2 = _mm_loadu_si128((const __m128i *) (map.words + i));
+		_mm_storeu_si128((__m128i *) (words + i), _mm_or_si128(v1, v2));
+	}
+#endif
+	for (; i < NUM_WORDS; i++)
+		words[i] |= map.words[i];
+}
+
+template<size_t NUM_WORDS>
+bool source_bitmap<NUM_WORDS>::assign_diff(const source_bitmap<NUM_WORDS> &map,
+		const source_bitmap<NUM_WORDS> &mask)
+{
+	size_t i = 0;
+	bool non_zero = false;
+#if defined(__AVX__)
+	for (; i + 4 <= NUM_WORDS; i += 4) {
+		__m256d v = _mm256_loadu_pd((const double *) (map.words + i));
+		__m256d m = _mm256_loadu_pd((const double *) (mask.words + i));
+		__m256i res = _mm256_castpd_si256(_mm256_andnot_pd(m, v));
+		_mm256_storeu_si256((__m256i *) (words + i), res);
+		non_zero |= !_mm256_testz_si256(res, res);
+	}
+#elif defined(__SSE2__)
+	for (; i + 2 <= NUM_WORDS; i += 2) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (map.words + i));
+		__m128i m = _mm_loadu_si128((const __m128i *) (mask.words + i));
+		__m128i res = _mm_andnot_si128(m, v);
+		_mm_storeu_si128((__m128i *) (words + i), res);
+		non_zero |= _mm_movemask_epi8(_mm_cmpeq_epi8(res,
+					_mm_setzero_si128())) != 0xffff;
+	}
+#endif
+	for (; i < NUM_WORDS; i++) {
+		words[i] = map.words[i] & ~mask.words[i];
+		non_zero |= words[i] != 0;
+	}
+	return non_zero;
+}
+
+template<size_t NUM_WORDS>
+class ms_bfs_message: public vertex_message
+{
+	source_bitmap<NUM_WORDS> srcs;
+public:
+	ms_bfs_message(const source_bitmap<NUM_WORDS> &srcs): vertex_message(
+			sizeof(ms_bfs_message), true), srcs(srcs) {
+	}
+
+	const source_bitmap<NUM_WORDS> &get_sources() const {
+		return srcs;
+	}
+};
+
+template<size_t NUM_WORDS>
+class ms_bfs_vertex: public compute_directed_vertex
+{
+	// The sources that have reached the vertex.
+	source_bitmap<NUM_WORDS> seen;
+	// The sources that reach the vertex in the current level. They are
+	// sent to the neighbors.
+	source_bitmap<NUM_WORDS> visit;
+	// The sources received from the neighbors in the current level.
+	source_bitmap<NUM_WORDS> next;
+public:
+	ms_bfs_vertex(vertex_id_t id): compute_directed_vertex(id) {
+	}
+
+	void reset() {
+		seen.clear();
+		visit.clear();
+		next.clear();
+	}
+
+	void init(const source_bitmap<NUM_WORDS> &srcs) {
+		seen = srcs;
+		visit = srcs;
+		next.clear();
+	}
+
+	void run(vertex_program &prog);
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+		next.merge(((const ms_bfs_message<NUM_WORDS> &) msg).get_sources());
+		prog.request_notify_iter_end(*this);
+	}
+
+	void notify_iteration_end(vertex_program &prog) {
+		// Only the sources that haven't reached the vertex expand
+		// the BFS in the next level.
+		if (visit.assign_diff(next, seen))
+			seen.merge(visit);
+		next.clear();
+	}
+};
+
+template<size_t NUM_WORDS>
+class ms_bfs_vertex_program: public vertex_program_impl<ms_bfs_vertex<NUM_WORDS> >
+{
+	edge_type traverse_e;
+	bool directed;
+	ms_bfs_visitor::ptr visitor;
+	int max_dist;
+public:
+	typedef std::shared_ptr<ms_bfs_vertex_program<NUM_WORDS> > ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<ms_bfs_vertex_program<NUM_WORDS>,
+			   vertex_program>(prog);
+	}
+
+	ms_bfs_vertex_program(edge_type traverse_e, bool directed,
+			ms_bfs_visitor::ptr visitor) {
+		this->traverse_e = traverse_e;
+		this->directed = directed;
+		this->visitor = visitor;
+		this->max_dist = 0;
+	}
+
+	edge_type get_traverse_edge() const {
+		return traverse_e;
+	}
+
+	bool is_directed() const {
+		return directed;
+	}
+
+	void visit(vertex_id_t id, const bfs_source_set &srcs) {
+		int dist = this->get_graph().get_curr_level();
+		max_dist = std::max(max_dist, dist);
+		visitor->visit(id, dist, srcs);
+	}
+
+	const ms_bfs_visitor &get_visitor() const {
+		return *visitor;
+	}
+
+	int get_max_dist() const {
+		return max_dist;
+	}
+};
+
+template<size_t NUM_WORDS>
+void ms_bfs_vertex<NUM_WORDS>::run(vertex_program &prog)
+{
+	if (!visit.any())
+		return;
+
+	ms_bfs_vertex_program<NUM_WORDS> &bfs_prog
+		= (ms_bfs_vertex_program<NUM_WORDS> &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	bfs_prog.visit(id, visit.get_sources());
+	if (bfs_prog.is_directed()) {
+		directed_vertex_request req(id, bfs_prog.get_traverse_edge());
+		request_partial_vertices(&req, 1);
+	}
+	else
+		request_vertices(&id, 1);
+}
+
+template<size_t NUM_WORDS>
+void ms_bfs_vertex<NUM_WORDS>::run(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	ms_bfs_vertex_program<NUM_WORDS> &bfs_prog
+		= (ms_bfs_vertex_program<NUM_WORDS> &) prog;
+	// All sources in the frontier of the vertex share the edge list.
+	ms_bfs_message<NUM_WORDS> msg(visit);
+	visit.clear();
+	edge_type traverse_e = bfs_prog.get_traverse_edge();
+	if (bfs_prog.is_directed() && traverse_e == BOTH_EDGES) {
+		edge_seq_iterator it = vertex.get_neigh_seq_it(IN_EDGE);
+		prog.multicast_msg(it, msg);
+		it = vertex.get_neigh_seq_it(OUT_EDGE);
+		prog.multicast_msg(it, msg);
+	}
+	else if (vertex.get_num_edges(traverse_e) > 0) {
+		edge_seq_iterator it = vertex.get_neigh_seq_it(traverse_e);
+		prog.multicast_msg(it, msg);
+	}
+}
+
+template<size_t NUM_WORDS>
+class ms_bfs_vertex_program_creater: public vertex_program_creater
+{
+	edge_type traverse_e;
+	bool directed;
+	const ms_bfs_visitor &visitor;
+public:
+	ms_bfs_vertex_program_creater(edge_type traverse_e, bool directed,
+			const ms_bfs_visitor &_visitor): visitor(_visitor) {
+		this->traverse_e = traverse_e;
+		this->directed = directed;
+	}
+
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new ms_bfs_vertex_program<NUM_WORDS>(
+					traverse_e, directed, visitor.clone()));
+	}
+};
+
+template<size_t NUM_WORDS>
+class ms_bfs_reset: public vertex_initializer
+{
+public:
+	void init(compute_vertex &v) {
+		((ms_bfs_vertex<NUM_WORDS> &) v).reset();
+	}
+};
+
+template<size_t NUM_WORDS>
+class ms_bfs_initializer: public vertex_initializer
+{
+	typedef std::unordered_map<vertex_id_t, source_bitmap<NUM_WORDS> > source_map;
+	source_map srcs;
+	graph_engine &graph;
+public:
+	ms_bfs_initializer(const std::vector<vertex_id_t> &sources,
+			graph_engine &_graph): graph(_graph) {
+		for (size_t i = 0; i < sources.size(); i++)
+			srcs[sources[i]].set(i);
+	}
+
+	void get_start_vertices(std::vector<vertex_id_t> &vertices) const {
+		for (typename source_map::const_iterator it = srcs.begin();
+				it != srcs.end(); it++)
+			vertices.push_back(it->first);
+	}
+
+	void init(compute_vertex &v) {
+		typename source_map::const_iterator it
+			= srcs.find(graph.get_graph_index().get_vertex_id(v));
+		assert(it != srcs.end());
+		((ms_bfs_vertex<NUM_WORDS> &) v).init(it->second);
+	}
+};
+
+template<size_t NUM_WORDS>
+class ms_bfs_engine_impl: public ms_bfs_engine
+{
+	graph_engine::ptr graph;
+	bool directed;
+public:
+	ms_bfs_engine_impl(FG_graph::ptr fg) {
+		graph_index::ptr index = NUMA_graph_index<ms_bfs_vertex<NUM_WORDS> >::create(
+				fg->get_graph_header());
+		graph = fg->create_engine(index);
+		directed = fg->get_graph_header().is_directed_graph();
+	}
+
+	virtual size_t get_width() const {
+		return NUM_WORDS * 64;
+	}
+
+	virtual int run(const std::vector<vertex_id_t> &sources,
+			edge_type traverse_e, ms_bfs_visitor &visitor);
+};
+
+template<size_t NUM_WORDS>
+int ms_bfs_engine_impl<NUM_WORDS>::run(const std::vector<vertex_id_t> &sources,
+		edge_type traverse_e, ms_bfs_visitor &visitor)
+{
+	assert(sources.size() <= get_width());
+	if (sources.empty())
+		return 0;
+
+	std::shared_ptr<ms_bfs_initializer<NUM_WORDS> > init(
+			new ms_bfs_initializer<NUM_WORDS>(sources, *graph));
+	std::vector<vertex_id_t> start_vertices;
+	init->get_start_vertices(start_vertices);
+	graph->init_all_vertices(vertex_initializer::ptr(
+				new ms_bfs_reset<NUM_WORDS>()));
+	graph->start(start_vertices.data(), start_vertices.size(), init,
+			vertex_program_creater::ptr(
+				new ms_bfs_vertex_program_creater<NUM_WORDS>(traverse_e,
+					directed, visitor)));
+	graph->wait4complete();
+
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	int max_dist = 0;
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		typename ms_bfs_vertex_program<NUM_WORDS>::ptr bfs_vprog
+			= ms_bfs_vertex_program<NUM_WORDS>::cast2(vprog);
+		visitor.merge(bfs_vprog->get_visitor());
+		max_dist = std::max(max_dist, bfs_vprog->get_max_dist());
+	}
+	return max_dist;
+}
+
+/*
+ * It sums the distances from each source to the vertices it reaches.
+ */
+class closeness_visitor: public ms_bfs_visitor
+{
+	std::vector<size_t> sum_dists;
+	std::vector<size_t> num_reached;
+public:
+	closeness_visitor(size_t num_sources): sum_dists(num_sources),
+			num_reached(num_sources) {
+	}
+
+	virtual void visit(vertex_id_t id, int dist, const bfs_source_set &srcs) {
+		srcs.for_each([&](size_t src) {
+				sum_dists[src] += dist;
+				num_reached[src]++;
+			});
+	}
+
+	virtual ptr clone() const {
+		return ptr(new closeness_visitor(sum_dists.size()));
+	}
+
+	virtual void merge(const ms_bfs_visitor &visitor) {
+		const closeness_visitor &v = (const closeness_visitor &) visitor;
+		for (size_t i = 0; i < sum_dists.size(); i++) {
+			sum_dists[i] += v.sum_dists[i];
+			num_reached[i] += v.num_reached[i];
+		}
+	}
+
+	size_t get_sum_dist(size_t src) const {
+		return sum_dists[src];
+	}
+
+	size_t get_num_reached(size_t src) const {
+		return num_reached[src];
+	}
+};
+
+/*
+ * It counts the pairs of sources and vertices at each distance.
+ */
+class distance_visitor: public ms_bfs_visitor
+{
+	std::vector<size_t> counts;
+public:
+	virtual void visit(vertex_id_t id, int dist, const bfs_source_set &srcs) {
+		if (counts.size() <= (size_t) dist)
+			counts.resize(dist + 1);
+		counts[dist] += srcs.get_num_sources();
+	}
+
+	virtual ptr clone() const {
+		return ptr(new distance_visitor());
+	}
+
+	virtual void merge(const ms_bfs_visitor &visitor) {
+		const distance_visitor &v = (const distance_visitor &) visitor;
+		if (counts.size() < v.counts.size())
+			counts.resize(v.counts.size());
+		for (size_t i = 0; i < v.counts.size(); i++)
+			counts[i] += v.counts[i];
+	}
+
+	const std::vector<size_t> &get_counts() const {
+		return counts;
+	}
+};
+
+bool check_sources(FG_graph::ptr fg, const std::vector<vertex_id_t> &sources)
+{
+	for (size_t i = 0; i < sources.size(); i++) {
+		if (sources[i] >= fg->get_num_vertices()) {
+			BOOST_LOG_TRIVIAL(error) << boost::format(
+					"source %1% doesn't exist") % sources[i];
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+namespace fg
+{
+
+ms_bfs_engine::ptr ms_bfs_engine::create(FG_graph::ptr fg, size_t width)
+{
+	if (width <= 64)
+		return ptr(new ms_bfs_engine_impl<1>(fg));
+	else if (width <= 256)
+		return ptr(new ms_bfs_engine_impl<4>(fg));
+	else if (width <= 512)
+		return ptr(new ms_bfs_engine_impl<8>(fg));
+	else {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"MS-BFS doesn't support the width of %1%") % width;
+		return ptr();
+	}
+}
+
+fm::vector::ptr compute_closeness_centrality(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &ids, edge_type traverse_e,
+		size_t width)
+{
+	if (!check_sources(fg, ids))
+		return fm::vector::ptr();
+	ms_bfs_engine::ptr engine = ms_bfs_engine::create(fg, width);
+	if (engine == NULL)
+		return fm::vector::ptr();
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"closeness centrality starts on %1% vertices with %2% sources per BFS")
+		% ids.size() % engine->get_width();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	size_t num_vertices = fg->get_num_vertices();
+	fm::detail::mem_vec_store::ptr res_store = fm::detail::mem_vec_store::create(
+			ids.size(), safs::params.get_num_nodes(),
+			fm::get_scalar_type<double>());
+	for (size_t batch_start = 0; batch_start < ids.size();
+			batch_start += engine->get_width()) {
+		size_t num_sources = std::min(engine->get_width(),
+				ids.size() - batch_start);
+		std::vector<vertex_id_t> sources(ids.begin() + batch_start,
+				ids.begin() + batch_start + num_sources);
+		closeness_visitor visitor(num_sources);
+		engine->run(sources, traverse_e, visitor);
+		// We use the Wasserman and Faust formula, which scales
+		// the closeness of a vertex by the fraction of the vertices it
+		// reaches, so it works on a graph that isn't connected.
+		for (size_t i = 0; i < num_sources; i++) {
+			size_t sum_dist = visitor.get_sum_dist(i);
+			double num_reached = visitor.get_num_reached(i) - 1;
+			double closeness = 0;
+			if (sum_dist > 0 && num_vertices > 1)
+				closeness = num_reached / sum_dist
+					* num_reached / (num_vertices - 1);
+			res_store->set<double>(batch_start + i, closeness);
+		}
+	}
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format("It takes %1% seconds")
+		% time_diff(start, end);
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	return fm::vector::create(res_store);
+}
+
+std::vector<size_t> compute_sampled_distances(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &sources, edge_type traverse_e,
+		size_t width)
+{
+	std::vector<size_t> counts;
+	if (!check_sources(fg, sources))
+		return counts;
+	ms_bfs_engine::ptr engine = ms_bfs_engine::create(fg, width);
+	if (engine == NULL)
+		return counts;
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"sampled distances start on %1% sources with %2% sources per BFS")
+		% sources.size() % engine->get_width();
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	distance_visitor visitor;
+	for (size_t batch_start = 0; batch_start < sources.size();
+			batch_start += engine->get_width()) {
+		size_t num_sources = std::min(engine->get_width(),
+				sources.size() - batch_start);
+		std::vector<vertex_id_t> batch(sources.begin() + batch_start,
+				sources.begin() + batch_start + num_sources);
+		engine->run(batch, traverse_e, visitor);
+	}
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format("It takes %1% seconds")
+		% time_diff(start, end);
+	return visitor.get_counts();
+}
+
+}
@@ -0,0 +1,142 @@
+#ifndef __MS_BFS_H__
+#define __MS_BFS_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "FGlib.h"
+
+/*
+ * This is the bit-parallel multi-source BFS (MS-BFS). It runs the BFS from
+ * many sources concurrently. Each vertex keeps a bit per source for
+ * the sources that have reached it and for the sources in its frontier.
+ * A vertex in the frontier of any source reads its edge list once and
+ * sends the frontier bits of all sources to its neighbors in a single
+ * multicast message, so the I/O of the edge list is shared by all sources.
+ */
+
+namespace fg
+{
+
+/*
+ * The sources that reach a vertex at the same level. Source i is
+ * the i-th vertex in the list of sources of an MS-BFS run.
+ */
+class bfs_source_set
+{
+	const uint64_t *words;
+	size_t num_words;
+public:
+	bfs_source_set(const uint64_t *words, size_t num_words) {
+		this->words = words;
+		this->num_words = num_words;
+	}
+
+	bool contains(size_t src) const {
+		return words[src / 64] & (1UL << (src % 64));
+	}
+
+	size_t get_num_sources() const {
+		size_t num = 0;
+		for (size_t i = 0; i < num_words; i++)
+			num += __builtin_popcountl(words[i]);
+		return num;
+	}
+
+	template<class Func>
+	void for_each(Func func) const {
+		for (size_t i = 0; i < num_words; i++) {
+			uint64_t word = words[i];
+			while (word) {
+				func(i * 64 + __builtin_ctzl(word));
+				word &= word - 1;
+			}
+		}
+	}
+};
+
+/*
+ * A visitor is notified when sources reach a vertex. Each worker thread
+ * has its own copy of the visitor, and the copies are merged when
+ * the BFS completes.
+ */
+class ms_bfs_visitor
+{
+public:
+	typedef std::shared_ptr<ms_bfs_visitor> ptr;
+
+	virtual ~ms_bfs_visitor() {
+	}
+
+	/*
+	 * The sources in `srcs' reach vertex `id' for the first time at
+	 * distance `dist'. A source reaches itself at distance 0. For each
+	 * thread, vertices are visited in ascending order of their distances.
+	 */
+	virtual void visit(vertex_id_t id, int dist, const bfs_source_set &srcs) = 0;
+	/*
+	 * Create an empty visitor of the same type for a worker thread.
+	 */
+	virtual ptr clone() const = 0;
+	/*
+	 * Merge the result of a visitor created by clone().
+	 */
+	virtual void merge(const ms_bfs_visitor &visitor) = 0;
+};
+
+/*
+ * The engine of MS-BFS. Its width is the max number of sources in
+ * a run. It can be 64, 256 or 512; a vertex keeps three bitmaps of
+ * this width, so a wider engine needs more memory per vertex.
+ * The engine can run many times on the same graph.
+ */
+class ms_bfs_engine
+{
+public:
+	typedef std::shared_ptr<ms_bfs_engine> ptr;
+
+	/*
+	 * Create an engine with the smallest supported width that isn't
+	 * smaller than `width'. It returns NULL if `width' is larger than 512.
+	 */
+	static ptr create(FG_graph::ptr fg, size_t width);
+
+	virtual ~ms_bfs_engine() {
+	}
+
+	virtual size_t get_width() const = 0;
+
+	/*
+	 * Run BFS from all sources. Duplicated sources are allowed.
+	 * The results of the visitors of all threads are merged to `visitor'.
+	 * It returns the max distance from the sources to the vertices
+	 * they reach.
+	 */
+	virtual int run(const std::vector<vertex_id_t> &sources,
+			edge_type traverse_e, ms_bfs_visitor &visitor) = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,482 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <atomic>
+#include <vector>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+#include "edge_weight.h"
+
+/*
+ * This computes the minimum spanning forest of an undirected graph with
+ * Borůvka's algorithm.
+ *
+ * In each round, every vertex scans its edge list for the lightest edge to
+ * another component, and the lightest of these edges in a component is
+ * picked with a CAS loop on the component's root. The roots then merge
+ * their components along the picked edges in a lock-free union-find.
+ * Edges are ordered by their weights and then by their endpoints, so
+ * the picked edges never form a cycle.
+ *
+ * A vertex whose neighbors are all in its own component never needs to
+ * read its edge list again. Once the edges between components fit in
+ * memory, the vertices read their edge lists one last time to copy
+ * these edges, and the remaining rounds run on the contracted graph in
+ * memory.
+ */
+
+using namespace fg;
+
+namespace
+{
+
+// The max number of edges in the contracted graph kept in memory.
+const size_t MAX_CONTRACTED_EDGES = 8 * 1024 * 1024;
+
+enum msf_stage
+{
+	SCAN,
+	MERGE,
+	CONTRACT,
+};
+
+msf_stage stage;
+weight_kind weight = UNIT_WEIGHT;
+
+// The parent of each vertex in the union-find.
+std::unique_ptr<std::atomic<vertex_id_t>[]> parents;
+// The lightest edge from each vertex to another component.
+std::vector<vertex_id_t> best_neighs;
+std::vector<double> best_weights;
+// The vertex with the lightest edge out of each component.
+std::unique_ptr<std::atomic<vertex_id_t>[]> comp_best;
+// Whether all neighbors of a vertex are in the same component as the vertex.
+std::vector<char> finished;
+
+vertex_id_t find(vertex_id_t id)
+{
+	while (true) {
+		vertex_id_t parent = parents[id].load();
+		if (parent == id)
+			return id;
+		vertex_id_t grandparent = parents[parent].load();
+		// Path halving. It fails if the parent has been linked, which
+		// is fine.
+		if (parent != grandparent)
+			parents[id].compare_exchange_weak(parent, grandparent);
+		id = parent;
+	}
+}
+
+/*
+ * Link the root with the larger id to the one with the smaller id.
+ * It returns false if the two vertices are already in the same component.
+ */
+bool unite(vertex_id_t v1, vertex_id_t v2)
+{
+	while (true) {
+		v1 = find(v1);
+		v2 = find(v2);
+		if (v1 == v2)
+			return false;
+		if (v1 < v2)
+			std::swap(v1, v2);
+		vertex_id_t expected = v1;
+		if (parents[v1].compare_exchange_strong(expected, v2))
+			return true;
+	}
+}
+
+/*
+ * Edges are ordered by their weights, and then by their endpoints to break
+ * ties. With the total order, each component has a unique lightest edge.
+ */
+bool lighter(double w1, vertex_id_t from1, vertex_id_t to1,
+		double w2, vertex_id_t from2, vertex_id_t to2)
+{
+	if (w1 != w2)
+		return w1 < w2;
+	vertex_id_t min1 = std::min(from1, to1);
+	vertex_id_t min2 = std::min(from2, to2);
+	if (min1 != min2)
+		return min1 < min2;
+	return std::max(from1, to1) < std::max(from2, to2);
+}
+
+class msf_vertex: public compute_vertex
+{
+	template<class weight_t>
+	void scan(vertex_program &prog, const page_vertex &vertex);
+	template<class weight_t>
+	void contract(vertex_program &prog, const page_vertex &vertex);
+
+	template<class weight_t>
+	void run_stage(vertex_program &prog, const page_vertex &vertex) {
+		if (stage == SCAN)
+			scan<weight_t>(prog, vertex);
+		else
+			contract<weight_t>(prog, vertex);
+	}
+
+	class run_stage_func
+	{
+		msf_vertex &v;
+		vertex_program &prog;
+		const page_vertex &vertex;
+	public:
+		run_stage_func(msf_vertex &_v, vertex_program &_prog,
+				const page_vertex &_vertex): v(_v), prog(_prog), vertex(_vertex) {
+		}
+
+		template<class weight_t>
+		void run() {
+			v.run_stage<weight_t>(prog, vertex);
+		}
+	};
+
+	void merge(vertex_program &prog);
+public:
+	msf_vertex(vertex_id_t id): compute_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		if (stage == MERGE) {
+			merge(prog);
+			return;
+		}
+		vertex_id_t id = prog.get_vertex_id(*this);
+		request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		run_stage_func func(*this, prog, vertex);
+		dispatch_weight(weight, func);
+	}
+
+	void run_on_message(vertex_program &, const vertex_message &) {
+	}
+};
+
+class msf_vertex_program: public vertex_program_impl<msf_vertex>
+{
+	size_t num_reads;
+	// The number of edges between components seen in the scan.
+	size_t num_cross_edges;
+	std::vector<msf_edge> forest_edges;
+	// The edges of the contracted graph.
+	std::vector<msf_edge> contracted_edges;
+public:
+	typedef std::shared_ptr<msf_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<msf_vertex_program, vertex_program>(
+				prog);
+	}
+
+	msf_vertex_program() {
+		num_reads = 0;
+		num_cross_edges = 0;
+	}
+
+	void add_read(size_t num_cross_edges) {
+		num_reads++;
+		this->num_cross_edges += num_cross_edges;
+	}
+
+	void add_forest_edge(vertex_id_t from, vertex_id_t to, double weight) {
+		forest_edges.push_back(msf_edge(from, to, weight));
+	}
+
+	void add_contracted_edge(vertex_id_t from, vertex_id_t to, double weight) {
+		contracted_edges.push_back(msf_edge(from, to, weight));
+	}
+
+	size_t get_num_reads() const {
+		return num_reads;
+	}
+
+	size_t get_num_cross_edges() const {
+		return num_cross_edges;
+	}
+
+	std::vector<msf_edge> &get_forest_edges() {
+		return forest_edges;
+	}
+
+	std::vector<msf_edge> &get_contracted_edges() {
+		return contracted_edges;
+	}
+};
+
+class msf_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new msf_vertex_program());
+	}
+};
+
+template<class weight_t>
+void msf_vertex::scan(vertex_program &prog, const page_vertex &vertex)
+{
+	msf_vertex_program &mprog = (msf_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	vertex_id_t root = find(id);
+	vertex_id_t best = INVALID_VERTEX_ID;
+	double best_weight = 0;
+	size_t num_cross = 0;
+	for_each_weighted_edge<weight_t>(weight, id, vertex,
+			[&](vertex_id_t neigh, double w) {
+			if (find(neigh) == root)
+				return;
+			num_cross++;
+			if (best == INVALID_VERTEX_ID
+				|| lighter(w, id, neigh, best_weight, id, best)) {
+				best = neigh;
+				best_weight = w;
+			}
+		});
+	mprog.add_read(num_cross);
+	if (best == INVALID_VERTEX_ID) {
+		finished[id] = 1;
+		return;
+	}
+
+	best_neighs[id] = best;
+	best_weights[id] = best_weight;
+	vertex_id_t curr = comp_best[root].load();
+	while (curr == INVALID_VERTEX_ID
+			|| lighter(best_weight, id, best, best_weights[curr], curr,
+				best_neighs[curr])) {
+		if (comp_best[root].compare_exchange_weak(curr, id))
+			break;
+	}
+}
+
+template<class weight_t>
+void msf_vertex::contract(vertex_program &prog, const page_vertex &vertex)
+{
+	msf_vertex_program &mprog = (msf_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	vertex_id_t root = find(id);
+	// Each edge is copied from the endpoint with the smaller id.
+	for_each_weighted_edge<weight_t>(weight, id, vertex,
+			[&](vertex_id_t neigh, double w) {
+			if (neigh > id && find(neigh) != root)
+				mprog.add_contracted_edge(id, neigh, w);
+		});
+	mprog.add_read(0);
+}
+
+void msf_vertex::merge(vertex_program &prog)
+{
+	msf_vertex_program &mprog = (msf_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	vertex_id_t best = comp_best[id].load();
+	comp_best[id] = INVALID_VERTEX_ID;
+	// Two components may pick the same edge, and only one of them adds
+	// the edge to the forest.
+	if (unite(best, best_neighs[best]))
+		mprog.add_forest_edge(best, best_neighs[best], best_weights[best]);
+}
+
+class unfinished_filter: public vertex_filter
+{
+public:
+	bool keep(vertex_program &prog, compute_vertex &v) {
+		return !finished[prog.get_vertex_id(v)];
+	}
+};
+
+class picked_root_filter: public vertex_filter
+{
+public:
+	bool keep(vertex_program &prog, compute_vertex &v) {
+		return comp_best[prog.get_vertex_id(v)].load() != INVALID_VERTEX_ID;
+	}
+};
+
+/*
+ * Run Borůvka's algorithm on the contracted graph in memory.
+ */
+void run_in_mem(std::vector<msf_edge> &edges, msf_result &res)
+{
+	size_t num_vertices = best_neighs.size();
+	std::vector<size_t> best_edges(num_vertices, std::numeric_limits<size_t>::max());
+	std::vector<vertex_id_t> roots;
+	while (!edges.empty()) {
+		// Drop the edges inside components.
+		size_t num_edges = 0;
+		for (size_t i = 0; i < edges.size(); i++)
+			if (find(edges[i].from) != find(edges[i].to))
+				edges[num_edges++] = edges[i];
+		edges.resize(num_edges);
+
+		roots.clear();
+		for (size_t i = 0; i < edges.size(); i++) {
+			const msf_edge &e = edges[i];
+			vertex_id_t ends[2] = {find(e.from), find(e.to)};
+			for (int j = 0; j < 2; j++) {
+				size_t &best = best_edges[ends[j]];
+				if (best == std::numeric_limits<size_t>::max())
+					roots.push_back(ends[j]);
+				if (best == std::numeric_limits<size_t>::max()
+						|| lighter(e.weight, e.from, e.to, edges[best].weight,
+							edges[best].from, edges[best].to))
+					best = i;
+			}
+		}
+		for (size_t i = 0; i < roots.size(); i++) {
+			size_t best = best_edges[roots[i]];
+			best_edges[roots[i]] = std::numeric_limits<size_t>::max();
+			const msf_edge &e = edges[best];
+			if (unite(e.from, e.to))
+				res.edges.push_back(e);
+		}
+	}
+}
+
+void run_stage(graph_engine::ptr graph, msf_stage curr_stage,
+		std::shared_ptr<vertex_filter> filter,
+		std::vector<msf_vertex_program::ptr> &mprogs)
+{
+	stage = curr_stage;
+	graph->start(filter, vertex_program_creater::ptr(
+				new msf_vertex_program_creater()));
+	graph->wait4complete();
+
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	mprogs.clear();
+	for (size_t i = 0; i < vprogs.size(); i++)
+		mprogs.push_back(msf_vertex_program::cast2(vprogs[i]));
+}
+
+}
+
+namespace fg
+{
+
+msf_result compute_msf(FG_graph::ptr fg, const fm::scalar_type *weight_type)
+{
+	msf_result res;
+	if (fg->get_graph_header().is_directed_graph()) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "The minimum spanning forest only works on undirected graphs";
+		return res;
+	}
+	if (!get_weight_kind(fg, weight_type, ::weight))
+		return res;
+
+	graph_index::ptr index = NUMA_graph_index<msf_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	size_t num_vertices = fg->get_num_vertices();
+	parents = std::unique_ptr<std::atomic<vertex_id_t>[]>(
+			new std::atomic<vertex_id_t>[num_vertices]);
+	comp_best = std::unique_ptr<std::atomic<vertex_id_t>[]>(
+			new std::atomic<vertex_id_t>[num_vertices]);
+	for (vertex_id_t id = 0; id < num_vertices; id++) {
+		parents[id] = id;
+		comp_best[id] = INVALID_VERTEX_ID;
+	}
+	best_neighs.assign(num_vertices, INVALID_VERTEX_ID);
+	best_weights.assign(num_vertices, 0);
+	finished.assign(num_vertices, 0);
+
+	BOOST_LOG_TRIVIAL(info) << "Borůvka minimum spanning forest starts";
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	std::vector<msf_vertex_program::ptr> mprogs;
+	std::shared_ptr<vertex_filter> unfinished(new unfinished_filter());
+	// All edges are between components at the beginning, and each edge
+	// is stored in both endpoints.
+	size_t num_cross_edges = fg->get_num_edges();
+	size_t num_reads = 0;
+	for (int round = 0; ; round++) {
+		if (num_cross_edges / 2 <= MAX_CONTRACTED_EDGES) {
+			run_stage(graph, CONTRACT, unfinished, mprogs);
+			std::vector<msf_edge> edges;
+			for (size_t i = 0; i < mprogs.size(); i++) {
+				std::vector<msf_edge> &part
+					= mprogs[i]->get_contracted_edges();
+				edges.insert(edges.end(), part.begin(), part.end());
+				num_reads += mprogs[i]->get_num_reads();
+			}
+			BOOST_LOG_TRIVIAL(info) << boost::format(
+					"round %1%: contract %2% edges in memory") % round
+				% edges.size();
+			run_in_mem(edges, res);
+			break;
+		}
+
+		run_stage(graph, SCAN, unfinished, mprogs);
+		num_cross_edges = 0;
+		for (size_t i = 0; i < mprogs.size(); i++) {
+			num_cross_edges += mprogs[i]->get_num_cross_edges();
+			num_reads += mprogs[i]->get_num_reads();
+		}
+		if (num_cross_edges == 0)
+			break;
+
+		run_stage(graph, MERGE, std::shared_ptr<vertex_filter>(
+					new picked_root_filter()), mprogs);
+		size_t num_merged = 0;
+		for (size_t i = 0; i < mprogs.size(); i++) {
+			std::vector<msf_edge> &part = mprogs[i]->get_forest_edges();
+			res.edges.insert(res.edges.end(), part.begin(), part.end());
+			num_merged += part.size();
+		}
+		BOOST_LOG_TRIVIAL(info) << boost::format(
+				"round %1%: %2% edges between components, %3% merges") % round
+			% (num_cross_edges / 2) % num_merged;
+	}
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	for (size_t i = 0; i < res.edges.size(); i++)
+		res.total_weight += res.edges[i].weight;
+	res.num_trees = num_vertices - res.edges.size();
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"The minimum spanning forest has %1% trees, %2% edges and weight %3%, reading %4% edge lists in %5% seconds")
+		% res.num_trees % res.edges.size() % res.total_weight % num_reads
+		% time_diff(start, end);
+
+	parents.reset();
+	comp_best.reset();
+	std::vector<vertex_id_t>().swap(best_neighs);
+	std::vector<double>().swap(best_weights);
+	std::vector<char>().swap(finished);
+	return res;
+}
+
+}
@@ -28,6 +28,7 @@
 
 #include "FGlib.h"
 #include "graph_engine.h"
+#include "set_intersection.h"
 
 using namespace fg;
 
@@ -150,69 +151,22 @@ size_t get_unique_neighbors(const page_vertex &vertex,
 	return num_neighbors;
 }
 
-size_t get_common_vertices(const std::vector<vertex_id_t> &vertices1,
-		const std::vector<vertex_id_t> &vertices2)
+class count_common
 {
-	size_t common = 0;
-	size_t i, j;
-	// We assume both vectors are sorted in the ascending order.
-	// We only need to scan them together to extract the common elements.
-	for (i = 0, j = 0; i < vertices1.size() && j < vertices2.size();) {
-		if (vertices1[i] == vertices2[j]) {
-			common++;
-			i++;
-			j++;
-		}
-		else if (vertices1[i] > vertices2[j])
-			j++;
-		else
-			i++;
-
+public:
+	void operator()(uint32_t idx, uint32_t num) {
 	}
-	return common;
-}
+};
 
-size_t get_union_vertices(const std::vector<vertex_id_t> &vertices1,
+/*
+ * Both vectors are sorted in the ascending order and don't have duplicates.
+ */
+size_t get_common_vertices(const std::vector<vertex_id_t> &vertices1,
 		const std::vector<vertex_id_t> &vertices2)
 {
-	class skip_none {
-	public:
-		bool operator()(vertex_id_t id) {
-			return false;
-		}
-	};
-
-	class null_iterator: public std::iterator<std::random_access_iterator_tag, vertex_id_t> {
-		vertex_id_t id;
-		int idx;
-	public:
-		typedef typename std::iterator<std::random_access_iterator_tag,
-				vertex_id_t>::difference_type difference_type;
-
-		null_iterator() {
-			idx = 0;
-			id = 0;
-		}
-
-		vertex_id_t &operator*() {
-			return id;
-		}
-
-		null_iterator operator++(int) {
-			null_iterator it = *this;
-			idx++;
-			return it;
-		}
-
-		difference_type operator-(const null_iterator &it) {
-			return idx - it.idx;
-		}
-	};
-
-	size_t num_eles = unique_merge(vertices1.begin(), vertices1.end(),
-			vertices2.begin(), vertices2.end(), skip_none(), merge_edge(),
-			null_iterator());
-	return num_eles;
+	count_common count;
+	sorted_id_list list(vertices1.data(), vertices1.size());
+	return list.intersect(vertices2.data(), vertices2.size(), count);
 }
 
 class overlap_vertex: public compute_vertex
@@ -308,7 +262,8 @@ void overlap_vertex::run_stage2(vertex_program &prog)
 
 		overlap_vertex &neigh = (overlap_vertex &) prog.get_graph().get_vertex(id);
 		size_t common = get_common_vertices(*neighborhood, *neigh.neighborhood);
-		size_t vunion = get_union_vertices(*neighborhood, *neigh.neighborhood);
+		size_t vunion = neighborhood->size() + neigh.neighborhood->size()
+			- common;
 		overlaps[i] = ((double) common) / vunion;
 	}
 	overlap_vertex_program &overlap_prog = (overlap_vertex_program &) prog;
@@ -22,6 +22,7 @@
 
 #include <limits>
 #include <cmath>
+#include <atomic>
 
 #include "graph_engine.h"
 #include "graph_config.h"
@@ -140,6 +141,14 @@ public:
 	float get_delta() const {
 		return delta;
 	}
+
+	float get_value() const {
+		return delta;
+	}
+
+	void set_value(float delta) {
+		this->delta = delta;
+	}
 };
 
 class pgrank_vertex2: public compute_directed_vertex
@@ -181,15 +190,124 @@ void pgrank_vertex2::run(vertex_program &prog, const page_vertex &vertex)
 	// If this is the first iteration.
 	if (prog.get_graph().get_curr_level() == 0) {
 		pr_message msg(curr_itr_pr / num_dests * DAMPING_FACTOR);
+		msg.set_combinable(true);
 		prog.multicast_msg(it, msg);
 	}
 	else if (std::fabs(new_pr - curr_itr_pr) > TOLERANCE) {
 		pr_message msg((new_pr - curr_itr_pr) / num_dests * DAMPING_FACTOR);
+		msg.set_combinable(true);
 		prog.multicast_msg(it, msg);
 		curr_itr_pr = new_pr;
 	}
 }
 
+/*
+ * A vertex only needs the sum of the deltas sent to it.
+ */
+class pgrank2_vertex_program: public vertex_program_impl<pgrank_vertex2>
+{
+public:
+	pgrank2_vertex_program() {
+		set_combiner(msg_combiner_impl<pr_message,
+				sum_msg_op<pr_message> >::create());
+	}
+};
+
+class pgrank2_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new pgrank2_vertex_program());
+	}
+};
+
+/*
+ * PageRank-delta. A vertex accumulates the PageRank pushed by its
+ * in-neighbors in `residual' and pushes it to its out-neighbors only
+ * when the residual is larger than the tolerance. It doesn't depend on
+ * levels, so it runs in both the synchronous and the asynchronous mode.
+ */
+class pgrank_delta_vertex: public compute_directed_vertex
+{
+	float pr;
+	// The owner thread adds the PageRank from messages to the residual
+	// while the vertex may be processed by another thread, so the residual
+	// has to be updated atomically.
+	std::atomic<float> residual;
+public:
+	pgrank_delta_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		this->pr = 0;
+		this->residual = 1 - DAMPING_FACTOR;
+	}
+
+	float get_result() const {
+		return pr;
+	}
+
+	float get_residual() const {
+		return residual.load();
+	}
+
+	void run(vertex_program &prog) {
+		if (residual.load() <= TOLERANCE)
+			return;
+		directed_vertex_request req(prog.get_vertex_id(*this),
+				edge_type::OUT_EDGE);
+		request_partial_vertices(&req, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		// The residual may have grown since the vertex requested its edges,
+		// so we push all of it.
+		float delta = residual.exchange(0);
+		pr += delta;
+		int num_dests = vertex.get_num_edges(OUT_EDGE);
+		if (num_dests > 0) {
+			edge_seq_iterator it = vertex.get_neigh_seq_it(OUT_EDGE, 0,
+					num_dests);
+			pr_message msg(delta / num_dests * DAMPING_FACTOR);
+			msg.set_combinable(true);
+			prog.multicast_msg(it, msg);
+		}
+	}
+
+	void run_on_message(vertex_program &, const vertex_message &msg1) {
+		const pr_message &msg = (const pr_message &) msg1;
+		float old = residual.load();
+		while (!residual.compare_exchange_weak(old, old + msg.get_delta())) {
+		}
+	}
+};
+
+class pgrank_delta_vertex_program: public vertex_program_impl<pgrank_delta_vertex>
+{
+public:
+	pgrank_delta_vertex_program() {
+		set_combiner(msg_combiner_impl<pr_message,
+				sum_msg_op<pr_message> >::create());
+	}
+};
+
+class pgrank_delta_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new pgrank_delta_vertex_program());
+	}
+};
+
+/*
+ * In the asynchronous mode, the vertex with the largest residual is
+ * processed first.
+ */
+class residual_priority: public vertex_priority
+{
+public:
+	float get_priority(vertex_program &, const compute_vertex &v) const {
+		return -((const pgrank_delta_vertex &) v).get_residual();
+	}
+};
+
 }
 
 #include "save_result.h"
@@ -286,7 +404,8 @@ fm::vector::ptr compute_pagerank2(FG_graph::ptr fg, int num_iters,
 
 	struct timeval start, end;
 	gettimeofday(&start, NULL);
-	graph->start_all(); 
+	graph->start_all(vertex_initializer::ptr(),
+			vertex_program_creater::ptr(new pgrank2_vertex_program_creater()));
 	graph->wait4complete();
 	gettimeofday(&end, NULL);
 
@@ -307,4 +426,62 @@ fm::vector::ptr compute_pagerank2(FG_graph::ptr fg, int num_iters,
 	return fm::vector::create(res_store);
 }
 
+fm::vector::ptr compute_pagerank_delta(FG_graph::ptr fg, float tolerance,
+		float damping_factor, bool async)
+{
+	bool directed = fg->get_graph_header().is_directed_graph();
+	if (!directed) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "This algorithm works on a directed graph";
+		return fm::vector::ptr();
+	}
+
+	DAMPING_FACTOR = damping_factor;
+	if (DAMPING_FACTOR < 0 || DAMPING_FACTOR > 1) {
+		BOOST_LOG_TRIVIAL(fatal)
+			<< "Damping factor must be between 0 and 1 inclusive";
+		return fm::vector::ptr();
+	}
+	if (tolerance <= 0) {
+		BOOST_LOG_TRIVIAL(error) << "The tolerance has to be positive";
+		return fm::vector::ptr();
+	}
+	TOLERANCE = tolerance;
+
+	graph_index::ptr index = NUMA_graph_index<pgrank_delta_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	graph->set_async(async, vertex_priority::ptr(new residual_priority()));
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("Pagerank-delta (tolerance: %1%) starts in the %2% mode")
+		% TOLERANCE % (async ? "asynchronous" : "synchronous");
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	graph->start_all(vertex_initializer::ptr(),
+			vertex_program_creater::ptr(new pgrank_delta_vertex_program_creater()));
+	graph->wait4complete();
+	gettimeofday(&end, NULL);
+
+	fm::detail::mem_vec_store::ptr res_store = fm::detail::mem_vec_store::create(
+			fg->get_num_vertices(), safs::params.get_num_nodes(),
+			fm::get_scalar_type<float>());
+	graph->query_on_all(vertex_query::ptr(
+				new save_query<float, pgrank_delta_vertex>(res_store)));
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("Pagerank-delta converges in %1% seconds")
+		% time_diff(start, end);
+	return fm::vector::create(res_store);
+}
+
 }
@@ -0,0 +1,403 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <new>
+#include <queue>
+#include <vector>
+#include <unordered_map>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+
+/*
+ * This computes personalized PageRank (PPR) with forward push (Andersen,
+ * Chung and Lang). Each seed set starts with a residual of 1 spread over
+ * its vertices. A vertex whose residual of a seed set exceeds the threshold
+ * of the seed set times its out-degree keeps 1 - d of the residual as its
+ * PPR estimate and pushes the rest to its out-neighbors evenly.
+ * The estimate of a vertex never exceeds its PPR. In an undirected graph,
+ * it's smaller than its PPR by at most the threshold times its degree.
+ *
+ * Up to 64 seed sets run in a batch. A vertex pushes the residuals of
+ * all seed sets in one message, so it reads its edge list once per level
+ * for all of them. A vertex only keeps the estimates and residuals of
+ * the seed sets that reach it.
+ */
+
+using namespace fg;
+
+namespace
+{
+
+const size_t MAX_BATCH_SIZE = 64;
+
+double damping_factor;
+bool directed;
+// The seed sets and their thresholds in the current batch.
+std::vector<const std::vector<vertex_id_t> *> seed_sets;
+std::vector<double> thresholds;
+
+struct ppr_entry
+{
+	double est;
+	double residual;
+
+	ppr_entry() {
+		est = 0;
+		residual = 0;
+	}
+};
+
+template<class Func>
+void for_each_bit(uint64_t word, Func func)
+{
+	while (word) {
+		func(__builtin_ctzl(word));
+		word &= word - 1;
+	}
+}
+
+/*
+ * The residuals pushed from the sender for some seed sets. They're stored
+ * in the order of the seed sets.
+ */
+class residual_message: public vertex_message
+{
+	uint64_t seeds;
+	double residuals[0];
+public:
+	static size_t get_size(uint64_t seeds) {
+		return sizeof(residual_message)
+			+ sizeof(double) * __builtin_popcountl(seeds);
+	}
+
+	residual_message(uint64_t seeds): vertex_message(get_size(seeds), true) {
+		this->seeds = seeds;
+	}
+
+	uint64_t get_seeds() const {
+		return seeds;
+	}
+
+	double *get_residuals() {
+		return residuals;
+	}
+
+	const double *get_residuals() const {
+		return residuals;
+	}
+};
+
+class ppr_vertex: public compute_directed_vertex
+{
+	vsize_t num_out_edges;
+	// The seed sets that reach the vertex. Their entries are stored in
+	// the order of the seed sets.
+	uint64_t seeds;
+	// The seed sets whose residuals exceed their thresholds.
+	uint64_t active;
+	std::vector<ppr_entry> *entries;
+
+	ppr_entry &get_entry(int seed) {
+		uint64_t bit = 1UL << seed;
+		size_t idx = __builtin_popcountl(seeds & (bit - 1));
+		if (!(seeds & bit)) {
+			if (entries == NULL)
+				entries = new std::vector<ppr_entry>();
+			entries->insert(entries->begin() + idx, ppr_entry());
+			seeds |= bit;
+		}
+		return (*entries)[idx];
+	}
+
+	bool over_threshold(int seed, double residual) const {
+		// A vertex without out-edges pushes its residual back to the seeds.
+		return residual > thresholds[seed] * std::max(num_out_edges, 1U);
+	}
+public:
+	ppr_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		num_out_edges = 0;
+		seeds = 0;
+		active = 0;
+		entries = NULL;
+	}
+
+	void init(vsize_t num_out_edges) {
+		this->num_out_edges = num_out_edges;
+		seeds = 0;
+		active = 0;
+		delete entries;
+		entries = NULL;
+	}
+
+	/*
+	 * Add residual to the vertex. The vertex pushes the residual in
+	 * the next level if it exceeds the threshold.
+	 */
+	void add_residual(int seed, double residual) {
+		ppr_entry &entry = get_entry(seed);
+		entry.residual += residual;
+		if (over_threshold(seed, entry.residual))
+			active |= 1UL << seed;
+	}
+
+	template<class Func>
+	void for_each_est(Func func) const {
+		if (entries == NULL)
+			return;
+		size_t idx = 0;
+		for_each_bit(seeds, [&](int seed) {
+				func(seed, (*entries)[idx++].est);
+			});
+	}
+
+	void run(vertex_program &prog) {
+		if (active == 0)
+			return;
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (!directed)
+			request_vertices(&id, 1);
+		else {
+			directed_vertex_request req(id, edge_type::OUT_EDGE);
+			request_partial_vertices(&req, 1);
+		}
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg1) {
+		const residual_message &msg = (const residual_message &) msg1;
+		const double *residuals = msg.get_residuals();
+		for_each_bit(msg.get_seeds(), [&](int seed) {
+				add_residual(seed, *residuals++);
+			});
+	}
+};
+
+void ppr_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	uint64_t pushed = active;
+	active = 0;
+	size_t num_edges = vertex.get_num_edges(edge_type::OUT_EDGE);
+	stack_array<char, 256> buf(residual_message::get_size(pushed));
+	residual_message *msg = new (buf.data()) residual_message(pushed);
+	double *residuals = msg->get_residuals();
+	for_each_bit(pushed, [&](int seed) {
+			ppr_entry &entry = get_entry(seed);
+			entry.est += (1 - damping_factor) * entry.residual;
+			double residual = damping_factor * entry.residual;
+			entry.residual = 0;
+			if (num_edges > 0) {
+				*residuals++ = residual / num_edges;
+				return;
+			}
+
+			// A vertex without out-edges jumps back to the seeds.
+			const std::vector<vertex_id_t> &seed_set = *seed_sets[seed];
+			stack_array<char, 64> seed_buf(residual_message::get_size(1));
+			residual_message *seed_msg = new (seed_buf.data())
+				residual_message(1UL << seed);
+			seed_msg->get_residuals()[0] = residual / seed_set.size();
+			for (size_t i = 0; i < seed_set.size(); i++)
+				prog.send_msg(seed_set[i], *seed_msg);
+		});
+	if (num_edges > 0) {
+		edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+		prog.multicast_msg(it, *msg);
+	}
+}
+
+class ppr_initializer: public vertex_initializer
+{
+	graph_engine &graph;
+	const std::unordered_map<vertex_id_t, std::vector<int> > &seed_map;
+public:
+	ppr_initializer(graph_engine &_graph,
+			const std::unordered_map<vertex_id_t, std::vector<int> > &_seed_map): graph(
+				_graph), seed_map(_seed_map) {
+	}
+
+	void init(compute_vertex &v) {
+		ppr_vertex &pv = (ppr_vertex &) v;
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		pv.init(graph.get_num_edges(id, edge_type::OUT_EDGE));
+		auto it = seed_map.find(id);
+		if (it == seed_map.end())
+			return;
+		for (size_t i = 0; i < it->second.size(); i++) {
+			int seed = it->second[i];
+			pv.add_residual(seed, 1.0 / seed_sets[seed]->size());
+		}
+	}
+};
+
+typedef std::pair<float, vertex_id_t> score_t;
+typedef std::priority_queue<score_t, std::vector<score_t>,
+		std::greater<score_t> > topk_queue;
+
+/*
+ * Keep the k vertices with the largest estimates for each seed set.
+ */
+class topk_query: public vertex_query
+{
+	size_t k;
+	std::vector<topk_queue> queues;
+
+	void add(int seed, vertex_id_t id, float est) {
+		topk_queue &q = queues[seed];
+		if (q.size() < k)
+			q.push(score_t(est, id));
+		else if (q.top().first < est) {
+			q.pop();
+			q.push(score_t(est, id));
+		}
+	}
+public:
+	topk_query(size_t k, size_t num_seeds): queues(num_seeds) {
+		this->k = k;
+	}
+
+	virtual void run(graph_engine &graph, compute_vertex &v) {
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		((ppr_vertex &) v).for_each_est([&](int seed, double est) {
+				if (est > 0)
+					add(seed, id, est);
+			});
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+		topk_query *other = (topk_query *) q.get();
+		for (size_t i = 0; i < queues.size(); i++) {
+			while (!other->queues[i].empty()) {
+				add(i, other->queues[i].top().second, other->queues[i].top().first);
+				other->queues[i].pop();
+			}
+		}
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new topk_query(k, queues.size()));
+	}
+
+	void get_topk(size_t seed, std::vector<std::pair<vertex_id_t, float> > &res) {
+		topk_queue &q = queues[seed];
+		res.resize(q.size());
+		for (size_t i = res.size(); i > 0; i--) {
+			res[i - 1] = std::pair<vertex_id_t, float>(q.top().second,
+					q.top().first);
+			q.pop();
+		}
+	}
+};
+
+class ppr_cleaner: public vertex_initializer
+{
+public:
+	void init(compute_vertex &v) {
+		((ppr_vertex &) v).init(0);
+	}
+};
+
+}
+
+namespace fg
+{
+
+std::vector<std::vector<std::pair<vertex_id_t, float> > > compute_ppr_topk(
+		FG_graph::ptr fg, const std::vector<std::vector<vertex_id_t> > &seeds,
+		const std::vector<double> &epsilons, size_t k, float damping_factor)
+{
+	std::vector<std::vector<std::pair<vertex_id_t, float> > > res;
+	if (epsilons.size() != 1 && epsilons.size() != seeds.size()) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "there has to be one threshold or a threshold per seed set";
+		return res;
+	}
+	for (size_t i = 0; i < epsilons.size(); i++) {
+		if (epsilons[i] <= 0) {
+			BOOST_LOG_TRIVIAL(error) << "the thresholds have to be positive";
+			return res;
+		}
+	}
+	for (size_t i = 0; i < seeds.size(); i++) {
+		if (seeds[i].empty()) {
+			BOOST_LOG_TRIVIAL(error) << "a seed set can't be empty";
+			return res;
+		}
+	}
+	::damping_factor = damping_factor;
+	directed = fg->get_graph_header().is_directed_graph();
+
+	graph_index::ptr index = NUMA_graph_index<ppr_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"personalized PageRank for %1% seed sets") % seeds.size();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	res.resize(seeds.size());
+	for (size_t first = 0; first < seeds.size(); first += MAX_BATCH_SIZE) {
+		size_t num = std::min(MAX_BATCH_SIZE, seeds.size() - first);
+		seed_sets.resize(num);
+		thresholds.resize(num);
+		std::unordered_map<vertex_id_t, std::vector<int> > seed_map;
+		for (size_t i = 0; i < num; i++) {
+			seed_sets[i] = &seeds[first + i];
+			thresholds[i] = epsilons.size() == 1 ? epsilons[0]
+				: epsilons[first + i];
+			for (size_t j = 0; j < seeds[first + i].size(); j++)
+				seed_map[seeds[first + i][j]].push_back(i);
+		}
+		std::vector<vertex_id_t> start_ids;
+		for (auto it = seed_map.begin(); it != seed_map.end(); it++)
+			start_ids.push_back(it->first);
+
+		graph->init_all_vertices(vertex_initializer::ptr(
+					new ppr_initializer(*graph, seed_map)));
+		graph->start(start_ids.data(), start_ids.size());
+		graph->wait4complete();
+
+		vertex_query::ptr query(new topk_query(k, num));
+		graph->query_on_all(query);
+		for (size_t i = 0; i < num; i++)
+			((topk_query *) query.get())->get_topk(i, res[first + i]);
+	}
+	graph->init_all_vertices(vertex_initializer::ptr(new ppr_cleaner()));
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"personalized PageRank takes %1% seconds") % time_diff(start, end);
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	return res;
+}
+
+}
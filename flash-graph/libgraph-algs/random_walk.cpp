@@ -0,0 +1,638 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+#include "edge_weight.h"
+
+/*
+ * This generates random walks for DeepWalk and node2vec. A batch of walkers
+ * advance together, one step in a level. The walkers on the same vertex are
+ * kept in a list, so the vertex reads its edge list once for all of them.
+ *
+ * In a node2vec walk, the probability of moving from v to x depends on
+ * the previous vertex t: it's proportional to w(v, x) / p if x is t,
+ * w(v, x) if x is a neighbor of t and w(v, x) / q otherwise. Vertex v doesn't
+ * know the neighbors of t, so we use rejection sampling (as KnightKing does):
+ * v proposes x with the first-order probability and draws u in
+ * [0, max(1/p, 1, 1/q)). If u is small enough or large enough, v accepts or
+ * rejects x by itself. Otherwise, it sends the walker to x, which checks if
+ * t is its neighbor and accepts the move or sends the walker back to v.
+ */
+
+using namespace fg;
+
+namespace
+{
+
+const uint32_t INVALID_WALKER = std::numeric_limits<uint32_t>::max();
+/*
+ * We build an alias table for a vertex with at least this many edges in
+ * a weighted graph and keep it for all walkers that visit the vertex.
+ */
+const size_t ALIAS_MIN_DEGREE = 1024;
+
+enum walker_state
+{
+	// The walker moves from the vertex it's on.
+	WALK,
+	// The walker is proposed to move to the vertex.
+	PROPOSED,
+};
+
+/*
+ * The state shared by all threads.
+ */
+weight_kind weight = UNIT_WEIGHT;
+bool directed = true;
+size_t walk_length;
+double return_param;
+double inout_param;
+bool biased;
+
+/*
+ * The vertices visited by all walkers in a batch. The walk of a walker is
+ * stored in `walk_length' consecutive entries. Only the thread that owns
+ * the vertex where a walker is updates the state of the walker.
+ */
+std::vector<vertex_id_t> walks;
+std::vector<uint32_t> walk_lens;
+/*
+ * The walkers on a vertex are linked with `next_walkers'.
+ */
+std::vector<uint32_t> next_walkers;
+std::vector<uint8_t> walker_states;
+// The threshold of accepting the move to a proposed vertex.
+std::vector<float> thresholds;
+
+class alias_table;
+/*
+ * The alias tables of the vertices with many edges. Only the thread that
+ * owns a vertex builds its table.
+ */
+std::vector<std::unique_ptr<alias_table> > alias_tables;
+
+vertex_id_t get_curr_vertex(uint32_t walker)
+{
+	return walks[walker * walk_length + walk_lens[walker] - 1];
+}
+
+vertex_id_t get_prev_vertex(uint32_t walker)
+{
+	return walks[walker * walk_length + walk_lens[walker] - 2];
+}
+
+void add_to_walk(uint32_t walker, vertex_id_t id)
+{
+	walks[walker * walk_length + walk_lens[walker]] = id;
+	walk_lens[walker]++;
+}
+
+/*
+ * Walker's alias method for sampling from a discrete distribution in
+ * constant time.
+ */
+class alias_table
+{
+	std::vector<double> probs;
+	std::vector<uint32_t> aliases;
+public:
+	alias_table(const std::vector<double> &weights);
+
+	size_t sample(double r1, double r2) const {
+		size_t idx = std::min((size_t) (r1 * probs.size()), probs.size() - 1);
+		return r2 < probs[idx] ? idx : aliases[idx];
+	}
+};
+
+alias_table::alias_table(const std::vector<double> &weights): probs(
+		weights.size()), aliases(weights.size())
+{
+	double sum = 0;
+	for (size_t i = 0; i < weights.size(); i++)
+		sum += weights[i];
+	std::vector<uint32_t> small, large;
+	for (size_t i = 0; i < weights.size(); i++) {
+		probs[i] = weights[i] * weights.size() / sum;
+		aliases[i] = i;
+		if (probs[i] < 1)
+			small.push_back(i);
+		else
+			large.push_back(i);
+	}
+	while (!small.empty() && !large.empty()) {
+		uint32_t s = small.back();
+		uint32_t l = large.back();
+		small.pop_back();
+		aliases[s] = l;
+		probs[l] -= 1 - probs[s];
+		if (probs[l] < 1) {
+			large.pop_back();
+			small.push_back(l);
+		}
+	}
+	// The remaining entries have a probability of 1 up to rounding errors.
+	for (size_t i = 0; i < small.size(); i++)
+		probs[small[i]] = 1;
+	for (size_t i = 0; i < large.size(); i++)
+		probs[large[i]] = 1;
+}
+
+/*
+ * A walker moves to the receiver, or is proposed to move to the receiver,
+ * or is sent back to the receiver after a proposal is rejected.
+ */
+class walker_message: public vertex_message
+{
+	uint32_t walker;
+	uint32_t state;
+	float threshold;
+public:
+	walker_message(uint32_t walker, walker_state state,
+			float threshold = 0): vertex_message(sizeof(walker_message), true) {
+		this->walker = walker;
+		this->state = state;
+		this->threshold = threshold;
+	}
+
+	uint32_t get_walker() const {
+		return walker;
+	}
+
+	walker_state get_state() const {
+		return (walker_state) state;
+	}
+
+	float get_threshold() const {
+		return threshold;
+	}
+};
+
+class walk_vertex_program;
+class neighbor_sampler;
+
+class walk_vertex: public compute_directed_vertex
+{
+	// The walkers that arrive in the current level and the walkers
+	// that move in the current level.
+	uint32_t arrived;
+	uint32_t walking;
+	bool has_proposal;
+
+	void move(walk_vertex_program &prog, neighbor_sampler &sampler,
+			uint32_t walker);
+public:
+	walk_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		arrived = INVALID_WALKER;
+		walking = INVALID_WALKER;
+		has_proposal = false;
+	}
+
+	void add_walker(uint32_t walker) {
+		next_walkers[walker] = arrived;
+		arrived = walker;
+	}
+
+	void run(vertex_program &prog);
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg);
+};
+
+class walk_vertex_program: public vertex_program_impl<walk_vertex>
+{
+	unsigned int seed;
+	// The edge weights and their prefix sums of the vertex being processed.
+	std::vector<double> weights;
+	std::vector<double> weight_sums;
+public:
+	walk_vertex_program(unsigned int seed) {
+		this->seed = seed;
+	}
+
+	double rand_uniform() {
+		return rand_r(&seed) / (RAND_MAX + 1.0);
+	}
+
+	size_t rand_index(size_t num) {
+		return std::min((size_t) (rand_uniform() * num), num - 1);
+	}
+
+	std::vector<double> &get_weights() {
+		return weights;
+	}
+
+	std::vector<double> &get_weight_sums() {
+		return weight_sums;
+	}
+};
+
+class walk_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new walk_vertex_program(random()));
+	}
+};
+
+class read_weights_func
+{
+	const page_vertex &vertex;
+	std::vector<double> &weights;
+public:
+	read_weights_func(const page_vertex &_vertex,
+			std::vector<double> &_weights): vertex(_vertex), weights(_weights) {
+	}
+
+	template<class weight_t>
+	void run() {
+		safs::page_byte_array::seq_const_iterator<weight_t> data_it
+			= directed ? ((const page_directed_vertex &) vertex).get_data_seq_it<
+			weight_t>(edge_type::OUT_EDGE) : ((const page_undirected_vertex &)
+					vertex).get_data_seq_it<weight_t>();
+		while (data_it.has_next())
+			weights.push_back(data_it.next());
+	}
+};
+
+/*
+ * Choose the next vertex with the first-order transition probability.
+ * The weights of a vertex are read only once for all walkers on it.
+ */
+class neighbor_sampler
+{
+	walk_vertex_program &prog;
+	const page_vertex &vertex;
+	vertex_id_t id;
+	size_t num_edges;
+	bool weights_read;
+
+	void read_weights();
+public:
+	neighbor_sampler(walk_vertex_program &_prog, const page_vertex &_vertex,
+			vertex_id_t id): prog(_prog), vertex(_vertex) {
+		this->id = id;
+		num_edges = vertex.get_num_edges(edge_type::OUT_EDGE);
+		weights_read = false;
+	}
+
+	size_t get_num_edges() const {
+		return num_edges;
+	}
+
+	vertex_id_t sample();
+};
+
+void neighbor_sampler::read_weights()
+{
+	std::vector<double> &weights = prog.get_weights();
+	weights.clear();
+	assert(weight != UNIT_WEIGHT);
+	read_weights_func func(vertex, weights);
+	dispatch_weight(weight, func);
+	if (num_edges >= ALIAS_MIN_DEGREE) {
+		alias_tables[id] = std::unique_ptr<alias_table>(
+				new alias_table(weights));
+		return;
+	}
+	std::vector<double> &sums = prog.get_weight_sums();
+	sums.resize(weights.size());
+	double sum = 0;
+	for (size_t i = 0; i < weights.size(); i++) {
+		sum += weights[i];
+		sums[i] = sum;
+	}
+}
+
+vertex_id_t neighbor_sampler::sample()
+{
+	size_t idx;
+	if (weight == UNIT_WEIGHT)
+		idx = prog.rand_index(num_edges);
+	else {
+		if (alias_tables[id] == NULL && !weights_read) {
+			read_weights();
+			weights_read = true;
+		}
+		if (alias_tables[id])
+			idx = alias_tables[id]->sample(prog.rand_uniform(),
+					prog.rand_uniform());
+		else {
+			const std::vector<double> &sums = prog.get_weight_sums();
+			double r = prog.rand_uniform() * sums.back();
+			idx = std::upper_bound(sums.begin(), sums.end(), r) - sums.begin();
+			idx = std::min(idx, num_edges - 1);
+		}
+	}
+	return *(vertex.get_neigh_begin(edge_type::OUT_EDGE) + idx);
+}
+
+/*
+ * Check if there is an edge from `id' to the vertex. The edge lists are
+ * sorted.
+ */
+bool has_edge_from(const page_vertex &vertex, vertex_id_t id)
+{
+	edge_type type = directed ? edge_type::IN_EDGE : edge_type::OUT_EDGE;
+	edge_iterator begin = vertex.get_neigh_begin(type);
+	size_t lo = 0;
+	size_t hi = vertex.get_num_edges(type);
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (*(begin + mid) < id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < vertex.get_num_edges(type) && *(begin + lo) == id;
+}
+
+void walk_vertex::run(vertex_program &prog)
+{
+	walking = arrived;
+	arrived = INVALID_WALKER;
+	if (walking == INVALID_WALKER)
+		return;
+
+	vertex_id_t id = prog.get_vertex_id(*this);
+	if (!directed)
+		request_vertices(&id, 1);
+	else {
+		// We need the in-edges to check a proposed move.
+		directed_vertex_request req(id, has_proposal
+				? edge_type::BOTH_EDGES : edge_type::OUT_EDGE);
+		request_partial_vertices(&req, 1);
+	}
+	has_proposal = false;
+}
+
+void walk_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	walk_vertex_program &walk_prog = (walk_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	neighbor_sampler sampler(walk_prog, vertex, id);
+	uint32_t walker = walking;
+	walking = INVALID_WALKER;
+	while (walker != INVALID_WALKER) {
+		// The walker may be added to another vertex once it moves.
+		uint32_t next = next_walkers[walker];
+		if (walker_states[walker] == PROPOSED) {
+			// The previous vertex is where the walker is now.
+			vertex_id_t prev = get_prev_vertex(walker);
+			double alpha = has_edge_from(vertex, prev) ? 1 : 1 / inout_param;
+			if (alpha < thresholds[walker]) {
+				walker_message msg(walker, WALK);
+				prog.send_msg(get_curr_vertex(walker), msg);
+				walker = next;
+				continue;
+			}
+			walker_states[walker] = WALK;
+			add_to_walk(walker, id);
+		}
+		if (walk_lens[walker] < walk_length && sampler.get_num_edges() > 0)
+			move(walk_prog, sampler, walker);
+		walker = next;
+	}
+}
+
+void walk_vertex::move(walk_vertex_program &prog, neighbor_sampler &sampler,
+		uint32_t walker)
+{
+	if (!biased || walk_lens[walker] < 2) {
+		walker_message msg(walker, WALK);
+		prog.send_msg(sampler.sample(), msg);
+		return;
+	}
+
+	vertex_id_t prev = get_prev_vertex(walker);
+	double max_alpha = std::max(std::max(1 / return_param, 1.0),
+			1 / inout_param);
+	double min_alpha = std::min(1.0, 1 / inout_param);
+	while (true) {
+		vertex_id_t dest = sampler.sample();
+		double u = prog.rand_uniform() * max_alpha;
+		if (dest == prev) {
+			if (u < 1 / return_param)
+				break;
+			continue;
+		}
+		if (u < min_alpha) {
+			walker_message msg(walker, WALK);
+			prog.send_msg(dest, msg);
+			return;
+		}
+		if (u >= std::max(1.0, 1 / inout_param))
+			continue;
+		// Only the destination knows if it's a neighbor of the previous
+		// vertex.
+		walker_message msg(walker, PROPOSED, u);
+		prog.send_msg(dest, msg);
+		return;
+	}
+	walker_message msg(walker, WALK);
+	prog.send_msg(prev, msg);
+}
+
+void walk_vertex::run_on_message(vertex_program &prog,
+		const vertex_message &msg1)
+{
+	const walker_message &msg = (const walker_message &) msg1;
+	uint32_t walker = msg.get_walker();
+	vertex_id_t id = prog.get_vertex_id(*this);
+	if (msg.get_state() == PROPOSED) {
+		walker_states[walker] = PROPOSED;
+		thresholds[walker] = msg.get_threshold();
+		has_proposal = true;
+	}
+	// The walker comes back after its proposal is rejected.
+	else if (get_curr_vertex(walker) == id && walker_states[walker] == PROPOSED)
+		walker_states[walker] = WALK;
+	else
+		add_to_walk(walker, id);
+	add_walker(walker);
+}
+
+class walk_initializer: public vertex_initializer
+{
+	graph_engine &graph;
+	size_t num_vertices;
+	size_t first_walker;
+	size_t num_walkers;
+public:
+	walk_initializer(graph_engine &_graph, size_t first_walker,
+			size_t num_walkers): graph(_graph) {
+		this->num_vertices = graph.get_num_vertices();
+		this->first_walker = first_walker;
+		this->num_walkers = num_walkers;
+	}
+
+	/*
+	 * Walker i starts from vertex i % n.
+	 */
+	void init(compute_vertex &v) {
+		walk_vertex &wv = (walk_vertex &) v;
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		size_t walker = first_walker + (id + num_vertices
+				- first_walker % num_vertices) % num_vertices;
+		for (; walker < first_walker + num_walkers; walker += num_vertices) {
+			uint32_t local = walker - first_walker;
+			walk_lens[local] = 0;
+			walker_states[local] = WALK;
+			add_to_walk(local, id);
+			wv.add_walker(local);
+		}
+	}
+};
+
+/*
+ * Write the walks of a batch. A walk is the number of vertices in it
+ * as a 32-bit integer followed by the vertex IDs.
+ */
+bool write_walks(FILE *f, size_t num_walkers)
+{
+	for (size_t i = 0; i < num_walkers; i++) {
+		uint32_t len = walk_lens[i];
+		if (fwrite(&len, sizeof(len), 1, f) != 1
+				|| fwrite(&walks[i * walk_length], sizeof(vertex_id_t), len, f)
+				!= len)
+			return false;
+	}
+	return true;
+}
+
+}
+
+namespace fg
+{
+
+size_t generate_random_walks(FG_graph::ptr fg, const std::string &out_file,
+		size_t num_walks_per_vertex, size_t walk_length, double p, double q,
+		const fm::scalar_type *weight_type, size_t batch_size)
+{
+	if (walk_length == 0 || batch_size == 0) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "the walk length and the batch size have to be positive";
+		return 0;
+	}
+	if (p <= 0 || q <= 0) {
+		BOOST_LOG_TRIVIAL(error) << "p and q have to be positive";
+		return 0;
+	}
+	batch_size = std::min(batch_size, (size_t) INVALID_WALKER);
+	if (!get_weight_kind(fg, weight_type, ::weight))
+		return 0;
+	directed = fg->get_graph_header().is_directed_graph();
+	::walk_length = walk_length;
+	return_param = p;
+	inout_param = q;
+	biased = p != 1 || q != 1;
+
+	FILE *f = fopen(out_file.c_str(), "w");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't open %1%: %2%")
+			% out_file % strerror(errno);
+		return 0;
+	}
+
+	graph_index::ptr index = NUMA_graph_index<walk_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	size_t num_vertices = fg->get_num_vertices();
+	size_t num_walks = num_vertices * num_walks_per_vertex;
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"generate %1% random walks with %2% vertices") % num_walks
+		% walk_length;
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	if (weight != UNIT_WEIGHT)
+		alias_tables.resize(num_vertices);
+	size_t num_written = 0;
+	for (size_t first = 0; first < num_walks; first += batch_size) {
+		size_t num = std::min(batch_size, num_walks - first);
+		walks.resize(num * walk_length);
+		walk_lens.resize(num);
+		next_walkers.resize(num);
+		walker_states.resize(num);
+		thresholds.resize(num);
+		graph->init_all_vertices(vertex_initializer::ptr(
+					new walk_initializer(*graph, first, num)));
+		if (num >= num_vertices)
+			graph->start_all(vertex_initializer::ptr(),
+					vertex_program_creater::ptr(new walk_vertex_program_creater()));
+		else {
+			std::vector<vertex_id_t> start_ids(num);
+			for (size_t i = 0; i < num; i++)
+				start_ids[i] = (first + i) % num_vertices;
+			graph->start(start_ids.data(), start_ids.size(),
+					vertex_initializer::ptr(), vertex_program_creater::ptr(
+						new walk_vertex_program_creater()));
+		}
+		graph->wait4complete();
+		if (!write_walks(f, num)) {
+			BOOST_LOG_TRIVIAL(error) << boost::format("can't write %1%: %2%")
+				% out_file % strerror(errno);
+			break;
+		}
+		num_written += num;
+	}
+	fclose(f);
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"generating random walks takes %1% seconds") % time_diff(start, end);
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	walks.clear();
+	walks.shrink_to_fit();
+	walk_lens.clear();
+	walk_lens.shrink_to_fit();
+	next_walkers.clear();
+	next_walkers.shrink_to_fit();
+	walker_states.clear();
+	walker_states.shrink_to_fit();
+	thresholds.clear();
+	thresholds.shrink_to_fit();
+	alias_tables.clear();
+	alias_tables.shrink_to_fit();
+	return num_written;
+}
+
+}
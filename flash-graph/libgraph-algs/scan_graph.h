@@ -22,8 +22,8 @@
 
 #include <memory>
 
-#include "graphlab/cuckoo_set_pow2.hpp"
 #include "graph_engine.h"
+#include "set_intersection.h"
 
 /*
  * The edge has two attributes:
@@ -143,58 +143,14 @@ size_t unique_merge(InputIterator1 it1, InputIterator1 last1,
 
 class neighbor_list
 {
-public:
-	class index_entry
-	{
-		fg::vertex_id_t id;
-		uint32_t idx;
-	public:
-		index_entry() {
-			id = -1;
-			idx = -1;
-		}
-
-		index_entry(fg::vertex_id_t id) {
-			this->id = id;
-			this->idx = -1;
-		}
-
-		index_entry(fg::vertex_id_t id, uint32_t idx) {
-			this->id = id;
-			this->idx = idx;
-		}
-
-		fg::vertex_id_t get_id() const {
-			return id;
-		}
-
-		uint32_t get_idx() const {
-			return idx;
-		}
-
-		bool operator==(const index_entry &e) const {
-			return id == e.get_id();
-		}
-	};
-
-	class index_hash
-	{
-		boost::hash<fg::vertex_id_t> id_hash;
-	public:
-		size_t operator()(const index_entry &e) const {
-			return id_hash(e.get_id());
-		}
-	};
-
-	typedef graphlab::cuckoo_set_pow2<index_entry, 3, size_t,
-			index_hash> edge_set_t;
-
 protected:
 	// The vertex Id that the neighbor list belongs to.
 	fg::vertex_id_t id;
 	std::vector<fg::vertex_id_t> id_list;
 	std::vector<int> num_dup_list;
-	edge_set_t *neighbor_set;
+	// It indexes the neighbor IDs to find neighbors and intersect them
+	// with the edge lists of other vertices.
+	fg::sorted_id_list id_set;
 public:
 	class id_iterator: public std::iterator<std::random_access_iterator_tag, fg::vertex_id_t>
 	{
@@ -253,18 +209,11 @@ public:
 			id_list[i] = neighbors[i].get_id();
 			num_dup_list[i] = neighbors[i].get_num_dups();
 		}
-		neighbor_set = NULL;
-		if (num_neighbors > 0) {
-			neighbor_set = new edge_set_t(index_entry(),
-					0, 2 * neighbors.size());
-			for (size_t i = 0; i < neighbors.size(); i++)
-				neighbor_set->insert(index_entry(neighbors[i].get_id(), i));
-		}
+		id_set = fg::sorted_id_list(id_list.data(), id_list.size());
+		id_set.build_index();
 	}
 
 	virtual ~neighbor_list() {
-		if (neighbor_set)
-			delete neighbor_set;
 	}
 
 	fg::vertex_id_t get_neighbor_id(size_t idx) const {
@@ -272,8 +221,8 @@ public:
 	}
 
 	bool contains(fg::vertex_id_t id) const {
-		edge_set_t::const_iterator it = neighbor_set->find(id);
-		return it != neighbor_set->end();
+		uint32_t idx;
+		return id_set.find(id, idx);
 	}
 
 	id_iterator get_id_begin() const {
@@ -309,24 +258,6 @@ public:
 	virtual size_t count_edges(const fg::page_vertex *v);
 	virtual size_t count_edges(const fg::page_vertex *v, fg::edge_type type,
 			std::vector<fg::vertex_id_t> *common_neighs) const;
-	virtual size_t count_edges_hash(const fg::page_vertex *v,
-			fg::edge_iterator other_it, fg::edge_iterator other_end,
-			std::vector<fg::vertex_id_t> *common_neighs) const;
-#if 0
-	virtual size_t count_edges_bin_search_this(const fg::page_vertex *v,
-			neighbor_list::id_iterator this_it,
-			neighbor_list::id_iterator this_end,
-			fg::edge_iterator other_it, fg::edge_iterator other_end) const;
-#endif
-	virtual size_t count_edges_bin_search_other(const fg::page_vertex *v,
-			neighbor_list::id_iterator this_it,
-			neighbor_list::id_iterator this_end,
-			fg::edge_iterator other_it, fg::edge_iterator other_end,
-			std::vector<fg::vertex_id_t> *common_neighs) const;
-	virtual size_t count_edges_scan(const fg::page_vertex *v,
-			neighbor_list::id_iterator this_it,
-			neighbor_list::id_iterator this_end, fg::edge_seq_iterator other_it,
-			std::vector<fg::vertex_id_t> *common_neighs) const;
 };
 
 /*
@@ -0,0 +1,463 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <signal.h>
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <limits>
+#include <vector>
+#include <atomic>
+#include <memory>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+#include "mem_vec_store.h"
+#include "edge_weight.h"
+
+using namespace fg;
+
+namespace
+{
+
+const double INF_DIST = std::numeric_limits<double>::infinity();
+// A vertex marks the sources whose distance is updated with the bits in
+// a 64-bit integer, so a batch has at most 64 sources.
+const size_t MAX_BATCH_SIZE = 64;
+const size_t INVALID_BUCKET = std::numeric_limits<size_t>::max();
+
+/*
+ * The state shared by all threads. The tentative distances of a vertex
+ * from all sources in a batch are stored together. The thread that owns
+ * a vertex updates its distances, while a thread that steals the vertex
+ * in the asynchronous mode may read them, so they're atomic.
+ */
+weight_kind weight = UNIT_WEIGHT;
+bool directed = true;
+double delta = 1;
+size_t num_sources = 0;
+size_t curr_bucket = 0;
+std::unique_ptr<std::atomic<double>[]> dists;
+// Delta-stepping doesn't work with negative weights, so we stop when
+// we find one on the edges being relaxed.
+std::atomic<bool> has_neg_weight;
+
+size_t get_bucket(double dist)
+{
+	// Avoid overflow with a tiny delta.
+	return std::min(dist / delta, 1e18);
+}
+
+double get_dist(vertex_id_t id, size_t source)
+{
+	return dists[id * num_sources + source].load(std::memory_order_relaxed);
+}
+
+/*
+ * Lower the distance of a vertex from a source.
+ * It returns true if the distance is lowered.
+ */
+bool lower_dist(vertex_id_t id, size_t source, double dist)
+{
+	std::atomic<double> &curr = dists[id * num_sources + source];
+	double old = curr.load(std::memory_order_relaxed);
+	while (dist < old) {
+		if (curr.compare_exchange_weak(old, dist, std::memory_order_relaxed))
+			return true;
+	}
+	return false;
+}
+
+class dist_message: public vertex_message
+{
+	uint32_t source;
+	double dist;
+public:
+	dist_message(uint32_t source, double dist): vertex_message(
+			sizeof(dist_message), true) {
+		this->source = source;
+		this->dist = dist;
+	}
+
+	uint32_t get_source() const {
+		return source;
+	}
+
+	double get_dist() const {
+		return dist;
+	}
+};
+
+class sssp_vertex: public compute_directed_vertex
+{
+	// The sources whose distance has been updated, but the edges of
+	// the vertex haven't been relaxed with the new distance. The owner
+	// thread marks a source while another thread may be relaxing the edges
+	// of the vertex, so the bits are updated atomically.
+	std::atomic<uint64_t> updated;
+
+	template<class weight_t>
+	void relax_edges(vertex_program &prog, const page_vertex &vertex,
+			uint32_t source, double dist);
+
+	class relax_edges_func
+	{
+		sssp_vertex &v;
+		vertex_program &prog;
+		const page_vertex &vertex;
+		uint32_t source;
+		double dist;
+	public:
+		relax_edges_func(sssp_vertex &_v, vertex_program &_prog,
+				const page_vertex &_vertex, uint32_t source,
+				double dist): v(_v), prog(_prog), vertex(_vertex) {
+			this->source = source;
+			this->dist = dist;
+		}
+
+		template<class weight_t>
+		void run() {
+			v.relax_edges<weight_t>(prog, vertex, source, dist);
+		}
+	};
+public:
+	sssp_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		updated = 0;
+	}
+
+	void add_source(uint32_t source) {
+		updated.fetch_or(1UL << source);
+	}
+
+	/*
+	 * Whether the vertex has an updated distance in the current bucket.
+	 * With non-negative weights, a distance can't fall in an earlier bucket.
+	 */
+	bool has_work(vertex_id_t id) const {
+		for (size_t i = 0; i < num_sources; i++)
+			if ((updated & (1UL << i)) && get_bucket(get_dist(id, i))
+					<= curr_bucket)
+				return true;
+		return false;
+	}
+
+	double get_min_updated_dist(vertex_id_t id) const {
+		double min_dist = INF_DIST;
+		for (size_t i = 0; i < num_sources; i++)
+			if (updated & (1UL << i))
+				min_dist = std::min(min_dist, get_dist(id, i));
+		return min_dist;
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (!has_work(id))
+			return;
+		if (directed) {
+			directed_vertex_request req(id, edge_type::OUT_EDGE);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg1) {
+		const dist_message &msg = (const dist_message &) msg1;
+		if (lower_dist(prog.get_vertex_id(*this), msg.get_source(),
+					msg.get_dist()))
+			add_source(msg.get_source());
+	}
+};
+
+template<class weight_t>
+void sssp_vertex::relax_edges(vertex_program &prog, const page_vertex &vertex,
+		uint32_t source, double dist)
+{
+	edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE, 0,
+			vertex.get_num_edges(edge_type::OUT_EDGE));
+	if (weight == UNIT_WEIGHT) {
+		dist_message msg(source, dist + 1);
+		prog.multicast_msg(it, msg);
+		return;
+	}
+
+	safs::page_byte_array::seq_const_iterator<weight_t> data_it
+		= directed ? ((const page_directed_vertex &) vertex).get_data_seq_it<
+		weight_t>(edge_type::OUT_EDGE) : ((const page_undirected_vertex &)
+				vertex).get_data_seq_it<weight_t>();
+	while (it.has_next()) {
+		vertex_id_t dest = it.next();
+		weight_t w = data_it.next();
+		if (w < 0) {
+			has_neg_weight.store(true, std::memory_order_relaxed);
+			continue;
+		}
+		dist_message msg(source, dist + w);
+		prog.send_msg(dest, msg);
+	}
+}
+
+void sssp_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	vertex_id_t id = prog.get_vertex_id(*this);
+	for (size_t i = 0; i < num_sources; i++) {
+		if (!(updated & (1UL << i)))
+			continue;
+		// The distance will be relaxed when its bucket is processed.
+		if (get_bucket(get_dist(id, i)) > curr_bucket)
+			continue;
+		// We read the distance after clearing the bit, so a smaller distance
+		// set by the owner thread in the meantime will be relaxed again.
+		updated.fetch_and(~(1UL << i));
+		double dist = get_dist(id, i);
+
+		relax_edges_func func(*this, prog, vertex, i, dist);
+		dispatch_weight(weight, func);
+	}
+}
+
+/*
+ * The sources are activated in the first level.
+ */
+class source_initializer: public vertex_initializer
+{
+	graph_engine &graph;
+	std::vector<vertex_id_t> sources;
+public:
+	source_initializer(graph_engine &_graph, const vertex_id_t sources[],
+			size_t num): graph(_graph) {
+		this->sources.assign(sources, sources + num);
+	}
+
+	void init(compute_vertex &v) {
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		for (size_t i = 0; i < sources.size(); i++)
+			if (sources[i] == id)
+				((sssp_vertex &) v).add_source(i);
+	}
+};
+
+class bucket_filter: public vertex_filter
+{
+public:
+	bool keep(vertex_program &prog, compute_vertex &v) {
+		return ((sssp_vertex &) v).has_work(prog.get_vertex_id(v));
+	}
+};
+
+/*
+ * Find the first bucket that still has vertices to process.
+ */
+class min_bucket_query: public vertex_query
+{
+	size_t min_bucket;
+public:
+	min_bucket_query() {
+		min_bucket = INVALID_BUCKET;
+	}
+
+	virtual void run(graph_engine &graph, compute_vertex &v) {
+		double dist = ((sssp_vertex &) v).get_min_updated_dist(
+				graph.get_graph_index().get_vertex_id(v));
+		if (dist < INF_DIST)
+			min_bucket = std::min(min_bucket, get_bucket(dist));
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+		min_bucket_query *mbq = (min_bucket_query *) q.get();
+		min_bucket = std::min(min_bucket, mbq->min_bucket);
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new min_bucket_query());
+	}
+
+	size_t get_min_bucket() const {
+		return min_bucket;
+	}
+};
+
+/*
+ * Inside a level, we process the vertices with smaller distances first,
+ * so fewer vertices are relaxed with a distance that isn't final yet.
+ */
+class dist_scheduler: public vertex_scheduler
+{
+public:
+	void schedule(vertex_program &prog,
+			std::vector<compute_vertex_pointer> &vertices) {
+		std::vector<std::pair<double, compute_vertex_pointer> > sorted(
+				vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++) {
+			sssp_vertex &v = (sssp_vertex &) *vertices[i];
+			sorted[i] = std::pair<double, compute_vertex_pointer>(
+					v.get_min_updated_dist(prog.get_vertex_id(vertices[i])),
+					vertices[i]);
+		}
+		std::stable_sort(sorted.begin(), sorted.end(),
+				[](const std::pair<double, compute_vertex_pointer> &p1,
+					const std::pair<double, compute_vertex_pointer> &p2) {
+				return p1.first < p2.first;
+				});
+		for (size_t i = 0; i < vertices.size(); i++)
+			vertices[i] = sorted[i].second;
+	}
+};
+
+/*
+ * In the asynchronous mode, the vertices with smaller distances are
+ * processed first, so SSSP works like a parallel Dijkstra's algorithm
+ * inside a bucket.
+ */
+class dist_priority: public vertex_priority
+{
+public:
+	float get_priority(vertex_program &prog, const compute_vertex &v) const {
+		return ((const sssp_vertex &) v).get_min_updated_dist(
+				prog.get_vertex_id(v));
+	}
+};
+
+}
+
+namespace fg
+{
+
+std::vector<fm::vector::ptr> compute_multi_sssp(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &sources, double delta,
+		const fm::scalar_type *weight_type, bool async)
+{
+	std::vector<fm::vector::ptr> res;
+	if (delta <= 0) {
+		BOOST_LOG_TRIVIAL(error) << "delta has to be positive";
+		return res;
+	}
+	size_t num_vertices = fg->get_num_vertices();
+	for (size_t i = 0; i < sources.size(); i++) {
+		if (sources[i] >= num_vertices) {
+			BOOST_LOG_TRIVIAL(error) << boost::format(
+					"source %1% doesn't exist") % sources[i];
+			return res;
+		}
+	}
+	if (!get_weight_kind(fg, weight_type, ::weight))
+		return res;
+	::delta = delta;
+	has_neg_weight = false;
+	::directed = fg->get_graph_header().is_directed_graph();
+
+	graph_index::ptr index = NUMA_graph_index<sssp_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	graph->set_vertex_scheduler(vertex_scheduler::ptr(new dist_scheduler()));
+	graph->set_async(async, vertex_priority::ptr(new dist_priority()));
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"delta-stepping SSSP starts from %1% sources with delta %2% in the %3% mode")
+		% sources.size() % delta % (async ? "asynchronous" : "synchronous");
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	size_t num_buckets = 0;
+	for (size_t batch_start = 0; batch_start < sources.size();
+			batch_start += MAX_BATCH_SIZE) {
+		num_sources = std::min(MAX_BATCH_SIZE, sources.size() - batch_start);
+		const vertex_id_t *batch = sources.data() + batch_start;
+		size_t num_dists = num_vertices * num_sources;
+		dists = std::unique_ptr<std::atomic<double>[]>(
+				new std::atomic<double>[num_dists]);
+		for (size_t i = 0; i < num_dists; i++)
+			dists[i].store(INF_DIST, std::memory_order_relaxed);
+		for (size_t i = 0; i < num_sources; i++)
+			dists[batch[i] * num_sources + i].store(0,
+					std::memory_order_relaxed);
+
+		curr_bucket = 0;
+		std::vector<vertex_id_t> start_vertices(batch, batch + num_sources);
+		std::sort(start_vertices.begin(), start_vertices.end());
+		start_vertices.erase(std::unique(start_vertices.begin(),
+					start_vertices.end()), start_vertices.end());
+		graph->start(start_vertices.data(), start_vertices.size(),
+				vertex_initializer::ptr(new source_initializer(*graph, batch,
+						num_sources)));
+		graph->wait4complete();
+		num_buckets++;
+
+		// Process the buckets in order. The vertices in a bucket may be
+		// processed multiple times until the bucket becomes empty.
+		while (!has_neg_weight) {
+			vertex_query::ptr mbq(new min_bucket_query());
+			graph->query_on_all(mbq);
+			size_t bucket = ((min_bucket_query *) mbq.get())->get_min_bucket();
+			if (bucket == INVALID_BUCKET)
+				break;
+			curr_bucket = bucket;
+			graph->start(std::shared_ptr<vertex_filter>(new bucket_filter()));
+			graph->wait4complete();
+			num_buckets++;
+		}
+		if (has_neg_weight)
+			break;
+
+		for (size_t i = 0; i < num_sources; i++) {
+			fm::detail::mem_vec_store::ptr res_store
+				= fm::detail::mem_vec_store::create(num_vertices,
+						safs::params.get_num_nodes(),
+						fm::get_scalar_type<double>());
+			for (size_t j = 0; j < num_vertices; j++)
+				res_store->set<double>(j, get_dist(j, i));
+			res.push_back(fm::vector::create(res_store));
+		}
+	}
+	dists.reset();
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"SSSP processes %1% buckets in %2% seconds")
+		% num_buckets % time_diff(start, end);
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	if (has_neg_weight) {
+		BOOST_LOG_TRIVIAL(error) << "SSSP doesn't support negative edge weights";
+		res.clear();
+	}
+	return res;
+}
+
+fm::vector::ptr compute_sssp(FG_graph::ptr fg, vertex_id_t source,
+		double delta, const fm::scalar_type *weight_type, bool async)
+{
+	std::vector<fm::vector::ptr> res = compute_multi_sssp(fg,
+			std::vector<vertex_id_t>(1, source), delta, weight_type, async);
+	if (res.empty())
+		return fm::vector::ptr();
+	else
+		return res[0];
+}
+
+}
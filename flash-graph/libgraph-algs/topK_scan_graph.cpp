@@ -367,7 +367,7 @@ void topK_scan_vertex::run_on_message(vertex_program &prog,
 		data->add_part(msg.get());
 		// We send the local degree of the vertex and the edges
 		// counted in each partition in separately messages.
-		if (data->get_num_parts() == graph_conf.get_num_vparts() + 1) {
+		if (data->get_num_parts() == prog.get_graph().get_num_vparts() + 1) {
 			size_t local_scan = data->get_local_scan();
 			local_value.set_real_local(local_scan);
 			delete data;
@@ -564,7 +564,7 @@ void part_topK_scan_vertex::run_on_itself(vertex_program &prog, const page_verte
 	local_data->neighbors->get_neighbors(neighbors);
 
 	size_t part_size
-		= ceil(((double) neighbors.size()) / graph_conf.get_num_vparts());
+		= ceil(((double) neighbors.size()) / prog.get_graph().get_num_vparts());
 	size_t start_off = std::min(part_size * get_part_id(), neighbors.size());
 	size_t end_off = std::min(part_size * (get_part_id() + 1), neighbors.size());
 	local_data->num_required = end_off - start_off;
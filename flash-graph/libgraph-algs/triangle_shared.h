@@ -21,16 +21,14 @@
 
 #include "graph_engine.h"
 #include "graph_config.h"
-#include "graphlab/cuckoo_set_pow2.hpp"
 #include "FGlib.h"
+#include "set_intersection.h"
 
 /*
  * This contains the data structures shared directed triangle counting
  * and undirected triangle counting.
  */
 
-const double BIN_SEARCH_RATIO = 100;
-const int HASH_SEARCH_RATIO = 16;
 const int hash_threshold = 1000;
 
 static atomic_number<long> num_working_vertices;
@@ -51,49 +49,6 @@ public:
 
 struct runtime_data_t
 {
-	class index_entry
-	{
-		fg::vertex_id_t id;
-		uint32_t idx;
-	public:
-		index_entry() {
-			id = -1;
-			idx = -1;
-		}
-
-		index_entry(fg::vertex_id_t id) {
-			this->id = id;
-			this->idx = -1;
-		}
-
-		index_entry(fg::vertex_id_t id, uint32_t idx) {
-			this->id = id;
-			this->idx = idx;
-		}
-
-		fg::vertex_id_t get_id() const {
-			return id;
-		}
-
-		uint32_t get_idx() const {
-			return idx;
-		}
-
-		bool operator==(const index_entry &e) const {
-			return id == e.get_id();
-		}
-	};
-
-	class index_hash
-	{
-		boost::hash<fg::vertex_id_t> id_hash;
-	public:
-		size_t operator()(const index_entry &e) const {
-			return id_hash(e.get_id());
-		}
-	};
-	typedef graphlab::cuckoo_set_pow2<index_entry, 3, size_t,
-			index_hash> edge_set_t;
 	// It contains part of the edge list.
 	// We only use the neighbors whose ID is smaller than this vertex.
 	std::vector<fg::vertex_id_t> edges;
@@ -106,22 +61,65 @@ struct runtime_data_t
 	size_t num_required;
 	size_t num_triangles;
 
-	edge_set_t edge_set;
+	fg::sorted_id_list edge_list;
+
+	/*
+	 * This is invoked on each neighbor that is shared with another vertex.
+	 */
+	class triangle_counter
+	{
+		runtime_data_t &data;
+		fg::vertex_id_t id1;
+		fg::vertex_id_t id2;
+		size_t num_triangles;
+	public:
+		triangle_counter(runtime_data_t &_data, fg::vertex_id_t id1,
+				fg::vertex_id_t id2): data(_data) {
+			this->id1 = id1;
+			this->id2 = id2;
+			num_triangles = 0;
+		}
+
+		void operator()(uint32_t idx, uint32_t num) {
+			fg::vertex_id_t id = data.edges[idx];
+			// We need to skip loops.
+			if (id != id1 && id != id2) {
+				num_triangles++;
+				data.triangles[idx]++;
+			}
+		}
+
+		size_t get_num_triangles() const {
+			return num_triangles;
+		}
+	};
 public:
-	runtime_data_t(size_t num_edges, size_t num_triangles): edge_set(
-				index_entry(), 0, 2 * num_edges) {
+	runtime_data_t(size_t num_edges, size_t num_triangles) {
+		edges.reserve(num_edges);
 		num_joined = 0;
 		this->num_required = 0;
 		this->num_triangles = num_triangles;
 	}
 
 	void finalize_init() {
-		// We only build a hash table on large vertices
+		edge_list = fg::sorted_id_list(edges.data(), edges.size());
+		// We only build an index on large vertices
 		if (edges.size() > (size_t) hash_threshold)
-			for (size_t i = 0; i < edges.size(); i++)
-				edge_set.insert(index_entry(edges[i], i));
+			edge_list.build_index();
 		triangles.resize(edges.size());
 	}
+
+	/*
+	 * Count the triangles formed by this vertex, the vertex `id1' and
+	 * the common neighbors in the edge list of `id1', which is in [it, end).
+	 * The vertex `id2' is excluded from the common neighbors as well.
+	 */
+	size_t count_triangles(fg::edge_iterator it, fg::edge_iterator end,
+			fg::vertex_id_t id1, fg::vertex_id_t id2) {
+		triangle_counter counter(*this, id1, id2);
+		edge_list.intersect(it, end, counter);
+		return counter.get_num_triangles();
+	}
 };
 
 enum multi_func_flags
@@ -44,8 +44,22 @@ public:
 	vertex_id_t get_id() const {
 		return id;
 	}
+
+	vertex_id_t get_value() const {
+		return id;
+	}
+
+	void set_value(vertex_id_t id) {
+		this->id = id;
+	}
 };
 
+/*
+ * A vertex only needs the smallest component ID sent to it.
+ */
+typedef msg_combiner_impl<component_message, min_msg_op<component_message> >
+	component_combiner;
+
 class wcc_vertex: public compute_directed_vertex
 {
 protected:
@@ -101,6 +115,10 @@ class wcc_vertex_program: public vertex_program_impl<vertex_type>
 public:
 	typedef std::shared_ptr<wcc_vertex_program<vertex_type> > ptr;
 
+	wcc_vertex_program() {
+		this->set_combiner(component_combiner::create());
+	}
+
 	static ptr cast2(vertex_program::ptr prog) {
 		return std::static_pointer_cast<wcc_vertex_program<vertex_type>,
 			   vertex_program>(prog);
@@ -162,6 +180,7 @@ void wcc_vertex::run(vertex_program &prog, const page_vertex &vertex)
 {
 	const size_t BUF_SIZE = 512 * 1024 / sizeof(vertex_id_t) - 1;
 	component_message msg(component_id);
+	msg.set_combinable(true);
 	const page_directed_vertex &dvertex = (const page_directed_vertex &) vertex;
 	assert(dvertex.has_in_part());
 	assert(dvertex.has_out_part());
@@ -231,6 +250,10 @@ class cc_vertex_program: public vertex_program_impl<vertex_type>
 public:
 	typedef std::shared_ptr<cc_vertex_program<vertex_type> > ptr;
 
+	cc_vertex_program() {
+		this->set_combiner(component_combiner::create());
+	}
+
 	static ptr cast2(vertex_program::ptr prog) {
 		return std::static_pointer_cast<cc_vertex_program<vertex_type>,
 			   vertex_program>(prog);
@@ -253,6 +276,7 @@ public:
 void cc_vertex::run(vertex_program &prog, const page_vertex &vertex)
 {
 	component_message msg(component_id);
+	msg.set_combinable(true);
 	empty = (vertex.get_num_edges(BOTH_EDGES) == 0);
 	edge_seq_iterator it = vertex.get_neigh_seq_it(OUT_EDGE);
 	prog.multicast_msg(it, msg);
@@ -316,6 +340,7 @@ void sync_wcc_vertex::run(vertex_program &prog, const page_vertex &vertex)
 {
 	const size_t BUF_SIZE = 512 * 1024 / sizeof(vertex_id_t) - 1;
 	component_message msg(component_id);
+	msg.set_combinable(true);
 	const page_directed_vertex &dvertex = (const page_directed_vertex &) vertex;
 	assert(dvertex.has_in_part());
 	assert(dvertex.has_out_part());
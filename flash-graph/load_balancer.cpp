@@ -27,7 +27,10 @@ namespace fg
 load_balancer::load_balancer(graph_engine &_graph,
 		worker_thread &_owner): owner(_owner), graph(_graph)
 {
-	steal_thread_id = (owner.get_worker_id() + 1) % graph.get_num_threads();
+	num_local_victims = 0;
+	victim_idx = 0;
+	stolen_fetch_idx = 0;
+
 	// TODO can I have a better way to do it?
 	completed_stolen_vertices = (fifo_queue<vertex_id_t> *) malloc(
 			graph.get_num_threads() * sizeof(fifo_queue<vertex_id_t>));
@@ -36,6 +39,7 @@ load_balancer::load_balancer(graph_engine &_graph,
 				_owner.get_node_id(), 4096, true);
 	}
 	num_completed_stolen_vertices = 0;
+	reset_stats();
 }
 
 load_balancer::~load_balancer()
@@ -45,35 +49,72 @@ load_balancer::~load_balancer()
 	free(completed_stolen_vertices);
 }
 
+/*
+ * We prefer to steal vertices from the threads on the same NUMA node.
+ * Each thread starts with a different victim, so thieves don't always
+ * compete for the same victim. This is invoked when the thread steals
+ * vertices for the first time, when all worker threads have been created.
+ */
+void load_balancer::init_victims()
+{
+	int num_threads = graph.get_num_threads();
+	std::vector<int> remote_victims;
+	for (int i = 1; i < num_threads; i++) {
+		int id = (owner.get_worker_id() + i) % num_threads;
+		if (graph.get_thread(id)->get_node_id() == owner.get_node_id())
+			victims.push_back(id);
+		else
+			remote_victims.push_back(id);
+	}
+	num_local_victims = victims.size();
+	victims.insert(victims.end(), remote_victims.begin(), remote_victims.end());
+}
+
+/*
+ * We keep stealing from the same victim until it runs out of vertices.
+ * Then we try the other threads on the same NUMA node before we try
+ * the threads on other NUMA nodes.
+ */
+bool load_balancer::steal_from_victims()
+{
+	assert(stolen_fetch_idx == stolen_buf.size());
+	stolen_buf.clear();
+	stolen_fetch_idx = 0;
+	if (victims.empty())
+		init_victims();
+	for (size_t num_tries = 0; num_tries < victims.size(); num_tries++) {
+		worker_thread *t = graph.get_thread(victims[victim_idx]);
+		size_t num = t->steal_activated_vertices(stolen_buf);
+		if (num > 0) {
+			num_steals++;
+			num_stolen_vertices += num;
+			if (victim_idx >= num_local_victims)
+				num_remote_stolen_vertices += num;
+			return true;
+		}
+		// If we can't steal vertices from the thread, we should move
+		// to the next thread. We start with local victims again after
+		// trying the remote victims.
+		victim_idx = (victim_idx + 1) % victims.size();
+	}
+	return false;
+}
+
 /**
  * This steals vertices from other threads. It tries to steal more vertices
- * than it can process, and the remaining vertices will be placed in its
- * own activated vertex queue.
+ * than it can process, and the remaining vertices will be kept in
+ * the stolen buffer.
  */
 int load_balancer::steal_activated_vertices(compute_vertex_pointer vertex_buf[],
 		int buf_size)
 {
-	if (steal_thread_id == owner.get_worker_id())
-		steal_thread_id = (steal_thread_id + 1) % graph.get_num_threads();
-	int num_tries = 0;
-	int num;
-	do {
-		worker_thread *t = graph.get_thread(steal_thread_id);
-		num_tries++;
-
-		num = t->steal_activated_vertices(vertex_buf, buf_size);
-		// If we can't steal vertices from the thread, we should move
-		// to the next thread.
-		if (num == 0)
-			steal_thread_id = (steal_thread_id + 1) % graph.get_num_threads();
-		// If we have tried to steal vertices from all threads.
-	} while (num == 0 && num_tries < graph.get_num_threads());
-
-	// Record the owner thread of the stolen vertices.
-	for (int i = 0; i < num; i++)
-		stolen_vertex_map.insert(vertex_map_t::value_type(
-					vertex_buf[i].get(), steal_thread_id));
+	if (stolen_fetch_idx == stolen_buf.size() && !steal_from_victims())
+		return 0;
 
+	int num = std::min((size_t) buf_size, stolen_buf.size() - stolen_fetch_idx);
+	memcpy(vertex_buf, stolen_buf.data() + stolen_fetch_idx,
+			num * sizeof(vertex_buf[0]));
+	stolen_fetch_idx += num;
 	return num;
 }
 
@@ -93,6 +134,7 @@ void load_balancer::process_completed_stolen_vertices()
 			BOOST_VERIFY(q.fetch(buf.data(), num_completed)
 					== num_completed);
 			t->return_vertices(buf.data(), num_completed);
+			num_returned_vertices += num_completed;
 		}
 	}
 	assert(num_tot == num_completed_stolen_vertices);
@@ -103,13 +145,12 @@ void load_balancer::return_vertices(const compute_vertex_pointer vs[], int num)
 {
 	for (int i = 0; i < num; i++) {
 		compute_vertex_pointer v = vs[i];
-		vertex_map_t::iterator it = stolen_vertex_map.find(v.get());
-		assert(it != stolen_vertex_map.end());
-		int part_id = it->second;
 		// We don't need to return verticalled partitioned vertices to their
 		// owner because messages are processed in the main vertices and the
 		// main vertices cannot be stolen by other threads.
 		if (!v.is_part()) {
+			int part_id = graph.get_graph_index().get_part_id(*v);
+			assert(part_id >= 0 && part_id != owner.get_worker_id());
 			if (completed_stolen_vertices[part_id].is_full()) {
 				completed_stolen_vertices[part_id].expand_queue(
 						completed_stolen_vertices[part_id].get_size() * 2);
@@ -121,7 +162,6 @@ void load_balancer::return_vertices(const compute_vertex_pointer vs[], int num)
 			completed_stolen_vertices[part_id].push_back(id);
 			num_completed_stolen_vertices++;
 		}
-		stolen_vertex_map.erase(it);
 	}
 }
 
@@ -130,15 +170,19 @@ void load_balancer::reset()
 	for (int i = 0; i < graph.get_num_threads(); i++)
 		assert(completed_stolen_vertices[i].is_empty());
 	assert(num_completed_stolen_vertices == 0);
+	assert(stolen_fetch_idx == stolen_buf.size());
+	// Start with the local victims in a new level.
+	if (victim_idx >= num_local_victims)
+		victim_idx = 0;
 }
 
 int load_balancer::get_stolen_vertex_part(const compute_vertex &v) const
 {
-	vertex_map_t::const_iterator it = stolen_vertex_map.find(&v);
-	if (it != stolen_vertex_map.end())
-		return it->second;
-	else
+	int part_id = graph.get_graph_index().get_part_id(v);
+	if (part_id == owner.get_worker_id())
 		return -1;
+	else
+		return part_id;
 }
 
 }
@@ -20,10 +20,11 @@
  * limitations under the License.
  */
 
-#include <unordered_map>
+#include <vector>
 
 #include "container.h"
 #include "vertex.h"
+#include "vertex_pointer.h"
 
 namespace fg
 {
@@ -31,30 +32,46 @@ namespace fg
 class worker_thread;
 class graph_engine;
 class compute_vertex;
-class compute_vertex_pointer;
 
 /*
  * This class is to help balance the load.
  * If the owner thread has finished the work originally assigned to it,
  * it can steal work from other threads through this class.
+ * The owner thread of a stolen vertex is found from the address of
+ * the vertex, so we don't need to record the stolen vertices.
  */
 class load_balancer
 {
-	typedef std::unordered_map<const compute_vertex *, int> vertex_map_t;
-
 	worker_thread &owner;
 	graph_engine &graph;
 
-	// This map records the owner threads of vertices stolen from another
-	// partition.
-	vertex_map_t stolen_vertex_map;
+	// The threads where we steal activated vertices from. The threads
+	// on the same NUMA node are placed before the ones on other nodes.
+	std::vector<int> victims;
+	// The number of victims on the same NUMA node.
+	size_t num_local_victims;
+	// The victim where we should steal activated vertices from.
+	size_t victim_idx;
+
+	// This buffer contains the vertices stolen from other threads, which
+	// haven't been processed. A thief always steals a whole range of
+	// vertices, which may be more than it can process at once.
+	std::vector<compute_vertex_pointer> stolen_buf;
+	size_t stolen_fetch_idx;
 
 	// This is a local buffer that contains the completed stolen vertices.
 	// All vertices here need to be returned to their owner threads.
 	fifo_queue<vertex_id_t> *completed_stolen_vertices;
 	int num_completed_stolen_vertices;
-	// The thread where we should steal activated vertices from.
-	int steal_thread_id;
+
+	// The statistics of load balancing in the current level.
+	size_t num_steals;
+	size_t num_stolen_vertices;
+	size_t num_remote_stolen_vertices;
+	size_t num_returned_vertices;
+
+	void init_victims();
+	bool steal_from_victims();
 public:
 	load_balancer(graph_engine &_graph, worker_thread &_owner);
 
@@ -74,6 +91,26 @@ public:
 	void process_completed_stolen_vertices();
 
 	void reset();
+
+	/*
+	 * Get the number of successful steals, the number of vertices stolen
+	 * from other threads (and from the threads on other NUMA nodes) and
+	 * the number of vertices returned to their owner threads.
+	 */
+	void get_stats(size_t &num_steals, size_t &num_stolen,
+			size_t &num_remote_stolen, size_t &num_returned) const {
+		num_steals = this->num_steals;
+		num_stolen = this->num_stolen_vertices;
+		num_remote_stolen = this->num_remote_stolen_vertices;
+		num_returned = this->num_returned_vertices;
+	}
+
+	void reset_stats() {
+		num_steals = 0;
+		num_stolen_vertices = 0;
+		num_remote_stolen_vertices = 0;
+		num_returned_vertices = 0;
+	}
 };
 
 }
@@ -92,4 +92,44 @@ int multicast_msg_sender::add_dests(local_vid_t ids[], int num)
 	return orig_num;
 }
 
+int combining_msg_sender::flush()
+{
+	if (num_msgs == 0)
+		return 0;
+	for (size_t i = 0; i < num_msgs; i++) {
+		vertex_message *msg = (vertex_message *) &buf[i * msg_size];
+		sender->send_cached(*msg);
+	}
+	num_msgs = 0;
+	locs.clear();
+	return 1;
+}
+
+void combining_msg_sender::send(const vertex_message &msg)
+{
+	if (!msg.is_combinable()) {
+		sender->send_cached(msg);
+		return;
+	}
+	assert(msg.get_serialized_size() == (int) msg_size);
+	num_sent++;
+	std::unordered_map<vertex_id_t, size_t>::const_iterator it
+		= locs.find(msg.get_dest().id);
+	if (it != locs.end()) {
+		vertex_message *combined = (vertex_message *) &buf[it->second];
+		combiner->combine(*combined, msg);
+		if (msg.is_activate())
+			combined->set_activate(true);
+		num_combined++;
+		return;
+	}
+
+	if (num_msgs == MAX_NUM_MSGS)
+		flush();
+	size_t loc = num_msgs * msg_size;
+	msg.serialize(&buf[loc], msg_size);
+	locs.insert(std::pair<vertex_id_t, size_t>(msg.get_dest().id, loc));
+	num_msgs++;
+}
+
 }
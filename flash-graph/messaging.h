@@ -20,6 +20,9 @@
  * limitations under the License.
  */
 
+#include <atomic>
+#include <unordered_map>
+
 #include "slab_allocator.h"
 
 #include "vertex.h"
@@ -182,10 +185,38 @@ public:
 
 class msg_queue: public thread_safe_FIFO_queue<message>
 {
+	// The number of messages added to and fetched from the queue.
+	// They are used to detect termination in the asynchronous mode.
+	std::atomic<size_t> num_added;
+	std::atomic<size_t> num_fetched;
 public:
 	msg_queue(int node_id, const std::string _name, int init_size,
 			int max_size): thread_safe_FIFO_queue<message>(_name,
 				node_id, init_size, max_size) {
+		num_added = 0;
+		num_fetched = 0;
+	}
+
+	using thread_safe_FIFO_queue<message>::add;
+
+	virtual int add(message *entries, int num) {
+		int ret = thread_safe_FIFO_queue<message>::add(entries, num);
+		num_added += ret;
+		return ret;
+	}
+
+	virtual int fetch(message *entries, int num) {
+		int ret = thread_safe_FIFO_queue<message>::fetch(entries, num);
+		num_fetched += ret;
+		return ret;
+	}
+
+	size_t get_num_added() const {
+		return num_added.load();
+	}
+
+	size_t get_num_fetched() const {
+		return num_fetched.load();
 	}
 
 	static msg_queue *create(int node_id, const std::string name,
@@ -299,7 +330,10 @@ protected:
 	// This is a flag to indicate that it's a system's activation message.
 	unsigned activation_msg: 1;
 	unsigned flush: 1;
-	unsigned size: 28;
+	// This is a flag to indicate that the sender allows the message to be
+	// merged with others by the message combiner.
+	unsigned combinable: 1;
+	unsigned size: 27;
 	union {
 		vertex_id_t dest;
 		int num_dests;
@@ -316,6 +350,7 @@ public:
 		this->multicast = 0;
 		this->activation_msg = 0;
 		this->flush = 0;
+		this->combinable = 0;
 		this->u.dest = -1;
 		this->size = size;
 		assert(size % 4 == 0);
@@ -333,6 +368,10 @@ public:
 		return activate;
 	}
 
+	void set_activate(bool activate) {
+		this->activate = activate;
+	}
+
 	bool is_multicast() const {
 		return multicast;
 	}
@@ -345,6 +384,18 @@ public:
 		this->flush = flush;
 	}
 
+	bool is_combinable() const {
+		return combinable;
+	}
+
+	/*
+	 * A sender marks a message combinable if it's of the type of the
+	 * messages of the registered combiner.
+	 */
+	void set_combinable(bool combinable) {
+		this->combinable = combinable;
+	}
+
 	local_vid_t get_dest() const {
 		return local_vid_t(u.dest);
 	}
@@ -549,6 +600,14 @@ public:
 
 	bool add_dest(local_vid_t id);
 
+	/*
+	 * Test if the sender only has the initialized multicast message
+	 * without destinations.
+	 */
+	bool has_empty_multicast() const {
+		return mmsg != NULL && num_dests == 0 && buf.get_num_objs() == 1;
+	}
+
 	void end_multicast() {
 		if (num_dests == 0) {
 			multicast_message *mmsg_template
@@ -561,6 +620,154 @@ public:
 	}
 };
 
+
+/**
+ * A message combiner merges the messages sent to the same vertex before
+ * they leave the sender thread, so the destination vertex receives one
+ * message instead of many. The operation has to be commutative and
+ * associative because messages are combined in an arbitrary order.
+ * All messages combined by a combiner have to be of the same type, and
+ * only the messages that their senders mark combinable are combined.
+ */
+class msg_combiner
+{
+public:
+	typedef std::shared_ptr<msg_combiner> ptr;
+
+	virtual ~msg_combiner() {
+	}
+
+	/**
+	 * The size of the messages that can be combined.
+	 */
+	virtual int get_msg_size() const = 0;
+	/**
+	 * Merge `msg' into `combined'. Both are sent to the same vertex.
+	 */
+	virtual void combine(vertex_message &combined,
+			const vertex_message &msg) const = 0;
+};
+
+/*
+ * The predefined combine operations. A message type needs to provide
+ * `get_value()' and `set_value()' to use them.
+ */
+
+template<class MsgType>
+struct sum_msg_op
+{
+	void operator()(MsgType &combined, const MsgType &msg) const {
+		combined.set_value(combined.get_value() + msg.get_value());
+	}
+};
+
+template<class MsgType>
+struct min_msg_op
+{
+	void operator()(MsgType &combined, const MsgType &msg) const {
+		if (msg.get_value() < combined.get_value())
+			combined.set_value(msg.get_value());
+	}
+};
+
+template<class MsgType>
+struct max_msg_op
+{
+	void operator()(MsgType &combined, const MsgType &msg) const {
+		if (msg.get_value() > combined.get_value())
+			combined.set_value(msg.get_value());
+	}
+};
+
+/**
+ * This combiner applies a combine operation to messages of `MsgType'.
+ * The operation can be one of the predefined ones or any functor that
+ * takes `(MsgType &combined, const MsgType &msg)'.
+ */
+template<class MsgType, class OpType>
+class msg_combiner_impl: public msg_combiner
+{
+	OpType op;
+
+	msg_combiner_impl(const OpType &op): op(op) {
+	}
+public:
+	static msg_combiner::ptr create(const OpType &op = OpType()) {
+		return msg_combiner::ptr(new msg_combiner_impl<MsgType, OpType>(op));
+	}
+
+	virtual int get_msg_size() const {
+		return sizeof(MsgType);
+	}
+
+	virtual void combine(vertex_message &combined,
+			const vertex_message &msg) const {
+		op((MsgType &) combined, (const MsgType &) msg);
+	}
+};
+
+/**
+ * This sender buffers the messages to the vertices in a partition and
+ * combines the messages to the same vertex. The combined messages are
+ * passed to a simple_msg_sender when the buffer is full or flushed.
+ */
+class combining_msg_sender
+{
+	const static size_t MAX_NUM_MSGS = 4096;
+	simple_msg_sender *sender;
+	msg_combiner::ptr combiner;
+	size_t msg_size;
+	// The location of the message to a vertex in the buffer.
+	std::unordered_map<vertex_id_t, size_t> locs;
+	std::vector<char> buf;
+	size_t num_msgs;
+	// The number of messages sent to the sender and the number of them
+	// that are combined with other messages.
+	size_t num_sent;
+	size_t num_combined;
+
+	combining_msg_sender(simple_msg_sender *sender, msg_combiner::ptr combiner) {
+		this->sender = sender;
+		this->combiner = combiner;
+		this->msg_size = combiner->get_msg_size();
+		this->num_msgs = 0;
+		this->num_sent = 0;
+		this->num_combined = 0;
+		buf.resize(msg_size * MAX_NUM_MSGS);
+		locs.reserve(MAX_NUM_MSGS);
+	}
+public:
+	static combining_msg_sender *create(simple_msg_sender *sender,
+			msg_combiner::ptr combiner) {
+		return new combining_msg_sender(sender, combiner);
+	}
+
+	static void destroy(combining_msg_sender *s) {
+		delete s;
+	}
+
+	int flush();
+
+	/**
+	 * The destination of the message has been set. A message that isn't
+	 * marked combinable is passed to the simple sender directly.
+	 */
+	void send(const vertex_message &msg);
+
+	size_t get_num_sent() const {
+		return num_sent;
+	}
+
+	size_t get_num_combined() const {
+		return num_combined;
+	}
+
+	void reset_stats() {
+		num_sent = 0;
+		num_combined = 0;
+	}
+};
+
 }
 
 #endif
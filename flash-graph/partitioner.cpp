@@ -154,4 +154,72 @@ size_t range_graph_partitioner::map2loc(edge_seq_iterator &it,
 	return ret;
 }
 
+
+void edge_balanced_graph_partitioner::init(int num_nodes)
+{
+	int num_parts = range_starts.size() - 1;
+	// Partition i is processed by a thread on NUMA node i % num_nodes.
+	// We give each node a contiguous block of ranges.
+	if (num_nodes <= 0 || num_parts % num_nodes != 0)
+		num_nodes = 1;
+	int num_parts_per_node = num_parts / num_nodes;
+	range_parts.resize(num_parts);
+	part_starts.resize(num_parts);
+	part_ends.resize(num_parts);
+	for (int range_id = 0; range_id < num_parts; range_id++) {
+		int node_id = range_id / num_parts_per_node;
+		int part_id = (range_id % num_parts_per_node) * num_nodes + node_id;
+		range_parts[range_id] = part_id;
+		part_starts[part_id] = range_starts[range_id];
+		part_ends[part_id] = range_starts[range_id + 1];
+	}
+}
+
+size_t edge_balanced_graph_partitioner::get_all_vertices_in_part(int part_id,
+			size_t tot_num_vertices, std::vector<vertex_id_t> &ids) const
+{
+	assert(tot_num_vertices == num_vertices);
+	for (vertex_id_t id = part_starts[part_id]; id < part_ends[part_id]; id++)
+		ids.push_back(id);
+	return ids.size();
+}
+
+void edge_balanced_graph_partitioner::map2loc(vertex_id_t ids[], int num,
+		std::vector<local_vid_t> locs[], int num_parts) const
+{
+	assert(num_parts <= get_num_partitions());
+	for (int i = 0; i < num; i++) {
+		int range_id = get_range_id(ids[i]);
+		locs[range_parts[range_id]].push_back(local_vid_t(
+					ids[i] - range_starts[range_id]));
+	}
+}
+
+void edge_balanced_graph_partitioner::map2loc(edge_seq_iterator &it,
+		std::vector<local_vid_t> locs[], int num_parts) const
+{
+	assert(num_parts <= get_num_partitions());
+	PAGE_FOREACH(vertex_id_t, id, it) {
+		int range_id = get_range_id(id);
+		locs[range_parts[range_id]].push_back(local_vid_t(
+					id - range_starts[range_id]));
+	} PAGE_FOREACH_END
+}
+
+size_t edge_balanced_graph_partitioner::map2loc(edge_seq_iterator &it,
+		vertex_loc_t locs[], size_t num) const
+{
+	size_t ret = 0;
+	PAGE_FOREACH(vertex_id_t, id, it) {
+		if ((size_t) page_foreach_idx == num)
+			break;
+		int range_id = get_range_id(id);
+		vertex_loc_t loc(range_parts[range_id],
+				local_vid_t(id - range_starts[range_id]));
+		locs[page_foreach_idx] = loc;
+		ret++;
+	} PAGE_FOREACH_END
+	return ret;
+}
+
 }
@@ -23,6 +23,9 @@
 #include <math.h>
 
 #include <utility>
+#include <vector>
+#include <memory>
+#include <algorithm>
 
 #include "vertex.h"
 
@@ -56,6 +59,11 @@ typedef std::pair<int, struct local_vid_t> vertex_loc_t;
 class graph_partitioner
 {
 public:
+	typedef std::shared_ptr<graph_partitioner> ptr;
+
+	virtual ~graph_partitioner() {
+	}
+
 	virtual int get_num_partitions() const = 0;
 	virtual int map(vertex_id_t id) const = 0;
 	virtual void map2loc(vertex_id_t id, int &part_id, off_t &off) const = 0;
@@ -176,6 +184,114 @@ public:
 	}
 };
 
+/*
+ * This partitioner splits the vertex ID space into contiguous ranges that
+ * have about the same number of edges plus vertices, so worker threads
+ * get a balanced amount of work even if the degree distribution is skewed.
+ * The edge lists of the vertices in a range are adjacent in the graph file,
+ * so a thread reads a contiguous region of the file.
+ * The ranges are assigned to the partitions in the order of NUMA nodes,
+ * so all threads on a NUMA node access one contiguous region of the graph.
+ */
+class edge_balanced_graph_partitioner: public graph_partitioner
+{
+	// The start of a range is aligned to this number of vertices, so that
+	// the bits of different partitions aren't in the same word of a bitmap.
+	static const size_t RANGE_ALIGN = 64;
+
+	size_t num_vertices;
+	// The start of the ranges in the order of vertex IDs. It has one more
+	// element than the number of partitions.
+	std::vector<vertex_id_t> range_starts;
+	// The partition that each range belongs to.
+	std::vector<int> range_parts;
+	std::vector<vertex_id_t> part_starts;
+	std::vector<vertex_id_t> part_ends;
+
+	int get_range_id(vertex_id_t id) const {
+		assert(id < num_vertices);
+		return std::upper_bound(range_starts.begin() + 1, range_starts.end(),
+				id) - range_starts.begin() - 1;
+	}
+
+	void init(int num_nodes);
+public:
+	/*
+	 * `get_degree' returns the number of edges of a vertex. The weight of
+	 * a vertex is its degree plus one.
+	 */
+	template<class DegreeFunc>
+	edge_balanced_graph_partitioner(int num_parts, int num_nodes,
+			size_t num_vertices, DegreeFunc get_degree): range_starts(
+				num_parts + 1) {
+		this->num_vertices = num_vertices;
+		size_t tot_weight = 0;
+		for (vertex_id_t id = 0; id < num_vertices; id++)
+			tot_weight += get_degree(id) + 1;
+
+		// A range ends once it gets its share of the weights that haven't
+		// been assigned. A range may get more than its share because of
+		// a large vertex or alignment, and the remaining ranges share
+		// the rest evenly.
+		range_starts[0] = 0;
+		int range_id = 1;
+		size_t weight = 0;
+		size_t range_end_weight = tot_weight / num_parts;
+		vertex_id_t id = 0;
+		while (id < num_vertices && range_id < num_parts) {
+			weight += get_degree(id) + 1;
+			id++;
+			if (weight < range_end_weight)
+				continue;
+
+			vertex_id_t end = std::min((size_t) ROUNDUP(id, RANGE_ALIGN),
+					num_vertices);
+			for (; id < end; id++)
+				weight += get_degree(id) + 1;
+			range_starts[range_id++] = end;
+			if (range_id < num_parts)
+				range_end_weight = weight
+					+ (tot_weight - weight) / (num_parts - range_id + 1);
+		}
+		while (range_id <= num_parts)
+			range_starts[range_id++] = num_vertices;
+		init(num_nodes);
+	}
+
+	int get_num_partitions() const {
+		return part_starts.size();
+	}
+
+	virtual int map(vertex_id_t id) const {
+		return range_parts[get_range_id(id)];
+	}
+
+	virtual void map2loc(vertex_id_t id, int &part_id, off_t &off) const {
+		int range_id = get_range_id(id);
+		part_id = range_parts[range_id];
+		off = id - range_starts[range_id];
+	}
+
+	virtual void map2loc(vertex_id_t ids[], int num,
+			std::vector<local_vid_t> locs[], int num_parts) const;
+	virtual void map2loc(edge_seq_iterator &, std::vector<local_vid_t> locs[],
+			int num_parts) const;
+	virtual size_t map2loc(edge_seq_iterator &,
+			vertex_loc_t locs[], size_t num) const;
+
+	virtual void loc2map(int part_id, off_t off, vertex_id_t &id) const {
+		id = part_starts[part_id] + off;
+	}
+
+	virtual size_t get_all_vertices_in_part(int part_id,
+			size_t tot_num_vertices, std::vector<vertex_id_t> &ids) const;
+
+	virtual size_t get_part_size(int part_id, size_t num_vertices) const {
+		assert(num_vertices == this->num_vertices);
+		return part_ends[part_id] - part_starts[part_id];
+	}
+};
+
 }
 
 #endif
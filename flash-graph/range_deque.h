@@ -0,0 +1,165 @@
+#ifndef __RANGE_DEQUE_H__
+#define __RANGE_DEQUE_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <assert.h>
+
+#include <atomic>
+#include <vector>
+
+namespace fg
+{
+
+/*
+ * A range of active vertices in a partition. What the range refers to
+ * is decided by the owner of the deque.
+ */
+struct vertex_range
+{
+	uint32_t start;
+	uint32_t end;
+
+	vertex_range() {
+		start = 0;
+		end = 0;
+	}
+
+	vertex_range(uint32_t start, uint32_t end) {
+		this->start = start;
+		this->end = end;
+	}
+
+	size_t get_size() const {
+		return end - start;
+	}
+};
+
+/*
+ * This is a Chase-Lev work-stealing deque of vertex ranges.
+ * Only the owner thread pushes and pops ranges at the bottom, and
+ * other threads steal ranges from the top without locking.
+ * A range is packed in a 64-bit integer, so it can be read atomically.
+ * The capacity of the deque is fixed when it's created, so thieves never
+ * read the array of ranges while it's being reallocated.
+ */
+class vertex_range_deque
+{
+	std::atomic<int64_t> top;
+	std::atomic<int64_t> bottom;
+	std::vector<std::atomic<uint64_t> > ranges;
+	int64_t mask;
+
+	static uint64_t pack(vertex_range range) {
+		return (((uint64_t) range.start) << 32) | range.end;
+	}
+
+	static vertex_range unpack(uint64_t val) {
+		return vertex_range(val >> 32, val & 0xffffffffUL);
+	}
+
+	static size_t get_array_size(size_t capacity) {
+		size_t size = 1;
+		while (size < capacity)
+			size *= 2;
+		return size;
+	}
+public:
+	enum steal_result {
+		STEAL_SUCCESS,
+		STEAL_EMPTY,
+		// Another thread took the range first. It's worth trying again.
+		STEAL_ABORT,
+	};
+
+	vertex_range_deque(size_t capacity): ranges(get_array_size(capacity)) {
+		top = 0;
+		bottom = 0;
+		mask = ranges.size() - 1;
+	}
+
+	size_t get_capacity() const {
+		return ranges.size();
+	}
+
+	bool is_empty() const {
+		return bottom.load() <= top.load();
+	}
+
+	size_t get_num_ranges() const {
+		int64_t num = bottom.load() - top.load();
+		return num > 0 ? num : 0;
+	}
+
+	/*
+	 * The methods below can only be called by the owner thread.
+	 */
+
+	void push(vertex_range range) {
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		assert(b - t <= mask);
+		ranges[b & mask].store(pack(range), std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	bool pop(vertex_range &range) {
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+		if (t > b) {
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+		range = unpack(ranges[b & mask].load(std::memory_order_relaxed));
+		if (t == b) {
+			// This is the last range. We race with thieves for it.
+			bool success = top.compare_exchange_strong(t, t + 1,
+					std::memory_order_seq_cst, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return success;
+		}
+		return true;
+	}
+
+	/*
+	 * This is called by other threads.
+	 */
+	steal_result steal(vertex_range &range) {
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return STEAL_EMPTY;
+		uint64_t val = ranges[t & mask].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+					std::memory_order_relaxed))
+			return STEAL_ABORT;
+		range = unpack(val);
+		return STEAL_SUCCESS;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,278 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <immintrin.h>
+
+#include "set_intersection.h"
+
+namespace fg
+{
+
+/*
+ * Add a match to the output arrays. The same element in `a' may match
+ * the elements in `b' multiple times, and its matches are added together.
+ */
+static inline void add_match(uint32_t idx, uint32_t count, uint32_t a_idxs[],
+		uint32_t counts[], size_t &num)
+{
+	if (num > 0 && a_idxs[num - 1] == idx)
+		counts[num - 1] += count;
+	else {
+		a_idxs[num] = idx;
+		counts[num] = count;
+		num++;
+	}
+}
+
+static size_t merge(const vertex_id_t a[], size_t i, size_t na,
+		const vertex_id_t b[], size_t j, size_t nb, uint32_t a_idxs[],
+		uint32_t counts[], size_t num)
+{
+	while (i < na && j < nb) {
+		if (a[i] < b[j])
+			i++;
+		else if (a[i] > b[j])
+			j++;
+		else {
+			// We only move forward in `b' because the next element in `b'
+			// may be the same.
+			add_match(i, 1, a_idxs, counts, num);
+			j++;
+		}
+	}
+	return num;
+}
+
+size_t intersect_merge(const vertex_id_t a[], size_t na, const vertex_id_t b[],
+		size_t nb, uint32_t a_idxs[], uint32_t counts[])
+{
+	return merge(a, 0, na, b, 0, nb, a_idxs, counts, 0);
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+#ifdef __AVX2__
+static const size_t BLOCK_SIZE = 8;
+#else
+static const size_t BLOCK_SIZE = 4;
+#endif
+
+size_t intersect_block(const vertex_id_t a[], size_t na, const vertex_id_t b[],
+		size_t nb, uint32_t a_idxs[], uint32_t counts[])
+{
+	size_t i = 0, j = 0, num = 0;
+	while (i + BLOCK_SIZE <= na && j + BLOCK_SIZE <= nb) {
+		// We compare every element in the block of `a' with every element
+		// in the block of `b' by rotating the block of `b'. Each lane of
+		// `c' gets the negative number of matches of an element in `a'.
+		int32_t cnts[BLOCK_SIZE];
+#ifdef __AVX2__
+		__m256i va = _mm256_loadu_si256((const __m256i *) (a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i *) (b + j));
+		const __m256i rot = _mm256_set_epi32(0, 7, 6, 5, 4, 3, 2, 1);
+		__m256i c = _mm256_cmpeq_epi32(va, vb);
+		for (size_t k = 1; k < BLOCK_SIZE; k++) {
+			vb = _mm256_permutevar8x32_epi32(vb, rot);
+			c = _mm256_add_epi32(c, _mm256_cmpeq_epi32(va, vb));
+		}
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(c));
+		if (mask)
+			_mm256_storeu_si256((__m256i *) cnts, c);
+#else
+		__m128i va = _mm_loadu_si128((const __m128i *) (a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i *) (b + j));
+		__m128i c = _mm_cmpeq_epi32(va, vb);
+		c = _mm_add_epi32(c, _mm_cmpeq_epi32(va,
+					_mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+		c = _mm_add_epi32(c, _mm_cmpeq_epi32(va,
+					_mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+		c = _mm_add_epi32(c, _mm_cmpeq_epi32(va,
+					_mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(c));
+		if (mask)
+			_mm_storeu_si128((__m128i *) cnts, c);
+#endif
+		while (mask) {
+			int k = __builtin_ctz(mask);
+			add_match(i + k, -cnts[k], a_idxs, counts, num);
+			mask &= mask - 1;
+		}
+		// If the last elements of the two blocks are the same, we move
+		// forward in `b' because the next block of `b' may have
+		// the same element.
+		if (a[i + BLOCK_SIZE - 1] < b[j + BLOCK_SIZE - 1])
+			i += BLOCK_SIZE;
+		else
+			j += BLOCK_SIZE;
+	}
+	return merge(a, i, na, b, j, nb, a_idxs, counts, num);
+}
+
+#else
+
+size_t intersect_block(const vertex_id_t a[], size_t na, const vertex_id_t b[],
+		size_t nb, uint32_t a_idxs[], uint32_t counts[])
+{
+	return intersect_merge(a, na, b, nb, a_idxs, counts);
+}
+
+#endif
+
+/*
+ * Find the first element in `arr' in [start, end) that isn't smaller than
+ * `val'. We search with exponentially growing steps before the binary
+ * search, so it's fast if the element is close to `start'.
+ */
+static inline size_t gallop(const vertex_id_t arr[], size_t start, size_t end,
+		vertex_id_t val)
+{
+	size_t step = 1;
+	while (start + step < end && arr[start + step - 1] < val)
+		step *= 2;
+	return std::lower_bound(arr + start + step / 2,
+			arr + std::min(start + step, end), val) - arr;
+}
+
+size_t intersect_gallop(const vertex_id_t a[], size_t na, const vertex_id_t b[],
+		size_t nb, uint32_t a_idxs[], uint32_t counts[])
+{
+	size_t num = 0;
+	if (na <= nb) {
+		size_t j = 0;
+		for (size_t i = 0; i < na && j < nb; i++) {
+			j = gallop(b, j, nb, a[i]);
+			size_t start = j;
+			while (j < nb && b[j] == a[i])
+				j++;
+			if (j > start)
+				add_match(i, j - start, a_idxs, counts, num);
+		}
+	}
+	else {
+		size_t i = 0;
+		for (size_t j = 0; j < nb && i < na;) {
+			vertex_id_t val = b[j];
+			i = gallop(a, i, na, val);
+			size_t start = j;
+			while (j < nb && b[j] == val)
+				j++;
+			if (i < na && a[i] == val)
+				add_match(i, j - start, a_idxs, counts, num);
+		}
+	}
+	return num;
+}
+
+size_t intersect_sorted(const vertex_id_t a[], size_t na, const vertex_id_t b[],
+		size_t nb, uint32_t a_idxs[], uint32_t counts[])
+{
+	if (na == 0 || nb == 0)
+		return 0;
+	else if (na > nb * GALLOP_SIZE_RATIO || nb > na * GALLOP_SIZE_RATIO)
+		return intersect_gallop(a, na, b, nb, a_idxs, counts);
+	else
+		return intersect_block(a, na, b, nb, a_idxs, counts);
+}
+
+static inline uint32_t hash_id(vertex_id_t id, int shift)
+{
+	return ((uint32_t) (id * 2654435761U)) >> shift;
+}
+
+void sorted_id_list::build_index()
+{
+	id_bits.clear();
+	id_ranks.clear();
+	id_table.clear();
+	if (num == 0)
+		return;
+
+	min_id = ids[0];
+	size_t range = ids[num - 1] - min_id + 1;
+	size_t num_words = ROUNDUP(range, 64) / 64;
+	// A bitmap is more compact than a hash table if the IDs are dense.
+	if (num_words <= num) {
+		id_bits.resize(num_words);
+		id_ranks.resize(num_words);
+		for (size_t i = 0; i < num; i++) {
+			size_t off = ids[i] - min_id;
+			id_bits[off / 64] |= 1UL << (off % 64);
+		}
+		uint32_t rank = 0;
+		for (size_t i = 0; i < num_words; i++) {
+			id_ranks[i] = rank;
+			rank += __builtin_popcountl(id_bits[i]);
+		}
+	}
+	else {
+		int table_log = 1;
+		while ((1UL << table_log) < num * 2)
+			table_log++;
+		assert(table_log < 32);
+		table_shift = 32 - table_log;
+		size_t mask = (1UL << table_log) - 1;
+		id_table.resize(mask + 1, std::pair<vertex_id_t, uint32_t>(
+					INVALID_VERTEX_ID, 0));
+		for (size_t i = 0; i < num; i++) {
+			size_t loc = hash_id(ids[i], table_shift);
+			while (id_table[loc].first != INVALID_VERTEX_ID)
+				loc = (loc + 1) & mask;
+			id_table[loc] = std::pair<vertex_id_t, uint32_t>(ids[i], i);
+		}
+	}
+}
+
+bool sorted_id_list::find(vertex_id_t id, uint32_t &idx) const
+{
+	if (!id_bits.empty()) {
+		if (id < min_id)
+			return false;
+		size_t off = id - min_id;
+		size_t word_idx = off / 64;
+		if (word_idx >= id_bits.size())
+			return false;
+		uint64_t word = id_bits[word_idx];
+		uint64_t bit = 1UL << (off % 64);
+		if (!(word & bit))
+			return false;
+		idx = id_ranks[word_idx] + __builtin_popcountl(word & (bit - 1));
+		return true;
+	}
+	else if (!id_table.empty()) {
+		size_t mask = id_table.size() - 1;
+		for (size_t loc = hash_id(id, table_shift);
+				id_table[loc].first != INVALID_VERTEX_ID;
+				loc = (loc + 1) & mask) {
+			if (id_table[loc].first == id) {
+				idx = id_table[loc].second;
+				return true;
+			}
+		}
+		return false;
+	}
+	else {
+		const vertex_id_t *loc = std::lower_bound(ids, ids + num, id);
+		if (loc == ids + num || *loc != id)
+			return false;
+		idx = loc - ids;
+		return true;
+	}
+}
+
+}
@@ -0,0 +1,319 @@
+#ifndef __SET_INTERSECTION_H__
+#define __SET_INTERSECTION_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "vertex.h"
+
+namespace fg
+{
+
+/*
+ * These functions intersect two sorted lists of vertex IDs stored
+ * contiguously in memory. The list `a' can't have duplicates, but the list
+ * `b' may. They output the locations of the common elements in `a' in
+ * ascending order and the number of times each of them appears in `b'.
+ * The output arrays need to have space for min(na, nb) elements.
+ * They return the number of common elements in `a'.
+ */
+
+/*
+ * Merge the two lists one element at a time.
+ */
+size_t intersect_merge(const vertex_id_t a[], size_t na, const vertex_id_t b[],
+		size_t nb, uint32_t a_idxs[], uint32_t counts[]);
+/*
+ * Merge the two lists a block at a time. All elements in a block of `a' are
+ * compared with all elements in a block of `b' with SIMD instructions.
+ */
+size_t intersect_block(const vertex_id_t a[], size_t na, const vertex_id_t b[],
+		size_t nb, uint32_t a_idxs[], uint32_t counts[]);
+/*
+ * Search for each element of the shorter list in the longer list
+ * with galloping. It works well when the sizes of the lists are skewed.
+ */
+size_t intersect_gallop(const vertex_id_t a[], size_t na, const vertex_id_t b[],
+		size_t nb, uint32_t a_idxs[], uint32_t counts[]);
+/*
+ * Choose one of the methods above based on the sizes of the lists.
+ */
+size_t intersect_sorted(const vertex_id_t a[], size_t na, const vertex_id_t b[],
+		size_t nb, uint32_t a_idxs[], uint32_t counts[]);
+
+/*
+ * This is the size ratio of two lists above which we use galloping.
+ */
+static const size_t GALLOP_SIZE_RATIO = 32;
+
+/*
+ * This is a sorted list of vertex IDs without duplicates, which we intersect
+ * with other sorted lists, such as the edge lists of vertices.
+ * It doesn't own the IDs. For a large list (e.g., the neighbor list of
+ * a hub vertex), we can build an index on the list so that we can intersect
+ * it with a much shorter list by looking up each element of the short list.
+ *
+ * The intersection invokes `on_match(idx, num)' for each common element in
+ * ascending order, where `idx' is the location of the element in this list
+ * and `num' is the number of times it appears in the other list.
+ */
+class sorted_id_list
+{
+	/*
+	 * The number of elements we intersect in a batch when the other list
+	 * is stored in pages. It's the max number of IDs in a page.
+	 */
+	static const size_t BATCH_SIZE = safs::PAGE_SIZE / sizeof(vertex_id_t);
+	/*
+	 * We look up the elements of the other list in the index if this list
+	 * is larger than the other list by this ratio.
+	 */
+	static const size_t INDEX_SIZE_RATIO = 16;
+
+	const vertex_id_t *ids;
+	size_t num;
+
+	/*
+	 * If the IDs are dense, the index is a bitmap on the range of the IDs,
+	 * and we keep the number of IDs before each word of the bitmap.
+	 */
+	vertex_id_t min_id;
+	std::vector<uint64_t> id_bits;
+	std::vector<uint32_t> id_ranks;
+	/*
+	 * Otherwise, the index is an open-addressing hash table that maps
+	 * an ID to its location in the list.
+	 */
+	std::vector<std::pair<vertex_id_t, uint32_t> > id_table;
+	int table_shift;
+
+	template<class Merger>
+	void intersect_batch(const vertex_id_t b[], size_t nb,
+			const vertex_id_t *&a_start, Merger &merger) const;
+
+	/*
+	 * It merges the matches of the same element in this list when we
+	 * intersect the other list in multiple batches.
+	 */
+	template<class Func>
+	class match_merger
+	{
+		Func &on_match;
+		uint32_t idx;
+		uint32_t count;
+		size_t num_matches;
+	public:
+		match_merger(Func &_on_match): on_match(_on_match) {
+			idx = 0;
+			count = 0;
+			num_matches = 0;
+		}
+
+		void add(uint32_t idx, uint32_t count) {
+			if (this->count > 0 && this->idx == idx) {
+				this->count += count;
+				return;
+			}
+			if (this->count > 0)
+				on_match(this->idx, this->count);
+			this->idx = idx;
+			this->count = count;
+			num_matches++;
+		}
+
+		size_t finish() {
+			if (count > 0)
+				on_match(idx, count);
+			count = 0;
+			return num_matches;
+		}
+	};
+public:
+	sorted_id_list() {
+		ids = NULL;
+		num = 0;
+		min_id = 0;
+		table_shift = 0;
+	}
+
+	sorted_id_list(const vertex_id_t ids[], size_t num) {
+		this->ids = ids;
+		this->num = num;
+		min_id = 0;
+		table_shift = 0;
+	}
+
+	/*
+	 * Build an index on the list. It's only worth it for a large list
+	 * that is intersected with many other lists.
+	 */
+	void build_index();
+
+	/*
+	 * Find the location of an ID in the list. It searches the index if
+	 * the list has one, and binary searches the list otherwise.
+	 */
+	bool find(vertex_id_t id, uint32_t &idx) const;
+
+	bool has_index() const {
+		return !id_bits.empty() || !id_table.empty();
+	}
+
+	size_t size() const {
+		return num;
+	}
+
+	const vertex_id_t *data() const {
+		return ids;
+	}
+
+	/*
+	 * Intersect with a sorted list stored contiguously in memory.
+	 */
+	template<class Func>
+	size_t intersect(const vertex_id_t b[], size_t nb, Func &on_match) const;
+
+	/*
+	 * Intersect with a sorted list in a page vertex. The elements in
+	 * a page are contiguous in memory, so we intersect the elements
+	 * page by page without copying them.
+	 */
+	template<class Func>
+	size_t intersect(edge_iterator b_it, edge_iterator b_end,
+			Func &on_match) const;
+};
+
+/*
+ * Intersect a batch of the other list with the part of this list that
+ * starts at `a_start'. The batch has at most BATCH_SIZE elements.
+ * It moves `a_start' forward to where the next batch should start.
+ */
+template<class Merger>
+void sorted_id_list::intersect_batch(const vertex_id_t b[], size_t nb,
+		const vertex_id_t *&a_start, Merger &merger) const
+{
+	assert(nb <= BATCH_SIZE);
+	const vertex_id_t *first = a_start;
+	const vertex_id_t *last = ids + num;
+	// If this list is much longer than the batch, only the elements in
+	// the value range of the batch can match.
+	if ((size_t) (last - first) > nb * 2) {
+		first = std::lower_bound(first, last, b[0]);
+		last = std::upper_bound(first, last, b[nb - 1]);
+	}
+	uint32_t a_idxs[BATCH_SIZE];
+	uint32_t counts[BATCH_SIZE];
+	size_t num_matches = intersect_sorted(first, last - first, b, nb,
+			a_idxs, counts);
+	for (size_t i = 0; i < num_matches; i++)
+		merger.add(a_idxs[i] + (first - ids), counts[i]);
+	// The last element in the batch may also appear in the next batch,
+	// so the next batch starts from the first element we can match.
+	a_start = first;
+}
+
+template<class Func>
+size_t sorted_id_list::intersect(const vertex_id_t b[], size_t nb,
+		Func &on_match) const
+{
+	if (num == 0 || nb == 0)
+		return 0;
+
+	match_merger<Func> merger(on_match);
+	if (has_index() && num > nb * INDEX_SIZE_RATIO) {
+		for (size_t i = 0; i < nb; i++) {
+			uint32_t idx;
+			if (find(b[i], idx))
+				merger.add(idx, 1);
+		}
+		return merger.finish();
+	}
+
+	const vertex_id_t *a_start = ids;
+	for (size_t off = 0; off < nb && a_start != ids + num; off += BATCH_SIZE)
+		intersect_batch(b + off, std::min(nb - off, BATCH_SIZE), a_start,
+				merger);
+	return merger.finish();
+}
+
+template<class Func>
+size_t sorted_id_list::intersect(edge_iterator b_it, edge_iterator b_end,
+		Func &on_match) const
+{
+	size_t nb = b_end - b_it;
+	if (num == 0 || nb == 0)
+		return 0;
+
+	match_merger<Func> merger(on_match);
+	if (has_index() && num > nb * INDEX_SIZE_RATIO) {
+		for (; b_it != b_end; ++b_it) {
+			uint32_t idx;
+			if (find(*b_it, idx))
+				merger.add(idx, 1);
+		}
+		return merger.finish();
+	}
+
+	// If the other list is much longer, we search for each element of
+	// this list in the other list with galloping.
+	if (nb > num * GALLOP_SIZE_RATIO) {
+		for (size_t i = 0; i < num && b_it != b_end; i++) {
+			size_t step = 1;
+			while ((size_t) (b_end - b_it) > step
+					&& *(b_it + (step - 1)) < ids[i])
+				step *= 2;
+			// The first element not smaller than ids[i] is in
+			// [step / 2, min(step, remaining)).
+			size_t lo = step / 2;
+			size_t hi = std::min(step, (size_t) (b_end - b_it));
+			while (lo < hi) {
+				size_t mid = (lo + hi) / 2;
+				if (*(b_it + mid) < ids[i])
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			b_it += lo;
+			uint32_t count = 0;
+			for (; b_it != b_end && *b_it == ids[i]; ++b_it)
+				count++;
+			if (count > 0)
+				merger.add(i, count);
+		}
+		return merger.finish();
+	}
+
+	const vertex_id_t *a_start = ids;
+	while (b_it != b_end && a_start != ids + num) {
+		size_t num_eles = std::min(b_it.get_num_entries_in_page(),
+				(size_t) (b_end - b_it));
+		intersect_batch(b_it.get_curr_addr(), num_eles, a_start, merger);
+		b_it += num_eles;
+	}
+	return merger.finish();
+}
+
+}
+
+#endif
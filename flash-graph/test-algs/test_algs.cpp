@@ -22,8 +22,11 @@
 #include <gperftools/profiler.h>
 #endif
 
+#include "native_file.h"
+
 #include "FGlib.h"
 #include "ts_graph.h"
+#include "vertex_reorder.h"
 #include "sparse_matrix.h"
 #include "libgraph-algs/sem_kmeans.h"
 
@@ -35,6 +38,22 @@ using namespace fg;
 
 void print_usage();
 
+/*
+ * If the graph was relabelled by fg_reorder, the vertex IDs in the input and
+ * the output of the algorithms are the IDs in the original graph.
+ */
+vertex_permutation::ptr vperm;
+
+vertex_id_t get_orig_id(vertex_id_t id)
+{
+	return vperm ? vperm->get_orig_id(id) : id;
+}
+
+vertex_id_t get_new_id(vertex_id_t id)
+{
+	return vperm ? vperm->get_new_id(id) : id;
+}
+
 void int_handler(int sig_num)
 {
 #ifdef PROFILER
@@ -81,6 +100,84 @@ void run_triangle(FG_graph::ptr graph, int argc, char *argv[])
 		printf("There are %ld triangles\n", triangles->sum<size_t>());
 }
 
+void run_approx_triangle(FG_graph::ptr graph, int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	std::string method = "wedge";
+	double prob = 0.1;
+	size_t num_wedges = 100000;
+	size_t num_local = 0;
+	bool local = false;
+	double confidence = 0.95;
+	std::string output_file;
+
+	while ((opt = getopt(argc, argv, "m:p:n:l:c:o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'm':
+				method = optarg;
+				num_opts++;
+				break;
+			case 'p':
+				prob = atof(optarg);
+				num_opts++;
+				break;
+			case 'n':
+				num_wedges = atol(optarg);
+				num_opts++;
+				break;
+			case 'l':
+				num_local = atol(optarg);
+				num_opts++;
+				break;
+			case 'c':
+				confidence = atof(optarg);
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				local = true;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				assert(0);
+		}
+	}
+
+	approx_triangle_result res;
+	if (method == "doulion")
+		res = compute_doulion_triangles(graph, prob, local, confidence);
+	else if (method == "wedge") {
+		if (local && num_local == 0)
+			num_local = 1000;
+		res = compute_wedge_sampling_triangles(graph, num_wedges, num_local,
+				confidence);
+	}
+	else {
+		fprintf(stderr, "unknown method: %s\n", method.c_str());
+		return;
+	}
+	printf("There are about %g triangles, in [%g, %g] with confidence %g\n",
+			res.num_triangles, res.lower, res.upper, confidence);
+	printf("transitivity: %g, %ld samples, %ld edge lists read\n",
+			res.transitivity, res.num_samples, res.num_reads);
+	if (!output_file.empty() && res.local_clustering) {
+		FILE *f = fopen(output_file.c_str(), "w");
+		if (f == NULL) {
+			perror("fopen");
+			return;
+		}
+		fm::detail::mem_vec_store::const_ptr ccs
+			= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
+					res.local_clustering->get_raw_store());
+		for (size_t i = 0; i < ccs->get_length(); i++)
+			fprintf(f, "%d %g\n", get_orig_id(i), ccs->get<double>(i));
+		fclose(f);
+	}
+}
+
 void run_local_scan(FG_graph::ptr graph, int argc, char *argv[])
 {
 	int opt;
@@ -139,7 +236,8 @@ void run_topK_scan(FG_graph::ptr graph, int argc, char *argv[])
 	if (scan) {
 		printf("The top %d scans:\n", topK);
 		for (int i = 0; i < topK; i++)
-			printf("%u\t%ld\n", scan->get(i).first, scan->get(i).second);
+			printf("%u\t%ld\n", get_orig_id(scan->get(i).first),
+					scan->get(i).second);
 	}
 }
 
@@ -230,8 +328,13 @@ void run_wcc(FG_graph::ptr graph, int argc, char *argv[])
 		fm::detail::mem_vec_store::const_ptr mem_ids
 			= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
 					comp_ids->get_raw_store());
-		for (size_t i = 0; i < comp_ids->get_length(); i++)
-			fprintf(f, "%ld %d\n", i, mem_ids->get<vertex_id_t>(i));
+		for (size_t i = 0; i < comp_ids->get_length(); i++) {
+			// A component is identified by one of its vertices.
+			vertex_id_t comp_id = mem_ids->get<vertex_id_t>(i);
+			if (comp_id != INVALID_VERTEX_ID)
+				comp_id = get_orig_id(comp_id);
+			fprintf(f, "%d %d\n", get_orig_id(i), comp_id);
+		}
 		fclose(f);
 	}
 	print_cc(comp_ids);
@@ -285,8 +388,11 @@ void run_pagerank(FG_graph::ptr graph, int argc, char *argv[], int version)
 
 	int num_iters = 30;
 	float damping_factor = 0.85;
+	float tolerance = 1e-3;
+	bool async = false;
+	bool compare = false;
 
-	while ((opt = getopt(argc, argv, "i:D:")) != -1) {
+	while ((opt = getopt(argc, argv, "i:D:e:ab")) != -1) {
 		num_opts++;
 		switch (opt) {
 			case 'i':
@@ -297,6 +403,16 @@ void run_pagerank(FG_graph::ptr graph, int argc, char *argv[], int version)
 				damping_factor = atof(optarg);
 				num_opts++;
 				break;
+			case 'e':
+				tolerance = atof(optarg);
+				num_opts++;
+				break;
+			case 'a':
+				async = true;
+				break;
+			case 'b':
+				compare = true;
+				break;
 			default:
 				print_usage();
 				abort();
@@ -311,6 +427,30 @@ void run_pagerank(FG_graph::ptr graph, int argc, char *argv[], int version)
 		case 2:
 			pr = compute_pagerank2(graph, num_iters, damping_factor);
 			break;
+		case 3:
+			{
+				struct timeval start, end;
+				gettimeofday(&start, NULL);
+				pr = compute_pagerank_delta(graph, tolerance, damping_factor,
+						async);
+				gettimeofday(&end, NULL);
+				printf("%s pagerank-delta converges in %.3f seconds\n",
+						async ? "asynchronous" : "synchronous",
+						time_diff(start, end));
+				if (pr != NULL && compare) {
+					gettimeofday(&start, NULL);
+					fm::vector::ptr pr2 = compute_pagerank_delta(graph,
+							tolerance, damping_factor, !async);
+					gettimeofday(&end, NULL);
+					printf("%s pagerank-delta converges in %.3f seconds\n",
+							!async ? "asynchronous" : "synchronous",
+							time_diff(start, end));
+					printf("The sum of pagerank in the %s mode: %f\n",
+							!async ? "asynchronous" : "synchronous",
+							pr2->sum<float>());
+				}
+			}
+			break;
 		default:
 			abort();
 	}
@@ -338,7 +478,7 @@ void run_pagerank(FG_graph::ptr graph, int argc, char *argv[], int version)
 	}
 	while (!queue.empty()) {
 		val_loc_t pair = queue.top();
-		printf("v%ld: %f\n", pair.second, pair.first);
+		printf("v%u: %f\n", get_orig_id(pair.second), pair.first);
 		queue.pop();
 	}
 }
@@ -441,7 +581,7 @@ void run_sstsg(FG_graph::ptr graph, int argc, char *argv[])
 			fm::vector::ptr res = compute_sstsg(graph, interval_start,
 					time_interval, num_time_intervals);
 			std::pair<float, off_t> p = max_val_loc<float>(res);
-			printf("v%ld has max scan %f\n", p.second, p.first);
+			printf("v%u has max scan %f\n", get_orig_id(p.second), p.first);
 		}
 	}
 	else {
@@ -450,7 +590,7 @@ void run_sstsg(FG_graph::ptr graph, int argc, char *argv[])
 				time_interval, num_time_intervals);
 
 		std::pair<float, off_t> p = max_val_loc<float>(res);
-		printf("v%ld has max scan %f\n", p.second, p.first);
+		printf("v%u has max scan %f\n", get_orig_id(p.second), p.first);
 		if (!output_file.empty()) {
 			FILE *f = fopen(output_file.c_str(), "w");
 			if (f == NULL) {
@@ -461,7 +601,8 @@ void run_sstsg(FG_graph::ptr graph, int argc, char *argv[])
 				= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
 						res->get_raw_store());
 			for (size_t i = 0; i < res->get_length(); i++)
-				fprintf(f, "\"%ld\" %f\n", i, res_store->get<float>(i));
+				fprintf(f, "\"%u\" %f\n", get_orig_id(i),
+						res_store->get<float>(i));
 			fclose(f);
 		}
 	}
@@ -526,11 +667,15 @@ void run_kcore(FG_graph::ptr graph, int argc, char* argv[])
 	int num_opts = 0;
 	size_t kmax = 0;
 	size_t k = 2;
+	bool all_cores = false;
 	std::string write_out = "";
 
-	while ((opt = getopt(argc, argv, "k:m:w:")) != -1) {
+	while ((opt = getopt(argc, argv, "k:m:w:a")) != -1) {
 		num_opts++;
 		switch (opt) {
+			case 'a':
+				all_cores = true;
+				break;
 			case 'k':
 				k = atol(optarg);
 				num_opts++;
@@ -548,6 +693,25 @@ void run_kcore(FG_graph::ptr graph, int argc, char* argv[])
 		}
 	}
 
+	if (all_cores) {
+		fm::vector::ptr cores = compute_core_decomposition(graph);
+		printf("The max core is %ld\n", cores->max<size_t>());
+		if (!write_out.empty()) {
+			fm::detail::mem_vec_store::const_ptr store
+				= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
+						cores->get_raw_store());
+			FILE *f = fopen(write_out.c_str(), "w");
+			if (f == NULL) {
+				perror("fopen");
+				return;
+			}
+			for (size_t i = 0; i < store->get_length(); i++)
+				fprintf(f, "%u %ld\n", get_orig_id(i), store->get<size_t>(i));
+			fclose(f);
+		}
+		return;
+	}
+
 	if (k < 2) {
 		fprintf(stderr, "[Error]: kmin cannot be < 2\n");
 		exit(-1);
@@ -564,8 +728,11 @@ void run_betweenness_centrality(FG_graph::ptr graph, int argc, char* argv[])
 	int num_opts = 0;
 	std::string write_out = "";
 	vertex_id_t id = INVALID_VERTEX_ID;
+	double epsilon = 0;
+	double delta = 0.1;
+	size_t width = 64;
 
-	while ((opt = getopt(argc, argv, "w:s:")) != -1) {
+	while ((opt = getopt(argc, argv, "w:s:a:d:b:")) != -1) {
 		num_opts++;
 		switch (opt) {
 			case 'w':
@@ -574,12 +741,60 @@ void run_betweenness_centrality(FG_graph::ptr graph, int argc, char* argv[])
 			case 's':
 				id = atol(optarg);
 				break;
+			case 'a':
+				epsilon = atof(optarg);
+				break;
+			case 'd':
+				delta = atof(optarg);
+				break;
+			case 'b':
+				width = atol(optarg);
+				break;
 			default:
 				print_usage();
 				assert(0);
 		}
 	}
 
+	if (epsilon > 0) {
+		struct timeval start, end;
+		gettimeofday(&start, NULL);
+		approx_betweenness_result res = compute_approx_betweenness(graph,
+				epsilon, delta, width);
+		gettimeofday(&end, NULL);
+		if (res.btwn == NULL)
+			return;
+		printf("%ld samples (at most %ld) take %.3f seconds\n", res.num_samples,
+				res.max_samples, time_diff(start, end));
+		fm::detail::mem_vec_store::const_ptr btwn
+			= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
+					res.btwn->get_raw_store());
+		fm::detail::mem_vec_store::const_ptr err
+			= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
+					res.err->get_raw_store());
+		std::vector<std::pair<double, vertex_id_t> > top;
+		for (size_t i = 0; i < btwn->get_length(); i++)
+			top.push_back(std::pair<double, vertex_id_t>(btwn->get<double>(i), i));
+		size_t num_top = std::min(top.size(), 10UL);
+		std::partial_sort(top.begin(), top.begin() + num_top, top.end(),
+				std::greater<std::pair<double, vertex_id_t> >());
+		for (size_t i = 0; i < num_top; i++)
+			printf("v%u: %g +- %g\n", get_orig_id(top[i].second), top[i].first,
+					err->get<double>(top[i].second));
+		if (!write_out.empty()) {
+			FILE *f = fopen(write_out.c_str(), "w");
+			if (f == NULL) {
+				perror("fopen");
+				return;
+			}
+			for (size_t i = 0; i < btwn->get_length(); i++)
+				fprintf(f, "%u %g %g\n", get_orig_id(i), btwn->get<double>(i),
+						err->get<double>(i));
+			fclose(f);
+		}
+		return;
+	}
+
 	std::vector<vertex_id_t> ids;
 
 	if (id == INVALID_VERTEX_ID) {
@@ -587,7 +802,7 @@ void run_betweenness_centrality(FG_graph::ptr graph, int argc, char* argv[])
 			ids.push_back(id);
 		}
 	} else {
-		ids.push_back(id);
+		ids.push_back(get_new_id(id));
 	}
 
 	fm::vector::ptr btwn_v = compute_betweenness_centrality(graph, ids);
@@ -647,6 +862,8 @@ void run_overlap(FG_graph::ptr graph, int argc, char* argv[])
 
 	std::vector<vertex_id_t> overlap_vertices;
 	read_vertices(vertex_file, overlap_vertices);
+	for (size_t i = 0; i < overlap_vertices.size(); i++)
+		overlap_vertices[i] = get_new_id(overlap_vertices[i]);
 	std::vector<std::vector<double> > overlaps;
 	std::sort(overlap_vertices.begin(), overlap_vertices.end());
 	compute_overlap(graph, overlap_vertices, overlaps);
@@ -661,8 +878,9 @@ void run_overlap(FG_graph::ptr graph, int argc, char* argv[])
 			for (size_t j = 0; j < num_vertices; j++) {
 				double overlap = overlaps[i][j];
 				if (overlap >= threshold)
-					fprintf(fout, "%u %u %f\n", overlap_vertices[i],
-							overlap_vertices[j], overlap);
+					fprintf(fout, "%u %u %f\n",
+							get_orig_id(overlap_vertices[i]),
+							get_orig_id(overlap_vertices[j]), overlap);
 			}
 		}
 		fclose(fout);
@@ -675,9 +893,11 @@ void run_bfs(FG_graph::ptr graph, int argc, char* argv[])
 	int num_opts = 0;
 	edge_type edge = edge_type::OUT_EDGE;
 	vertex_id_t start_vertex = 0;
+	bool direction_opt = false;
+	bool compare = false;
 
 	std::string edge_type_str;
-	while ((opt = getopt(argc, argv, "e:s:")) != -1) {
+	while ((opt = getopt(argc, argv, "e:s:dc")) != -1) {
 		num_opts++;
 		switch (opt) {
 			case 'e':
@@ -688,6 +908,12 @@ void run_bfs(FG_graph::ptr graph, int argc, char* argv[])
 				start_vertex = atol(optarg);
 				num_opts++;
 				break;
+			case 'd':
+				direction_opt = true;
+				break;
+			case 'c':
+				compare = true;
+				break;
 			default:
 				print_usage();
 				abort();
@@ -706,24 +932,594 @@ void run_bfs(FG_graph::ptr graph, int argc, char* argv[])
 		}
 	}
 
-	size_t bfs(FG_graph::ptr fg, vertex_id_t start_vertex, edge_type);
-	size_t num_vertices = bfs(graph, start_vertex, edge);
-	printf("BFS from v%u traverses %ld vertices on edge type %d\n",
-			start_vertex, num_vertices, edge);
+	struct timeval start, end;
+	size_t num_vertices;
+	if (!direction_opt || compare) {
+		gettimeofday(&start, NULL);
+		num_vertices = bfs(graph, get_new_id(start_vertex), edge);
+		gettimeofday(&end, NULL);
+		printf("BFS from v%u traverses %ld vertices on edge type %d in %.3f seconds\n",
+				start_vertex, num_vertices, edge, time_diff(start, end));
+	}
+	if (direction_opt || compare) {
+		gettimeofday(&start, NULL);
+		num_vertices = direction_opt_bfs(graph, get_new_id(start_vertex), edge);
+		gettimeofday(&end, NULL);
+		printf("direction-optimizing BFS from v%u traverses %ld vertices on edge type %d in %.3f seconds\n",
+				start_vertex, num_vertices, edge, time_diff(start, end));
+	}
+}
+
+edge_type parse_edge_type(const std::string &edge_type_str)
+{
+	if (edge_type_str == "IN")
+		return edge_type::IN_EDGE;
+	else if (edge_type_str == "OUT")
+		return edge_type::OUT_EDGE;
+	else if (edge_type_str == "BOTH")
+		return edge_type::BOTH_EDGES;
+	else {
+		fprintf(stderr, "wrong edge type");
+		exit(1);
+	}
+}
+
+/*
+ * The sampled vertices have the IDs in the graph, so they don't need to be
+ * mapped before they're passed to the algorithms.
+ */
+void sample_vertices(FG_graph::ptr graph, size_t num,
+		std::vector<vertex_id_t> &vertices)
+{
+	size_t num_vertices = graph->get_num_vertices();
+	if (num >= num_vertices) {
+		for (vertex_id_t id = 0; id < num_vertices; id++)
+			vertices.push_back(id);
+	}
+	else {
+		for (size_t i = 0; i < num; i++)
+			vertices.push_back(random() % num_vertices);
+	}
+}
+
+void run_closeness(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	edge_type edge = edge_type::OUT_EDGE;
+	size_t num_vertices = std::numeric_limits<size_t>::max();
+	size_t width = 256;
+	std::string output_file;
+	bool check = false;
+
+	while ((opt = getopt(argc, argv, "e:n:w:o:c")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'e':
+				edge = parse_edge_type(optarg);
+				num_opts++;
+				break;
+			case 'n':
+				num_vertices = atol(optarg);
+				num_opts++;
+				break;
+			case 'w':
+				width = atol(optarg);
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			case 'c':
+				check = true;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	std::vector<vertex_id_t> ids;
+	sample_vertices(graph, num_vertices, ids);
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	fm::vector::ptr closeness = compute_closeness_centrality(graph, ids, edge,
+			width);
+	gettimeofday(&end, NULL);
+	if (closeness == NULL)
+		return;
+	fm::detail::mem_vec_store::const_ptr store
+		= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
+				closeness->get_raw_store());
+	size_t max_idx = 0;
+	for (size_t i = 1; i < ids.size(); i++)
+		if (store->get<double>(i) > store->get<double>(max_idx))
+			max_idx = i;
+	printf("closeness of %ld vertices takes %.3f seconds\n", ids.size(),
+			time_diff(start, end));
+	if (!ids.empty())
+		printf("v%u has the max closeness %g\n", get_orig_id(ids[max_idx]),
+				store->get<double>(max_idx));
+
+	// SSSP with unit weights gives the distances along out-edges.
+	if (check && edge == edge_type::OUT_EDGE) {
+		size_t num_checks = std::min(ids.size(), 16UL);
+		std::vector<vertex_id_t> sources(ids.begin(), ids.begin() + num_checks);
+		std::vector<fm::vector::ptr> dists = compute_multi_sssp(graph,
+				sources, 1);
+		size_t num_diffs = 0;
+		for (size_t i = 0; i < dists.size(); i++) {
+			fm::detail::mem_vec_store::const_ptr mem_dists
+				= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
+						dists[i]->get_raw_store());
+			double sum = 0, num_reached = 0;
+			for (size_t j = 0; j < mem_dists->get_length(); j++) {
+				double dist = mem_dists->get<double>(j);
+				if (dist > 0 && dist < std::numeric_limits<double>::infinity()) {
+					sum += dist;
+					num_reached++;
+				}
+			}
+			double expected = sum > 0 ? num_reached / sum * num_reached
+				/ (graph->get_num_vertices() - 1) : 0;
+			if (fabs(expected - store->get<double>(i)) > 1e-9 * expected)
+				num_diffs++;
+		}
+		printf("%ld of %ld vertices have different closeness from SSSP\n",
+				num_diffs, num_checks);
+	}
+
+	if (!output_file.empty()) {
+		FILE *f = fopen(output_file.c_str(), "w");
+		if (f == NULL) {
+			perror("fopen");
+			return;
+		}
+		for (size_t i = 0; i < ids.size(); i++)
+			fprintf(f, "%u %g\n", get_orig_id(ids[i]), store->get<double>(i));
+		fclose(f);
+	}
+}
+
+void run_distances(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	edge_type edge = edge_type::OUT_EDGE;
+	size_t num_samples = 1024;
+	size_t width = 256;
+
+	while ((opt = getopt(argc, argv, "e:n:w:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'e':
+				edge = parse_edge_type(optarg);
+				num_opts++;
+				break;
+			case 'n':
+				num_samples = atol(optarg);
+				num_opts++;
+				break;
+			case 'w':
+				width = atol(optarg);
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	std::vector<vertex_id_t> sources;
+	sample_vertices(graph, num_samples, sources);
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	std::vector<size_t> counts = compute_sampled_distances(graph, sources,
+			edge, width);
+	gettimeofday(&end, NULL);
+	printf("distances from %ld sources take %.3f seconds\n", sources.size(),
+			time_diff(start, end));
+
+	// We don't count the distance from a source to itself.
+	size_t num_pairs = 0;
+	double sum = 0;
+	for (size_t i = 1; i < counts.size(); i++) {
+		num_pairs += counts[i];
+		sum += i * counts[i];
+		printf("dist %ld: %ld pairs\n", i, counts[i]);
+	}
+	if (num_pairs == 0)
+		return;
+	size_t effective_diameter = 0;
+	for (size_t i = 1, num = 0; i < counts.size(); i++) {
+		num += counts[i];
+		if (num >= num_pairs * 0.9) {
+			effective_diameter = i;
+			break;
+		}
+	}
+	printf("average distance: %g, effective diameter: %ld, max distance: %ld\n",
+			sum / num_pairs, effective_diameter, counts.size() - 1);
+}
+
+void run_anf(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	edge_type edge = edge_type::OUT_EDGE;
+	int log2m = 6;
+	std::string output_file;
+
+	while ((opt = getopt(argc, argv, "e:b:o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'e':
+				edge = parse_edge_type(optarg);
+				num_opts++;
+				break;
+			case 'b':
+				log2m = atoi(optarg);
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	hyper_anf_result res = compute_hyper_anf(graph, edge, log2m);
+	gettimeofday(&end, NULL);
+	if (res.nf.empty())
+		return;
+	printf("HyperANF takes %.3f seconds\n", time_diff(start, end));
+	for (size_t i = 0; i < res.nf.size(); i++)
+		printf("N(%ld): %g pairs\n", i, res.nf[i]);
+	printf("average distance: %g, effective diameter: %g\n",
+			res.get_average_distance(), res.get_effective_diameter());
+
+	if (!output_file.empty()) {
+		fm::detail::mem_vec_store::const_ptr harmonic
+			= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
+					res.harmonic->get_raw_store());
+		FILE *f = fopen(output_file.c_str(), "w");
+		if (f == NULL) {
+			perror("fopen");
+			return;
+		}
+		for (size_t i = 0; i < harmonic->get_length(); i++)
+			fprintf(f, "%u %g\n", get_orig_id(i), harmonic->get<double>(i));
+		fclose(f);
+	}
+}
+
+/*
+ * Map the vertex IDs in the walks written by generate_random_walks() to
+ * the IDs before the graph was reordered.
+ */
+void map_walks(const std::string &file)
+{
+	FILE *f = fopen(file.c_str(), "r+");
+	if (f == NULL) {
+		perror("fopen");
+		return;
+	}
+	uint32_t len;
+	std::vector<vertex_id_t> walk;
+	while (fread(&len, sizeof(len), 1, f) == 1) {
+		walk.resize(len);
+		if (fread(walk.data(), sizeof(vertex_id_t), len, f) != len) {
+			fprintf(stderr, "%s is truncated\n", file.c_str());
+			break;
+		}
+		for (size_t i = 0; i < walk.size(); i++)
+			walk[i] = get_orig_id(walk[i]);
+		// We have to seek between reading and writing the file.
+		fseek(f, -(long) (len * sizeof(vertex_id_t)), SEEK_CUR);
+		if (fwrite(walk.data(), sizeof(vertex_id_t), len, f) != len) {
+			perror("fwrite");
+			break;
+		}
+		fseek(f, 0, SEEK_CUR);
+	}
+	fclose(f);
+}
+
+void run_random_walk(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	size_t num_walks = 10;
+	size_t walk_length = 80;
+	double p = 1;
+	double q = 1;
+	size_t batch_size = 1 << 20;
+	std::string weight_type_str;
+	std::string output_file;
+
+	while ((opt = getopt(argc, argv, "n:l:p:q:b:t:o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'n':
+				num_walks = atol(optarg);
+				num_opts++;
+				break;
+			case 'l':
+				walk_length = atol(optarg);
+				num_opts++;
+				break;
+			case 'p':
+				p = atof(optarg);
+				num_opts++;
+				break;
+			case 'q':
+				q = atof(optarg);
+				num_opts++;
+				break;
+			case 'b':
+				batch_size = atol(optarg);
+				num_opts++;
+				break;
+			case 't':
+				weight_type_str = optarg;
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+	if (output_file.empty()) {
+		fprintf(stderr, "random walks need an output file\n");
+		return;
+	}
+
+	const fm::scalar_type *weight_type = NULL;
+	if (!weight_type_str.empty())
+		weight_type = &fm::get_ele_parser(weight_type_str)->get_type();
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	size_t num_written = generate_random_walks(graph, output_file, num_walks,
+			walk_length, p, q, weight_type, batch_size);
+	gettimeofday(&end, NULL);
+	printf("%ld random walks (p: %g, q: %g) take %.3f seconds\n", num_written,
+			p, q, time_diff(start, end));
+	if (vperm)
+		map_walks(output_file);
+}
+
+void run_ppr(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	std::string seed_file;
+	size_t num_seeds = 64;
+	double epsilon = 1e-6;
+	size_t k = 10;
+	float damping_factor = 0.85;
+
+	while ((opt = getopt(argc, argv, "s:n:e:k:D:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 's':
+				seed_file = optarg;
+				num_opts++;
+				break;
+			case 'n':
+				num_seeds = atol(optarg);
+				num_opts++;
+				break;
+			case 'e':
+				epsilon = atof(optarg);
+				num_opts++;
+				break;
+			case 'k':
+				k = atol(optarg);
+				num_opts++;
+				break;
+			case 'D':
+				damping_factor = atof(optarg);
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	std::vector<vertex_id_t> ids;
+	if (seed_file.empty())
+		sample_vertices(graph, num_seeds, ids);
+	else {
+		read_vertices(seed_file, ids);
+		for (size_t i = 0; i < ids.size(); i++)
+			ids[i] = get_new_id(ids[i]);
+	}
+	std::vector<std::vector<vertex_id_t> > seeds(ids.size());
+	for (size_t i = 0; i < ids.size(); i++)
+		seeds[i].push_back(ids[i]);
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	std::vector<std::vector<std::pair<vertex_id_t, float> > > topk
+		= compute_ppr_topk(graph, seeds, std::vector<double>(1, epsilon), k,
+				damping_factor);
+	gettimeofday(&end, NULL);
+	if (topk.empty())
+		return;
+	printf("personalized PageRank (eps: %g) for %ld seeds takes %.3f seconds\n",
+			epsilon, seeds.size(), time_diff(start, end));
+	for (size_t i = 0; i < std::min(topk.size(), 10UL); i++) {
+		printf("seed %u:", get_orig_id(seeds[i][0]));
+		for (size_t j = 0; j < topk[i].size(); j++)
+			printf(" %u:%g", get_orig_id(topk[i][j].first), topk[i][j].second);
+		printf("\n");
+	}
+}
+
+void run_sssp(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	vertex_id_t source = 0;
+	double delta = 1;
+	std::string weight_type_str;
+	std::string source_file;
+	std::string output_file;
+	bool check = false;
+	bool async = false;
+	bool compare = false;
+
+	while ((opt = getopt(argc, argv, "s:d:t:m:o:cab")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 's':
+				source = atol(optarg);
+				num_opts++;
+				break;
+			case 'd':
+				delta = atof(optarg);
+				num_opts++;
+				break;
+			case 't':
+				weight_type_str = optarg;
+				num_opts++;
+				break;
+			case 'm':
+				source_file = optarg;
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			case 'c':
+				check = true;
+				break;
+			case 'a':
+				async = true;
+				break;
+			case 'b':
+				compare = true;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	const fm::scalar_type *weight_type = NULL;
+	if (!weight_type_str.empty())
+		weight_type = &fm::get_ele_parser(weight_type_str)->get_type();
+
+	std::vector<vertex_id_t> sources;
+	if (source_file.empty())
+		sources.push_back(source);
+	else
+		read_vertices(source_file, sources);
+	for (size_t i = 0; i < sources.size(); i++)
+		sources[i] = get_new_id(sources[i]);
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	std::vector<fm::vector::ptr> dists = compute_multi_sssp(graph, sources,
+			delta, weight_type, async);
+	gettimeofday(&end, NULL);
+	if (dists.empty())
+		return;
+	printf("%s delta-stepping SSSP (delta: %g) from %ld sources takes %.3f seconds\n",
+			async ? "asynchronous" : "synchronous", delta, sources.size(),
+			time_diff(start, end));
+
+	if (compare) {
+		gettimeofday(&start, NULL);
+		compute_multi_sssp(graph, sources, delta, weight_type, !async);
+		gettimeofday(&end, NULL);
+		printf("%s delta-stepping SSSP (delta: %g) from %ld sources takes %.3f seconds\n",
+				!async ? "asynchronous" : "synchronous", delta, sources.size(),
+				time_diff(start, end));
+	}
+
+	if (check) {
+		gettimeofday(&start, NULL);
+		std::vector<fm::vector::ptr> bf_dists = compute_multi_sssp(graph,
+				sources, std::numeric_limits<double>::infinity(), weight_type);
+		gettimeofday(&end, NULL);
+		printf("Bellman-Ford from %ld sources takes %.3f seconds\n",
+				sources.size(), time_diff(start, end));
+		size_t num_diffs = 0;
+		for (size_t i = 0; i < sources.size(); i++) {
+			fm::detail::mem_vec_store::const_ptr v1
+				= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
+						dists[i]->get_raw_store());
+			fm::detail::mem_vec_store::const_ptr v2
+				= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
+						bf_dists[i]->get_raw_store());
+			for (size_t j = 0; j < v1->get_length(); j++)
+				if (v1->get<double>(j) != v2->get<double>(j))
+					num_diffs++;
+		}
+		printf("%ld distances differ from Bellman-Ford\n", num_diffs);
+	}
+
+	if (!output_file.empty()) {
+		FILE *f = fopen(output_file.c_str(), "w");
+		if (f == NULL) {
+			perror("fopen");
+			return;
+		}
+		for (size_t i = 0; i < sources.size(); i++) {
+			fm::detail::mem_vec_store::const_ptr mem_dists
+				= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
+						dists[i]->get_raw_store());
+			for (size_t j = 0; j < mem_dists->get_length(); j++) {
+				double dist = mem_dists->get<double>(j);
+				if (dist < std::numeric_limits<double>::infinity())
+					fprintf(f, "%u %u %g\n", get_orig_id(sources[i]),
+							get_orig_id(j), dist);
+			}
+		}
+		fclose(f);
+	}
 }
 
-#if 0
 void run_louvain(FG_graph::ptr graph, int argc, char* argv[])
 {
 	int opt;
 	int num_opts = 0;
-	uint32_t levels = 1;
+	uint32_t levels = 10;
+	bool refine = true;
+	std::string weight_type_str;
+	std::string output_file;
 
-	while ((opt = getopt(argc, argv, "l:")) != -1) {
+	while ((opt = getopt(argc, argv, "l:nt:o:")) != -1) {
 		num_opts++;
 		switch (opt) {
 			case 'l':
 				levels = atoi(optarg);
+				num_opts++;
+				break;
+			case 'n':
+				refine = false;
+				break;
+			case 't':
+				weight_type_str = optarg;
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
 				break;
 			default:
 				print_usage();
@@ -731,9 +1527,74 @@ void run_louvain(FG_graph::ptr graph, int argc, char* argv[])
 		}
 	}
 
-	compute_louvain(graph, levels);
+	const fm::scalar_type *weight_type = NULL;
+	if (!weight_type_str.empty())
+		weight_type = &fm::get_ele_parser(weight_type_str)->get_type();
+
+	louvain_result res = compute_louvain(graph, levels, refine, weight_type);
+	if (res.communities == NULL)
+		return;
+	for (size_t i = 0; i < res.modularity.size(); i++)
+		printf("level %ld: %ld communities, modularity: %g, %.3f seconds\n", i,
+				res.num_communities[i], res.modularity[i], res.runtimes[i]);
+	if (!output_file.empty()) {
+		FILE *f = fopen(output_file.c_str(), "w");
+		if (f == NULL) {
+			perror("fopen");
+			return;
+		}
+		fm::detail::mem_vec_store::const_ptr comms
+			= std::dynamic_pointer_cast<const fm::detail::mem_vec_store>(
+					res.communities->get_raw_store());
+		for (size_t i = 0; i < comms->get_length(); i++)
+			fprintf(f, "%d %d\n", get_orig_id(i), comms->get<vertex_id_t>(i));
+		fclose(f);
+	}
+}
+
+void run_msf(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	std::string weight_type_str;
+	std::string output_file;
+
+	while ((opt = getopt(argc, argv, "t:o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 't':
+				weight_type_str = optarg;
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				assert(0);
+		}
+	}
+
+	const fm::scalar_type *weight_type = NULL;
+	if (!weight_type_str.empty())
+		weight_type = &fm::get_ele_parser(weight_type_str)->get_type();
+
+	msf_result res = compute_msf(graph, weight_type);
+	printf("The minimum spanning forest has %ld trees, %ld edges and weight %g\n",
+			res.num_trees, res.edges.size(), res.total_weight);
+	if (!output_file.empty()) {
+		FILE *f = fopen(output_file.c_str(), "w");
+		if (f == NULL) {
+			perror("fopen");
+			return;
+		}
+		for (size_t i = 0; i < res.edges.size(); i++)
+			fprintf(f, "%d %d %g\n", get_orig_id(res.edges[i].from),
+					get_orig_id(res.edges[i].to), res.edges[i].weight);
+		fclose(f);
+	}
 }
-#endif
 
 void run_sem_kmeans(FG_graph::ptr graph, int argc, char *argv[])
 {
@@ -821,6 +1682,7 @@ void run_spmm(FG_graph::ptr fg, int argc, char *argv[])
 std::string supported_algs[] = {
 	"cycle_triangle",
 	"triangle",
+	"approx_triangle",
 	"local_scan",
 	"topK_scan",
 	"wcc",
@@ -828,13 +1690,21 @@ std::string supported_algs[] = {
 	"diameter",
 	"pagerank",
 	"pagerank2",
+	"pagerank_delta",
 	"sstsg",
 	"ts_wcc",
 	"kcore",
 	"betweenness",
 	"overlap",
 	"bfs",
+	"sssp",
+	"closeness",
+	"distances",
+	"anf",
+	"randwalk",
+	"ppr",
 	"louvain",
+	"msf",
     "sem_kmeans"
 };
 int num_supported = sizeof(supported_algs) / sizeof(supported_algs[0]);
@@ -843,6 +1713,8 @@ void print_usage()
 {
 	fprintf(stderr,
 			"test_algs conf_file graph_file index_file algorithm [alg-options]\n");
+	fprintf(stderr,
+			"If graph_file.perm (without the .adj suffix) exists, vertex IDs are the IDs before fg_reorder\n");
 	fprintf(stderr, "scan-statistics:\n");
 	fprintf(stderr, "-K topK: topK vertices in topK scan\n");
 	fprintf(stderr, "\n");
@@ -857,6 +1729,9 @@ void print_usage()
 	fprintf(stderr, "pagerank\n");
 	fprintf(stderr, "-i num: the maximum number of iterations\n");
 	fprintf(stderr, "-D v: damping factor\n");
+	fprintf(stderr, "-e tolerance: the tolerance of pagerank_delta (default: 0.001)\n");
+	fprintf(stderr, "-a: run pagerank_delta asynchronously\n");
+	fprintf(stderr, "-b: compare the asynchronous mode with the synchronous mode\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "sstsg\n");
 	fprintf(stderr, "-n num: the number of time intervals\n");
@@ -873,11 +1748,15 @@ void print_usage()
 	fprintf(stderr, "kcore\n");
 	fprintf(stderr, "-k k: the minimum k value to compute\n");
 	fprintf(stderr, "-m kmax: the maximum k value to compute\n");
-	fprintf(stderr, "-w output: the file name for a vector written to file\n");
+	fprintf(stderr, "-a: compute the coreness of all vertices by bucketed peeling\n");
+	fprintf(stderr, "-w output: the file where the coreness of each vertex is written with -a\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "betweenness\n");
 	fprintf(stderr, "-w output: the file name for a vector written to file\n");
 	fprintf(stderr, "-s vertex id: the vertex where BC starts. (Default runs all)\n");
+	fprintf(stderr, "-a epsilon: approximate BC by sampling paths with the max error\n");
+	fprintf(stderr, "-d delta: the probability that the approximation error exceeds epsilon\n");
+	fprintf(stderr, "-b width: the number of sampled paths that run together (at most 64)\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "cycle_triangle\n");
 	fprintf(stderr, "-f: run the fast implementation\n");
@@ -892,9 +1771,69 @@ void print_usage()
 	fprintf(stderr, "bfs\n");
 	fprintf(stderr, "-e edge type: the type of edge to traverse (IN, OUT, BOTH)\n");
 	fprintf(stderr, "-s vertex id: the vertex where the BFS starts\n");
+	fprintf(stderr, "-d: run direction-optimizing BFS\n");
+	fprintf(stderr, "-c: compare BFS with direction-optimizing BFS\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "sssp\n");
+	fprintf(stderr, "-s vertex id: the source vertex\n");
+	fprintf(stderr, "-m file: the file with multiple source vertices\n");
+	fprintf(stderr, "-d delta: the bucket width of delta-stepping (default: 1)\n");
+	fprintf(stderr, "-t type: the type of edge weights (I, L, F, D). Default: unit weights\n");
+	fprintf(stderr, "-o output: the output file\n");
+	fprintf(stderr, "-c: check the distances against Bellman-Ford\n");
+	fprintf(stderr, "-a: process the vertices in a bucket asynchronously\n");
+	fprintf(stderr, "-b: compare the asynchronous mode with the synchronous mode\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "closeness\n");
+	fprintf(stderr, "-e edge type: the type of edge to traverse (IN, OUT, BOTH)\n");
+	fprintf(stderr, "-n num: the number of random vertices (default: all vertices)\n");
+	fprintf(stderr, "-w width: the number of BFS that run together (64, 256, 512)\n");
+	fprintf(stderr, "-o output: the output file\n");
+	fprintf(stderr, "-c: check the closeness of some vertices with SSSP\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "distances\n");
+	fprintf(stderr, "-e edge type: the type of edge to traverse (IN, OUT, BOTH)\n");
+	fprintf(stderr, "-n num: the number of sampled sources (default: 1024)\n");
+	fprintf(stderr, "-w width: the number of BFS that run together (64, 256, 512)\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "anf\n");
+	fprintf(stderr, "-e edge type: the type of edge to traverse (IN, OUT, BOTH)\n");
+	fprintf(stderr, "-b bits: the log of the number of registers in a counter (default: 6)\n");
+	fprintf(stderr, "-o output: the output file of the harmonic centrality\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "randwalk\n");
+	fprintf(stderr, "-n num: the number of walks from each vertex (default: 10)\n");
+	fprintf(stderr, "-l length: the max number of vertices in a walk (default: 80)\n");
+	fprintf(stderr, "-p p: the return parameter of node2vec (default: 1)\n");
+	fprintf(stderr, "-q q: the in-out parameter of node2vec (default: 1)\n");
+	fprintf(stderr, "-b size: the number of walkers in a batch\n");
+	fprintf(stderr, "-t type: the type of edge weights (I, L, F, D). Default: unit weights\n");
+	fprintf(stderr, "-o output: the output file of the walks\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "ppr\n");
+	fprintf(stderr, "-s file: the file with a seed vertex in each line\n");
+	fprintf(stderr, "-n num: the number of random seed vertices (default: 64)\n");
+	fprintf(stderr, "-e epsilon: the residual threshold of forward push (default: 1e-6)\n");
+	fprintf(stderr, "-k k: the number of vertices returned for each seed (default: 10)\n");
+	fprintf(stderr, "-D v: damping factor\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "approx_triangle\n");
+	fprintf(stderr, "-m method: doulion or wedge (default: wedge)\n");
+	fprintf(stderr, "-p prob: the probability of sampling an edge in doulion (default: 0.1)\n");
+	fprintf(stderr, "-n num: the number of sampled wedges (default: 100000)\n");
+	fprintf(stderr, "-l num: the number of wedges sampled on each vertex for local clustering\n");
+	fprintf(stderr, "-c confidence: the confidence level of the interval (default: 0.95)\n");
+	fprintf(stderr, "-o output: the output file of the local clustering coefficients\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "louvain\n");
-	fprintf(stderr, "-l: how many levels in the hierarchy to compute\n");
+	fprintf(stderr, "-l: how many levels in the hierarchy to compute (default: 10)\n");
+	fprintf(stderr, "-n: don't refine communities as Leiden does\n");
+	fprintf(stderr, "-t type: the type of edge weights (I, L, F, D). Default: unit weights\n");
+	fprintf(stderr, "-o output: the output file of the communities\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "msf\n");
+	fprintf(stderr, "-t type: the type of edge weights (I, L, F, D). Default: unit weights\n");
+	fprintf(stderr, "-o output: the output file of the edges in the forest\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "sem_kmeans\n");
 	fprintf(stderr, "-k: the number of clusters to use\n");
@@ -933,6 +1872,18 @@ int main(int argc, char *argv[])
 		configs = config_map::ptr();
 	signal(SIGINT, int_handler);
 
+	std::string perm_file = graph_file;
+	if (perm_file.size() > 4 && perm_file.substr(perm_file.size() - 4) == ".adj")
+		perm_file = perm_file.substr(0, perm_file.size() - 4);
+	perm_file += ".perm";
+	if (safs::native_file(perm_file).exist()) {
+		vperm = vertex_permutation::load(perm_file);
+		if (vperm == NULL)
+			exit(-1);
+		printf("vertex IDs are mapped to the original graph with %s\n",
+				perm_file.c_str());
+	}
+
 	graph_engine::init_flash_graph(configs);
 	FG_graph::ptr graph;
 	try {
@@ -941,6 +1892,11 @@ int main(int argc, char *argv[])
 		fprintf(stderr, "%s\n", e.what());
 		exit(-1);
 	}
+	if (vperm && vperm->get_num_vertices()
+			!= graph->get_graph_header().get_num_vertices()) {
+		fprintf(stderr, "the permutation doesn't match the graph\n");
+		exit(-1);
+	}
 
 	if (alg == "cycle_triangle") {
 		run_cycle_triangle(graph, argc, argv);
@@ -948,6 +1904,9 @@ int main(int argc, char *argv[])
 	else if (alg == "triangle") {
 		run_triangle(graph, argc, argv);
 	}
+	else if (alg == "approx_triangle") {
+		run_approx_triangle(graph, argc, argv);
+	}
 	else if (alg == "local_scan") {
 		run_local_scan(graph, argc, argv);
 	}
@@ -963,6 +1922,9 @@ int main(int argc, char *argv[])
 	else if (alg == "pagerank2") {
 		run_pagerank(graph, argc, argv, 2);
 	}
+	else if (alg == "pagerank_delta") {
+		run_pagerank(graph, argc, argv, 3);
+	}
 	else if (alg == "wcc") {
 		run_wcc(graph, argc, argv);
 	}
@@ -990,11 +1952,30 @@ int main(int argc, char *argv[])
 	else if (alg == "bfs") {
 		run_bfs(graph, argc, argv);
 	}
-#if 0
+	else if (alg == "sssp") {
+		run_sssp(graph, argc, argv);
+	}
+	else if (alg == "closeness") {
+		run_closeness(graph, argc, argv);
+	}
+	else if (alg == "distances") {
+		run_distances(graph, argc, argv);
+	}
+	else if (alg == "anf") {
+		run_anf(graph, argc, argv);
+	}
+	else if (alg == "randwalk") {
+		run_random_walk(graph, argc, argv);
+	}
+	else if (alg == "ppr") {
+		run_ppr(graph, argc, argv);
+	}
 	else if (alg == "louvain") {
 		run_louvain(graph, argc, argv);
 	}
-#endif
+	else if (alg == "msf") {
+		run_msf(graph, argc, argv);
+	}
 	else if (alg == "sem_kmeans") {
 		run_sem_kmeans(graph, argc, argv);
 	}
@@ -0,0 +1,285 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This benchmarks the methods of intersecting sorted edge lists.
+ * It samples edges from a graph and intersects the edge lists of the two
+ * end vertices of each edge as triangle counting and scan statistics do,
+ * so the sizes of the lists follow the degree distribution of the graph.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "vertex.h"
+#include "vertex_index.h"
+#include "in_mem_storage.h"
+#include "FGlib.h"
+#include "fg_utils.h"
+#include "set_intersection.h"
+
+using namespace fg;
+
+/*
+ * We build an index on the edge lists larger than this.
+ */
+const size_t INDEX_THRESHOLD = 1000;
+
+/*
+ * The adjacency lists of the graph in memory. The edges of a vertex
+ * are sorted and don't have duplicates.
+ */
+class adj_lists
+{
+	std::vector<size_t> offs;
+	std::vector<vertex_id_t> ids;
+	std::vector<std::unique_ptr<sorted_id_list> > indexed_lists;
+public:
+	adj_lists(FG_graph::ptr graph);
+
+	size_t get_num_vertices() const {
+		return offs.size() - 1;
+	}
+
+	size_t get_num_edges() const {
+		return ids.size();
+	}
+
+	size_t get_max_degree() const {
+		size_t max_degree = 0;
+		for (size_t i = 0; i < get_num_vertices(); i++)
+			max_degree = std::max(max_degree, get_degree(i));
+		return max_degree;
+	}
+
+	size_t get_degree(vertex_id_t id) const {
+		return offs[id + 1] - offs[id];
+	}
+
+	const vertex_id_t *get_edges(vertex_id_t id) const {
+		return ids.data() + offs[id];
+	}
+
+	/*
+	 * Get the source vertex of an edge.
+	 */
+	vertex_id_t get_source(size_t edge_idx) const {
+		return std::upper_bound(offs.begin(), offs.end(), edge_idx)
+			- offs.begin() - 1;
+	}
+
+	vertex_id_t get_edge(size_t edge_idx) const {
+		return ids[edge_idx];
+	}
+
+	void build_index() {
+		indexed_lists.resize(get_num_vertices());
+		for (size_t i = 0; i < get_num_vertices(); i++) {
+			if (get_degree(i) > INDEX_THRESHOLD) {
+				indexed_lists[i] = std::unique_ptr<sorted_id_list>(
+						new sorted_id_list(get_edges(i), get_degree(i)));
+				indexed_lists[i]->build_index();
+			}
+		}
+	}
+
+	const sorted_id_list *get_indexed_list(vertex_id_t id) const {
+		return indexed_lists[id].get();
+	}
+};
+
+adj_lists::adj_lists(FG_graph::ptr graph)
+{
+	vertex_index::ptr vindex = graph->get_index_data();
+	std::vector<off_t> vertex_offs(vindex->get_num_vertices() + 1);
+	init_out_offs(vindex, vertex_offs);
+	const safs::NUMA_buffer &data = graph->get_graph_data()->get_data();
+	std::vector<char> buf;
+	offs.push_back(0);
+	for (size_t i = 0; i < vindex->get_num_vertices(); i++) {
+		size_t size = vertex_offs[i + 1] - vertex_offs[i];
+		buf.resize(size);
+		data.copy_to(buf.data(), size, vertex_offs[i]);
+		const ext_mem_undirected_vertex *v
+			= (const ext_mem_undirected_vertex *) buf.data();
+		size_t start = ids.size();
+		for (size_t j = 0; j < v->get_num_edges(); j++)
+			ids.push_back(v->get_neighbor(j));
+		ids.resize(std::unique(ids.begin() + start, ids.end()) - ids.begin());
+		offs.push_back(ids.size());
+	}
+}
+
+struct vertex_pair
+{
+	vertex_id_t id1;
+	vertex_id_t id2;
+};
+
+class null_counter
+{
+public:
+	void operator()(uint32_t idx, uint32_t num) {
+	}
+};
+
+typedef size_t (*intersect_func)(const vertex_id_t a[], size_t na,
+		const vertex_id_t b[], size_t nb, uint32_t a_idxs[], uint32_t counts[]);
+
+/*
+ * Run a method on all pairs and return the number of common neighbors.
+ */
+size_t run_kernel(const adj_lists &lists, const std::vector<vertex_pair> &pairs,
+		intersect_func func, std::vector<uint32_t> &a_idxs,
+		std::vector<uint32_t> &counts)
+{
+	size_t num_common = 0;
+	for (size_t i = 0; i < pairs.size(); i++) {
+		vertex_id_t id1 = pairs[i].id1;
+		vertex_id_t id2 = pairs[i].id2;
+		num_common += func(lists.get_edges(id1), lists.get_degree(id1),
+				lists.get_edges(id2), lists.get_degree(id2), a_idxs.data(),
+				counts.data());
+	}
+	return num_common;
+}
+
+/*
+ * Intersect the lists as the graph algorithms do: the larger list
+ * is indexed if it's large enough.
+ */
+size_t run_list(const adj_lists &lists, const std::vector<vertex_pair> &pairs)
+{
+	size_t num_common = 0;
+	null_counter counter;
+	for (size_t i = 0; i < pairs.size(); i++) {
+		vertex_id_t id1 = pairs[i].id1;
+		vertex_id_t id2 = pairs[i].id2;
+		if (lists.get_degree(id1) < lists.get_degree(id2))
+			std::swap(id1, id2);
+		const sorted_id_list *list = lists.get_indexed_list(id1);
+		if (list)
+			num_common += list->intersect(lists.get_edges(id2),
+					lists.get_degree(id2), counter);
+		else
+			num_common += sorted_id_list(lists.get_edges(id1),
+					lists.get_degree(id1)).intersect(lists.get_edges(id2),
+					lists.get_degree(id2), counter);
+	}
+	return num_common;
+}
+
+void bench_pairs(const adj_lists &lists, const std::vector<vertex_pair> &pairs,
+		const std::string &name)
+{
+	if (pairs.empty())
+		return;
+
+	const char *kernel_names[] = {"merge", "block", "gallop", "adaptive"};
+	intersect_func kernels[] = {intersect_merge, intersect_block,
+		intersect_gallop, intersect_sorted};
+	size_t num_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+	size_t max_degree = lists.get_max_degree();
+	std::vector<uint32_t> a_idxs(max_degree);
+	std::vector<uint32_t> counts(max_degree);
+	printf("%s: %ld pairs\n", name.c_str(), pairs.size());
+	size_t expected = 0;
+	for (size_t i = 0; i <= num_kernels; i++) {
+		struct timeval start, end;
+		gettimeofday(&start, NULL);
+		size_t num_common;
+		if (i < num_kernels)
+			num_common = run_kernel(lists, pairs, kernels[i], a_idxs, counts);
+		else
+			num_common = run_list(lists, pairs);
+		gettimeofday(&end, NULL);
+		if (i == 0)
+			expected = num_common;
+		else if (num_common != expected)
+			fprintf(stderr, "%s gets %ld common neighbors instead of %ld\n",
+					i < num_kernels ? kernel_names[i] : "indexed", num_common,
+					expected);
+		printf("\t%s: %.1f ns per pair, %ld common neighbors\n",
+				i < num_kernels ? kernel_names[i] : "indexed",
+				time_diff_us(start, end) * 1000.0 / pairs.size(), num_common);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3) {
+		fprintf(stderr, "bench_intersect adj_list_file index_file [num_pairs]\n");
+		return -1;
+	}
+
+	const std::string adj_file_name = argv[1];
+	const std::string index_file_name = argv[2];
+	size_t num_pairs = 1000000;
+	if (argc >= 4)
+		num_pairs = atol(argv[3]);
+
+	FG_graph::ptr graph = FG_graph::create(adj_file_name, index_file_name,
+			config_map::ptr());
+	if (graph->get_graph_header().has_compressed_edges()) {
+		fprintf(stderr, "the benchmark doesn't support compressed edge lists\n");
+		return -1;
+	}
+	adj_lists lists(graph);
+	lists.build_index();
+	printf("The graph has %ld vertices and %ld edges\n",
+			lists.get_num_vertices(), lists.get_num_edges());
+	if (lists.get_num_edges() == 0)
+		return 0;
+
+	// We sample edges uniformly and group the pairs of end vertices
+	// by the ratio of their degrees.
+	const size_t ratios[] = {4, GALLOP_SIZE_RATIO};
+	std::vector<vertex_pair> all_pairs;
+	std::vector<vertex_pair> bucket_pairs[3];
+	for (size_t i = 0; i < num_pairs; i++) {
+		size_t edge_idx = random() % lists.get_num_edges();
+		vertex_pair pair;
+		pair.id1 = lists.get_source(edge_idx);
+		pair.id2 = lists.get_edge(edge_idx);
+		size_t degree1 = lists.get_degree(pair.id1);
+		size_t degree2 = lists.get_degree(pair.id2);
+		size_t ratio = std::max(degree1, degree2)
+			/ std::max(std::min(degree1, degree2), 1UL);
+		all_pairs.push_back(pair);
+		if (ratio < ratios[0])
+			bucket_pairs[0].push_back(pair);
+		else if (ratio < ratios[1])
+			bucket_pairs[1].push_back(pair);
+		else
+			bucket_pairs[2].push_back(pair);
+	}
+	bench_pairs(lists, all_pairs, "all pairs");
+	bench_pairs(lists, bucket_pairs[0], "degree ratio < "
+			+ std::to_string(ratios[0]));
+	bench_pairs(lists, bucket_pairs[1], "degree ratio in ["
+			+ std::to_string(ratios[0]) + ", " + std::to_string(ratios[1]) + ")");
+	bench_pairs(lists, bucket_pairs[2], "degree ratio >= "
+			+ std::to_string(ratios[1]));
+}
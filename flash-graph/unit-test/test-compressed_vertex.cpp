@@ -0,0 +1,191 @@
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#define BOOST_TEST_MODULE compressed_vertex
+#include <boost/test/included/unit_test.hpp>
+
+#include "compressed_vertex.h"
+
+using namespace fg;
+
+/*
+ * A byte array on a memory buffer. The buffer starts at the beginning
+ * of a page.
+ */
+class mem_byte_array: public safs::page_byte_array
+{
+	const char *buf;
+	off_t off_in_page;
+	size_t size;
+public:
+	mem_byte_array(const char *buf, off_t off_in_page, size_t size) {
+		this->buf = buf;
+		this->off_in_page = off_in_page;
+		this->size = size;
+	}
+
+	virtual void lock() {
+	}
+
+	virtual void unlock() {
+	}
+
+	virtual size_t get_size() const {
+		return size;
+	}
+
+	virtual page_byte_array *clone() {
+		return NULL;
+	}
+
+	virtual off_t get_offset() const {
+		return off_in_page;
+	}
+
+	virtual off_t get_offset_in_first_page() const {
+		return off_in_page;
+	}
+
+	virtual const char *get_page(int idx) const {
+		return buf + ((size_t) idx) * safs::PAGE_SIZE;
+	}
+};
+
+std::vector<uint32_t> gen_neighbors(size_t num, uint32_t max_gap)
+{
+	std::vector<uint32_t> neighs(num);
+	uint32_t curr = 0;
+	for (size_t i = 0; i < num; i++) {
+		curr += random() % max_gap;
+		neighs[i] = curr;
+	}
+	return neighs;
+}
+
+BOOST_AUTO_TEST_SUITE (compressed_vertex_test)
+
+BOOST_AUTO_TEST_CASE (test_stream_vbyte)
+{
+	size_t nums[] = {0, 1, 3, 4, 5, 17, 100, 10000};
+	uint32_t gaps[] = {2, 300, 70000, 1U << 26};
+	for (size_t i = 0; i < sizeof(nums) / sizeof(nums[0]); i++) {
+		for (size_t j = 0; j < sizeof(gaps) / sizeof(gaps[0]); j++) {
+			std::vector<uint32_t> neighs = gen_neighbors(nums[i], gaps[j]);
+			std::vector<uint8_t> buf(stream_vbyte_max_size(neighs.size()));
+			size_t size = stream_vbyte_delta_encode(neighs.data(),
+					neighs.size(), buf.data());
+			BOOST_CHECK(size <= buf.size());
+			std::vector<uint32_t> decoded(neighs.size());
+			size_t consumed = stream_vbyte_delta_decode(buf.data(), size,
+					neighs.size(), decoded.data());
+			BOOST_CHECK_EQUAL(consumed, size);
+			BOOST_CHECK(decoded == neighs);
+		}
+	}
+
+	// Unsorted lists should also be decoded correctly.
+	std::vector<uint32_t> neighs(1000);
+	for (size_t i = 0; i < neighs.size(); i++)
+		neighs[i] = random();
+	std::vector<uint8_t> buf(stream_vbyte_max_size(neighs.size()));
+	size_t size = stream_vbyte_delta_encode(neighs.data(), neighs.size(),
+			buf.data());
+	std::vector<uint32_t> decoded(neighs.size());
+	stream_vbyte_delta_decode(buf.data(), size, neighs.size(), decoded.data());
+	BOOST_CHECK(decoded == neighs);
+}
+
+static void check_vertex(const ext_mem_undirected_vertex &v,
+		const std::vector<uint32_t> &neighs, vertex_id_t id)
+{
+	BOOST_CHECK_EQUAL(v.get_id(), id);
+	BOOST_CHECK_EQUAL(v.get_num_edges(), neighs.size());
+	for (size_t i = 0; i < neighs.size(); i++) {
+		BOOST_CHECK_EQUAL(v.get_neighbor(i), neighs[i]);
+		if (v.has_edge_data())
+			BOOST_CHECK_EQUAL(v.get_edge_data<double>(i), (double) i);
+	}
+}
+
+static void test_vertex(size_t num_edges, uint32_t edge_data_size)
+{
+	std::vector<uint32_t> neighs = gen_neighbors(num_edges, 1000);
+	vertex_id_t id = random() % 1000;
+	std::vector<char> raw_buf(ext_mem_undirected_vertex::num_edges2vsize(
+				num_edges, edge_data_size));
+	ext_mem_undirected_vertex *v = new (raw_buf.data())
+		ext_mem_undirected_vertex(id, num_edges, edge_data_size);
+	for (size_t i = 0; i < num_edges; i++) {
+		v->set_neighbor(i, neighs[i]);
+		if (edge_data_size > 0)
+			*(double *) v->get_raw_edge_data(i) = i;
+	}
+
+	// Put the compressed vertex at the end of a page, so it crosses
+	// the page boundary.
+	size_t max_size = ext_mem_compressed_vertex::get_max_size(num_edges,
+			edge_data_size);
+	off_t off_in_page = safs::PAGE_SIZE - 20;
+	std::vector<char> comp_buf(off_in_page + max_size);
+	size_t size = ext_mem_compressed_vertex::compress(*v,
+			comp_buf.data() + off_in_page, max_size);
+	BOOST_CHECK(size <= max_size);
+	if (num_edges > 100 && edge_data_size == 0)
+		BOOST_CHECK(size < v->get_size());
+
+	const ext_mem_compressed_vertex *cv
+		= (const ext_mem_compressed_vertex *) (comp_buf.data() + off_in_page);
+	BOOST_CHECK_EQUAL(cv->get_size(), size);
+	BOOST_CHECK_EQUAL(cv->get_decompressed_size(), v->get_size());
+	std::vector<char> dec_buf(cv->get_decompressed_size());
+	cv->decompress(dec_buf.data(), dec_buf.size());
+	check_vertex(*(const ext_mem_undirected_vertex *) dec_buf.data(), neighs,
+			id);
+
+	mem_byte_array arr(comp_buf.data(), off_in_page, size);
+	std::vector<char> buf;
+	decompressed_byte_array dec_arr;
+	dec_arr.init(arr, buf);
+	BOOST_CHECK_EQUAL(dec_arr.get_compressed_size(), size);
+	BOOST_CHECK_EQUAL(dec_arr.get_size(), v->get_size());
+	BOOST_CHECK_EQUAL(dec_arr.get_offset(), off_in_page);
+	page_undirected_vertex pg_v(dec_arr);
+	BOOST_CHECK_EQUAL(pg_v.get_id(), id);
+	BOOST_CHECK_EQUAL(pg_v.get_num_edges(), num_edges);
+	edge_seq_iterator it = pg_v.get_neigh_seq_it(edge_type::IN_EDGE);
+	for (size_t i = 0; i < num_edges; i++) {
+		BOOST_CHECK(it.has_next());
+		BOOST_CHECK_EQUAL(it.next(), neighs[i]);
+	}
+	BOOST_CHECK(!it.has_next());
+	std::vector<vertex_id_t> edges(num_edges);
+	BOOST_CHECK_EQUAL(pg_v.read_edges(edge_type::IN_EDGE, edges.data(),
+				num_edges), num_edges);
+	BOOST_CHECK(std::equal(edges.begin(), edges.end(), neighs.begin()));
+
+	// The clone keeps the vertex after the buffer is reused.
+	safs::page_byte_array *copy = dec_arr.clone();
+	BOOST_REQUIRE(copy);
+	buf.assign(buf.size(), 0);
+	BOOST_CHECK_EQUAL(copy->get_size(), dec_arr.get_size());
+	BOOST_CHECK_EQUAL(copy->get_offset(), off_in_page);
+	page_undirected_vertex copy_v(*copy);
+	BOOST_CHECK_EQUAL(copy_v.get_id(), id);
+	BOOST_CHECK_EQUAL(copy_v.read_edges(edge_type::IN_EDGE, edges.data(),
+				num_edges), num_edges);
+	BOOST_CHECK(std::equal(edges.begin(), edges.end(), neighs.begin()));
+	safs::page_byte_array::destroy(copy);
+}
+
+BOOST_AUTO_TEST_CASE (test_compressed_vertex)
+{
+	size_t nums[] = {0, 1, 7, 1000, 5000};
+	for (size_t i = 0; i < sizeof(nums) / sizeof(nums[0]); i++) {
+		test_vertex(nums[i], 0);
+		test_vertex(nums[i], sizeof(double));
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END( )
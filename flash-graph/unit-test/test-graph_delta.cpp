@@ -0,0 +1,224 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#define BOOST_TEST_MODULE graph_delta
+#include <boost/test/included/unit_test.hpp>
+
+#include "graph_delta.h"
+
+using namespace fg;
+
+/*
+ * A byte array on a memory buffer. The buffer starts at the beginning
+ * of a page.
+ */
+class mem_byte_array: public safs::page_byte_array
+{
+	const char *buf;
+	off_t off_in_page;
+	size_t size;
+public:
+	mem_byte_array(const char *buf, off_t off_in_page, size_t size) {
+		this->buf = buf;
+		this->off_in_page = off_in_page;
+		this->size = size;
+	}
+
+	virtual void lock() {
+	}
+
+	virtual void unlock() {
+	}
+
+	virtual size_t get_size() const {
+		return size;
+	}
+
+	virtual page_byte_array *clone() {
+		return NULL;
+	}
+
+	virtual off_t get_offset() const {
+		return off_in_page;
+	}
+
+	virtual off_t get_offset_in_first_page() const {
+		return off_in_page;
+	}
+
+	virtual const char *get_page(int idx) const {
+		return buf + ((size_t) idx) * safs::PAGE_SIZE;
+	}
+};
+
+const size_t NUM_VERTICES = 1000;
+
+static std::string get_log_file()
+{
+	char name[] = "/tmp/test-graph_delta.XXXXXX";
+	int fd = mkstemp(name);
+	close(fd);
+	unlink(name);
+	return name;
+}
+
+BOOST_AUTO_TEST_SUITE (graph_delta_test)
+
+BOOST_AUTO_TEST_CASE (test_snapshot)
+{
+	std::string log_file = get_log_file();
+	graph_header header(graph_type::DIRECTED, NUM_VERTICES, 0, sizeof(int));
+	graph_delta::ptr delta = graph_delta::create(header, log_file);
+	BOOST_REQUIRE(delta);
+	delta_snapshot::ptr empty = delta->get_snapshot();
+	BOOST_CHECK(empty->empty());
+
+	for (int i = 0; i < 100; i++)
+		BOOST_CHECK(delta->add_edge(i % 10, 100 - i, &i));
+	// The vertices don't exist.
+	int data = 0;
+	BOOST_CHECK(!delta->add_edge(NUM_VERTICES, 0, &data));
+	BOOST_CHECK_EQUAL(delta->get_num_edges(), 100U);
+
+	delta_snapshot::ptr snapshot = delta->get_snapshot();
+	BOOST_CHECK_EQUAL(snapshot->get_num_edges(), 100U);
+	for (vertex_id_t i = 0; i < 10; i++) {
+		const vertex_delta *out = snapshot->get_delta(i, edge_type::OUT_EDGE);
+		BOOST_REQUIRE(out);
+		BOOST_CHECK_EQUAL(out->neighs.size(), 10U);
+		BOOST_CHECK(std::is_sorted(out->neighs.begin(), out->neighs.end()));
+		for (size_t j = 0; j < out->neighs.size(); j++)
+			BOOST_CHECK_EQUAL(((const int *) out->data.data())[j],
+					100 - (int) out->neighs[j]);
+		BOOST_CHECK_EQUAL(snapshot->get_num_edges(i, edge_type::BOTH_EDGES),
+				i > 0 ? 11U : 10U);
+	}
+	BOOST_CHECK(snapshot->get_delta(1, edge_type::IN_EDGE));
+	BOOST_CHECK(snapshot->get_delta(50, edge_type::OUT_EDGE) == NULL);
+
+	// The old snapshots don't see new edges.
+	data = 5;
+	BOOST_CHECK(delta->add_edge(500, 501, &data));
+	BOOST_CHECK(delta->get_snapshot()->get_delta(500, edge_type::OUT_EDGE));
+	BOOST_CHECK(snapshot->get_delta(500, edge_type::OUT_EDGE) == NULL);
+	BOOST_CHECK(empty->empty());
+	BOOST_CHECK(delta->flush());
+
+	// Replay the log.
+	graph_delta::ptr delta2 = graph_delta::create(header, log_file);
+	BOOST_REQUIRE(delta2);
+	BOOST_CHECK_EQUAL(delta2->get_num_edges(), 101U);
+	snapshot = delta2->get_snapshot();
+	const vertex_delta *in = snapshot->get_delta(501, edge_type::IN_EDGE);
+	BOOST_REQUIRE(in);
+	BOOST_CHECK_EQUAL(in->neighs.size(), 1U);
+	BOOST_CHECK_EQUAL(in->neighs[0], 500U);
+	BOOST_CHECK_EQUAL(*(const int *) in->data.data(), 5);
+
+	// A log of a different graph is rejected.
+	graph_header header2(graph_type::UNDIRECTED, NUM_VERTICES, 0, sizeof(int));
+	BOOST_CHECK(graph_delta::create(header2, log_file) == NULL);
+	unlink(log_file.c_str());
+}
+
+BOOST_AUTO_TEST_CASE (test_undirected)
+{
+	std::string log_file = get_log_file();
+	graph_header header(graph_type::UNDIRECTED, NUM_VERTICES, 0, 0);
+	graph_delta::ptr delta = graph_delta::create(header, log_file);
+	BOOST_REQUIRE(delta);
+	BOOST_CHECK(delta->add_edge(3, 7));
+	delta_snapshot::ptr snapshot = delta->get_snapshot();
+	// The edge type is ignored in an undirected graph.
+	BOOST_CHECK_EQUAL(snapshot->get_num_edges(3, edge_type::IN_EDGE), 1U);
+	BOOST_CHECK_EQUAL(snapshot->get_num_edges(7, edge_type::OUT_EDGE), 1U);
+	BOOST_CHECK_EQUAL(snapshot->get_delta(7, edge_type::BOTH_EDGES)->neighs[0],
+			3U);
+	unlink(log_file.c_str());
+}
+
+static void test_merge(size_t num_edges, size_t num_new_edges)
+{
+	std::string log_file = get_log_file();
+	graph_header header(graph_type::UNDIRECTED, NUM_VERTICES, 0,
+			sizeof(double));
+	graph_delta::ptr delta = graph_delta::create(header, log_file);
+	BOOST_REQUIRE(delta);
+
+	vertex_id_t id = 10;
+	std::vector<vertex_id_t> neighs(num_edges);
+	for (size_t i = 0; i < num_edges; i++)
+		neighs[i] = random() % NUM_VERTICES;
+	std::sort(neighs.begin(), neighs.end());
+	std::vector<char> raw_buf(ext_mem_undirected_vertex::num_edges2vsize(
+				num_edges, sizeof(double)));
+	ext_mem_undirected_vertex *v = new (raw_buf.data())
+		ext_mem_undirected_vertex(id, num_edges, sizeof(double));
+	for (size_t i = 0; i < num_edges; i++) {
+		v->set_neighbor(i, neighs[i]);
+		*(double *) v->get_raw_edge_data(i) = neighs[i];
+	}
+	for (size_t i = 0; i < num_new_edges; i++) {
+		vertex_id_t neigh = random() % NUM_VERTICES;
+		double data = neigh;
+		BOOST_CHECK(delta->add_edge(id, neigh, &data));
+		neighs.push_back(neigh);
+		// A self edge is in the edge list twice in an undirected graph.
+		if (neigh == id)
+			neighs.push_back(neigh);
+	}
+	std::sort(neighs.begin(), neighs.end());
+
+	// Put the vertex at the end of a page, so it crosses the page boundary.
+	off_t off_in_page = safs::PAGE_SIZE - 24;
+	std::vector<char> page_buf(off_in_page + raw_buf.size());
+	memcpy(page_buf.data() + off_in_page, raw_buf.data(), raw_buf.size());
+	mem_byte_array arr(page_buf.data(), off_in_page, raw_buf.size());
+	delta_snapshot::ptr snapshot = delta->get_snapshot();
+	const vertex_delta *v_delta = snapshot->get_delta(id, edge_type::OUT_EDGE);
+	BOOST_REQUIRE(v_delta);
+	std::vector<char> buf;
+	merged_byte_array merged;
+	merged.init(arr, *v_delta, sizeof(double), buf);
+	BOOST_CHECK_EQUAL(merged.get_offset(), off_in_page);
+
+	page_undirected_vertex pg_v(merged);
+	BOOST_CHECK_EQUAL(pg_v.get_id(), id);
+	BOOST_CHECK_EQUAL(pg_v.get_num_edges(), neighs.size());
+	edge_seq_iterator it = pg_v.get_neigh_seq_it(edge_type::OUT_EDGE);
+	safs::page_byte_array::seq_const_iterator<double> data_it
+		= pg_v.get_data_seq_it<double>();
+	for (size_t i = 0; i < neighs.size(); i++) {
+		BOOST_CHECK(it.has_next());
+		BOOST_CHECK_EQUAL(it.next(), neighs[i]);
+		BOOST_CHECK(data_it.has_next());
+		BOOST_CHECK_EQUAL(data_it.next(), (double) neighs[i]);
+	}
+	BOOST_CHECK(!it.has_next());
+
+	// The clone keeps the vertex after the buffer is reused.
+	safs::page_byte_array *copy = merged.clone();
+	BOOST_REQUIRE(copy);
+	buf.assign(buf.size(), 0);
+	page_undirected_vertex copy_v(*copy);
+	BOOST_CHECK_EQUAL(copy_v.get_id(), id);
+	BOOST_CHECK_EQUAL(copy_v.get_num_edges(), neighs.size());
+	it = copy_v.get_neigh_seq_it(edge_type::OUT_EDGE);
+	for (size_t i = 0; i < neighs.size(); i++)
+		BOOST_CHECK_EQUAL(it.next(), neighs[i]);
+	safs::page_byte_array::destroy(copy);
+	unlink(log_file.c_str());
+}
+
+BOOST_AUTO_TEST_CASE (test_merged_byte_array)
+{
+	test_merge(0, 1);
+	test_merge(5, 3);
+	test_merge(2000, 1);
+	test_merge(2000, 500);
+}
+
+BOOST_AUTO_TEST_SUITE_END( )
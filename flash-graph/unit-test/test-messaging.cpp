@@ -0,0 +1,218 @@
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#define BOOST_TEST_MODULE messaging
+#include <boost/test/included/unit_test.hpp>
+
+#include "messaging.h"
+
+using namespace fg;
+
+class count_message: public vertex_message
+{
+	int count;
+public:
+	count_message(int count, bool activate): vertex_message(
+			sizeof(count_message), activate) {
+		this->count = count;
+	}
+
+	int get_value() const {
+		return count;
+	}
+
+	void set_value(int count) {
+		this->count = count;
+	}
+};
+
+/*
+ * A message of another type with the same size as count_message.
+ */
+class id_message: public vertex_message
+{
+	int id;
+public:
+	id_message(int id): vertex_message(sizeof(id_message), false) {
+		this->id = id;
+	}
+
+	int get_id() const {
+		return id;
+	}
+};
+
+typedef msg_combiner_impl<count_message, sum_msg_op<count_message> >
+	sum_combiner;
+typedef msg_combiner_impl<count_message, min_msg_op<count_message> >
+	min_combiner;
+
+/*
+ * Get the messages from the queue and merge the messages to the same
+ * vertex.
+ */
+static size_t fetch_msgs(msg_queue &queue, std::map<vertex_id_t, int> &values,
+		std::map<vertex_id_t, bool> &activates)
+{
+	size_t num_msgs = 0;
+	message msg;
+	while (queue.fetch(&msg, 1) == 1) {
+		vertex_message *v_msgs[64];
+		while (msg.has_next()) {
+			int num = msg.get_next(v_msgs, 64);
+			for (int i = 0; i < num; i++) {
+				count_message *cmsg = (count_message *) v_msgs[i];
+				values[cmsg->get_dest().id] += cmsg->get_value();
+				activates[cmsg->get_dest().id] = activates[cmsg->get_dest().id]
+					|| cmsg->is_activate();
+			}
+			num_msgs += num;
+		}
+	}
+	return num_msgs;
+}
+
+BOOST_AUTO_TEST_SUITE (messaging_test)
+
+BOOST_AUTO_TEST_CASE (test_combining_msg_sender)
+{
+	// There are more vertices than the messages that can be buffered
+	// in the combining sender.
+	const int num_vertices = 10000;
+	std::shared_ptr<slab_allocator> alloc(new slab_allocator("test-msg-alloc",
+				4096, 1024 * 1024, INT_MAX, -1));
+	msg_queue *queue = msg_queue::create(-1, "test-queue", 16, INT_MAX);
+	simple_msg_sender *sender = simple_msg_sender::create(0, alloc, queue);
+	combining_msg_sender *csender = combining_msg_sender::create(sender,
+			sum_combiner::create());
+
+	std::map<vertex_id_t, int> exp_values;
+	std::map<vertex_id_t, bool> exp_activates;
+	size_t num_sent = 0;
+	for (int i = 0; i < 100000; i++) {
+		vertex_id_t dest = random() % num_vertices;
+		bool activate = random() % 10 == 0;
+		count_message msg(i % 7, activate);
+		msg.set_combinable(true);
+		msg.set_dest(local_vid_t(dest));
+		csender->send(msg);
+		num_sent++;
+		exp_values[dest] += i % 7;
+		exp_activates[dest] = exp_activates[dest] || activate;
+
+		if (i == 50000) {
+			csender->flush();
+			sender->flush();
+			std::map<vertex_id_t, int> values;
+			std::map<vertex_id_t, bool> activates;
+			BOOST_CHECK(fetch_msgs(*queue, values, activates) < num_sent);
+			BOOST_CHECK(values == exp_values);
+			BOOST_CHECK(activates == exp_activates);
+			exp_values.clear();
+			exp_activates.clear();
+		}
+	}
+	csender->flush();
+	sender->flush();
+	std::map<vertex_id_t, int> values;
+	std::map<vertex_id_t, bool> activates;
+	BOOST_CHECK(fetch_msgs(*queue, values, activates) < num_sent);
+	BOOST_CHECK(values == exp_values);
+	BOOST_CHECK(activates == exp_activates);
+	BOOST_CHECK_EQUAL(csender->get_num_sent(), num_sent);
+	BOOST_CHECK(csender->get_num_combined() > 0);
+	csender->reset_stats();
+	BOOST_CHECK_EQUAL(csender->get_num_sent(), 0U);
+
+	combining_msg_sender::destroy(csender);
+	simple_msg_sender::destroy(sender);
+	msg_queue::destroy(queue);
+}
+
+BOOST_AUTO_TEST_CASE (test_min_combiner)
+{
+	std::shared_ptr<slab_allocator> alloc(new slab_allocator("test-msg-alloc",
+				4096, 1024 * 1024, INT_MAX, -1));
+	msg_queue *queue = msg_queue::create(-1, "test-queue", 16, INT_MAX);
+	simple_msg_sender *sender = simple_msg_sender::create(0, alloc, queue);
+	combining_msg_sender *csender = combining_msg_sender::create(sender,
+			min_combiner::create());
+	for (int i = 10; i > 0; i--) {
+		count_message msg(i, false);
+		msg.set_combinable(true);
+		msg.set_dest(local_vid_t(i % 2));
+		csender->send(msg);
+	}
+	csender->flush();
+	sender->flush();
+	std::map<vertex_id_t, int> values;
+	std::map<vertex_id_t, bool> activates;
+	// Each vertex receives one message.
+	BOOST_CHECK_EQUAL(fetch_msgs(*queue, values, activates), 2U);
+	BOOST_CHECK_EQUAL(values[0], 2);
+	BOOST_CHECK_EQUAL(values[1], 1);
+	BOOST_CHECK_EQUAL(csender->get_num_combined(), 8U);
+
+	combining_msg_sender::destroy(csender);
+	simple_msg_sender::destroy(sender);
+	msg_queue::destroy(queue);
+}
+
+BOOST_AUTO_TEST_CASE (test_combine_tagged_msgs)
+{
+	std::shared_ptr<slab_allocator> alloc(new slab_allocator("test-msg-alloc",
+				4096, 1024 * 1024, INT_MAX, -1));
+	msg_queue *queue = msg_queue::create(-1, "test-queue", 16, INT_MAX);
+	simple_msg_sender *sender = simple_msg_sender::create(0, alloc, queue);
+	combining_msg_sender *csender = combining_msg_sender::create(sender,
+			sum_combiner::create());
+	// Both types of messages have the same size, but only the count
+	// messages are marked combinable.
+	BOOST_CHECK_EQUAL(sizeof(id_message), sizeof(count_message));
+	for (int i = 0; i < 10; i++) {
+		count_message cmsg(1, false);
+		cmsg.set_combinable(true);
+		cmsg.set_dest(local_vid_t(i % 2));
+		csender->send(cmsg);
+		id_message imsg(i);
+		imsg.set_dest(local_vid_t(i % 2));
+		csender->send(imsg);
+	}
+	csender->flush();
+	sender->flush();
+
+	std::map<vertex_id_t, int> counts;
+	std::vector<int> ids;
+	message msg;
+	while (queue->fetch(&msg, 1) == 1) {
+		vertex_message *v_msgs[64];
+		while (msg.has_next()) {
+			int num = msg.get_next(v_msgs, 64);
+			for (int i = 0; i < num; i++) {
+				if (v_msgs[i]->is_combinable())
+					counts[v_msgs[i]->get_dest().id]
+						+= ((count_message *) v_msgs[i])->get_value();
+				else
+					ids.push_back(((id_message *) v_msgs[i])->get_id());
+			}
+		}
+	}
+	// The count messages to each vertex are combined into one.
+	BOOST_CHECK_EQUAL(counts.size(), 2U);
+	BOOST_CHECK_EQUAL(counts[0], 5);
+	BOOST_CHECK_EQUAL(counts[1], 5);
+	BOOST_CHECK_EQUAL(csender->get_num_sent(), 10U);
+	BOOST_CHECK_EQUAL(csender->get_num_combined(), 8U);
+	// All id messages are delivered intact.
+	std::sort(ids.begin(), ids.end());
+	BOOST_CHECK_EQUAL(ids.size(), 10U);
+	for (size_t i = 0; i < ids.size(); i++)
+		BOOST_CHECK_EQUAL(ids[i], (int) i);
+
+	combining_msg_sender::destroy(csender);
+	simple_msg_sender::destroy(sender);
+	msg_queue::destroy(queue);
+}
+
+BOOST_AUTO_TEST_SUITE_END( )
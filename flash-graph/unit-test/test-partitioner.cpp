@@ -7,37 +7,95 @@ using namespace fg;
 const int num_parts = 16;
 const int M = 1024 * 1024;
 
+void check_partitioner(graph_partitioner &partitioner, size_t num_vertices)
+{
+	std::vector<vertex_id_t> parts[num_parts];
+	printf("there are %ld vertices\n", num_vertices);
+	for (int i = 0; i < num_parts; i++) {
+		partitioner.get_all_vertices_in_part(i, num_vertices, parts[i]);
+		size_t computed_part_size = partitioner.get_part_size(i,
+				num_vertices);
+		assert(computed_part_size == parts[i].size());
+	}
+	for (vertex_id_t id = 0; id < num_vertices; id++) {
+		int part_id;
+		off_t off;
+		partitioner.map2loc(id, part_id, off);
+		assert(part_id == partitioner.map(id));
+		assert(parts[part_id][off] == id);
+	}
+	for (int part_id = 0; part_id < num_parts; part_id++) {
+		for (off_t off = 0; off < parts[part_id].size(); off++) {
+			vertex_id_t id;
+			partitioner.loc2map(part_id, off, id);
+			assert(id == parts[part_id][off]);
+		}
+	}
+	size_t tot = 0;
+	for (int i = 0; i < num_parts; i++)
+		tot += parts[i].size();
+	printf("There are %ld vertices in all partitions\n", tot);
+	assert(num_vertices == tot);
+}
+
 void test_partitioner(graph_partitioner &partitioner)
 {
 	for (int k = 0; k < 100; k++) {
-		std::vector<vertex_id_t> parts[num_parts];
 		size_t num_vertices = random() % M + M;
-		printf("there are %ld vertices\n", num_vertices);
-		for (int i = 0; i < num_parts; i++) {
-			partitioner.get_all_vertices_in_part(i, num_vertices, parts[i]);
-			size_t computed_part_size = partitioner.get_part_size(i,
-					num_vertices);
-			assert(computed_part_size == parts[i].size());
-		}
-		for (vertex_id_t id = 0; id < num_vertices; id++) {
-			int part_id;
-			off_t off;
-			partitioner.map2loc(id, part_id, off);
-			assert(part_id == partitioner.map(id));
-			assert(parts[part_id][off] == id);
+		check_partitioner(partitioner, num_vertices);
+	}
+}
+
+struct degree_func
+{
+	const std::vector<size_t> &degrees;
+
+	degree_func(const std::vector<size_t> &_degrees): degrees(_degrees) {
+	}
+
+	size_t operator()(vertex_id_t id) const {
+		return degrees[id];
+	}
+};
+
+void test_edge_balanced_partitioner()
+{
+	const int num_nodes = 4;
+	for (int k = 0; k < 10; k++) {
+		size_t num_vertices = random() % M + M;
+		// The degrees follow a power law roughly, and a few vertices
+		// have a very large degree.
+		std::vector<size_t> degrees(num_vertices);
+		size_t tot_weight = 0;
+		size_t max_weight = 0;
+		for (size_t i = 0; i < num_vertices; i++) {
+			degrees[i] = M / (random() % M + 1);
+			tot_weight += degrees[i] + 1;
+			max_weight = std::max(max_weight, degrees[i] + 1);
 		}
-		for (int part_id = 0; part_id < num_parts; part_id++) {
-			for (off_t off = 0; off < parts[part_id].size(); off++) {
-				vertex_id_t id;
-				partitioner.loc2map(part_id, off, id);
-				assert(id == parts[part_id][off]);
+		edge_balanced_graph_partitioner partitioner(num_parts, num_nodes,
+				num_vertices, degree_func(degrees));
+		check_partitioner(partitioner, num_vertices);
+
+		int parts_per_node = num_parts / num_nodes;
+		vertex_id_t prev_end = 0;
+		for (int i = 0; i < num_parts; i++) {
+			// The ranges are ordered by NUMA nodes, and partition i runs
+			// on node i % num_nodes.
+			int part_id = (i % parts_per_node) * num_nodes + i / parts_per_node;
+			std::vector<vertex_id_t> ids;
+			partitioner.get_all_vertices_in_part(part_id, num_vertices, ids);
+			size_t weight = 0;
+			for (size_t j = 0; j < ids.size(); j++) {
+				assert(ids[j] == prev_end + j);
+				weight += degrees[ids[j]] + 1;
 			}
+			prev_end += ids.size();
+			// A partition gets its share, except that the last vertex and
+			// the alignment of the range may be added to it.
+			assert(weight <= tot_weight / num_parts + 65 * max_weight);
 		}
-		size_t tot = 0;
-		for (int i = 0; i < num_parts; i++)
-			tot += parts[i].size();
-		printf("There are %ld vertices in all partitions\n", tot);
-		assert(num_vertices == tot);
+		assert(prev_end == num_vertices);
 	}
 }
 
@@ -51,4 +109,6 @@ int main()
 	modulo_graph_partitioner m_partitioner(num_parts);
 	test_partitioner(m_partitioner);
 
+	printf("test edge_balanced_graph_partitioner\n");
+	test_edge_balanced_partitioner();
 }
@@ -0,0 +1,191 @@
+#include <stdlib.h>
+
+#include <map>
+#include <vector>
+
+#include "set_intersection.h"
+
+using namespace fg;
+
+/*
+ * A byte array whose pages are scattered in memory.
+ */
+class scattered_byte_array: public safs::page_byte_array
+{
+	std::vector<char *> pages;
+	off_t off_in_page;
+	size_t size;
+public:
+	scattered_byte_array(const std::vector<vertex_id_t> &ids,
+			off_t off_in_page) {
+		this->off_in_page = off_in_page;
+		this->size = ids.size() * sizeof(vertex_id_t);
+		size_t num_pages = ROUNDUP(off_in_page + size, safs::PAGE_SIZE)
+			/ safs::PAGE_SIZE;
+		for (size_t i = 0; i < num_pages; i++)
+			pages.push_back(new char[safs::PAGE_SIZE]);
+		const char *src = (const char *) ids.data();
+		for (size_t off = 0; off < size; off += sizeof(vertex_id_t)) {
+			size_t loc = off_in_page + off;
+			::memcpy(pages[loc / safs::PAGE_SIZE] + loc % safs::PAGE_SIZE,
+					src + off, sizeof(vertex_id_t));
+		}
+	}
+
+	~scattered_byte_array() {
+		for (size_t i = 0; i < pages.size(); i++)
+			delete [] pages[i];
+	}
+
+	virtual void lock() {
+	}
+
+	virtual void unlock() {
+	}
+
+	virtual size_t get_size() const {
+		return size;
+	}
+
+	virtual page_byte_array *clone() {
+		return NULL;
+	}
+
+	virtual off_t get_offset() const {
+		return off_in_page;
+	}
+
+	virtual off_t get_offset_in_first_page() const {
+		return off_in_page;
+	}
+
+	virtual const char *get_page(int idx) const {
+		return pages[idx];
+	}
+};
+
+/*
+ * Generate a sorted list. If `dup' is true, the list may have duplicates.
+ */
+std::vector<vertex_id_t> gen_list(size_t num, vertex_id_t max_id, bool dup)
+{
+	std::vector<vertex_id_t> ids(num);
+	for (size_t i = 0; i < num; i++)
+		ids[i] = random() % max_id;
+	std::sort(ids.begin(), ids.end());
+	if (!dup)
+		ids.resize(std::unique(ids.begin(), ids.end()) - ids.begin());
+	return ids;
+}
+
+typedef std::map<uint32_t, uint32_t> match_map;
+
+match_map get_expected(const std::vector<vertex_id_t> &a,
+		const std::vector<vertex_id_t> &b)
+{
+	match_map matches;
+	for (size_t i = 0; i < b.size(); i++) {
+		auto it = std::lower_bound(a.begin(), a.end(), b[i]);
+		if (it != a.end() && *it == b[i])
+			matches[it - a.begin()]++;
+	}
+	return matches;
+}
+
+typedef size_t (*intersect_func)(const vertex_id_t a[], size_t na,
+		const vertex_id_t b[], size_t nb, uint32_t a_idxs[], uint32_t counts[]);
+
+void check_kernel(intersect_func func, const std::vector<vertex_id_t> &a,
+		const std::vector<vertex_id_t> &b, const match_map &expected)
+{
+	std::vector<uint32_t> a_idxs(std::min(a.size(), b.size()));
+	std::vector<uint32_t> counts(a_idxs.size());
+	size_t num = func(a.data(), a.size(), b.data(), b.size(), a_idxs.data(),
+			counts.data());
+	assert(num == expected.size());
+	auto it = expected.begin();
+	for (size_t i = 0; i < num; i++, it++) {
+		assert(a_idxs[i] == it->first);
+		assert(counts[i] == it->second);
+	}
+}
+
+struct collect_matches
+{
+	std::vector<std::pair<uint32_t, uint32_t> > matches;
+
+	void operator()(uint32_t idx, uint32_t num) {
+		matches.push_back(std::pair<uint32_t, uint32_t>(idx, num));
+	}
+
+	void check(const match_map &expected) const {
+		assert(matches.size() == expected.size());
+		auto it = expected.begin();
+		for (size_t i = 0; i < matches.size(); i++, it++) {
+			assert(matches[i].first == it->first);
+			assert(matches[i].second == it->second);
+		}
+	}
+};
+
+void check_list(const sorted_id_list &list, const std::vector<vertex_id_t> &b,
+		const match_map &expected)
+{
+	for (size_t i = 0; i < b.size(); i++) {
+		uint32_t idx;
+		bool found = list.find(b[i], idx);
+		const vertex_id_t *loc = std::lower_bound(list.data(),
+				list.data() + list.size(), b[i]);
+		assert(found == (loc != list.data() + list.size() && *loc == b[i]));
+		assert(!found || idx == (uint32_t) (loc - list.data()));
+	}
+
+	collect_matches arr_matches;
+	size_t num = list.intersect(b.data(), b.size(), arr_matches);
+	assert(num == expected.size());
+	arr_matches.check(expected);
+
+	scattered_byte_array arr(b, (random() % 1024) * sizeof(vertex_id_t));
+	edge_iterator begin(&arr, 0, arr.get_size());
+	edge_iterator end(&arr, arr.get_size(), arr.get_size());
+	collect_matches page_matches;
+	num = list.intersect(begin, end, page_matches);
+	assert(num == expected.size());
+	page_matches.check(expected);
+}
+
+void test_intersection(size_t na, size_t nb, vertex_id_t max_id)
+{
+	std::vector<vertex_id_t> a = gen_list(na, max_id, false);
+	std::vector<vertex_id_t> b = gen_list(nb, max_id, true);
+	match_map expected = get_expected(a, b);
+
+	check_kernel(intersect_merge, a, b, expected);
+	check_kernel(intersect_block, a, b, expected);
+	check_kernel(intersect_gallop, a, b, expected);
+	check_kernel(intersect_sorted, a, b, expected);
+
+	sorted_id_list list(a.data(), a.size());
+	check_list(list, b, expected);
+	list.build_index();
+	assert(a.empty() || list.has_index());
+	check_list(list, b, expected);
+}
+
+int main()
+{
+	size_t sizes[] = {0, 1, 3, 8, 17, 100, 1000, 5000, 100000};
+	size_t num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+	for (size_t i = 0; i < num_sizes; i++) {
+		for (size_t j = 0; j < num_sizes; j++) {
+			printf("intersect lists with %ld and %ld elements\n",
+					sizes[i], sizes[j]);
+			// A small range of IDs gives many matches and duplicates,
+			// and a large range of IDs gives sparse lists, which are
+			// indexed by a hash table.
+			test_intersection(sizes[i], sizes[j], 1000);
+			test_intersection(sizes[i], sizes[j], 200000);
+			test_intersection(sizes[i], sizes[j], 100000000);
+		}
+	}
+}
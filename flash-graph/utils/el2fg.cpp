@@ -57,6 +57,7 @@ void print_usage()
 	fprintf(stderr, "-g size: groupby buffer size\n");
 	fprintf(stderr, "-t type: the edge attribute type\n");
 	fprintf(stderr, "-d delim: specified the string as delimiter\n");
+	fprintf(stderr, "-c: compress the edge lists\n");
 }
 
 int main(int argc, char *argv[])
@@ -64,13 +65,14 @@ int main(int argc, char *argv[])
 	bool directed = true;
 	bool in_mem = true;
 	bool uniq_edge = false;
+	bool compress = false;
 	size_t sort_buf_size = 1UL * 1024 * 1024 * 1024;
 	size_t groupby_buf_size = 1UL * 1024 * 1024 * 1024;
 	int opt;
 	int num_opts = 0;
 	std::string edge_attr_type;
 	std::string delim = "auto";
-	while ((opt = getopt(argc, argv, "uUes:g:t:d:")) != -1) {
+	while ((opt = getopt(argc, argv, "uUes:g:t:d:c")) != -1) {
 		num_opts++;
 		switch (opt) {
 			case 'u':
@@ -98,6 +100,9 @@ int main(int argc, char *argv[])
 				delim = optarg;
 				num_opts++;
 				break;
+			case 'c':
+				compress = true;
+				break;
 			default:
 				print_usage();
 				exit(1);
@@ -110,6 +115,10 @@ int main(int argc, char *argv[])
 		print_usage();
 		exit(1);
 	}
+	if (compress && !in_mem) {
+		fprintf(stderr, "only an in-memory graph can be compressed\n");
+		exit(1);
+	}
 
 	std::string conf_file = argv[0];
 	std::string file_name = argv[1];
@@ -141,6 +150,7 @@ int main(int argc, char *argv[])
 			matrix_conf.get_sort_buf_size(), matrix_conf.get_groupby_buf_size());
 	fg::set_deduplicate(uniq_edge);
 
+	int ret = 0;
 	{
 		struct timeval start, end;
 		/*
@@ -163,12 +173,21 @@ int main(int argc, char *argv[])
 		printf("start to construct FlashGraph graph\n");
 		fg::FG_graph::ptr graph = create_fg_graph(graph_name, el);
 
-		if (graph && graph->get_index_data())
-			graph->get_index_data()->dump(index_file);
-		if (graph && graph->get_graph_data())
-			graph->get_graph_data()->dump(adj_file);
+		if (graph && compress) {
+			if (!fg::export_compressed_graph(graph, adj_file, index_file)) {
+				fprintf(stderr, "can't export the compressed graph to %s and %s\n",
+						adj_file.c_str(), index_file.c_str());
+				ret = -1;
+			}
+		}
+		else {
+			if (graph && graph->get_index_data())
+				graph->get_index_data()->dump(index_file);
+			if (graph && graph->get_graph_data())
+				graph->get_graph_data()->dump(adj_file);
+		}
 	}
 	destroy_flash_matrix();
 
-	return 0;
+	return ret;
 }
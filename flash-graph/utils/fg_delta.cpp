@@ -0,0 +1,171 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "common.h"
+
+#include "FGlib.h"
+#include "graph_delta.h"
+#include "data_io.h"
+
+void print_usage()
+{
+	fprintf(stderr,
+			"add edges to a graph without rebuilding the graph image\n");
+	fprintf(stderr,
+			"fg_delta [options] conf_file graph_file index_file log_file\n");
+	fprintf(stderr, "-a edge_file: append the edges in the text edge list to the log\n");
+	fprintf(stderr, "-t type: the type of the edge data in the edge list (I, L, F, D)\n");
+	fprintf(stderr, "-m new_graph_name: merge the log with the graph image and write\n");
+	fprintf(stderr, "                   new_graph_name.adj and new_graph_name.index\n");
+}
+
+/*
+ * Each line of the edge list has the source vertex, the destination vertex
+ * and optionally the edge data.
+ */
+bool add_edges(fg::graph_delta::ptr delta, const std::string &edge_file,
+		fm::ele_parser::const_ptr parser)
+{
+	std::ifstream in(edge_file.c_str());
+	if (!in) {
+		fprintf(stderr, "can't open %s\n", edge_file.c_str());
+		return false;
+	}
+	std::vector<std::pair<fg::vertex_id_t, fg::vertex_id_t> > edges;
+	std::vector<char> data;
+	size_t data_size = parser ? parser->get_type().get_size() : 0;
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream fields(line);
+		long src, dst;
+		if (!(fields >> src >> dst)) {
+			fprintf(stderr, "wrong edge: %s\n", line.c_str());
+			return false;
+		}
+		edges.push_back(std::pair<fg::vertex_id_t, fg::vertex_id_t>(src, dst));
+		if (parser) {
+			std::string field;
+			if (!(fields >> field)) {
+				fprintf(stderr, "the edge doesn't have data: %s\n", line.c_str());
+				return false;
+			}
+			data.resize(data.size() + data_size);
+			parser->parse(field, data.data() + data.size() - data_size);
+		}
+	}
+	if (!delta->add_edges(edges, parser ? data.data() : NULL))
+		return false;
+	if (!delta->flush())
+		return false;
+	printf("add %ld edges to %s\n", edges.size(), delta->get_log_file().c_str());
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	std::string edge_file;
+	std::string edge_type;
+	std::string new_graph_name;
+	while ((opt = getopt(argc, argv, "a:t:m:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'a':
+				edge_file = optarg;
+				num_opts++;
+				break;
+			case 't':
+				edge_type = optarg;
+				num_opts++;
+				break;
+			case 'm':
+				new_graph_name = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				exit(1);
+		}
+	}
+
+	argv += 1 + num_opts;
+	argc -= 1 + num_opts;
+	if (argc < 4) {
+		print_usage();
+		exit(1);
+	}
+
+	std::string conf_file = argv[0];
+	std::string graph_file = argv[1];
+	std::string index_file = argv[2];
+	std::string log_file = argv[3];
+
+	config_map::ptr configs = config_map::create(conf_file);
+	fg::graph_engine::init_flash_graph(configs);
+	fg::FG_graph::ptr graph = fg::FG_graph::create(graph_file, index_file,
+			configs);
+	const fg::graph_header &header = graph->get_graph_header();
+	fm::ele_parser::const_ptr parser;
+	if (!edge_type.empty()) {
+		if (!fm::valid_ele_type(edge_type)) {
+			fprintf(stderr, "unknown edge data type: %s\n", edge_type.c_str());
+			exit(1);
+		}
+		parser = fm::get_ele_parser(edge_type);
+	}
+	size_t data_size = parser ? parser->get_type().get_size() : 0;
+	if (data_size != (size_t) header.get_edge_data_size()) {
+		fprintf(stderr, "the graph has %d bytes of edge data, but the edge list has %ld bytes\n",
+				header.get_edge_data_size(), data_size);
+		exit(1);
+	}
+
+	fg::graph_delta::ptr delta = fg::graph_delta::create(header, log_file);
+	if (delta == NULL)
+		exit(1);
+	graph->set_delta(delta);
+	if (!edge_file.empty() && !add_edges(delta, edge_file, parser))
+		exit(1);
+	printf("The graph image has %ld edges and the log has %ld edges\n",
+			header.get_num_edges(), delta->get_num_edges());
+
+	if (!new_graph_name.empty()) {
+		struct timeval start, end;
+		gettimeofday(&start, NULL);
+		if (!delta->start_compaction(graph, new_graph_name + ".adj",
+					new_graph_name + ".index"))
+			exit(1);
+		fg::FG_graph::ptr new_graph = delta->finish_compaction();
+		if (new_graph == NULL)
+			exit(1);
+		gettimeofday(&end, NULL);
+		printf("It takes %.3f seconds to merge the log. The new graph has %ld edges\n",
+				time_diff(start, end), new_graph->get_num_edges());
+	}
+	fg::graph_engine::destroy_flash_graph();
+}
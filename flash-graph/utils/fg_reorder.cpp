@@ -0,0 +1,127 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "common.h"
+
+#include "FGlib.h"
+#include "vertex_reorder.h"
+
+void print_usage()
+{
+	fprintf(stderr,
+			"relabel the vertices of a graph to improve the locality of the graph\n");
+	fprintf(stderr,
+			"fg_reorder [options] conf_file graph_file index_file new_graph_name\n");
+	fprintf(stderr, "-o order: degree, bfs, rcm, gorder, community (default: gorder)\n");
+	fprintf(stderr, "-w window: the window size of gorder\n");
+	fprintf(stderr, "-c: compress the edge lists of the new graph\n");
+	fprintf(stderr, "-s: only print the locality of the new order\n");
+	fprintf(stderr, "The tool writes new_graph_name.adj, new_graph_name.index and\n");
+	fprintf(stderr, "new_graph_name.perm, which maps the new vertex IDs to the original ones.\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	std::string order_name = "gorder";
+	int window = 5;
+	bool compress = false;
+	bool stat_only = false;
+	while ((opt = getopt(argc, argv, "o:w:cs")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'o':
+				order_name = optarg;
+				num_opts++;
+				break;
+			case 'w':
+				window = atoi(optarg);
+				num_opts++;
+				break;
+			case 'c':
+				compress = true;
+				break;
+			case 's':
+				stat_only = true;
+				break;
+			default:
+				print_usage();
+				exit(1);
+		}
+	}
+
+	argv += 1 + num_opts;
+	argc -= 1 + num_opts;
+	if (argc < 4) {
+		print_usage();
+		exit(1);
+	}
+
+	std::string conf_file = argv[0];
+	std::string graph_file = argv[1];
+	std::string index_file = argv[2];
+	std::string new_graph_name = argv[3];
+
+	fg::vertex_order order;
+	if (!fg::get_vertex_order(order_name, order)) {
+		fprintf(stderr, "unknown order: %s\n", order_name.c_str());
+		print_usage();
+		exit(1);
+	}
+
+	config_map::ptr configs = config_map::create(conf_file);
+	fg::graph_engine::init_flash_graph(configs);
+	fg::FG_graph::ptr graph = fg::FG_graph::create(graph_file, index_file,
+			configs);
+	if (!graph->is_in_mem()) {
+		fprintf(stderr, "the graph has to be loaded to memory\n");
+		exit(1);
+	}
+	const fg::graph_header &header = graph->get_graph_header();
+	printf("The graph has %ld vertices and %ld edges\n",
+			header.get_num_vertices(), header.get_num_edges());
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	fg::vertex_permutation::ptr perm = fg::reorder_vertices(graph, order,
+			window);
+	if (perm == NULL)
+		exit(1);
+	gettimeofday(&end, NULL);
+	printf("It takes %.3f seconds to compute the %s order\n",
+			time_diff(start, end), order_name.c_str());
+
+	printf("Before reordering:\n");
+	fg::estimate_locality(graph, fg::vertex_permutation::ptr()).print();
+	printf("After reordering:\n");
+	fg::estimate_locality(graph, perm).print();
+	if (stat_only)
+		return 0;
+
+	if (!fg::export_reordered_graph(graph, perm, new_graph_name + ".adj",
+				new_graph_name + ".index", compress))
+		exit(1);
+	if (!perm->dump(new_graph_name + ".perm"))
+		exit(1);
+	fg::graph_engine::destroy_flash_graph();
+}
@@ -736,6 +736,17 @@ class page_directed_vertex: public page_vertex
 	size_t out_size;
 	const safs::page_byte_array *in_array;
 	const safs::page_byte_array *out_array;
+	// The location of the first edge in the byte arrays.
+	off_t in_edge_off;
+	off_t out_edge_off;
+	// Whether the page vertex only contains a range of edges of an edge
+	// list. If so, it doesn't have edge data.
+	bool edge_range;
+
+	void check_edge_data() const {
+		if (edge_range)
+			throw unsupported_exception("edge data of a range of edges");
+	}
 public:
 	static vertex_id_t get_id(const safs::page_byte_array &arr) {
 		BOOST_VERIFY(arr.get_size()
@@ -752,6 +763,9 @@ public:
      */
 	page_directed_vertex(const safs::page_byte_array &arr,
 			bool in_part): page_vertex(true) {
+		in_edge_off = ext_mem_undirected_vertex::get_header_size();
+		out_edge_off = ext_mem_undirected_vertex::get_header_size();
+		edge_range = false;
 		size_t size = arr.get_size();
 		BOOST_VERIFY(size >= ext_mem_undirected_vertex::get_header_size());
 		ext_mem_undirected_vertex v = arr.get<ext_mem_undirected_vertex>(0);
@@ -779,6 +793,9 @@ public:
 
 	page_directed_vertex(const safs::page_byte_array &in_arr,
 			const safs::page_byte_array &out_arr): page_vertex(true) {
+		in_edge_off = ext_mem_undirected_vertex::get_header_size();
+		out_edge_off = ext_mem_undirected_vertex::get_header_size();
+		edge_range = false;
 		this->in_array = &in_arr;
 		this->out_array = &out_arr;
 
@@ -799,6 +816,44 @@ public:
 		num_out_edges = v.get_num_edges();
 	}
 
+	/**
+	 * \internal
+	 * The constructor for a range of edges of a directed vertex.
+	 *  \param id The vertex ID.
+	 *  \param type The type of the edge list.
+	 *  \param arr The byte array containing the edges in the range.
+	 *  \param edge_off The location of the first edge in the range in `arr'.
+	 *  \param num_edges The number of edges in the range.
+	 */
+	page_directed_vertex(vertex_id_t id, edge_type type,
+			const safs::page_byte_array &arr, off_t edge_off,
+			vsize_t num_edges): page_vertex(true) {
+		assert(arr.get_size() >= edge_off + num_edges * sizeof(vertex_id_t));
+		this->id = id;
+		edge_range = true;
+		if (type == IN_EDGE) {
+			in_array = &arr;
+			out_array = NULL;
+			in_edge_off = edge_off;
+			out_edge_off = 0;
+			num_in_edges = num_edges;
+			num_out_edges = 0;
+			in_size = arr.get_size();
+			out_size = 0;
+		}
+		else {
+			assert(type == OUT_EDGE);
+			out_array = &arr;
+			in_array = NULL;
+			out_edge_off = edge_off;
+			in_edge_off = 0;
+			num_out_edges = num_edges;
+			num_in_edges = 0;
+			out_size = arr.get_size();
+			in_size = 0;
+		}
+	}
+
 	size_t get_in_size() const {
 		return in_size;
 	}
@@ -837,12 +892,10 @@ public:
 		switch(type) {
 			case IN_EDGE:
 				assert(in_array);
-				return in_array->begin<vertex_id_t>(
-						ext_mem_undirected_vertex::get_header_size());
+				return in_array->begin<vertex_id_t>(in_edge_off);
 			case OUT_EDGE:
 				assert(out_array);
-				return out_array->begin<vertex_id_t>(
-						ext_mem_undirected_vertex::get_header_size());
+				return out_array->begin<vertex_id_t>(out_edge_off);
 			default:
 				throw invalid_arg_exception("invalid edge type");
 		}
@@ -881,17 +934,13 @@ public:
 			case IN_EDGE:
 				assert(in_array);
 				return in_array->get_seq_iterator<vertex_id_t>(
-						ext_mem_undirected_vertex::get_header_size()
-						+ start * sizeof(vertex_id_t),
-						ext_mem_undirected_vertex::get_header_size()
-						+ end * sizeof(vertex_id_t));
+						in_edge_off + start * sizeof(vertex_id_t),
+						in_edge_off + end * sizeof(vertex_id_t));
 			case OUT_EDGE:
 				assert(out_array);
 				return out_array->get_seq_iterator<vertex_id_t>(
-						ext_mem_undirected_vertex::get_header_size()
-						+ start * sizeof(vertex_id_t),
-						ext_mem_undirected_vertex::get_header_size()
-						+ end * sizeof(vertex_id_t));
+						out_edge_off + start * sizeof(vertex_id_t),
+						out_edge_off + end * sizeof(vertex_id_t));
 			default:
 				throw invalid_arg_exception("invalid edge type");
 		}
@@ -908,6 +957,7 @@ public:
 	template<class edge_data_type>
 	safs::page_byte_array::const_iterator<edge_data_type> get_data_begin(
 			edge_type type) const {
+		check_edge_data();
 		switch(type) {
 			case IN_EDGE:
 				assert(in_array);
@@ -952,6 +1002,7 @@ public:
 	template<class edge_data_type>
 	safs::page_byte_array::seq_const_iterator<edge_data_type> get_data_seq_it(
 			edge_type type, size_t start, size_t end) const {
+		check_edge_data();
 		off_t edge_end;
 		switch(type) {
 			case IN_EDGE:
@@ -996,14 +1047,14 @@ public:
 				assert(num_in_edges <= num);
 				assert(in_array);
 				num_edges = num_in_edges;
-				in_array->memcpy(ext_mem_undirected_vertex::get_header_size(),
+				in_array->memcpy(in_edge_off,
 						(char *) edges, sizeof(vertex_id_t) * num_edges);
 				break;
 			case OUT_EDGE:
 				assert(num_out_edges <= num);
 				assert(out_array);
 				num_edges = num_out_edges;
-				out_array->memcpy(ext_mem_undirected_vertex::get_header_size(),
+				out_array->memcpy(out_edge_off,
 						(char *) edges, sizeof(vertex_id_t) * num_edges);
 				break;
 			default:
@@ -20,12 +20,75 @@
 #include "graph_engine.h"
 #include "worker_thread.h"
 #include "vertex_index_reader.h"
+#include "compressed_vertex.h"
+#include "graph_delta.h"
 
 using namespace safs;
 
 namespace fg
 {
 
+/*
+ * This provides the byte array of a vertex in the format of
+ * ext_mem_undirected_vertex. If the edge lists are compressed, the vertex
+ * is decompressed to a buffer, and if edges were added to the vertex after
+ * the graph image was built, they are merged with the edge list, so vertex
+ * programs always see the same vertex format.
+ */
+class vertex_byte_array
+{
+	const page_byte_array *arr;
+	decompressed_byte_array dec_arr;
+	merged_byte_array merged_arr;
+	std::vector<char> merge_buf;
+	size_t stored_size;
+public:
+	vertex_byte_array(const page_byte_array &arr, const graph_engine &graph,
+			std::vector<char> &buf) {
+		this->arr = &arr;
+		stored_size = 0;
+		if (graph.has_compressed_edges()) {
+			dec_arr.init(arr, buf);
+			this->arr = &dec_arr;
+			stored_size = dec_arr.get_compressed_size();
+		}
+
+		const delta_snapshot *delta = graph.get_delta_snapshot();
+		if (delta) {
+			vertex_id_t id = this->arr->get<ext_mem_undirected_vertex>(0).get_id();
+			edge_type type = edge_type::OUT_EDGE;
+			if (graph.get_graph_header().is_directed_graph()
+					&& (size_t) arr.get_offset() < graph.get_in_part_size())
+				type = edge_type::IN_EDGE;
+			const vertex_delta *v_delta = delta->get_delta(id, type);
+			if (v_delta) {
+				if (stored_size == 0)
+					stored_size = ext_mem_undirected_vertex::num_edges2vsize(
+							this->arr->get<ext_mem_undirected_vertex>(0).get_num_edges(),
+							delta->get_edge_data_size());
+				merged_arr.init(*this->arr, *v_delta,
+						delta->get_edge_data_size(), merge_buf);
+				this->arr = &merged_arr;
+			}
+		}
+	}
+
+	const page_byte_array &get() const {
+		return *arr;
+	}
+
+	/*
+	 * The size of the vertex in the adjacency list file.
+	 * `size' is the size of the vertex seen by vertex programs.
+	 */
+	size_t get_stored_size(size_t size) const {
+		if (stored_size > 0)
+			return stored_size;
+		else
+			return size;
+	}
+};
+
 request_range vertex_compute::get_next_request()
 {
 	// Get the next vertex.
@@ -71,7 +134,8 @@ void vertex_compute::request_num_edges(vertex_id_t ids[], size_t num)
 void vertex_compute::run_on_vertex_size(vertex_id_t id, vsize_t size)
 {
 	start_run();
-	vsize_t num_edges = issue_thread->get_graph().cal_num_edges(size);
+	vsize_t num_edges = issue_thread->get_graph().cal_num_edges(id, size,
+			edge_type::IN_EDGE);
 	vertex_header header(id, num_edges);
 	issue_thread->get_vertex_program(v.is_part()).run_on_num_edges(*v, header);
 	num_edge_completed++;
@@ -99,7 +163,9 @@ void vertex_compute::run(page_byte_array &array)
 {
 	num_complete_fetched++;
 	start_run();
-	page_undirected_vertex pg_v(array);
+	std::vector<char> buf;
+	vertex_byte_array v_arr(array, get_graph(), buf);
+	page_undirected_vertex pg_v(v_arr.get());
 	issue_thread->get_vertex_program(v.is_part()).run(*v, pg_v);
 	finish_run();
 }
@@ -111,13 +177,47 @@ void directed_vertex_compute::run_on_page_vertex(page_directed_vertex &pg_v)
 	finish_run();
 }
 
+void directed_vertex_compute::run_on_edge_range(page_byte_array &arr,
+		const edge_range_req &req)
+{
+	if (req.trimmed) {
+		page_directed_vertex pg_v(req.id, req.type, arr, 0,
+				req.end - req.start);
+		run_on_page_vertex(pg_v);
+	}
+	else {
+		std::vector<char> buf;
+		vertex_byte_array v_arr(arr, get_graph(), buf);
+		vsize_t num_edges
+			= v_arr.get().get<ext_mem_undirected_vertex>(0).get_num_edges();
+		vsize_t end = std::min(req.end, num_edges);
+		vsize_t start = std::min(req.start, end);
+		page_directed_vertex pg_v(req.id, req.type, v_arr.get(),
+				ext_mem_undirected_vertex::get_header_size()
+				+ start * sizeof(vertex_id_t), end - start);
+		run_on_page_vertex(pg_v);
+	}
+}
+
 void directed_vertex_compute::run(page_byte_array &array)
 {
 	num_complete_fetched++;
+	if (!range_ios.empty()) {
+		auto it = range_ios.find(array.get_offset());
+		if (it != range_ios.end()) {
+			edge_range_req req = it->second;
+			range_ios.erase(it);
+			run_on_edge_range(array, req);
+			return;
+		}
+	}
+
+	std::vector<char> buf;
 	// If the combine map is empty, we don't need to merge
 	// byte arrays.
 	if (combine_map.empty()) {
-		page_directed_vertex pg_v(array,
+		vertex_byte_array v_arr(array, get_graph(), buf);
+		page_directed_vertex pg_v(v_arr.get(),
 				(size_t) array.get_offset() < graph->get_in_part_size());
 		run_on_page_vertex(pg_v);
 		return;
@@ -128,7 +228,8 @@ void directed_vertex_compute::run(page_byte_array &array)
 	// If the vertex isn't in the combine map, we don't need to
 	// merge byte arrays.
 	if (it == combine_map.end()) {
-		page_directed_vertex pg_v(array,
+		vertex_byte_array v_arr(array, get_graph(), buf);
+		page_directed_vertex pg_v(v_arr.get(),
 				(size_t) array.get_offset() < graph->get_in_part_size());
 		run_on_page_vertex(pg_v);
 		return;
@@ -151,7 +252,10 @@ void directed_vertex_compute::run(page_byte_array &array)
 			in_arr = &array;
 			assert((size_t) array.get_offset() < get_graph().get_in_part_size());
 		}
-		page_directed_vertex pg_v(*in_arr, *out_arr);
+		std::vector<char> out_buf;
+		vertex_byte_array in_v_arr(*in_arr, get_graph(), buf);
+		vertex_byte_array out_v_arr(*out_arr, get_graph(), out_buf);
+		page_directed_vertex pg_v(in_v_arr.get(), out_v_arr.get());
 		run_on_page_vertex(pg_v);
 		page_byte_array::destroy(it->second);
 		combine_map.erase(it);
@@ -174,16 +278,70 @@ void directed_vertex_compute::request_partial_vertices(
 			num_requested += 2;
 		else
 			num_requested++;
+		if (reqs[i].has_range()) {
+			edge_range_req req;
+			req.id = reqs[i].get_id();
+			req.type = reqs[i].get_type();
+			req.start = reqs[i].get_start();
+			req.end = reqs[i].get_end();
+			// We can only read part of an edge list if the edges are
+			// stored in the file as they are.
+			req.trimmed = !graph->has_compressed_edges()
+				&& graph->get_delta_snapshot() == NULL;
+			range_reqs.push_back(req);
+		}
 	}
 	issue_thread->get_index_reader().request_vertices(reqs, num, *this);
 }
 
+void directed_vertex_compute::issue_io_request(const ext_mem_vertex_info &info)
+{
+	if (range_reqs.empty()) {
+		vertex_compute::issue_io_request(info);
+		return;
+	}
+
+	edge_type type = edge_type::OUT_EDGE;
+	if ((size_t) info.get_off() < graph->get_in_part_size())
+		type = edge_type::IN_EDGE;
+	std::vector<edge_range_req>::iterator it;
+	for (it = range_reqs.begin(); it != range_reqs.end(); it++) {
+		if (it->id == info.get_id() && it->type == type)
+			break;
+	}
+	if (it == range_reqs.end()) {
+		vertex_compute::issue_io_request(info);
+		return;
+	}
+
+	edge_range_req req = *it;
+	range_reqs.erase(it);
+	ext_mem_vertex_info range_info = info;
+	if (req.trimmed) {
+		vsize_t num_edges = graph->cal_num_edges(info.get_id(),
+				info.get_size(), type);
+		req.end = std::min(req.end, num_edges);
+		// If there are no edges in the range, we read the vertex instead.
+		if (req.start < req.end)
+			range_info = ext_mem_vertex_info(info.get_id(), info.get_off()
+					+ ext_mem_undirected_vertex::get_header_size()
+					+ req.start * sizeof(vertex_id_t),
+					(req.end - req.start) * sizeof(vertex_id_t));
+		else
+			req.trimmed = false;
+	}
+	range_ios.insert(std::make_pair(range_info.get_off(), req));
+	vertex_compute::issue_io_request(range_info);
+}
+
 void directed_vertex_compute::run_on_vertex_size(vertex_id_t id,
 		size_t in_size, size_t out_size)
 {
 	start_run();
-	vsize_t num_in_edges = issue_thread->get_graph().cal_num_edges(in_size);
-	vsize_t num_out_edges = issue_thread->get_graph().cal_num_edges(out_size);
+	vsize_t num_in_edges = issue_thread->get_graph().cal_num_edges(id, in_size,
+			edge_type::IN_EDGE);
+	vsize_t num_out_edges = issue_thread->get_graph().cal_num_edges(id,
+			out_size, edge_type::OUT_EDGE);
 	directed_vertex_header header(id, num_in_edges, num_out_edges);
 	issue_thread->get_vertex_program(v.is_part()).run_on_num_edges(*v, header);
 	num_edge_completed++;
@@ -246,15 +404,17 @@ void merged_undirected_vertex_compute::run(page_byte_array &array)
 	worker_thread *t = (worker_thread *) thread::get_curr_thread();
 	// We don't support part vertex compute here.
 	vertex_program &curr_vprog = t->get_vertex_program(false);
+	std::vector<char> buf;
 	for (int i = 0; i < get_num_vertices(); i++, id++) {
 		sub_page_byte_array sub_arr(array, off);
-		page_undirected_vertex pg_v(sub_arr);
+		vertex_byte_array v_arr(sub_arr, get_graph(), buf);
+		page_undirected_vertex pg_v(v_arr.get());
 		assert(pg_v.get_id() == id);
 		compute_vertex_pointer v(&get_graph().get_vertex(pg_v.get_id()));
 		start_run(v);
 		curr_vprog.run(*v, pg_v);
 		finish_run(v);
-		off += pg_v.get_size();
+		off += v_arr.get_stored_size(pg_v.get_size());
 	}
 
 	complete = true;
@@ -268,18 +428,20 @@ void merged_directed_vertex_compute::run_on_array(page_byte_array &array)
 	// We don't support part vertex compute here.
 	vertex_program &curr_vprog = t->get_vertex_program(false);
 	bool in_part = (size_t) array.get_offset() < get_graph().get_in_part_size();
+	std::vector<char> buf;
 	for (int i = 0; i < get_num_vertices(); i++, id++) {
 		sub_page_byte_array sub_arr(array, off);
-		page_directed_vertex pg_v(sub_arr, in_part);
+		vertex_byte_array v_arr(sub_arr, get_graph(), buf);
+		page_directed_vertex pg_v(v_arr.get(), in_part);
 		assert(pg_v.get_id() == id);
 		compute_vertex_pointer v(&get_graph().get_vertex(pg_v.get_id()));
 		start_run(v);
 		curr_vprog.run(*v, pg_v);
 		finish_run(v);
 		if (in_part)
-			off += pg_v.get_in_size();
+			off += v_arr.get_stored_size(pg_v.get_in_size());
 		else
-			off += pg_v.get_out_size();
+			off += v_arr.get_stored_size(pg_v.get_out_size());
 	}
 }
 
@@ -292,17 +454,21 @@ void merged_directed_vertex_compute::run_on_arrays(page_byte_array &in_arr,
 	worker_thread *t = (worker_thread *) thread::get_curr_thread();
 	// We don't support part vertex compute here.
 	vertex_program &curr_vprog = t->get_vertex_program(false);
+	std::vector<char> in_buf;
+	std::vector<char> out_buf;
 	for (int i = 0; i < get_num_vertices(); i++, id++) {
 		sub_page_byte_array sub_in_arr(in_arr, in_off);
 		sub_page_byte_array sub_out_arr(out_arr, out_off);
-		page_directed_vertex pg_v(sub_in_arr, sub_out_arr);
+		vertex_byte_array in_v_arr(sub_in_arr, get_graph(), in_buf);
+		vertex_byte_array out_v_arr(sub_out_arr, get_graph(), out_buf);
+		page_directed_vertex pg_v(in_v_arr.get(), out_v_arr.get());
 		assert(pg_v.get_id() == id);
 		compute_vertex_pointer v(&get_graph().get_vertex(pg_v.get_id()));
 		start_run(v);
 		curr_vprog.run(*v, pg_v);
 		finish_run(v);
-		in_off += pg_v.get_in_size();
-		out_off += pg_v.get_out_size();
+		in_off += in_v_arr.get_stored_size(pg_v.get_in_size());
+		out_off += out_v_arr.get_stored_size(pg_v.get_out_size());
 	}
 }
 
@@ -366,6 +532,7 @@ void sparse_undirected_vertex_compute::run(page_byte_array &arr)
 {
 	assert(arr.get_offset() + arr.get_size() > (size_t) ranges[num_ranges - 1].start_off);
 	vertex_program &curr_vprog = issue_thread->get_vertex_program(false);
+	std::vector<char> buf;
 	for (int i = 0; i < num_ranges; i++) {
 		vertex_id_t id = this->ranges[i].id_range.first;
 		int num_vertices
@@ -373,13 +540,14 @@ void sparse_undirected_vertex_compute::run(page_byte_array &arr)
 		off_t off = this->ranges[i].start_off - arr.get_offset();
 		for (int j = 0; j < num_vertices; j++, id++) {
 			sub_page_byte_array sub_arr(arr, off);
-			page_undirected_vertex pg_v(sub_arr);
+			vertex_byte_array v_arr(sub_arr, get_graph(), buf);
+			page_undirected_vertex pg_v(v_arr.get());
 			assert(pg_v.get_id() == id);
 			compute_vertex_pointer v(&get_graph().get_vertex(pg_v.get_id()));
 			start_run(v);
 			curr_vprog.run(*v, pg_v);
 			finish_run(v);
-			off += pg_v.get_size();
+			off += v_arr.get_stored_size(pg_v.get_size());
 		}
 	}
 	complete = true;
@@ -389,6 +557,7 @@ void sparse_directed_vertex_compute::run_on_array(page_byte_array &arr)
 {
 	assert(arr.get_offset() + arr.get_size() > (size_t) ranges[num_ranges - 1].start_off);
 	vertex_program &curr_vprog = issue_thread->get_vertex_program(false);
+	std::vector<char> buf;
 	for (int i = 0; i < num_ranges; i++) {
 		vertex_id_t id = this->ranges[i].id_range.first;
 		int num_vertices
@@ -398,16 +567,17 @@ void sparse_directed_vertex_compute::run_on_array(page_byte_array &arr)
 		bool in_part = (size_t) arr.get_offset() < get_graph().get_in_part_size();
 		for (int j = 0; j < num_vertices; j++, id++) {
 			sub_page_byte_array sub_arr(arr, off);
-			page_directed_vertex pg_v(sub_arr, in_part);
+			vertex_byte_array v_arr(sub_arr, get_graph(), buf);
+			page_directed_vertex pg_v(v_arr.get(), in_part);
 			assert(pg_v.get_id() == id);
 			compute_vertex_pointer v(&get_graph().get_vertex(pg_v.get_id()));
 			start_run(v);
 			curr_vprog.run(*v, pg_v);
 			finish_run(v);
 			if (in_part)
-				off += pg_v.get_in_size();
+				off += v_arr.get_stored_size(pg_v.get_in_size());
 			else
-				off += pg_v.get_out_size();
+				off += v_arr.get_stored_size(pg_v.get_out_size());
 		}
 	}
 	complete = true;
@@ -423,6 +593,8 @@ void sparse_directed_vertex_compute::run_on_arrays(page_byte_array &in_arr,
 	assert((size_t) num_ranges == out_start_offs.size());
 	// We don't support part vertex compute here.
 	vertex_program &curr_vprog = issue_thread->get_vertex_program(false);
+	std::vector<char> in_buf;
+	std::vector<char> out_buf;
 
 	for (int i = 0; i < num_ranges; i++) {
 		vertex_id_t id = this->ranges[i].id_range.first;
@@ -433,14 +605,16 @@ void sparse_directed_vertex_compute::run_on_arrays(page_byte_array &in_arr,
 		for (int i = 0; i < num_vertices; i++, id++) {
 			sub_page_byte_array sub_in_arr(in_arr, in_off);
 			sub_page_byte_array sub_out_arr(out_arr, out_off);
-			page_directed_vertex pg_v(sub_in_arr, sub_out_arr);
+			vertex_byte_array in_v_arr(sub_in_arr, get_graph(), in_buf);
+			vertex_byte_array out_v_arr(sub_out_arr, get_graph(), out_buf);
+			page_directed_vertex pg_v(in_v_arr.get(), out_v_arr.get());
 			assert(pg_v.get_id() == id);
 			compute_vertex_pointer v(&get_graph().get_vertex(pg_v.get_id()));
 			start_run(v);
 			curr_vprog.run(*v, pg_v);
 			finish_run(v);
-			in_off += pg_v.get_in_size();
-			out_off += pg_v.get_out_size();
+			in_off += in_v_arr.get_stored_size(pg_v.get_in_size());
+			out_off += out_v_arr.get_stored_size(pg_v.get_out_size());
 		}
 	}
 	complete = true;
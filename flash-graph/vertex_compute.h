@@ -171,7 +171,7 @@ public:
 	 * a vertex is ready, the vertex index notifies the vertex compute
 	 * of the information.
 	 */
-	void issue_io_request(const ext_mem_vertex_info &info);
+	virtual void issue_io_request(const ext_mem_vertex_info &info);
 
 	/*
 	 * The methods below deal with requesting # edges of vertices.
@@ -213,7 +213,29 @@ class directed_vertex_compute: public vertex_compute
 	typedef std::unordered_map<vertex_id_t, safs::page_byte_array *> combine_map_t;
 	combine_map_t combine_map;
 
+	/*
+	 * A request for a range of edges of a vertex.
+	 */
+	struct edge_range_req
+	{
+		vertex_id_t id;
+		edge_type type;
+		vsize_t start;
+		vsize_t end;
+		// Whether only the edges in the range are read. Otherwise, the entire
+		// edge list is read and the range is taken from it, which happens
+		// when the edge list has to be decompressed or merged with new edges.
+		bool trimmed;
+	};
+	// The requests for ranges of edges whose locations aren't known yet.
+	std::vector<edge_range_req> range_reqs;
+	// The requests for ranges of edges being read, indexed by the location
+	// of the data in the file.
+	std::unordered_multimap<off_t, edge_range_req> range_ios;
+
 	void run_on_page_vertex(page_directed_vertex &);
+	void run_on_edge_range(safs::page_byte_array &arr,
+			const edge_range_req &req);
 public:
 	directed_vertex_compute(graph_engine *graph,
 			safs::compute_allocator *alloc): vertex_compute(graph, alloc) {
@@ -242,7 +264,7 @@ public:
 	 */
 	void run_on_vertex_size(vertex_id_t id, size_t in_size, size_t out_size);
 
-	using vertex_compute::issue_io_request;
+	virtual void issue_io_request(const ext_mem_vertex_info &info);
 	void issue_io_request(const ext_mem_vertex_info &in_info,
 			const ext_mem_vertex_info &out_info);
 
@@ -43,6 +43,11 @@ static void verify_index(vertex_index::ptr idx)
 	if (!idx->get_graph_header().is_graph_file()
 			|| !idx->get_graph_header().is_right_version())
 		throw wrong_format("wrong index file or format version");
+	// The compressed index computes the vertex size from the number of edges,
+	// which doesn't work for compressed edge lists.
+	if (idx->is_compressed()
+			&& idx->get_graph_header().has_compressed_edges())
+		throw wrong_format("compressed edge lists need an uncompressed index");
 
 	bool verify_format;
 	if (idx->get_graph_header().is_directed_graph()) {
@@ -735,12 +740,16 @@ public:
 	}
 
 	vsize_t get_num_in_edges(vertex_id_t id) const {
+		if (index->get_graph_header().has_compressed_edges())
+			return index->get_num_edges_array()[id];
 		ext_mem_vertex_info info = index->get_vertex_info_in(id);
 		return ext_mem_undirected_vertex::vsize2num_edges(info.get_size(),
 				index->get_graph_header().get_edge_data_size());
 	}
 
 	vsize_t get_num_out_edges(vertex_id_t id) const {
+		if (index->get_graph_header().has_compressed_edges())
+			return index->get_num_edges_array()[index->get_num_vertices() + id];
 		ext_mem_vertex_info info = index->get_vertex_info_out(id);
 		return ext_mem_undirected_vertex::vsize2num_edges(info.get_size(),
 				index->get_graph_header().get_edge_data_size());
@@ -777,6 +786,8 @@ public:
 	}
 
 	virtual vsize_t get_num_edges(vertex_id_t id, edge_type type) const {
+		if (index->get_graph_header().has_compressed_edges())
+			return index->get_num_edges_array()[id];
 		ext_mem_vertex_info info = index->get_vertex_info(id);
 		return ext_mem_undirected_vertex::vsize2num_edges(info.get_size(),
 				index->get_graph_header().get_edge_data_size());
@@ -790,6 +801,9 @@ public:
 in_mem_query_vertex_index::ptr in_mem_query_vertex_index::create(
 		vertex_index::ptr index, bool compress)
 {
+	// We can't compress the index of compressed edge lists.
+	if (index->get_graph_header().has_compressed_edges())
+		compress = false;
 	if (index->is_compressed() || compress) {
 		if (index->get_graph_header().is_directed_graph())
 			return in_mem_cdirected_vertex_index::create(*index);
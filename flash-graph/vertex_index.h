@@ -115,6 +115,22 @@ public:
 		return h.data.compressed;
 	}
 
+	/*
+	 * If the edge lists are compressed, we can't compute the number of edges
+	 * of a vertex from its size, so the index stores the number of edges
+	 * of each vertex behind the entries. A directed graph stores
+	 * the number of in-edges of all vertices first and then the number of
+	 * out-edges.
+	 */
+	size_t get_num_edge_counts() const {
+		if (!get_graph_header().has_compressed_edges())
+			return 0;
+		else if (get_graph_header().is_directed_graph())
+			return get_num_vertices() * 2;
+		else
+			return get_num_vertices();
+	}
+
 	void dump(const std::string &file) const {
 		FILE *f = fopen(file.c_str(), "w");
 		if (f == NULL)
@@ -151,6 +167,8 @@ public:
 
 	static vertex_index::ptr create(const graph_header &header,
 			const std::vector<vertex_entry_type> &vertices) {
+		// The index of compressed edge lists is only created by dump().
+		assert(!header.has_compressed_edges());
 		char *buf = (char *) malloc(vertex_index::get_header_size()
 				+ vertices.size() * sizeof(vertices[0]));
 		vertex_index_temp<vertex_entry_type> *index
@@ -163,10 +181,12 @@ public:
 	}
 
 	static void dump(const std::string &file, const graph_header &header,
-			const std::vector<vertex_entry_type> &vertices) {
+			const std::vector<vertex_entry_type> &vertices,
+			const std::vector<vsize_t> &num_edges = std::vector<vsize_t>()) {
 		vertex_index_temp<vertex_entry_type> index(header);
 		index.h.data.num_entries = vertices.size();
 		assert(header.get_num_vertices() + 1 == vertices.size());
+		assert(index.get_num_edge_counts() == num_edges.size());
 		FILE *f = fopen(file.c_str(), "w");
 		if (f == NULL)
 			BOOST_LOG_TRIVIAL(error) << boost::format("fail to open %1%: %2%")
@@ -175,6 +195,9 @@ public:
 			BOOST_VERIFY(fwrite(&index, vertex_index::get_header_size(), 1, f));
 			BOOST_VERIFY(fwrite(vertices.data(),
 						vertices.size() * sizeof(vertices[0]), 1, f));
+			if (!num_edges.empty())
+				BOOST_VERIFY(fwrite(num_edges.data(),
+							num_edges.size() * sizeof(num_edges[0]), 1, f));
 		}
 		fclose(f);
 	}
@@ -192,9 +215,19 @@ public:
 		return vertices;
 	}
 
+	/*
+	 * The number of edges of each vertex. It's only available when
+	 * the edge lists are compressed.
+	 */
+	const vsize_t *get_num_edges_array() const {
+		assert(get_graph_header().has_compressed_edges());
+		return (const vsize_t *) (vertices + h.data.num_entries);
+	}
+
 	size_t cal_index_size() const {
 		return sizeof(vertex_index)
-			+ h.data.num_entries * h.data.entry_size;
+			+ h.data.num_entries * h.data.entry_size
+			+ get_num_edge_counts() * sizeof(vsize_t);
 	}
 
 	bool verify() const {
@@ -326,6 +359,8 @@ public:
 
 	static vertex_index::ptr create(const graph_header &header,
 			const std::vector<directed_vertex_entry> &vertices) {
+		// The index of compressed edge lists is only created by dump().
+		assert(!header.has_compressed_edges());
 		char *buf = (char *) malloc(vertex_index::get_header_size()
 				+ vertices.size() * sizeof(vertices[0]));
 		directed_vertex_index *index = new (buf) directed_vertex_index(header);
@@ -338,11 +373,13 @@ public:
 	}
 
 	static void dump(const std::string &file, const graph_header &header,
-			const std::vector<directed_vertex_entry> &vertices) {
+			const std::vector<directed_vertex_entry> &vertices,
+			const std::vector<vsize_t> &num_edges = std::vector<vsize_t>()) {
 		directed_vertex_index index(header);
 		index.h.data.num_entries = vertices.size();
 		index.h.data.out_part_loc = vertices.front().get_out_off();
 		assert(header.get_num_vertices() + 1 == vertices.size());
+		assert(index.get_num_edge_counts() == num_edges.size());
 		FILE *f = fopen(file.c_str(), "w");
 		if (f == NULL)
 			BOOST_LOG_TRIVIAL(error) << boost::format("fail to open %1%: %2%")
@@ -351,6 +388,9 @@ public:
 			BOOST_VERIFY(fwrite(&index, vertex_index::get_header_size(), 1, f));
 			BOOST_VERIFY(fwrite(vertices.data(),
 						vertices.size() * sizeof(vertices[0]), 1, f));
+			if (!num_edges.empty())
+				BOOST_VERIFY(fwrite(num_edges.data(),
+							num_edges.size() * sizeof(num_edges[0]), 1, f));
 		}
 		fclose(f);
 	}
@@ -39,6 +39,8 @@ vertex_program::~vertex_program()
 		multicast_msg_sender::destroy(multicast_senders[i]);
 	for (unsigned i = 0; i < activate_senders.size(); i++)
 		multicast_msg_sender::destroy(activate_senders[i]);
+	for (unsigned i = 0; i < combining_senders.size(); i++)
+		combining_msg_sender::destroy(combining_senders[i]);
 }
 
 void vertex_program::init(graph_engine *graph, worker_thread *t)
@@ -72,6 +74,55 @@ void vertex_program::init_messaging(const std::vector<worker_thread *> &threads,
 		activate_sender->init(msg);
 		activate_senders.push_back(activate_sender);
 	}
+	if (combiner)
+		init_combining_senders();
+}
+
+void vertex_program::init_combining_senders()
+{
+	for (unsigned i = 0; i < combining_senders.size(); i++) {
+		combining_senders[i]->flush();
+		combining_msg_sender::destroy(combining_senders[i]);
+	}
+	combining_senders.clear();
+	for (unsigned i = 0; i < msg_senders.size(); i++)
+		combining_senders.push_back(combining_msg_sender::create(
+					msg_senders[i], combiner));
+}
+
+void vertex_program::set_combiner(msg_combiner::ptr combiner)
+{
+	this->combiner = combiner;
+	// If the messaging has been initialized, we need to replace
+	// the combining senders.
+	if (!msg_senders.empty()) {
+		if (combiner)
+			init_combining_senders();
+		else {
+			for (unsigned i = 0; i < combining_senders.size(); i++) {
+				combining_senders[i]->flush();
+				combining_msg_sender::destroy(combining_senders[i]);
+			}
+			combining_senders.clear();
+		}
+	}
+}
+
+void vertex_program::get_combine_stats(size_t &num_sent,
+		size_t &num_combined) const
+{
+	num_sent = 0;
+	num_combined = 0;
+	for (unsigned i = 0; i < combining_senders.size(); i++) {
+		num_sent += combining_senders[i]->get_num_sent();
+		num_combined += combining_senders[i]->get_num_combined();
+	}
+}
+
+void vertex_program::reset_combine_stats()
+{
+	for (unsigned i = 0; i < combining_senders.size(); i++)
+		combining_senders[i]->reset_stats();
 }
 
 void vertex_program::multicast_msg(vertex_id_t ids[], int num,
@@ -83,7 +134,8 @@ void vertex_program::multicast_msg(vertex_id_t ids[], int num,
 	if (num == 0)
 		return;
 
-	if (num < graph->get_num_threads() * 2) {
+	// Messages that can be combined are sent to each destination separately.
+	if (num < graph->get_num_threads() * 2 || can_combine(msg)) {
 		for (int i = 0; i < num; i++)
 			this->send_msg(ids[i], msg);
 		return;
@@ -113,7 +165,7 @@ void vertex_program::multicast_msg(edge_seq_iterator &it, vertex_message &msg)
 	if (num_dests == 0)
 		return;
 
-	if (num_dests < graph->get_num_threads() * 2) {
+	if (num_dests < graph->get_num_threads() * 2 || can_combine(msg)) {
 		PAGE_FOREACH(vertex_id_t, id, it) {
 			this->send_msg(id, msg);
 		} PAGE_FOREACH_END
@@ -150,12 +202,16 @@ void vertex_program::send_msg(vertex_id_t dest, vertex_message &msg)
 		// the flush message.
 		get_activate_sender(part_id).flush();
 		get_multicast_sender(part_id).flush();
+		if (!combining_senders.empty())
+			combining_senders[part_id]->flush();
 		get_msg_sender(part_id).flush();
 
 		simple_msg_sender &sender = get_flush_msg_sender(part_id);
 		sender.send_cached(msg);
 		sender.flush();
 	}
+	else if (can_combine(msg))
+		combining_senders[part_id]->send(msg);
 	else {
 		simple_msg_sender &sender = get_msg_sender(part_id);
 		sender.send_cached(msg);
@@ -245,11 +301,17 @@ void vertex_program::activate_vertices(edge_seq_iterator &it)
 
 void vertex_program::flush_msgs()
 {
+	// The combined messages are passed to the message senders.
+	for (size_t i = 0; i < combining_senders.size(); i++)
+		combining_senders[i]->flush();
 	for (size_t i = 0; i < msg_senders.size(); i++)
 		msg_senders[i]->flush();
 	for (size_t i = 0; i < multicast_senders.size(); i++)
 		multicast_senders[i]->flush();
 	for (size_t i = 0; i < activate_senders.size(); i++) {
+		// The sender only has the activation message without destinations.
+		if (activate_senders[i]->has_empty_multicast())
+			continue;
 		activate_senders[i]->flush();
 		activation_message msg;
 		activate_senders[i]->init(msg);
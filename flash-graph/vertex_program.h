@@ -59,6 +59,10 @@ class vertex_program
 	std::vector<simple_msg_sender *> flush_msg_senders;
 	std::vector<multicast_msg_sender *> multicast_senders;
 	std::vector<multicast_msg_sender *> activate_senders;
+	// The senders that combine messages before passing them to `msg_senders'.
+	// They only exist if a combiner is registered.
+	msg_combiner::ptr combiner;
+	std::vector<combining_msg_sender *> combining_senders;
     
 	multicast_msg_sender &get_activate_sender(int thread_id) const {
 		return *activate_senders[thread_id];
@@ -75,6 +79,15 @@ class vertex_program
 	simple_msg_sender &get_msg_sender(int thread_id) const {
 		return *msg_senders[thread_id];
 	}
+
+	bool can_combine(const vertex_message &msg) const {
+		bool ret = combiner && !msg.is_flush() && msg.is_combinable();
+		// A combinable message has to be of the type of the combiner.
+		assert(!ret || msg.get_serialized_size() == combiner->get_msg_size());
+		return ret;
+	}
+
+	void init_combining_senders();
 public:
 	typedef std::shared_ptr<vertex_program> ptr; /**Smart pointer by which `vertex_program`s should be accessed.*/
 
@@ -218,6 +231,29 @@ public:
     /* Internal */
 	void flush_msgs();
 
+	/**
+	 * \brief Register a combiner that merges the messages sent by this
+	 *        vertex program to the same vertex. It only applies to
+	 *        point-to-point and multicast messages that are marked with
+	 *        `vertex_message::set_combinable()', which have to be of the
+	 *        type of the combiner's messages. A combinable multicast
+	 *        message is sent to each destination separately so that it
+	 *        can be combined.
+	 *        It should be called before the graph engine starts, usually
+	 *        in the constructor of a custom vertex program.
+	 *  \param combiner The message combiner.
+	 */
+	void set_combiner(msg_combiner::ptr combiner);
+
+	/**
+	 * \brief Get the number of messages sent through the combiner and
+	 *        the number of them merged with other messages since the stats
+	 *        were reset.
+	 */
+	void get_combine_stats(size_t &num_sent, size_t &num_combined) const;
+    /* Internal */
+	void reset_combine_stats();
+
 	/**
 	 * \brief A vertex requests the end of an iteration.
 	 * `notify_iteration_end' of the vertex will be invoked at the end
@@ -0,0 +1,754 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "log.h"
+#include "io_request.h"
+
+#include "vertex_reorder.h"
+#include "vertex_index.h"
+#include "in_mem_storage.h"
+#include "compressed_vertex.h"
+#include "fg_utils.h"
+
+namespace fg
+{
+
+vertex_permutation::vertex_permutation(const std::vector<vertex_id_t> &new2orig)
+{
+	this->new2orig = new2orig;
+	orig2new.resize(new2orig.size(), INVALID_VERTEX_ID);
+	for (size_t i = 0; i < new2orig.size(); i++)
+		orig2new[new2orig[i]] = i;
+}
+
+vertex_permutation::ptr vertex_permutation::create(
+		const std::vector<vertex_id_t> &new2orig)
+{
+	ptr perm(new vertex_permutation(new2orig));
+	for (size_t i = 0; i < perm->orig2new.size(); i++) {
+		if (perm->orig2new[i] == INVALID_VERTEX_ID) {
+			BOOST_LOG_TRIVIAL(error) << boost::format(
+					"vertex %1% doesn't exist in the new order") % i;
+			return ptr();
+		}
+	}
+	return perm;
+}
+
+vertex_permutation::ptr vertex_permutation::load(const std::string &file)
+{
+	FILE *f = fopen(file.c_str(), "r");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to open %1%: %2%")
+			% file % strerror(errno);
+		return ptr();
+	}
+	std::vector<vertex_id_t> new2orig;
+	vertex_id_t buf[4096];
+	size_t ret;
+	while ((ret = fread(buf, sizeof(buf[0]), 4096, f)) > 0)
+		new2orig.insert(new2orig.end(), buf, buf + ret);
+	fclose(f);
+	for (size_t i = 0; i < new2orig.size(); i++) {
+		if (new2orig[i] >= new2orig.size()) {
+			BOOST_LOG_TRIVIAL(error) << file << " isn't a valid permutation";
+			return ptr();
+		}
+	}
+	return create(new2orig);
+}
+
+bool vertex_permutation::dump(const std::string &file) const
+{
+	FILE *f = fopen(file.c_str(), "w");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to open %1%: %2%")
+			% file % strerror(errno);
+		return false;
+	}
+	size_t ret = fwrite(new2orig.data(), sizeof(new2orig[0]), new2orig.size(),
+			f);
+	fclose(f);
+	if (ret != new2orig.size()) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to write %1%: %2%")
+			% file % strerror(errno);
+		return false;
+	}
+	return true;
+}
+
+bool get_vertex_order(const std::string &name, vertex_order &order)
+{
+	if (name == "degree")
+		order = DEGREE_ORDER;
+	else if (name == "bfs")
+		order = BFS_ORDER;
+	else if (name == "rcm")
+		order = RCM_ORDER;
+	else if (name == "gorder")
+		order = GORDER;
+	else if (name == "community")
+		order = COMMUNITY_ORDER;
+	else
+		return false;
+	return true;
+}
+
+namespace
+{
+
+/*
+ * This reads vertices from the in-memory graph image and decompresses them
+ * if the edge lists are compressed.
+ */
+class vertex_reader
+{
+	const safs::NUMA_buffer &data;
+	bool compressed;
+	std::vector<char> raw_buf;
+	std::vector<char> dec_buf;
+public:
+	vertex_reader(FG_graph::ptr graph): data(graph->get_graph_data()->get_data()) {
+		compressed = graph->get_graph_header().has_compressed_edges();
+	}
+
+	/*
+	 * The returned vertex is only valid until the next read.
+	 */
+	const ext_mem_undirected_vertex &read(off_t off, size_t size) {
+		raw_buf.resize(size);
+		data.copy_to(raw_buf.data(), size, off);
+		if (!compressed)
+			return *(const ext_mem_undirected_vertex *) raw_buf.data();
+
+		const ext_mem_compressed_vertex *cv
+			= (const ext_mem_compressed_vertex *) raw_buf.data();
+		dec_buf.resize(cv->get_decompressed_size());
+		cv->decompress(dec_buf.data(), dec_buf.size());
+		return *(const ext_mem_undirected_vertex *) dec_buf.data();
+	}
+};
+
+/*
+ * The neighbors of vertices when the edge direction is ignored.
+ * The neighbor lists are sorted and don't contain self edges.
+ */
+class undirected_adj
+{
+	std::vector<size_t> offs;
+	std::vector<vertex_id_t> neighs;
+public:
+	undirected_adj(FG_graph::ptr graph);
+
+	size_t get_num_vertices() const {
+		return offs.size() - 1;
+	}
+
+	size_t get_degree(vertex_id_t id) const {
+		return offs[id + 1] - offs[id];
+	}
+
+	const vertex_id_t *begin(vertex_id_t id) const {
+		return neighs.data() + offs[id];
+	}
+
+	const vertex_id_t *end(vertex_id_t id) const {
+		return neighs.data() + offs[id + 1];
+	}
+
+	vertex_id_t get_max_degree_vertex() const {
+		vertex_id_t max_id = 0;
+		for (size_t i = 1; i < get_num_vertices(); i++)
+			if (get_degree(i) > get_degree(max_id))
+				max_id = i;
+		return max_id;
+	}
+};
+
+undirected_adj::undirected_adj(FG_graph::ptr graph)
+{
+	vertex_index::ptr vindex = graph->get_index_data();
+	size_t num_vertices = vindex->get_num_vertices();
+	std::vector<off_t> out_offs(num_vertices + 1);
+	std::vector<off_t> in_offs;
+	init_out_offs(vindex, out_offs);
+	bool directed = graph->get_graph_header().is_directed_graph();
+	if (directed) {
+		in_offs.resize(num_vertices + 1);
+		init_in_offs(vindex, in_offs);
+	}
+
+	vertex_reader reader(graph);
+	offs.resize(num_vertices + 1);
+	offs[0] = 0;
+	neighs.reserve(graph->get_graph_header().get_num_edges()
+			* (directed ? 2 : 1));
+	for (size_t i = 0; i < num_vertices; i++) {
+		const ext_mem_undirected_vertex &out_v = reader.read(out_offs[i],
+				out_offs[i + 1] - out_offs[i]);
+		for (size_t j = 0; j < out_v.get_num_edges(); j++)
+			neighs.push_back(out_v.get_neighbor(j));
+		if (directed) {
+			const ext_mem_undirected_vertex &in_v = reader.read(in_offs[i],
+					in_offs[i + 1] - in_offs[i]);
+			for (size_t j = 0; j < in_v.get_num_edges(); j++)
+				neighs.push_back(in_v.get_neighbor(j));
+		}
+		std::vector<vertex_id_t>::iterator start = neighs.begin() + offs[i];
+		std::sort(start, neighs.end());
+		neighs.erase(std::unique(start, neighs.end()), neighs.end());
+		std::vector<vertex_id_t>::iterator self = std::lower_bound(start,
+				neighs.end(), (vertex_id_t) i);
+		if (self != neighs.end() && *self == i)
+			neighs.erase(self);
+		offs[i + 1] = neighs.size();
+	}
+}
+
+/*
+ * Get all vertices sorted by their degree. The sort is stable, so vertices
+ * with the same degree keep their original order.
+ */
+void sort_by_degree(const undirected_adj &adj, bool descending,
+		std::vector<vertex_id_t> &order)
+{
+	order.resize(adj.get_num_vertices());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	if (descending)
+		std::stable_sort(order.begin(), order.end(),
+				[&](vertex_id_t v1, vertex_id_t v2) {
+				return adj.get_degree(v1) > adj.get_degree(v2);
+				});
+	else
+		std::stable_sort(order.begin(), order.end(),
+				[&](vertex_id_t v1, vertex_id_t v2) {
+				return adj.get_degree(v1) < adj.get_degree(v2);
+				});
+}
+
+/*
+ * Traverse the graph in the breadth-first order. A new traversal starts
+ * from the first unvisited vertex in `starts' after a component is
+ * traversed. If `by_degree' is true, the neighbors of a vertex are visited
+ * in the ascending order of their degree (Cuthill-McKee).
+ */
+void get_bfs_order(const undirected_adj &adj,
+		const std::vector<vertex_id_t> &starts, bool by_degree,
+		std::vector<vertex_id_t> &order)
+{
+	size_t num_vertices = adj.get_num_vertices();
+	std::vector<bool> visited(num_vertices);
+	order.clear();
+	order.reserve(num_vertices);
+	std::vector<vertex_id_t> neighs;
+	for (size_t i = 0; i < starts.size(); i++) {
+		if (visited[starts[i]])
+			continue;
+		// The vertices in `order' behind `head' form the BFS queue.
+		size_t head = order.size();
+		order.push_back(starts[i]);
+		visited[starts[i]] = true;
+		while (head < order.size()) {
+			vertex_id_t v = order[head++];
+			neighs.clear();
+			for (const vertex_id_t *it = adj.begin(v); it != adj.end(v); it++)
+				if (!visited[*it])
+					neighs.push_back(*it);
+			if (by_degree)
+				std::stable_sort(neighs.begin(), neighs.end(),
+						[&](vertex_id_t v1, vertex_id_t v2) {
+						return adj.get_degree(v1) < adj.get_degree(v2);
+						});
+			for (size_t j = 0; j < neighs.size(); j++) {
+				visited[neighs[j]] = true;
+				order.push_back(neighs[j]);
+			}
+		}
+	}
+}
+
+/*
+ * A priority queue whose keys only change by one at a time. Vertices with
+ * the same key are kept in a doubly linked list, so all operations take
+ * constant time (amortized for pop_max).
+ */
+class unit_heap
+{
+	std::vector<int> keys;
+	std::vector<vertex_id_t> prev;
+	std::vector<vertex_id_t> next;
+	std::vector<bool> in_heap;
+	// The first vertex of the list of each key.
+	std::vector<vertex_id_t> heads;
+	int max_key;
+
+	void link(vertex_id_t v) {
+		prev[v] = INVALID_VERTEX_ID;
+		next[v] = heads[keys[v]];
+		if (next[v] != INVALID_VERTEX_ID)
+			prev[next[v]] = v;
+		heads[keys[v]] = v;
+	}
+
+	void unlink(vertex_id_t v) {
+		if (prev[v] != INVALID_VERTEX_ID)
+			next[prev[v]] = next[v];
+		else
+			heads[keys[v]] = next[v];
+		if (next[v] != INVALID_VERTEX_ID)
+			prev[next[v]] = prev[v];
+	}
+public:
+	unit_heap(size_t num_vertices): keys(num_vertices), prev(num_vertices),
+			next(num_vertices), in_heap(num_vertices), heads(1,
+				INVALID_VERTEX_ID) {
+		max_key = 0;
+	}
+
+	/*
+	 * A vertex is inserted with key 0. Among the vertices with the same key,
+	 * the last inserted vertex is popped first.
+	 */
+	void insert(vertex_id_t v) {
+		keys[v] = 0;
+		in_heap[v] = true;
+		link(v);
+	}
+
+	bool contains(vertex_id_t v) const {
+		return in_heap[v];
+	}
+
+	void inc(vertex_id_t v) {
+		unlink(v);
+		keys[v]++;
+		if ((size_t) keys[v] >= heads.size())
+			heads.push_back(INVALID_VERTEX_ID);
+		link(v);
+		max_key = std::max(max_key, keys[v]);
+	}
+
+	void dec(vertex_id_t v) {
+		assert(keys[v] > 0);
+		unlink(v);
+		keys[v]--;
+		link(v);
+	}
+
+	vertex_id_t pop_max() {
+		while (max_key > 0 && heads[max_key] == INVALID_VERTEX_ID)
+			max_key--;
+		vertex_id_t v = heads[max_key];
+		assert(v != INVALID_VERTEX_ID);
+		unlink(v);
+		in_heap[v] = false;
+		return v;
+	}
+};
+
+/*
+ * Gorder places a vertex next to the vertices in a sliding window if they
+ * have edges between them or share neighbors. The score of a vertex is
+ * the number of such relations with the vertices in the window.
+ * Scanning the neighbors of high-degree vertices is expensive and they
+ * don't indicate locality, so we don't count the shared neighbors through
+ * them.
+ */
+void get_gorder(const undirected_adj &adj, int window,
+		std::vector<vertex_id_t> &order)
+{
+	size_t num_vertices = adj.get_num_vertices();
+	size_t hub_degree = std::max<size_t>(16, sqrt(num_vertices));
+	unit_heap heap(num_vertices);
+	// The vertex with the largest degree is popped first if no vertex
+	// is related to the vertices in the window.
+	std::vector<vertex_id_t> by_degree;
+	sort_by_degree(adj, false, by_degree);
+	for (size_t i = 0; i < by_degree.size(); i++)
+		heap.insert(by_degree[i]);
+
+	auto update = [&](vertex_id_t u, bool add) {
+		for (const vertex_id_t *it = adj.begin(u); it != adj.end(u); it++) {
+			vertex_id_t x = *it;
+			if (heap.contains(x)) {
+				if (add)
+					heap.inc(x);
+				else
+					heap.dec(x);
+			}
+			if (adj.get_degree(x) > hub_degree)
+				continue;
+			for (const vertex_id_t *it2 = adj.begin(x); it2 != adj.end(x);
+					it2++) {
+				vertex_id_t y = *it2;
+				if (y == u || !heap.contains(y))
+					continue;
+				if (add)
+					heap.inc(y);
+				else
+					heap.dec(y);
+			}
+		}
+	};
+
+	order.clear();
+	order.reserve(num_vertices);
+	while (order.size() < num_vertices) {
+		vertex_id_t v = heap.pop_max();
+		order.push_back(v);
+		update(v, true);
+		if (order.size() > (size_t) window)
+			update(order[order.size() - window - 1], false);
+	}
+}
+
+/*
+ * Find communities with label propagation. The communities are stored in
+ * the order that the BFS reaches them and the vertices in a community are
+ * stored in the BFS order, so the neighbors in the same community are close
+ * to each other.
+ */
+void get_community_order(const undirected_adj &adj,
+		std::vector<vertex_id_t> &order)
+{
+	const int max_iters = 10;
+	size_t num_vertices = adj.get_num_vertices();
+	std::vector<vertex_id_t> labels(num_vertices);
+	for (size_t i = 0; i < num_vertices; i++)
+		labels[i] = i;
+	std::vector<vertex_id_t> by_degree;
+	sort_by_degree(adj, true, by_degree);
+
+	std::vector<size_t> counts(num_vertices);
+	std::vector<vertex_id_t> touched;
+	for (int iter = 0; iter < max_iters; iter++) {
+		size_t num_changes = 0;
+		for (size_t i = 0; i < num_vertices; i++) {
+			vertex_id_t v = by_degree[i];
+			touched.clear();
+			for (const vertex_id_t *it = adj.begin(v); it != adj.end(v);
+					it++) {
+				vertex_id_t label = labels[*it];
+				if (counts[label]++ == 0)
+					touched.push_back(label);
+			}
+			// Keep the current label if it's one of the most frequent labels.
+			vertex_id_t best = labels[v];
+			size_t best_count = counts[best];
+			for (size_t j = 0; j < touched.size(); j++) {
+				vertex_id_t label = touched[j];
+				if (counts[label] > best_count || (counts[label] == best_count
+							&& best != labels[v] && label < best)) {
+					best = label;
+					best_count = counts[label];
+				}
+			}
+			for (size_t j = 0; j < touched.size(); j++)
+				counts[touched[j]] = 0;
+			if (best != labels[v]) {
+				labels[v] = best;
+				num_changes++;
+			}
+		}
+		BOOST_LOG_TRIVIAL(info) << boost::format(
+				"label propagation iteration %1%: %2% vertices change labels")
+			% iter % num_changes;
+		if (num_changes == 0)
+			break;
+	}
+
+	std::vector<vertex_id_t> bfs_order;
+	get_bfs_order(adj, by_degree, false, bfs_order);
+	std::vector<size_t> comm_ranks(num_vertices, -1);
+	size_t num_comms = 0;
+	for (size_t i = 0; i < bfs_order.size(); i++) {
+		vertex_id_t label = labels[bfs_order[i]];
+		if (comm_ranks[label] == (size_t) -1)
+			comm_ranks[label] = num_comms++;
+	}
+	BOOST_LOG_TRIVIAL(info) << boost::format("find %1% communities")
+		% num_comms;
+	order = bfs_order;
+	std::stable_sort(order.begin(), order.end(),
+			[&](vertex_id_t v1, vertex_id_t v2) {
+			return comm_ranks[labels[v1]] < comm_ranks[labels[v2]];
+			});
+}
+
+}
+
+vertex_permutation::ptr reorder_vertices(FG_graph::ptr graph,
+		vertex_order order, int window)
+{
+	if (!graph->is_in_mem()) {
+		BOOST_LOG_TRIVIAL(error) << "only an in-memory graph can be reordered";
+		return vertex_permutation::ptr();
+	}
+	graph_type type = graph->get_graph_header().get_graph_type();
+	if (type != graph_type::DIRECTED && type != graph_type::UNDIRECTED) {
+		BOOST_LOG_TRIVIAL(error) << "can't reorder a time-series graph";
+		return vertex_permutation::ptr();
+	}
+
+	undirected_adj adj(graph);
+	std::vector<vertex_id_t> new_order;
+	std::vector<vertex_id_t> starts;
+	switch (order) {
+		case DEGREE_ORDER:
+			sort_by_degree(adj, true, new_order);
+			break;
+		case BFS_ORDER:
+			sort_by_degree(adj, true, starts);
+			get_bfs_order(adj, starts, false, new_order);
+			break;
+		case RCM_ORDER:
+			// Each component starts from a vertex with the smallest degree.
+			sort_by_degree(adj, false, starts);
+			get_bfs_order(adj, starts, true, new_order);
+			std::reverse(new_order.begin(), new_order.end());
+			break;
+		case GORDER:
+			get_gorder(adj, std::max(window, 1), new_order);
+			break;
+		case COMMUNITY_ORDER:
+			get_community_order(adj, new_order);
+			break;
+		default:
+			BOOST_LOG_TRIVIAL(error) << "unknown vertex order";
+			return vertex_permutation::ptr();
+	}
+	return vertex_permutation::create(new_order);
+}
+
+bool export_reordered_graph(FG_graph::ptr graph, vertex_permutation::ptr perm,
+		const std::string &adj_file, const std::string &index_file,
+		bool compress)
+{
+	if (!graph->is_in_mem()) {
+		BOOST_LOG_TRIVIAL(error) << "only an in-memory graph can be reordered";
+		return false;
+	}
+	const graph_header &orig_header = graph->get_graph_header();
+	size_t num_vertices = orig_header.get_num_vertices();
+	if (perm->get_num_vertices() != num_vertices) {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"the permutation has %1% vertices, but the graph has %2%")
+			% perm->get_num_vertices() % num_vertices;
+		return false;
+	}
+	graph_header header(orig_header.get_graph_type(),
+			orig_header.get_num_vertices(), orig_header.get_num_edges(),
+			orig_header.get_edge_data_size(),
+			orig_header.get_max_num_timestamps());
+	if (compress)
+		header.set_edge_list_format(COMPRESSED_EDGE_LIST);
+
+	FILE *f = fopen(adj_file.c_str(), "w");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("fail to open %1%: %2%")
+			% adj_file % strerror(errno);
+		return false;
+	}
+	BOOST_VERIFY(fwrite(&header, sizeof(header), 1, f));
+
+	auto vindex = graph->get_index_data();
+	vertex_reader reader(graph);
+	off_t off = sizeof(header);
+	std::vector<std::pair<vertex_id_t, size_t> > neighs;
+	std::vector<char> raw_buf;
+	std::vector<char> comp_buf;
+	// Relabel the in-edge lists or the out-edge lists and store them in
+	// the new order.
+	auto write_part = [&](const std::vector<off_t> &offs,
+			std::vector<off_t> &new_offs, std::vector<vsize_t> &num_edges) {
+		for (size_t i = 0; i < num_vertices; i++) {
+			vertex_id_t orig_id = perm->get_orig_id(i);
+			const ext_mem_undirected_vertex &v = reader.read(offs[orig_id],
+					offs[orig_id + 1] - offs[orig_id]);
+			size_t edge_data_size = v.get_edge_data_size();
+			neighs.resize(v.get_num_edges());
+			for (size_t j = 0; j < neighs.size(); j++)
+				neighs[j] = std::pair<vertex_id_t, size_t>(
+						perm->get_new_id(v.get_neighbor(j)), j);
+			std::sort(neighs.begin(), neighs.end());
+
+			raw_buf.resize(ext_mem_undirected_vertex::num_edges2vsize(
+						neighs.size(), edge_data_size));
+			memset(raw_buf.data(), 0, raw_buf.size());
+			ext_mem_undirected_vertex *new_v = new (raw_buf.data())
+				ext_mem_undirected_vertex(i, neighs.size(), edge_data_size);
+			for (size_t j = 0; j < neighs.size(); j++) {
+				new_v->set_neighbor(j, neighs[j].first);
+				if (edge_data_size > 0)
+					memcpy(new_v->get_raw_edge_data(j),
+							v.get_raw_edge_data(neighs[j].second),
+							edge_data_size);
+			}
+
+			size_t size;
+			if (compress) {
+				comp_buf.resize(ext_mem_compressed_vertex::get_max_size(
+							neighs.size(), edge_data_size));
+				size = ext_mem_compressed_vertex::compress(*new_v,
+						comp_buf.data(), comp_buf.size());
+				BOOST_VERIFY(fwrite(comp_buf.data(), size, 1, f));
+				num_edges.push_back(neighs.size());
+			}
+			else {
+				size = new_v->get_size();
+				BOOST_VERIFY(fwrite(raw_buf.data(), size, 1, f));
+			}
+			new_offs[i] = off;
+			off += size;
+		}
+		new_offs[num_vertices] = off;
+	};
+
+	std::vector<vsize_t> num_edges;
+	std::vector<off_t> out_offs(num_vertices + 1);
+	std::vector<off_t> new_out_offs(num_vertices + 1);
+	init_out_offs(vindex, out_offs);
+	if (header.is_directed_graph()) {
+		std::vector<off_t> in_offs(num_vertices + 1);
+		std::vector<off_t> new_in_offs(num_vertices + 1);
+		init_in_offs(vindex, in_offs);
+		write_part(in_offs, new_in_offs, num_edges);
+		write_part(out_offs, new_out_offs, num_edges);
+		std::vector<directed_vertex_entry> entries(num_vertices + 1);
+		for (size_t i = 0; i <= num_vertices; i++)
+			entries[i] = directed_vertex_entry(new_in_offs[i], new_out_offs[i]);
+		directed_vertex_index::dump(index_file, header, entries, num_edges);
+	}
+	else {
+		write_part(out_offs, new_out_offs, num_edges);
+		std::vector<vertex_offset> entries(num_vertices + 1);
+		for (size_t i = 0; i <= num_vertices; i++)
+			entries[i] = vertex_offset(new_out_offs[i]);
+		undirected_vertex_index::dump(index_file, header, entries, num_edges);
+	}
+	fclose(f);
+	return true;
+}
+
+size_t locality_stat::get_tot_pages() const
+{
+	size_t tot = 0;
+	for (size_t i = 0; i < pages_per_level.size(); i++)
+		tot += pages_per_level[i];
+	return tot;
+}
+
+void locality_stat::print() const
+{
+	printf("average neighbor ID gap: %.2f\n", avg_neigh_gap);
+	printf("BFS reads %ld pages in %ld levels\n", get_tot_pages(),
+			pages_per_level.size());
+	for (size_t i = 0; i < pages_per_level.size(); i++)
+		printf("level %ld: %ld vertices, %ld pages\n", i,
+				vertices_per_level[i], pages_per_level[i]);
+}
+
+locality_stat estimate_locality(FG_graph::ptr graph,
+		vertex_permutation::ptr perm)
+{
+	locality_stat stat;
+	stat.avg_neigh_gap = 0;
+	if (!graph->is_in_mem()) {
+		BOOST_LOG_TRIVIAL(error) << "only an in-memory graph can be analyzed";
+		return stat;
+	}
+
+	undirected_adj adj(graph);
+	size_t num_vertices = adj.get_num_vertices();
+	auto get_id = [&](vertex_id_t id) {
+		return perm ? perm->get_new_id(id) : id;
+	};
+
+	double tot_gap = 0;
+	size_t num_gaps = 0;
+	std::vector<vertex_id_t> neighs;
+	for (size_t i = 0; i < num_vertices; i++) {
+		neighs.clear();
+		for (const vertex_id_t *it = adj.begin(i); it != adj.end(i); it++)
+			neighs.push_back(get_id(*it));
+		std::sort(neighs.begin(), neighs.end());
+		for (size_t j = 1; j < neighs.size(); j++)
+			tot_gap += neighs[j] - neighs[j - 1];
+		if (neighs.size() > 1)
+			num_gaps += neighs.size() - 1;
+	}
+	if (num_gaps > 0)
+		stat.avg_neigh_gap = tot_gap / num_gaps;
+
+	// The location of the out-edge list of each vertex after relabelling.
+	// We assume the edge lists have the same size as in the current image.
+	vertex_index::ptr vindex = graph->get_index_data();
+	std::vector<off_t> out_offs(num_vertices + 1);
+	init_out_offs(vindex, out_offs);
+	std::vector<off_t> locs(num_vertices);
+	off_t loc = 0;
+	for (size_t i = 0; i < num_vertices; i++) {
+		vertex_id_t id = perm ? perm->get_orig_id(i) : i;
+		locs[id] = loc;
+		loc += out_offs[id + 1] - out_offs[id];
+	}
+
+	if (num_vertices == 0)
+		return stat;
+	std::vector<bool> visited(num_vertices);
+	std::vector<vertex_id_t> level(1, adj.get_max_degree_vertex());
+	visited[level[0]] = true;
+	std::vector<off_t> pages;
+	while (!level.empty()) {
+		pages.clear();
+		std::vector<vertex_id_t> next_level;
+		for (size_t i = 0; i < level.size(); i++) {
+			vertex_id_t v = level[i];
+			size_t size = out_offs[v + 1] - out_offs[v];
+			off_t first = locs[v] / safs::PAGE_SIZE;
+			off_t last = (locs[v] + std::max<size_t>(size, 1) - 1)
+				/ safs::PAGE_SIZE;
+			for (off_t p = first; p <= last; p++)
+				pages.push_back(p);
+			for (const vertex_id_t *it = adj.begin(v); it != adj.end(v); it++) {
+				if (!visited[*it]) {
+					visited[*it] = true;
+					next_level.push_back(*it);
+				}
+			}
+		}
+		std::sort(pages.begin(), pages.end());
+		stat.pages_per_level.push_back(std::unique(pages.begin(), pages.end())
+				- pages.begin());
+		stat.vertices_per_level.push_back(level.size());
+		level.swap(next_level);
+	}
+	return stat;
+}
+
+}
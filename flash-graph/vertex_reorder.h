@@ -0,0 +1,140 @@
+#ifndef __VERTEX_REORDER_H__
+#define __VERTEX_REORDER_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FGlib.h"
+
+namespace fg
+{
+
+/*
+ * This maps the vertex IDs of a reordered graph to the vertex IDs of
+ * the original graph and vice versa.
+ * In the permutation file, the i-th vertex ID is the original ID of vertex i
+ * in the reordered graph.
+ */
+class vertex_permutation
+{
+	std::vector<vertex_id_t> new2orig;
+	std::vector<vertex_id_t> orig2new;
+
+	vertex_permutation(const std::vector<vertex_id_t> &new2orig);
+public:
+	typedef std::shared_ptr<vertex_permutation> ptr;
+
+	/*
+	 * Create a permutation from the new order of the vertices.
+	 * `new2orig[i]' is the original ID of the i-th vertex in the new order.
+	 */
+	static ptr create(const std::vector<vertex_id_t> &new2orig);
+	static ptr load(const std::string &file);
+	bool dump(const std::string &file) const;
+
+	size_t get_num_vertices() const {
+		return new2orig.size();
+	}
+
+	vertex_id_t get_orig_id(vertex_id_t new_id) const {
+		return new2orig[new_id];
+	}
+
+	vertex_id_t get_new_id(vertex_id_t orig_id) const {
+		return orig2new[orig_id];
+	}
+
+	const std::vector<vertex_id_t> &get_new_order() const {
+		return new2orig;
+	}
+};
+
+enum vertex_order
+{
+	// Sort vertices in the descending order of their degree.
+	DEGREE_ORDER,
+	// Breadth-first order, starting from the vertex with the largest degree.
+	BFS_ORDER,
+	// Reverse Cuthill-McKee.
+	RCM_ORDER,
+	// Greedily place vertices that share neighbors with the last
+	// `window' vertices next to them (Gorder).
+	GORDER,
+	// Cluster vertices into communities with label propagation and
+	// store vertices in a community together.
+	COMMUNITY_ORDER,
+};
+
+/*
+ * Get the order from its name. It returns false if the name is unknown.
+ */
+bool get_vertex_order(const std::string &name, vertex_order &order);
+
+/*
+ * Compute a new order of the vertices in the graph to improve the locality
+ * of accessing the adjacency lists of neighbors. The direction of edges
+ * is ignored. The graph has to be in memory.
+ */
+vertex_permutation::ptr reorder_vertices(FG_graph::ptr graph,
+		vertex_order order, int window = 5);
+
+/*
+ * Write the graph with the relabelled vertices to the adjacency list file
+ * and the index file. The neighbor lists of a vertex are sorted by the new
+ * IDs.
+ */
+bool export_reordered_graph(FG_graph::ptr graph, vertex_permutation::ptr perm,
+		const std::string &adj_file, const std::string &index_file,
+		bool compress);
+
+/*
+ * This estimates the locality of accessing neighbors' adjacency lists
+ * in a graph.
+ */
+struct locality_stat
+{
+	// The average gap between the IDs of two consecutive neighbors in
+	// the sorted neighbor lists.
+	double avg_neigh_gap;
+	// The number of pages that store the out-edge lists of the vertices
+	// in each level of a BFS traversal that ignores the edge direction.
+	std::vector<size_t> pages_per_level;
+	// The number of vertices in each level of the BFS.
+	std::vector<size_t> vertices_per_level;
+
+	size_t get_tot_pages() const;
+	void print() const;
+};
+
+/*
+ * Estimate the locality of the graph if its vertices are relabelled by
+ * `perm'. If `perm' is NULL, the current vertex IDs are used.
+ * The BFS starts from the vertex with the largest degree, so the same
+ * traversal is measured before and after reordering.
+ */
+locality_stat estimate_locality(FG_graph::ptr graph,
+		vertex_permutation::ptr perm);
+
+}
+
+#endif
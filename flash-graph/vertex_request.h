@@ -20,6 +20,8 @@
  * limitations under the License.
  */
 
+#include <limits>
+
 #include "vertex.h"
 
 namespace fg
@@ -58,18 +60,52 @@ public:
 class directed_vertex_request: public vertex_request
 {
 	edge_type type;
+	// The range of edges requested. By default, it requests all edges.
+	vsize_t start;
+	vsize_t end;
 public:
 	directed_vertex_request() {
 		type = edge_type::NONE;
+		start = 0;
+		end = std::numeric_limits<vsize_t>::max();
 	}
 
 	directed_vertex_request(vertex_id_t id, edge_type type): vertex_request(id) {
 		this->type = type;
+		start = 0;
+		end = std::numeric_limits<vsize_t>::max();
+	}
+
+	/*
+	 * This requests the edges in [start, end) of one type of edge lists.
+	 * Only the pages with the edges in the range are read, and the page
+	 * vertex passed to the requesting vertex contains only these edges
+	 * without edge data. `end' can be larger than the number of edges.
+	 */
+	directed_vertex_request(vertex_id_t id, edge_type type, vsize_t start,
+			vsize_t end): vertex_request(id) {
+		assert(type == edge_type::IN_EDGE || type == edge_type::OUT_EDGE);
+		assert(start < end);
+		this->type = type;
+		this->start = start;
+		this->end = end;
 	}
 
 	edge_type get_type() const {
 		return type;
 	}
+
+	bool has_range() const {
+		return start > 0 || end < std::numeric_limits<vsize_t>::max();
+	}
+
+	vsize_t get_start() const {
+		return start;
+	}
+
+	vsize_t get_end() const {
+		return end;
+	}
 };
 
 /**
@@ -17,6 +17,8 @@
  * limitations under the License.
  */
 
+#include <sched.h>
+
 #include <atomic>
 
 #include "io_interface.h"
@@ -62,7 +64,10 @@ void active_vertex_set::fetch_reset_active_vertices(size_t max_num,
 		while (ids.size() < max_num
 				&& bitmap_fetch_idx.get_num_remaining() > 0) {
 			size_t curr_loc = bitmap_fetch_idx.get_curr_loc();
-			size_t new_loc = bitmap_fetch_idx.move(max_num / NUM_BITS_LONG);
+			// We have to move by at least one long. Otherwise, we can't
+			// make progress when fewer than a long of vertices are requested.
+			size_t new_loc = bitmap_fetch_idx.move(
+					ROUNDUP(max_num, NUM_BITS_LONG) / NUM_BITS_LONG);
 			// bitmap_fetch_idx points to the locations of longs.
 			active_map.get_reset_set_bits(min(curr_loc, new_loc) * NUM_BITS_LONG,
 					max(curr_loc, new_loc) * NUM_BITS_LONG, ids);
@@ -80,6 +85,18 @@ void active_vertex_set::fetch_reset_active_vertices(
 			local_ids);
 }
 
+void active_vertex_set::fetch_reset_active_vertices(size_t long_begin,
+		size_t long_end, std::vector<local_vid_t> &local_ids)
+{
+	assert(active_v.empty());
+	std::vector<vertex_id_t> ids;
+	active_map.get_reset_set_bits_in_longs(long_begin, long_end, ids);
+	size_t orig_size = local_ids.size();
+	local_ids.resize(orig_size + ids.size());
+	for (size_t i = 0; i < ids.size(); i++)
+		local_ids[orig_size + i] = local_vid_t(ids[i]);
+}
+
 /*
  * This method split a list of vertices into a list of vertically
  * partitioned vertices and a list of unpartitioned vertices.
@@ -115,10 +132,58 @@ static void split_vertices(const graph_index &index, int part_id,
 	delete_val(vertices, INVALID_VERTEX_ID);
 }
 
+/*
+ * The active vertices are split into ranges and pushed to the deque.
+ * The owner thread pops ranges from the bottom of the deque and thieves
+ * steal ranges from the top, so we push ranges in the reverse order of
+ * the scan direction. This way, the owner thread accesses vertices in
+ * the order of vertex ID and thieves take the vertices farthest from
+ * the ones being processed by the owner thread.
+ */
+void default_vertex_queue::split_ranges(size_t num_units, size_t min_range_size)
+{
+	if (num_units == 0)
+		return;
+
+	size_t max_num_ranges = graph.get_num_threads() * RANGES_PER_THREAD;
+	size_t range_size = std::max(min_range_size,
+			(num_units + max_num_ranges - 1) / max_num_ranges);
+	size_t num_ranges = (num_units + range_size - 1) / range_size;
+	assert(num_ranges <= ranges.get_capacity());
+	for (size_t i = 0; i < num_ranges; i++) {
+		size_t idx = forward ? num_ranges - 1 - i : i;
+		ranges.push(vertex_range(idx * range_size,
+					std::min((idx + 1) * range_size, num_units)));
+	}
+}
+
+/*
+ * This may be invoked by the owner thread and thieves simultaneously.
+ * Each range is accessed by only one thread.
+ */
+void default_vertex_queue::get_range_vertices(vertex_range range,
+		std::vector<compute_vertex_pointer> &vertices)
+{
+	if (range_in_bitmap) {
+		std::vector<local_vid_t> local_ids;
+		active_vertices->fetch_reset_active_vertices(range.start, range.end,
+				local_ids);
+		size_t orig_size = vertices.size();
+		vertices.resize(orig_size + local_ids.size());
+		index.get_vertices(part_id, local_ids.data(), local_ids.size(),
+				compute_vertex_pointer::conv(vertices.data() + orig_size));
+	}
+	else
+		vertices.insert(vertices.end(), vertex_buf.begin() + range.start,
+				vertex_buf.begin() + range.end);
+}
+
 void default_vertex_queue::init(const vertex_id_t buf[], size_t size, bool sorted)
 {
-	lock.lock();
+	assert(ranges.is_empty());
+	assert(buf_fetch_idx.get_num_remaining() == 0);
 	vertex_buf.clear();
+	owner_buf.clear();
 	vpart_ps.clear();
 	active_vertices->clear();
 
@@ -135,18 +200,28 @@ void default_vertex_queue::init(const vertex_id_t buf[], size_t size, bool sorte
 	index.get_vertices(vertices.data(), vertices.size(),
 			compute_vertex_pointer::conv(vertex_buf.data()));
 
-	buf_fetch_idx = scan_pointer(vertex_buf.size(), true);
-	num_active = vertex_buf.size() + vpart_ps.size() * graph_conf.get_num_vparts();
-
-	lock.unlock();
-	curr_vpart = 0;
+	range_in_bitmap = false;
+	forward = true;
+	buf_fetch_idx = scan_pointer(0, true);
+	// Thieves may steal vertices as soon as the ranges are pushed to
+	// the deque, so we have to set the number of active vertices first.
+	num_active = vertex_buf.size() + vpart_ps.size() * graph.get_num_vparts();
+	split_ranges(vertex_buf.size(), MIN_BUF_RANGE);
+	split_vparts();
 }
 
 void default_vertex_queue::init(worker_thread &t)
 {
-	lock.lock();
+	assert(ranges.is_empty());
+	assert(buf_fetch_idx.get_num_remaining() == 0);
 	vertex_buf.clear();
+	owner_buf.clear();
 	vpart_ps.clear();
+	// All bits in the bitmap have been fetched in the previous level,
+	// but the number of set bits isn't updated when they are fetched
+	// in ranges.
+	if (range_in_bitmap)
+		active_vertices->finish_range_fetch();
 	assert(active_vertices->get_num_active_vertices() == 0);
 	// This process only happens in a single thread, so we can swap
 	// the two bitmap safely.
@@ -175,49 +250,101 @@ void default_vertex_queue::init(worker_thread &t)
 			}
 		}
 		printf("there are %ld vparts\n", vpart_ps.size());
-		num_active_vertices += vpart_ps.size() * graph_conf.get_num_vparts();
 	}
-	this->num_active = num_active_vertices;
+	size_t num_unpart = num_active_vertices;
 
-	bool forward = true;
+	forward = true;
 	if (graph_conf.get_elevator_enabled())
 		forward = graph.get_curr_level() % 2;
-	active_vertices->set_dir(forward);
 	buf_fetch_idx = scan_pointer(0, true);
-	lock.unlock();
-	curr_vpart = 0;
+	// When there are only a few active vertices, they are kept in a list.
+	// We move them to the vertex buffer and split the buffer.
+	range_in_bitmap = active_vertices->in_bitmap();
+	if (!range_in_bitmap) {
+		std::vector<local_vid_t> local_ids;
+		active_vertices->fetch_reset_active_vertices(local_ids);
+		vertex_buf.resize(local_ids.size());
+		index.get_vertices(part_id, local_ids.data(), local_ids.size(),
+				compute_vertex_pointer::conv(vertex_buf.data()));
+	}
+	// Thieves may steal vertices as soon as the ranges are pushed to
+	// the deque, so we have to set the number of active vertices first.
+	this->num_active = num_unpart
+		+ vpart_ps.size() * graph.get_num_vparts();
+	if (num_unpart > 0) {
+		if (range_in_bitmap)
+			split_ranges(active_vertices->get_num_longs(), MIN_BITMAP_RANGE);
+		else
+			split_ranges(vertex_buf.size(), MIN_BUF_RANGE);
+	}
+	split_vparts();
 }
 
-void default_vertex_queue::fetch_from_map()
+/*
+ * Each vertical partition of the activated vertices is a range.
+ */
+void default_vertex_queue::split_vparts()
 {
-	assert(buf_fetch_idx.get_num_remaining() == 0);
-	vertex_buf.clear();
-	std::vector<local_vid_t> local_ids;
-	active_vertices->fetch_reset_active_vertices(VERTEX_BUF_SIZE, local_ids);
-	vertex_buf.resize(local_ids.size());
-	index.get_vertices(part_id, local_ids.data(), local_ids.size(),
-			compute_vertex_pointer::conv(vertex_buf.data()));
-
-	bool forward = true;
-	if (graph_conf.get_elevator_enabled())
-		forward = graph.get_curr_level() % 2;
-	buf_fetch_idx = scan_pointer(vertex_buf.size(), forward);
+	if (vpart_ps.empty())
+		return;
+	assert(vpart_ranges.is_empty());
+	for (int i = graph.get_num_vparts() - 1; i >= 0; i--)
+		vpart_ranges.push(vertex_range(i, i + 1));
 }
 
-void default_vertex_queue::fetch_vparts()
+void default_vertex_queue::get_vpart_vertices(vertex_range range,
+		std::vector<compute_vertex_pointer> &vertices)
 {
-	if (curr_vpart >= graph_conf.get_num_vparts())
+	// The large vertices aren't split, so we run the vertices themselves.
+	if (graph.get_num_vparts() == 1) {
+		std::vector<vertex_id_t> ids(vpart_ps.size());
+		for (size_t i = 0; i < vpart_ps.size(); i++)
+			ids[i] = vpart_ps[i].get_vertex_id();
+		size_t orig_size = vertices.size();
+		vertices.resize(orig_size + ids.size());
+		index.get_vertices(ids.data(), ids.size(),
+				compute_vertex_pointer::conv(vertices.data() + orig_size));
 		return;
+	}
+	for (size_t vpart_id = range.start; vpart_id < range.end; vpart_id++) {
+		size_t orig_size = vertices.size();
+		vertices.resize(orig_size + vpart_ps.size());
+		index.get_vpart_vertices(part_id, vpart_id, vpart_ps.data(),
+				vpart_ps.size(), vertices.data() + orig_size);
+	}
+}
 
+/*
+ * The owner thread takes ranges from the deque until it gets some vertices.
+ * The vertically partitioned vertices are processed after all ranges of
+ * unpartitioned vertices are taken. The large vertices that aren't split
+ * are processed before the unpartitioned vertices.
+ */
+bool default_vertex_queue::fill_owner_buf()
+{
 	assert(buf_fetch_idx.get_num_remaining() == 0);
-	vertex_buf.clear();
-	vertex_buf.resize(vpart_ps.size());
-	index.get_vpart_vertices(part_id, curr_vpart, vpart_ps.data(),
-			vpart_ps.size(), vertex_buf.data());
-	curr_vpart++;
+	owner_buf.clear();
+	vertex_range range;
+	if (graph.get_num_vparts() == 1) {
+		while (owner_buf.empty() && vpart_ranges.pop(range))
+			get_vpart_vertices(range, owner_buf);
+		if (!owner_buf.empty()) {
+			buf_fetch_idx = scan_pointer(owner_buf.size(), true);
+			return true;
+		}
+	}
+	while (owner_buf.empty() && ranges.pop(range))
+		get_range_vertices(range, owner_buf);
+	if (!owner_buf.empty()) {
+		buf_fetch_idx = scan_pointer(owner_buf.size(), forward);
+		return true;
+	}
 
+	while (owner_buf.empty() && vpart_ranges.pop(range))
+		get_vpart_vertices(range, owner_buf);
 	// TODO Right now let's just scan the vertices in one direction.
-	buf_fetch_idx = scan_pointer(vertex_buf.size(), true);
+	buf_fetch_idx = scan_pointer(owner_buf.size(), true);
+	return !owner_buf.empty();
 }
 
 int default_vertex_queue::fetch(compute_vertex_pointer vertices[], int num)
@@ -226,55 +353,75 @@ int default_vertex_queue::fetch(compute_vertex_pointer vertices[], int num)
 		return 0;
 
 	int num_fetched = 0;
-	lock.lock();
-	if (buf_fetch_idx.get_num_remaining() > 0) {
-		int num_to_fetch = min(num, buf_fetch_idx.get_num_remaining());
+	while (num_fetched < num) {
+		if (buf_fetch_idx.get_num_remaining() == 0 && !fill_owner_buf())
+			break;
+		int num_to_fetch = min(num - num_fetched,
+				buf_fetch_idx.get_num_remaining());
 		size_t curr_loc = buf_fetch_idx.get_curr_loc();
 		size_t new_loc = buf_fetch_idx.move(num_to_fetch);
-		memcpy(vertices, vertex_buf.data() + min(curr_loc, new_loc),
+		memcpy(vertices + num_fetched, owner_buf.data() + min(curr_loc, new_loc),
 				num_to_fetch * sizeof(vertices[0]));
 		num_fetched += num_to_fetch;
 	}
-	// We have fetched all we need.
-	assert(num == num_fetched
-			// the vertex buffer is empty.
-			|| buf_fetch_idx.get_num_remaining() == 0);
-	// If the vertex buffer is empty, let's get some from the bitmap.
-	if (buf_fetch_idx.get_num_remaining() == 0) {
-		// We start with unpartitioned vertices first and then
-		// vertically partitioned vertices.
-		fetch_from_map();
-		if (vertex_buf.empty() && !vpart_ps.empty())
-			fetch_vparts();
-	}
-	// If we still need some vertices.
-	if (buf_fetch_idx.get_num_remaining() > 0 && num_fetched < num) {
-		int fetch_again = min(num - num_fetched, buf_fetch_idx.get_num_remaining());
-		size_t curr_loc = buf_fetch_idx.get_curr_loc();
-		size_t new_loc = buf_fetch_idx.move(fetch_again);
-		memcpy(vertices + num_fetched,
-				vertex_buf.data() + min(curr_loc, new_loc),
-				fetch_again * sizeof(vertices[0]));
-		num_fetched += fetch_again;
-	}
 	num_active -= num_fetched;
-	lock.unlock();
 	return num_fetched;
 }
 
+/*
+ * A thief always steals a whole range from the deque, so the number of
+ * vertices stolen may differ from the requested number.
+ */
+size_t default_vertex_queue::steal(std::vector<compute_vertex_pointer> &vertices,
+		size_t max_num)
+{
+	size_t orig_size = vertices.size();
+	// The large vertices that aren't split are stolen first.
+	while (vertices.size() == orig_size && graph.get_num_vparts() == 1) {
+		vertex_range range;
+		vertex_range_deque::steal_result ret = vpart_ranges.steal(range);
+		if (ret == vertex_range_deque::STEAL_EMPTY)
+			break;
+		else if (ret == vertex_range_deque::STEAL_SUCCESS)
+			get_vpart_vertices(range, vertices);
+	}
+	while (vertices.size() == orig_size) {
+		vertex_range range;
+		vertex_range_deque::steal_result ret = ranges.steal(range);
+		if (ret == vertex_range_deque::STEAL_EMPTY)
+			break;
+		else if (ret == vertex_range_deque::STEAL_SUCCESS)
+			get_range_vertices(range, vertices);
+	}
+	// Vertical partitions are stolen after all unpartitioned vertices
+	// have been taken.
+	while (vertices.size() == orig_size && ranges.is_empty()) {
+		vertex_range range;
+		vertex_range_deque::steal_result ret = vpart_ranges.steal(range);
+		if (ret == vertex_range_deque::STEAL_EMPTY)
+			break;
+		else if (ret == vertex_range_deque::STEAL_SUCCESS)
+			get_vpart_vertices(range, vertices);
+	}
+	size_t num = vertices.size() - orig_size;
+	num_active -= num;
+	return num;
+}
+
 void customized_vertex_queue::get_compute_vertex_pointers(
 		const std::vector<vertex_id_t> &vertices,
 		std::vector<vpart_vertex_pointer> &vpart_ps)
 {
 	sorted_vertices.resize(vertices.size()
-			+ vpart_ps.size() * graph_conf.get_num_vparts());
+			+ vpart_ps.size() * graph.get_num_vparts());
 	// Get unpartitioned vertices.
 	index.get_vertices(vertices.data(), vertices.size(),
 			compute_vertex_pointer::conv(sorted_vertices.data()));
-	if (graph_conf.get_num_vparts() <= 1)
+	// The partition may not have vertically partitioned vertices at all.
+	if (graph.get_num_vparts() <= 1 || vpart_ps.empty())
 		return;
 	// Get vertically partitioned vertices.
-	for (int i = 0; i < graph_conf.get_num_vparts(); i++) {
+	for (int i = 0; i < graph.get_num_vparts(); i++) {
 		off_t start = vertices.size() + i * vpart_ps.size();
 		off_t end = start + vpart_ps.size();
 		BOOST_VERIFY((size_t) end <= sorted_vertices.size());
@@ -296,7 +443,7 @@ void customized_vertex_queue::init(const vertex_id_t buf[],
 	vertices.insert(vertices.end(), buf, buf + size);
 	if (!sorted)
 		std::sort(vertices.begin(), vertices.end());
-	if (graph_conf.get_num_vparts() > 1)
+	if (graph.get_num_vparts() > 1)
 		split_vertices(index, part_id, vertices, vpart_ps);
 	get_compute_vertex_pointers(vertices, vpart_ps);
 
@@ -313,6 +460,8 @@ void customized_vertex_queue::init(worker_thread &t)
 	lock.lock();
 	sorted_vertices.clear();
 	std::vector<local_vid_t> local_ids;
+	t.next_activated_vertices->finalize();
+	t.next_activated_vertices->set_dir(true);
 	t.next_activated_vertices->fetch_reset_active_vertices(local_ids);
 
 	// the bitmap only contains the locations of vertices in the bitmap.
@@ -325,7 +474,7 @@ void customized_vertex_queue::init(worker_thread &t)
 	}
 	std::vector<local_vid_t>().swap(local_ids);
 	std::vector<vpart_vertex_pointer> vpart_ps;
-	if (graph_conf.get_num_vparts() > 1)
+	if (graph.get_num_vparts() > 1)
 		split_vertices(index, part_id, vertices, vpart_ps);
 	get_compute_vertex_pointers(vertices, vpart_ps);
 
@@ -337,6 +486,125 @@ void customized_vertex_queue::init(worker_thread &t)
 	lock.unlock();
 }
 
+async_vertex_queue::async_vertex_queue(vertex_program::ptr vprog,
+		int part_id): graph(vprog->get_graph())
+{
+	this->vprog = vprog;
+	this->part_id = part_id;
+	this->priority = graph.get_vertex_priority();
+	size_t num_local_vertices = graph.get_partitioner()->get_part_size(
+			part_id, graph.get_num_vertices());
+	priorities.resize(num_local_vertices);
+	states.resize(num_local_vertices);
+	num_queued = 0;
+}
+
+void async_vertex_queue::push(local_vid_t id, float prio)
+{
+	// The heap has too many invalid entries. Let's remove them.
+	if (heap.size() >= std::max(num_queued.load(), 1024UL) * 4) {
+		std::vector<entry> valid;
+		valid.reserve(num_queued);
+		BOOST_FOREACH(entry e, heap) {
+			if ((states[e.id.id] & QUEUED) && priorities[e.id.id] == e.priority)
+				valid.push_back(e);
+		}
+		heap.swap(valid);
+		std::make_heap(heap.begin(), heap.end(), entry_greater());
+	}
+	entry e;
+	e.priority = prio;
+	e.id = id;
+	heap.push_back(e);
+	std::push_heap(heap.begin(), heap.end(), entry_greater());
+}
+
+void async_vertex_queue::activate_locked(local_vid_t id)
+{
+	uint8_t &state = states[id.id];
+	if (state & RUNNING) {
+		state |= PENDING;
+		return;
+	}
+
+	float prio = get_priority(id);
+	if (state & QUEUED) {
+		// We only need to add the vertex again if its priority increases.
+		if (prio < priorities[id.id]) {
+			priorities[id.id] = prio;
+			push(id, prio);
+		}
+	}
+	else {
+		state |= QUEUED;
+		priorities[id.id] = prio;
+		push(id, prio);
+		num_queued++;
+	}
+}
+
+void async_vertex_queue::init(const vertex_id_t buf[], size_t size,
+		bool sorted)
+{
+	lock.lock();
+	for (size_t i = 0; i < size; i++) {
+		int part_id;
+		off_t off;
+		graph.get_partitioner()->map2loc(buf[i], part_id, off);
+		assert(part_id == this->part_id);
+		activate_locked(local_vid_t(off));
+	}
+	lock.unlock();
+}
+
+void async_vertex_queue::init(worker_thread &t)
+{
+	std::vector<local_vid_t> local_ids;
+	// The active vertices may be stored in the bitmap, so we have to
+	// scan the whole bitmap.
+	t.next_activated_vertices->finalize();
+	t.next_activated_vertices->set_dir(true);
+	t.next_activated_vertices->fetch_reset_active_vertices(local_ids);
+	activate(local_ids.data(), local_ids.size());
+}
+
+int async_vertex_queue::fetch(compute_vertex_pointer vertices[], int num)
+{
+	if (num_queued == 0)
+		return 0;
+
+	int num_fetched = 0;
+	lock.lock();
+	while (num_fetched < num && !heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), entry_greater());
+		entry e = heap.back();
+		heap.pop_back();
+		uint8_t &state = states[e.id.id];
+		// The entry is out of date.
+		if (!(state & QUEUED) || priorities[e.id.id] != e.priority)
+			continue;
+		state = (state & ~QUEUED) | RUNNING;
+		vertices[num_fetched++] = compute_vertex_pointer(
+				&graph.get_vertex(part_id, e.id), false);
+	}
+	num_queued -= num_fetched;
+	lock.unlock();
+	return num_fetched;
+}
+
+void async_vertex_queue::complete(local_vid_t id)
+{
+	lock.lock();
+	uint8_t &state = states[id.id];
+	assert(state & RUNNING);
+	state &= ~RUNNING;
+	if (state & PENDING) {
+		state &= ~PENDING;
+		activate_locked(id);
+	}
+	lock.unlock();
+}
+
 worker_thread::worker_thread(graph_engine *graph,
 		file_io_factory::shared_ptr graph_factory,
 		file_io_factory::shared_ptr index_factory,
@@ -347,6 +615,9 @@ worker_thread::worker_thread(graph_engine *graph,
 			node_id), index(graph->get_graph_index())
 {
 	this->scheduler = scheduler;
+	this->async_vertices = NULL;
+	async_idle = false;
+	num_wakeups = 0;
 	req_on_vertex = false;
 	this->vprogram = prog;
 	this->vpart_vprogram = vpart_prog;
@@ -413,7 +684,12 @@ void worker_thread::init()
 			new active_vertex_set(num_local_vertices, get_node_id()));
 	notify_vertices = std::unique_ptr<bitmap>(new bitmap(num_local_vertices,
 				get_node_id()));
-	if (scheduler)
+	if (graph->is_async()) {
+		async_vertices = new async_vertex_queue(vprogram, worker_id);
+		curr_activated_vertices = std::unique_ptr<active_vertex_queue>(
+				async_vertices);
+	}
+	else if (scheduler)
 		curr_activated_vertices = std::unique_ptr<active_vertex_queue>(
 				// TODO can we only use the default vertex program?
 				// what about the vertex program for vertex partitions.
@@ -437,14 +713,16 @@ void worker_thread::init()
 	}
 
 	if (!started_vertices.empty()) {
-		assert(curr_activated_vertices->is_empty());
-		curr_activated_vertices->init(started_vertices, false);
+		// Vertices are initialized before they are added to the queue,
+		// so a vertex scheduler and a vertex priority see their initial state.
 		if (vinitializer) {
 			BOOST_FOREACH(vertex_id_t id, started_vertices) {
 				compute_vertex &v = graph->get_vertex(id);
 				vinitializer->init(v);
 			}
 		}
+		assert(curr_activated_vertices->is_empty());
+		curr_activated_vertices->init(started_vertices, false);
 		// Free the space used by the vector.
 		started_vertices = std::vector<vertex_id_t>();
 	}
@@ -467,10 +745,6 @@ void worker_thread::init()
 	}
 	// If a user wants to start all vertices.
 	else if (start_all) {
-		next_activated_vertices->activate_all();
-		assert(curr_activated_vertices->is_empty());
-		curr_activated_vertices->init(*this);
-		assert(next_activated_vertices->get_num_active_vertices() == 0);
 		if (vinitializer) {
 			std::vector<vertex_id_t> local_ids;
 			graph->get_partitioner()->get_all_vertices_in_part(worker_id,
@@ -480,6 +754,10 @@ void worker_thread::init()
 				vinitializer->init(v);
 			}
 		}
+		next_activated_vertices->activate_all();
+		assert(curr_activated_vertices->is_empty());
+		curr_activated_vertices->init(*this);
+		assert(next_activated_vertices->get_num_active_vertices() == 0);
 	}
 
 	bool ret = graph->progress_first_level();
@@ -507,14 +785,18 @@ int worker_thread::process_activated_vertices(int max)
 
 	process_vertex_buf.resize(max);
 	int num = curr_activated_vertices->fetch(process_vertex_buf.data(), max);
-	if (num == 0) {
-		assert(curr_activated_vertices->is_empty());
+	// The queue may not be empty yet even if we can't fetch vertices from it.
+	// Other threads may have stolen ranges of vertices from the queue, but
+	// haven't taken the vertices out of the ranges.
+	if (num == 0)
 		num = balancer->steal_activated_vertices(process_vertex_buf.data(),
 				max);
-	}
 	if (num > 0) {
 		num_activated_vertices_in_level.inc(num);
-		graph->process_vertices(num);
+		// The asynchronous mode doesn't count the remaining vertices
+		// in a level.
+		if (!async_vertices)
+			graph->process_vertices(num);
 	}
 
 	for (int i = 0; i < num; i++) {
@@ -562,11 +844,92 @@ size_t worker_thread::enter_next_level()
 	return curr_activated_vertices->get_num_vertices();
 }
 
+/*
+ * Test if the thread may have work to do in the asynchronous mode.
+ */
+bool worker_thread::has_async_work()
+{
+	if (!msg_processor->get_msg_queue().is_empty()
+			|| !curr_activated_vertices->is_empty())
+		return true;
+	// We can steal vertices from other threads.
+	for (int i = 0; i < graph->get_num_threads(); i++) {
+		if (graph->get_thread(i)->get_activates() > 0)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * In the asynchronous mode, a thread keeps processing the vertices in its
+ * queue and the messages from other threads without waiting for other
+ * threads. When it runs out of work, it becomes idle and checks whether
+ * all threads are idle.
+ */
+void worker_thread::run_async()
+{
+	while (true) {
+		if (async_idle) {
+			if (!has_async_work()) {
+				if (graph->check_async_complete())
+					break;
+				// Give the CPU to the threads that still have work.
+				sched_yield();
+				continue;
+			}
+			// We have to leave the idle state before doing any work.
+			num_wakeups++;
+			async_idle = false;
+		}
+
+		balancer->process_completed_stolen_vertices();
+		int num = process_activated_vertices(
+				graph->get_max_processing_vertices()
+				- get_num_vertices_processing());
+		msg_processor->process_msgs();
+		index_reader->wait4complete(0);
+		io->access(adj_reqs.data(), adj_reqs.size());
+		adj_reqs.clear();
+		if (io->num_pending_ios() == 0 && index_reader->get_num_pending_tasks() > 0)
+			index_reader->wait4complete(1);
+		io->wait4complete(min(io->num_pending_ios() / 10, 2));
+		// Messages are delivered as soon as possible, so other threads
+		// can process them immediately.
+		vprogram->flush_msgs();
+
+		if (num == 0 && get_num_vertices_processing() == 0
+				&& curr_activated_vertices->is_empty()
+				&& msg_processor->get_msg_queue().is_empty()) {
+			// All stolen vertices have to be returned to their owners
+			// before the thread becomes idle.
+			balancer->process_completed_stolen_vertices();
+			async_idle = true;
+		}
+	}
+	assert(index_reader->get_num_pending_tasks() == 0);
+	assert(io->num_pending_ios() == 0);
+	assert(active_computes.size() == 0);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("worker %1% processes %2% vertices in the asynchronous mode")
+		% worker_id % num_completed_vertices_in_level.get();
+	num_activated_vertices_in_level = atomic_number<long>(0);
+	num_completed_vertices_in_level = atomic_number<long>(0);
+	balancer->reset();
+	msg_processor->reset();
+	async_idle = false;
+	stop();
+}
+
 /**
  * This method is the main function of the graph engine.
  */
 void worker_thread::run()
 {
+	if (async_vertices) {
+		run_async();
+		return;
+	}
+
 	while (true) {
 		int num_visited = 0;
 		int num;
@@ -626,7 +989,8 @@ void worker_thread::run()
 	stop();
 }
 
-int worker_thread::steal_activated_vertices(compute_vertex_pointer vertices[], int num)
+size_t worker_thread::steal_activated_vertices(
+		std::vector<compute_vertex_pointer> &vertices)
 {
 	// This method is called in the context of other worker threads,
 	// curr_activated_vertices may not have been initialized. If so,
@@ -637,18 +1001,28 @@ int worker_thread::steal_activated_vertices(compute_vertex_pointer vertices[], i
 	// to overloaded by the stolen vertices.
 	size_t num_steal = std::max(1UL,
 			curr_activated_vertices->get_num_vertices() / graph->get_num_threads());
-	num = curr_activated_vertices->fetch(vertices,
-			std::min((size_t) num, num_steal));
+	size_t orig_size = vertices.size();
+	size_t num = curr_activated_vertices->steal(vertices, num_steal);
 	if (num > 0)
 		// If the thread steals vertices from another thread successfully,
 		// it needs to notify the thread of the stolen vertices.
-		msg_processor->steal_vertices(vertices, num);
+		msg_processor->steal_vertices(vertices.data() + orig_size, num);
 	return num;
 }
 
 void worker_thread::return_vertices(vertex_id_t ids[], int num)
 {
 	msg_processor->return_vertices(ids, num);
+	// The stolen vertices have been processed, so they can run again.
+	if (async_vertices) {
+		for (int i = 0; i < num; i++) {
+			int part_id;
+			off_t off;
+			graph->get_partitioner()->map2loc(ids[i], part_id, off);
+			assert(part_id == worker_id);
+			async_vertices->complete(local_vid_t(off));
+		}
+	}
 }
 
 void worker_thread::complete_vertex(const compute_vertex_pointer v)
@@ -677,6 +1051,8 @@ void worker_thread::complete_vertex(const compute_vertex_pointer v)
 	// finished processing it, we should return it to its owner thread.
 	if (!index.belong2part(*v.get(), worker_id))
 		balancer->return_vertices(&v, 1);
+	else if (async_vertices)
+		async_vertices->complete(index.get_local_id(worker_id, *v.get()));
 }
 
 vertex_compute *worker_thread::get_vertex_compute(compute_vertex_pointer v)
@@ -24,10 +24,12 @@
 
 #include <vector>
 #include <unordered_map>
+#include <atomic>
 
 #include "graph_engine.h"
 #include "bitmap.h"
 #include "scan_pointer.h"
+#include "range_deque.h"
 
 namespace safs
 {
@@ -152,6 +154,30 @@ public:
 	void fetch_reset_active_vertices(size_t max_num,
 			std::vector<local_vid_t> &local_ids);
 	void fetch_reset_active_vertices(std::vector<local_vid_t> &local_ids);
+
+	/*
+	 * The methods below access the bitmap in ranges of longs. Multiple
+	 * threads can fetch active vertices in disjoint ranges in parallel.
+	 */
+
+	bool in_bitmap() const {
+		return active_v.empty();
+	}
+
+	size_t get_num_longs() const {
+		return active_map.get_num_longs();
+	}
+
+	void fetch_reset_active_vertices(size_t long_begin, size_t long_end,
+			std::vector<local_vid_t> &local_ids);
+
+	/*
+	 * This is invoked after all ranges in the bitmap have been fetched.
+	 */
+	void finish_range_fetch() {
+		assert(active_v.empty());
+		active_map.reset_num_set_bits();
+	}
 };
 
 /*
@@ -170,6 +196,20 @@ public:
 	virtual bool is_empty() = 0;
 	virtual size_t get_num_vertices() = 0;
 
+	/*
+	 * Other threads steal active vertices from the queue with this method.
+	 * The stolen vertices are appended to the vector and it returns
+	 * the number of vertices stolen.
+	 */
+	virtual size_t steal(std::vector<compute_vertex_pointer> &vertices,
+			size_t max_num) {
+		size_t orig_size = vertices.size();
+		vertices.resize(orig_size + max_num);
+		int num = fetch(vertices.data() + orig_size, max_num);
+		vertices.resize(orig_size + num);
+		return num;
+	}
+
 	void init(const std::vector<vertex_id_t> &vec, bool sorted) {
 		init(vec.data(), vec.size(), sorted);
 	}
@@ -177,31 +217,58 @@ public:
 
 /*
  * This vertex queue is sorted based on the vertex ID.
+ * The active vertices are split into ranges, which are kept in
+ * a work-stealing deque. The owner thread takes ranges from one end of
+ * the deque in the order of vertex ID and other threads steal ranges from
+ * the other end, so no lock is needed to access the active vertices.
+ * A range refers to longs in the bitmap of active vertices, or to
+ * locations in the vertex buffer when vertices are given in a list.
  */
 class default_vertex_queue: public active_vertex_queue
 {
-	static const size_t VERTEX_BUF_SIZE = 64 * 1024;
-	spin_lock lock;
-	// It contains the offset of the vertex in the local partition
-	// instead of the real vertex Ids.
+	// The number of ranges the active vertices of a thread are split into
+	// is at most the number of threads times this value.
+	static const size_t RANGES_PER_THREAD = 16;
+	// The minimal number of longs in a range of the bitmap.
+	static const size_t MIN_BITMAP_RANGE = 16;
+	// The minimal number of vertices in a range of the vertex buffer.
+	static const size_t MIN_BUF_RANGE = 64;
+
+	// It contains the activated vertices when they are given in a list.
 	std::vector<compute_vertex_pointer> vertex_buf;
+	// Indicate whether the ranges refer to the bitmap.
+	bool range_in_bitmap;
+	vertex_range_deque ranges;
 	// Pointers to the vertically partitioned vertices that are activated
 	// in this iteration.
 	std::vector<vpart_vertex_pointer> vpart_ps;
-	int curr_vpart;
+	// A range in this deque refers to vertical partitions. The vertical
+	// partitions of a vertex are processed after all unpartitioned
+	// vertices, and they can be processed by different threads.
+	vertex_range_deque vpart_ranges;
 	std::unique_ptr<active_vertex_set> active_vertices;
-	// The fetch index in the vertex buffer.
+	// The vertices the owner thread has taken from the deque.
+	std::vector<compute_vertex_pointer> owner_buf;
+	// The fetch index in the owner buffer.
 	scan_pointer buf_fetch_idx;
+	bool forward;
 	graph_engine &graph;
 	const graph_index &index;
 	std::atomic<size_t> num_active;
 	int part_id;
 
-	void fetch_from_map();
-	void fetch_vparts();
+	void split_ranges(size_t num_units, size_t min_range_size);
+	void get_range_vertices(vertex_range range,
+			std::vector<compute_vertex_pointer> &vertices);
+	bool fill_owner_buf();
+	void split_vparts();
+	void get_vpart_vertices(vertex_range range,
+			std::vector<compute_vertex_pointer> &vertices);
 public:
 	default_vertex_queue(graph_engine &_graph, int part_id,
-			int node_id): buf_fetch_idx(0, true), graph(_graph), index(
+			int node_id): ranges(_graph.get_num_threads() * RANGES_PER_THREAD + 1),
+			vpart_ranges(_graph.get_num_vparts()),
+			buf_fetch_idx(0, true), graph(_graph), index(
 				_graph.get_graph_index()) {
 		num_active = 0;
 		this->part_id = part_id;
@@ -209,12 +276,15 @@ public:
 				part_id, _graph.get_num_vertices());
 		this->active_vertices = std::unique_ptr<active_vertex_set>(
 				new active_vertex_set(num_local_vertices, node_id));
-		curr_vpart = 0;
+		range_in_bitmap = false;
+		forward = true;
 	}
 
 	virtual void init(const vertex_id_t buf[], size_t size, bool sorted);
 	virtual void init(worker_thread &);
 	virtual int fetch(compute_vertex_pointer vertices[], int num);
+	virtual size_t steal(std::vector<compute_vertex_pointer> &vertices,
+			size_t max_num);
 
 	virtual bool is_empty() {
 		return num_active == 0;
@@ -279,6 +349,94 @@ public:
 	}
 };
 
+/*
+ * The queue of active vertices in the asynchronous mode. A vertex is added
+ * to the queue as soon as it's activated, and the vertex with the highest
+ * priority (the smallest value) is fetched first. A vertex activated while
+ * it's being processed is added to the queue again after its processing
+ * completes, so a vertex is never processed by two threads simultaneously.
+ * Thieves fetch vertices from the queue, so all operations are protected
+ * by a lock.
+ */
+class async_vertex_queue: public active_vertex_queue
+{
+	enum {
+		QUEUED = 0x1,
+		RUNNING = 0x2,
+		// The vertex is activated while it's running.
+		PENDING = 0x4,
+	};
+
+	struct entry
+	{
+		float priority;
+		local_vid_t id;
+	};
+
+	struct entry_greater
+	{
+		bool operator()(const entry &e1, const entry &e2) const {
+			return e1.priority > e2.priority;
+		}
+	};
+
+	spin_lock lock;
+	// A vertex may appear in the heap multiple times if its priority
+	// increases after it's added. Only the entry with the current priority
+	// of the vertex is valid.
+	std::vector<entry> heap;
+	std::vector<float> priorities;
+	std::vector<uint8_t> states;
+	std::atomic<size_t> num_queued;
+	vertex_priority::ptr priority;
+	vertex_program::ptr vprog;
+	graph_engine &graph;
+	int part_id;
+
+	float get_priority(local_vid_t id) {
+		if (priority == NULL)
+			return 0;
+		else
+			return priority->get_priority(*vprog,
+					graph.get_vertex(part_id, id));
+	}
+
+	void push(local_vid_t id, float prio);
+	void activate_locked(local_vid_t id);
+public:
+	async_vertex_queue(vertex_program::ptr vprog, int part_id);
+
+	virtual void init(const vertex_id_t buf[], size_t size, bool sorted);
+	virtual void init(worker_thread &);
+	virtual int fetch(compute_vertex_pointer vertices[], int num);
+
+	virtual bool is_empty() {
+		return num_queued == 0;
+	}
+
+	virtual size_t get_num_vertices() {
+		return num_queued;
+	}
+
+	void activate(local_vid_t id) {
+		lock.lock();
+		activate_locked(id);
+		lock.unlock();
+	}
+
+	void activate(const local_vid_t ids[], int num) {
+		lock.lock();
+		for (int i = 0; i < num; i++)
+			activate_locked(ids[i]);
+		lock.unlock();
+	}
+
+	/*
+	 * The vertex fetched from the queue has been processed.
+	 */
+	void complete(local_vid_t id);
+};
+
 class vertex_compute;
 class steal_state_t;
 class message_processor;
@@ -336,7 +494,13 @@ class worker_thread: public thread
 	std::unique_ptr<active_vertex_set> next_activated_vertices;
 	// This contains the vertices activated in the current level.
 	std::unique_ptr<active_vertex_queue> curr_activated_vertices;
+	// It's the same as curr_activated_vertices in the asynchronous mode.
+	async_vertex_queue *async_vertices;
 	vertex_scheduler::ptr scheduler;
+	// The state of the thread in the asynchronous mode. The wakeup count
+	// increases whenever the thread leaves the idle state.
+	std::atomic<bool> async_idle;
+	std::atomic<size_t> num_wakeups;
 
 	// Indicate that we need to start all vertices.
 	bool start_all;
@@ -360,6 +524,8 @@ class worker_thread: public thread
 			- num_completed_vertices_in_level.get();
 	}
 	int process_activated_vertices(int max);
+	bool has_async_work();
+	void run_async();
 public:
 	worker_thread(graph_engine *graph, std::shared_ptr<safs::file_io_factory> graph_factory,
 			std::shared_ptr<safs::file_io_factory> index_factory, vertex_program::ptr prog,
@@ -424,18 +590,29 @@ public:
 	 * Activate the vertex in its own partition for the next iteration.
 	 */
 	void activate_vertex(local_vid_t id) {
-		next_activated_vertices->activate_vertex(id);
+		// In the asynchronous mode, the vertex can be processed immediately.
+		if (async_vertices)
+			async_vertices->activate(id);
+		else
+			next_activated_vertices->activate_vertex(id);
 	}
 
 	void activate_vertices(const local_vid_t ids[], int num) {
-		next_activated_vertices->activate_vertices(ids, num);
+		if (async_vertices)
+			async_vertices->activate(ids, num);
+		else
+			next_activated_vertices->activate_vertices(ids, num);
 	}
 
 	void request_notify_iter_end(local_vid_t id) {
 		notify_vertices->set(id.id);
 	}
 
-	int steal_activated_vertices(compute_vertex_pointer vertices[], int num);
+	/*
+	 * Other threads steal activated vertices from this thread. The stolen
+	 * vertices are appended to the vector.
+	 */
+	size_t steal_activated_vertices(std::vector<compute_vertex_pointer> &vertices);
 	void return_vertices(vertex_id_t ids[], int num);
 
 	size_t get_num_local_vertices() const {
@@ -471,6 +648,14 @@ public:
 		return curr_activated_vertices->get_num_vertices();
 	}
 
+	bool is_async_idle() const {
+		return async_idle.load();
+	}
+
+	size_t get_num_wakeups() const {
+		return num_wakeups.load();
+	}
+
 	safs::compute_allocator &get_merged_compute_allocator() {
 		return *merged_alloc;
 	}
@@ -481,9 +666,14 @@ public:
 
 	int get_stolen_vertex_part(const compute_vertex &v) const;
 
+	load_balancer &get_load_balancer() {
+		return *balancer;
+	}
+
 	friend class load_balancer;
 	friend class default_vertex_queue;
 	friend class customized_vertex_queue;
+	friend class async_vertex_queue;
 };
 
 }
@@ -103,6 +103,9 @@ file_mapper::ptr RAID_config::create_file_mapper(const std::string &file_name) c
 		case HASH:
 			return file_mapper::ptr(new hash_mapper(file_name, files,
 						block_size));
+		case RAID1:
+			return file_mapper::ptr(new RAID1_mapper(file_name, files,
+						block_size));
 		default:
 			fprintf(stderr, "wrong RAID mapping option\n");
 			return file_mapper::ptr();
@@ -121,6 +124,9 @@ file_mapper::ptr RAID_config::create_file_mapper() const
 		case HASH:
 			return file_mapper::ptr(new hash_mapper("root", root_paths,
 						RAID_block_size));
+		case RAID1:
+			return file_mapper::ptr(new RAID1_mapper("root", root_paths,
+						RAID_block_size));
 		default:
 			fprintf(stderr, "wrong RAID mapping option\n");
 			return file_mapper::ptr();
@@ -35,6 +35,7 @@ enum {
 	RAID0,
 	RAID5,
 	HASH,
+	RAID1,
 };
 
 class RAID_config
@@ -18,14 +18,19 @@
  */
 
 #include <limits.h>
+#include <string.h>
+
+#include <algorithm>
 
 #include <boost/assert.hpp>
+#include <boost/format.hpp>
 
 #include "aio_private.h"
 #include "messaging.h"
 #include "read_private.h"
 #include "file_partition.h"
 #include "slab_allocator.h"
+#include "log.h"
 
 template class blocking_FIFO_queue<safs::thread_callback_s *>;
 
@@ -36,6 +41,15 @@ namespace safs
 
 const int MAX_EMBED_BUFS = 64;
 
+/*
+ * The parameters for estimating the latency percentile of reads
+ * on mirrored files.
+ */
+const size_t NUM_READ_LATS = 1024;
+const long LAT_UPDATE_INTERVAL = 128;
+// The hedge delay (in us) before we collect enough latencies.
+const long INIT_HEDGE_DELAY = 10000;
+
 /* 
  * each file gets the same number of outstanding requests.
  */
@@ -44,6 +58,40 @@ const int MAX_EMBED_BUFS = 64;
 #define ALLOW_DROP
 #endif
 
+/*
+ * This keeps track of the copies of a request on a mirrored file.
+ * A write is issued to all copies and is completed after all copies are
+ * written. A copy that fails a write is marked stale, and reads skip
+ * stale copies. A read is issued to the first copy that isn't stale.
+ * Each time it doesn't complete within the hedge delay after the last copy
+ * was issued, it's hedged to the next copy that isn't stale until all
+ * copies are read. The first copy that completes completes the user's
+ * request.
+ */
+struct mirror_req
+{
+	io_request req;
+	// The time when the last copy was issued.
+	long issue_time;
+	int num_copies;
+	// The next copy that a read is hedged to.
+	int next_copy;
+	// The number of copies being accessed.
+	int num_pending;
+	bool completed;
+	// Whether the request is in the hedge queue.
+	bool in_queue;
+
+	mirror_req(const io_request &req): req(req) {
+		issue_time = get_curr_us();
+		num_copies = 1;
+		next_copy = 1;
+		num_pending = 0;
+		completed = false;
+		in_queue = false;
+	}
+};
+
 struct thread_callback_s
 {
 	struct io_callback_s cb;
@@ -51,6 +99,16 @@ struct thread_callback_s
 	callback_allocator *cb_allocator;
 	io_request req;
 	embedded_array<struct iovec, MAX_EMBED_BUFS> vec;
+	// These are only used by the requests on mirrored files.
+	mirror_req *mirror;
+	int copy;
+	// The result of the AIO request.
+	long res;
+	long issue_time;
+	// A read on a mirrored file reads data to its own buffer, so the copy
+	// that completes late can't overwrite the data in the user's buffer.
+	// The buffer comes from the pool of the I/O thread.
+	char *bounce_buf;
 };
 
 /**
@@ -82,6 +140,7 @@ void aio_callback(io_context_t ctx, struct iocb* iocb[],
 	for (int i = 0; i < num; i++) {
 		assert(res2[i] == 0);
 		tcbs[i] = (thread_callback_s *) cbs[i];
+		tcbs[i]->res = res[i];
 		if (aio == NULL)
 			aio = tcbs[i]->aio;
 		// This is true when disks are only accessed by disk access threads.
@@ -120,6 +179,14 @@ async_io::async_io(const logical_file_partition &partition,
 	num_iowait = 0;
 	num_completed_reqs = 0;
 	open_flags = flags;
+	hedge_enabled = params.get_hedge_percentile() > 0;
+	num_read_lats = 0;
+	hedge_delay = std::max(INIT_HEDGE_DELAY, params.get_hedge_min_delay());
+	num_mirror_writes = 0;
+	num_hedged_reads = 0;
+	num_hedge_wins = 0;
+	num_failed_mirror_writes = 0;
+	num_free_bounce_bufs = 0;
 	if (partition.is_active()) {
 		int file_id = partition.get_file_id();
 		io_ref io(new buffered_io(partition, t, header, O_DIRECT | flags));
@@ -136,6 +203,16 @@ void async_io::cleanup()
 		ctx->io_wait(NULL, 1);
 		slot = ctx->max_io_slot();
 	}
+	// All reads have completed, so we don't need to hedge them.
+	issue_hedged_reads();
+	assert(hedge_queue.empty());
+	for (auto it = free_bounce_bufs.begin(); it != free_bounce_bufs.end();
+			it++) {
+		for (size_t i = 0; i < it->second.size(); i++)
+			free(it->second[i]);
+	}
+	free_bounce_bufs.clear();
+	num_free_bounce_bufs = 0;
 	for (auto it = open_files.begin(); it != open_files.end(); it++) {
 		// Files may have been closed.
 		if (it->second.is_valid())
@@ -159,7 +236,40 @@ int async_io::get_file_id() const
 		return -1;
 }
 
-struct iocb *async_io::construct_req(io_request &io_req, callback_t cb_func)
+buffered_io &async_io::get_open_io(int file_id)
+{
+	auto it = open_files.find(file_id);
+	assert(it != open_files.end());
+	assert(it->second.is_valid());
+	return it->second.get_io();
+}
+
+int async_io::get_num_copies(const io_request &req)
+{
+	return get_open_io(req.get_file_id()).get_partition().get_num_copies();
+}
+
+/*
+ * Get the first copy of the data in the request from `copy' that isn't
+ * stale. It returns the number of copies if there isn't such a copy.
+ */
+int async_io::get_fresh_copy(const io_request &req, int copy)
+{
+	const logical_file_partition &partition
+		= get_open_io(req.get_file_id()).get_partition();
+	off_t pg_off = req.get_offset() / PAGE_SIZE;
+	int num_copies = partition.get_num_copies();
+	while (copy < num_copies && partition.is_stale_copy(pg_off, copy))
+		copy++;
+	return copy;
+}
+
+/*
+ * This constructs an AIO request that accesses the `copy'-th copy of data.
+ * If the request is on a mirrored file, `mirror' tracks all of its copies.
+ */
+struct iocb *async_io::construct_req(io_request &io_req, callback_t cb_func,
+		int copy, mirror_req *mirror)
 {
 	thread_callback_s *tcb = cb_allocator->alloc_obj();
 	io_callback_s *cb = (io_callback_s *) tcb;
@@ -170,6 +280,9 @@ struct iocb *async_io::construct_req(io_request &io_req, callback_t cb_func)
 	tcb->req = io_req;
 	tcb->aio = this;
 	tcb->cb_allocator = cb_allocator;
+	tcb->mirror = mirror;
+	tcb->copy = copy;
+	tcb->bounce_buf = NULL;
 
 	assert(tcb->req.get_size() >= MIN_BLOCK_SIZE);
 	assert(tcb->req.get_size() % MIN_BLOCK_SIZE == 0);
@@ -177,17 +290,26 @@ struct iocb *async_io::construct_req(io_request &io_req, callback_t cb_func)
 	assert((long) tcb->req.get_buf() % MIN_BLOCK_SIZE == 0);
 	int io_type = tcb->req.get_access_method() == READ ? A_READ : A_WRITE;
 	block_identifier bid;
-	auto it = open_files.find(io_req.get_file_id());
-	assert(it != open_files.end());
-	assert(it->second.is_valid());
-	buffered_io &io = it->second.get_io();
+	buffered_io &io = get_open_io(io_req.get_file_id());
 	io.get_partition().map(tcb->req.get_offset() / PAGE_SIZE, bid);
 	// Here we translate the global request offset to the offset in the local
-	// disk.
+	// disk. All copies of data are at the same location.
 	off_t local_off = bid.off * PAGE_SIZE + (tcb->req.get_offset() % PAGE_SIZE);
-	if (tcb->req.get_num_bufs() == 1)
-		return ctx->make_io_request(io.get_fd(tcb->req.get_offset()),
-				tcb->req.get_size(), local_off, tcb->req.get_buf(), io_type, cb);
+	int fd;
+	if (copy == 0)
+		fd = io.get_fd(tcb->req.get_offset());
+	else
+		fd = io.get_copy_fd(tcb->req.get_offset(), copy);
+	assert(fd >= 0);
+	if (mirror && io_type == A_READ) {
+		tcb->issue_time = get_curr_us();
+		tcb->bounce_buf = alloc_bounce_buf(tcb->req.get_size());
+		return ctx->make_io_request(fd, tcb->req.get_size(), local_off,
+				tcb->bounce_buf, io_type, cb);
+	}
+	else if (tcb->req.get_num_bufs() == 1)
+		return ctx->make_io_request(fd, tcb->req.get_size(), local_off,
+				tcb->req.get_buf(), io_type, cb);
 	else {
 		int num_bufs = tcb->req.get_num_bufs();
 		for (int i = 0; i < num_bufs; i++) {
@@ -196,7 +318,7 @@ struct iocb *async_io::construct_req(io_request &io_req, callback_t cb_func)
 		}
 		tcb->vec.resize(num_bufs);
 		BOOST_VERIFY(tcb->req.get_vec(tcb->vec.data(), num_bufs) == num_bufs);
-		struct iocb *req = ctx->make_iovec_request(io.get_fd(tcb->req.get_offset()),
+		struct iocb *req = ctx->make_iovec_request(fd,
 				/* 
 				 * iocb only contains a pointer to the io vector.
 				 * the space for the IO vector is stored
@@ -210,33 +332,83 @@ struct iocb *async_io::construct_req(io_request &io_req, callback_t cb_func)
 	}
 }
 
+/*
+ * This constructs the AIO requests for a request and returns the number of
+ * AIO requests that need to be submitted.
+ */
+int async_io::construct_reqs(io_request &io_req, struct iocb *reqs[])
+{
+	int num_copies = get_num_copies(io_req);
+	int num_iocb = 0;
+	if (num_copies == 1 || (io_req.get_access_method() == READ
+				&& !hedge_enabled)) {
+		struct iocb *req = construct_req(io_req, aio_callback);
+		if (req)
+			reqs[num_iocb++] = req;
+		return num_iocb;
+	}
+
+	mirror_req *mirror = new mirror_req(io_req);
+	if (io_req.get_access_method() == WRITE) {
+		mirror->num_pending = num_copies;
+		for (int i = 0; i < num_copies; i++) {
+			struct iocb *req = construct_req(io_req, aio_callback, i, mirror);
+			if (req)
+				reqs[num_iocb++] = req;
+		}
+		num_mirror_writes++;
+	}
+	else {
+		int copy = get_fresh_copy(io_req, 0);
+		// All copies are stale, so we read the first one anyway.
+		if (copy == num_copies)
+			copy = 0;
+		mirror->num_copies = num_copies;
+		mirror->next_copy = get_fresh_copy(io_req, copy + 1);
+		mirror->num_pending = 1;
+		reqs[num_iocb++] = construct_req(io_req, aio_callback, copy, mirror);
+		if (mirror->next_copy < num_copies) {
+			mirror->in_queue = true;
+			hedge_queue.push_back(mirror);
+		}
+	}
+	return num_iocb;
+}
+
 void async_io::access(io_request *requests, int num, io_status *status)
 {
 	ASSERT_EQ(get_thread(), thread::get_curr_thread());
+	trace_reqs(requests, num);
+	if (!hedge_queue.empty())
+		issue_hedged_reads();
 	while (num > 0) {
+		// A write to a mirrored file needs a slot for each copy.
+		int num_slots = get_num_slots(*requests);
+		assert(num_slots <= AIO_DEPTH);
 		int slot = ctx->max_io_slot();
-		if (slot == 0) {
+		while (slot < num_slots) {
 			/*
 			 * To achieve the best performance, we need to submit requests
 			 * as long as there is a slot available.
 			 */
 			num_iowait++;
-			ctx->io_wait(NULL, 1);
+			poll_wait(NULL, 1);
 			slot = ctx->max_io_slot();
 		}
 		struct iocb *reqs[slot];
-		int min = slot > num ? num : slot;
 		int num_iocb = 0;
-		for (int i = 0; i < min; i++) {
+		int used = 0;
+		while (num > 0 && used + num_slots <= slot) {
 			assert(requests->get_io());
-			struct iocb *req = construct_req(*requests, aio_callback);
+			num_iocb += construct_reqs(*requests, reqs + num_iocb);
+			used += num_slots;
 			requests++;
-			if (req)
-				reqs[num_iocb++] = req;
+			num--;
+			if (num > 0)
+				num_slots = get_num_slots(*requests);
 		}
 		if (num_iocb > 0)
 			ctx->submit_io_request(reqs, num_iocb);
-		num -= min;
 	}
 	if (status)
 		for (int i = 0; i < num; i++)
@@ -331,6 +503,225 @@ void aio_complete_thread::process_completed_reqs(thread_callback_s *tcbs[],
 	}
 }
 
+void async_io::record_read_lat(long lat)
+{
+	if (read_lats.size() < NUM_READ_LATS)
+		read_lats.push_back(lat);
+	else
+		read_lats[num_read_lats % NUM_READ_LATS] = lat;
+	num_read_lats++;
+	if (num_read_lats % LAT_UPDATE_INTERVAL == 0) {
+		std::vector<long> lats = read_lats;
+		size_t idx = lats.size() * params.get_hedge_percentile() / 100;
+		std::nth_element(lats.begin(), lats.begin() + idx, lats.end());
+		hedge_delay = std::max(lats[idx], params.get_hedge_min_delay());
+	}
+}
+
+/*
+ * The bounce buffers of the reads on mirrored files are reused, so we don't
+ * allocate and free a buffer for every copy of a read. The buffers are only
+ * used by the I/O thread, so no locking is needed.
+ */
+char *async_io::alloc_bounce_buf(size_t size)
+{
+	auto it = free_bounce_bufs.find(size);
+	if (it == free_bounce_bufs.end() || it->second.empty())
+		return (char *) malloc_aligned(size, PAGE_SIZE);
+	char *buf = it->second.back();
+	it->second.pop_back();
+	num_free_bounce_bufs--;
+	return buf;
+}
+
+void async_io::free_bounce_buf(char *buf, size_t size)
+{
+	// There can't be more reads in flight than the AIO depth.
+	if (num_free_bounce_bufs >= AIO_DEPTH)
+		free(buf);
+	else {
+		free_bounce_bufs[size].push_back(buf);
+		num_free_bounce_bufs++;
+	}
+}
+
+/*
+ * Send the reads on mirrored files that haven't completed by the latency
+ * percentile to the next copy. A read stays in the queue until it has
+ * been sent to all copies.
+ */
+void async_io::issue_hedged_reads()
+{
+	long curr = get_curr_us();
+	while (!hedge_queue.empty()) {
+		mirror_req *mirror = hedge_queue.front();
+		// A copy may have become stale after the read was queued.
+		if (!mirror->completed)
+			mirror->next_copy = get_fresh_copy(mirror->req, mirror->next_copy);
+		if (!mirror->completed && mirror->next_copy < mirror->num_copies) {
+			// The reads in the queue are in the order of issue, so the reads
+			// behind it aren't late either.
+			if (curr - mirror->issue_time < hedge_delay
+					|| ctx->max_io_slot() == 0)
+				break;
+			struct iocb *req = construct_req(mirror->req, aio_callback,
+					mirror->next_copy, mirror);
+			ctx->submit_io_request(&req, 1);
+			mirror->issue_time = curr;
+			mirror->next_copy = get_fresh_copy(mirror->req,
+					mirror->next_copy + 1);
+			mirror->num_pending++;
+			num_hedged_reads++;
+			// The read is issued later than all reads in the queue, so it
+			// goes to the back of the queue.
+			if (mirror->next_copy < mirror->num_copies) {
+				hedge_queue.pop_front();
+				hedge_queue.push_back(mirror);
+				continue;
+			}
+		}
+		hedge_queue.pop_front();
+		mirror->in_queue = false;
+		if (mirror->num_pending == 0)
+			delete mirror;
+	}
+}
+
+static void us2timespec(long us, struct timespec &ts)
+{
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (us % 1000000) * 1000;
+}
+
+/*
+ * Wait for `num' requests to complete or until the timeout expires.
+ * Depending on the poll mode, we check the completion queue without
+ * blocking for a while before we block in the kernel.
+ */
+int async_io::poll_wait(struct timespec *to, int num)
+{
+	long start = get_curr_us();
+	long timeout_us = LONG_MAX;
+	if (to)
+		timeout_us = to->tv_sec * 1000000 + to->tv_nsec / 1000;
+	long spin_time = std::min(poller.get_spin_time(), timeout_us);
+	int ret = 0;
+	long curr = start;
+	if (spin_time > 0) {
+		struct timespec zero = {0, 0};
+		do {
+			ret += ctx->io_wait(&zero, num - ret);
+			curr = get_curr_us();
+		} while (ret < num && curr - start < spin_time);
+		if (ret >= num || curr - start >= timeout_us) {
+			poller.add_wait(curr - start, 0, ret > 0);
+			return ret;
+		}
+	}
+
+	long sleep_start = curr;
+	if (to) {
+		struct timespec remaining;
+		us2timespec(timeout_us - (curr - start), remaining);
+		ret += ctx->io_wait(&remaining, num - ret);
+	}
+	else
+		ret += ctx->io_wait(NULL, num - ret);
+	curr = get_curr_us();
+	poller.add_wait(sleep_start - start, curr - sleep_start, ret > 0);
+	return ret;
+}
+
+int async_io::wait4complete(int num)
+{
+	if (hedge_queue.empty())
+		return poll_wait(NULL, num);
+
+	// We have to wake up in time to hedge the oldest read.
+	issue_hedged_reads();
+	if (hedge_queue.empty())
+		return poll_wait(NULL, num);
+	long wait_us = hedge_queue.front()->issue_time + hedge_delay
+		- get_curr_us();
+	int ret;
+	if (wait_us > 0) {
+		struct timespec timeout;
+		us2timespec(wait_us, timeout);
+		ret = poll_wait(&timeout, num);
+	}
+	// The read can't be hedged because all slots are used.
+	else
+		ret = poll_wait(NULL, num);
+	issue_hedged_reads();
+	return ret;
+}
+
+/*
+ * Process the completion of a copy of a request on a mirrored file.
+ * It returns true if the copy completes the user's request.
+ * Linux AIO can't cancel direct I/O that has been sent to a disk, so
+ * the copy that loses the race is discarded when it completes.
+ */
+bool async_io::complete_mirror(thread_callback_s *tcb)
+{
+	mirror_req *mirror = tcb->mirror;
+	bool complete;
+	mirror->num_pending--;
+	if (tcb->req.get_access_method() == WRITE) {
+		if (tcb->res != (long) tcb->req.get_size())
+			fail_mirror_write(tcb);
+		complete = mirror->num_pending == 0;
+	}
+	else {
+		record_read_lat(get_curr_us() - tcb->issue_time);
+		complete = !mirror->completed;
+		if (complete) {
+			io_request &req = tcb->req;
+			if (req.get_num_bufs() == 1)
+				memcpy(req.get_buf(), tcb->bounce_buf, req.get_size());
+			else {
+				off_t off = 0;
+				for (int i = 0; i < req.get_num_bufs(); i++) {
+					memcpy(req.get_buf(i), tcb->bounce_buf + off,
+							req.get_buf_size(i));
+					off += req.get_buf_size(i);
+				}
+			}
+			if (tcb->copy > 0)
+				num_hedge_wins++;
+		}
+		free_bounce_buf(tcb->bounce_buf, tcb->req.get_size());
+		tcb->bounce_buf = NULL;
+	}
+
+	if (complete)
+		mirror->completed = true;
+	else
+		tcb->cb_allocator->free(tcb);
+	if (mirror->num_pending == 0 && !mirror->in_queue)
+		delete mirror;
+	return complete;
+}
+
+/*
+ * A write to a copy of a mirrored file failed. The other copies may still
+ * succeed, so the copies diverge. We mark the copy stale, so reads no longer
+ * use it until the mapper of the file is recreated.
+ */
+void async_io::fail_mirror_write(thread_callback_s *tcb)
+{
+	const logical_file_partition &partition
+		= get_open_io(tcb->req.get_file_id()).get_partition();
+	off_t pg_off = tcb->req.get_offset() / PAGE_SIZE;
+	partition.set_stale_copy(pg_off, tcb->copy);
+	num_failed_mirror_writes++;
+	BOOST_LOG_TRIVIAL(error) << boost::format(
+			"fail to write %1% bytes at %2% to %3%: %4%, the copy is stale")
+		% tcb->req.get_size() % tcb->req.get_offset()
+		% partition.get_file_name(partition.map2copy(pg_off, tcb->copy))
+		% (tcb->res < 0 ? strerror(-tcb->res) : "short write");
+}
+
 void async_io::return_cb(thread_callback_s *tcbs[], int num)
 {
 	thread_callback_s *local_tcbs[num];
@@ -341,6 +732,8 @@ void async_io::return_cb(thread_callback_s *tcbs[], int num)
 	num_completed_reqs += num;
 	for (int i = 0; i < num; i++) {
 		thread_callback_s *tcb = tcbs[i];
+		if (tcb->mirror && !complete_mirror(tcb))
+			continue;
 		if (tcb->req.get_io() == this)
 			local_tcbs[num_local++] = tcb;
 		else
@@ -28,11 +28,13 @@
 #include "thread.h"
 #include "container.h"
 #include "io_request.h"
+#include "hybrid_poll.h"
 
 namespace safs
 {
 
 struct thread_callback_s;
+struct mirror_req;
 
 class buffered_io;
 class logical_file_partition;
@@ -49,6 +51,8 @@ class async_io: public io_interface
 
 	int num_iowait;
 	int num_completed_reqs;
+	// It decides whether to spin or to block when waiting for completion.
+	hybrid_poller poller;
 
 	class io_ref
 	{
@@ -87,7 +91,41 @@ class async_io: public io_interface
 	std::unordered_map<int, io_ref> open_files;
 	io_ref default_io;
 
-	struct iocb *construct_req(io_request &io_req, callback_t cb_func);
+	/*
+	 * These are used for the requests on mirrored files.
+	 */
+	bool hedge_enabled;
+	// The reads that may be hedged, in the order of issue.
+	std::deque<mirror_req *> hedge_queue;
+	// The recent read latencies (in us) on mirrored files.
+	std::vector<long> read_lats;
+	long num_read_lats;
+	// A read is hedged if it doesn't complete after the delay (in us).
+	long hedge_delay;
+	long num_mirror_writes;
+	long num_hedged_reads;
+	long num_hedge_wins;
+	long num_failed_mirror_writes;
+	// The free bounce buffers of the reads, indexed by their sizes.
+	std::unordered_map<size_t, std::vector<char *> > free_bounce_bufs;
+	int num_free_bounce_bufs;
+
+	buffered_io &get_open_io(int file_id);
+	int get_num_copies(const io_request &req);
+	int get_num_slots(const io_request &req) {
+		return req.get_access_method() == WRITE ? get_num_copies(req) : 1;
+	}
+	int construct_reqs(io_request &io_req, struct iocb *reqs[]);
+	struct iocb *construct_req(io_request &io_req, callback_t cb_func,
+			int copy = 0, mirror_req *mirror = NULL);
+	int get_fresh_copy(const io_request &req, int copy);
+	bool complete_mirror(thread_callback_s *tcb);
+	void fail_mirror_write(thread_callback_s *tcb);
+	void record_read_lat(long lat);
+	void issue_hedged_reads();
+	char *alloc_bounce_buf(size_t size);
+	void free_bounce_buf(char *buf, size_t size);
+	int poll_wait(struct timespec *to, int num);
 public:
 	/**
 	 * @aio_depth_per_file
@@ -136,9 +174,7 @@ public:
 	}
 
 	virtual void notify_completion(io_request *reqs[], int num);
-	int wait4complete(int num) {
-		return ctx->io_wait(NULL, num);
-	}
+	int wait4complete(int num);
 	virtual int get_max_num_pending_ios() const {
 		return AIO_DEPTH;
 	}
@@ -153,6 +189,30 @@ public:
 		return num_completed_reqs;
 	}
 
+	long get_num_mirror_writes() const {
+		return num_mirror_writes;
+	}
+
+	long get_num_hedged_reads() const {
+		return num_hedged_reads;
+	}
+
+	long get_num_hedge_wins() const {
+		return num_hedge_wins;
+	}
+
+	long get_num_failed_mirror_writes() const {
+		return num_failed_mirror_writes;
+	}
+
+	long get_hedge_delay() const {
+		return hedge_delay;
+	}
+
+	const hybrid_poller &get_poller() const {
+		return poller;
+	}
+
 	virtual void flush_requests();
 
 	// These two interfaces allow users to open and close more files.
@@ -34,6 +34,7 @@
 #include "concurrency.h"
 #include "io_request.h"
 #include "parameters.h"
+#include "miss_ratio_curve.h"
 
 namespace safs
 {
@@ -395,11 +396,25 @@ class io_interface;
 class page_filter;
 class page_cache
 {
+	// It estimates the miss-ratio curve of the workload on the cache.
+	miss_ratio_curve::ptr mrc;
 public:
 	typedef std::shared_ptr<page_cache> ptr;
 
 	virtual ~page_cache() {
 	}
+
+	void set_mrc(miss_ratio_curve::ptr mrc) {
+		this->mrc = mrc;
+	}
+
+	/**
+	 * The MRC estimator of the cache. It's NULL if the estimation
+	 * is disabled.
+	 */
+	miss_ratio_curve *get_mrc() const {
+		return mrc.get();
+	}
 	/**
 	 * This method searches for a page with the specified offset.
 	 * It may evict a page if the specificed page doesn't exist.
@@ -709,6 +724,28 @@ public:
 		bool has_next() const {
 			return end - off >= sizeof(T);
 		}
+
+		/**
+		 * This method gets the address of the current element.
+		 * The elements from the current one to the end of the page
+		 * are stored contiguously in memory.
+		 * \return the address of the current element.
+		 */
+		const T *get_curr_addr() const {
+			off_t pg_idx = off / PAGE_SIZE;
+			off_t off_in_pg = off % PAGE_SIZE;
+			return (const T *) (arr->get_page(pg_idx) + off_in_pg);
+		}
+
+		/**
+		 * This method gets the number of elements from the current one
+		 * to the end of the page or the end of the iterator.
+		 * \return the number of elements.
+		 */
+		size_t get_num_entries_in_page() const {
+			off_t pg_end = std::min((off_t) ROUND_PAGE(off) + PAGE_SIZE, end);
+			return (pg_end - off) / sizeof(T);
+		}
 	};
 
 	template<class T>
@@ -37,7 +37,10 @@ void disk_io_thread::open_comm::run()
 	int num_files = mapper->get_num_files();
 	std::vector<int> indices;
 	for (int i = 0; i < num_files; i++) {
-		if (t.disk_ids.find(mapper->get_disk_id(i)) != t.disk_ids.end())
+		// An I/O thread accesses all copies of a mirrored file, so it can
+		// hedge reads and replicate writes to the other copies.
+		if (t.disk_ids.find(mapper->get_disk_id(i)) != t.disk_ids.end()
+				|| mapper->get_num_copies() > 1)
 			indices.push_back(i);
 	}
 
@@ -241,6 +241,10 @@ public:
 		return num_write_bytes;
 	}
 
+	const hybrid_poller &get_poller() const {
+		return aio->get_poller();
+	}
+
 	void print_stat() {
 #ifdef STATISTICS
 		printf("\t%ld reads (%ld bytes), %ld writes (%ld bytes) and %d io waits, complete %d reqs and %ld low-prio reqs,\n",
@@ -255,6 +259,13 @@ public:
 					min_flush_delay);
 		printf("\tremain %d high-prio requests, %d low-prio requests, %ld messages in total\n",
 				get_num_high_prio_reqs(), get_num_low_prio_reqs(), num_msgs);
+		if (aio->get_num_mirror_writes() > 0 || aio->get_num_hedged_reads() > 0)
+			printf("\t%ld mirrored writes (%ld copies failed), %ld hedged reads (%ld won), hedge delay: %ldus\n",
+					aio->get_num_mirror_writes(),
+					aio->get_num_failed_mirror_writes(),
+					aio->get_num_hedged_reads(), aio->get_num_hedge_wins(),
+					aio->get_hedge_delay());
+		aio->get_poller().print_stat("\tpoll");
 #endif
 	}
 
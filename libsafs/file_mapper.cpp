@@ -41,6 +41,9 @@ file_mapper::ptr file_mapper::create(const safs_header &header,
 		case HASH:
 			return file_mapper::ptr(new hash_mapper(file_name, files,
 						block_size));
+		case RAID1:
+			return file_mapper::ptr(new RAID1_mapper(file_name, files,
+						block_size));
 		default:
 			fprintf(stderr, "wrong RAID mapping option\n");
 			return file_mapper::ptr();
@@ -22,6 +22,8 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <atomic>
 
 #include "common.h"
 #include "parameters.h"
@@ -129,6 +131,36 @@ public:
 	virtual void map(off_t, struct block_identifier &) const = 0;
 	virtual int map2file(off_t) const = 0;
 
+	/*
+	 * The number of copies of a chunk of data in the SAFS file.
+	 * Only a mirrored file has more than one copy.
+	 */
+	virtual int get_num_copies() const {
+		return 1;
+	}
+
+	/*
+	 * The file that stores the `copy'-th copy of a chunk of data.
+	 * The first copy is always the one returned by map2file().
+	 * All copies are stored at the same location in their files.
+	 */
+	virtual int map2copy(off_t off, int copy) const {
+		assert(copy == 0);
+		return map2file(off);
+	}
+
+	/*
+	 * A copy of data in the file `idx' is stale if a write to the file
+	 * failed, so the file may not have the latest data. Only a mirrored
+	 * file tracks stale copies.
+	 */
+	virtual bool is_stale(int idx) const {
+		return false;
+	}
+
+	virtual void set_stale(int idx) {
+	}
+
 	// Given the SAFS file size, this calculates physical file sizes in
 	// each disk. `size' is given in the number of pages.
 	virtual std::vector<size_t> get_size_per_disk(size_t size) const;
@@ -193,6 +225,61 @@ public:
 	}
 };
 
+/*
+ * This mirrors an SAFS file on all disks. Each physical file stores
+ * the entire SAFS file at the same offset, so a chunk of data can be read
+ * from any disk. The first copy of a block rotates among the disks as
+ * RAID0, so reads are still distributed to all disks.
+ */
+class RAID1_mapper: public file_mapper
+{
+	// The files that failed a write. They are shared by all I/O threads
+	// that access the file with the mapper, and they aren't persisted.
+	std::unique_ptr<std::atomic<bool>[]> stale;
+public:
+	RAID1_mapper(const std::string &name, const std::vector<part_file_info> &files,
+			int block_size): file_mapper(name, files, block_size) {
+		stale = std::unique_ptr<std::atomic<bool>[]>(
+				new std::atomic<bool>[files.size()]);
+		for (size_t i = 0; i < files.size(); i++)
+			stale[i] = false;
+	}
+
+	virtual void map(off_t off, struct block_identifier &bid) const {
+		bid.idx = map2file(off);
+		bid.off = off;
+	}
+
+	virtual int map2file(off_t off) const {
+		return (int) ((off / STRIPE_BLOCK_SIZE) % get_num_files());
+	}
+
+	virtual int get_num_copies() const {
+		return get_num_files();
+	}
+
+	virtual int map2copy(off_t off, int copy) const {
+		assert(copy >= 0 && copy < get_num_files());
+		return (map2file(off) + copy) % get_num_files();
+	}
+
+	virtual std::vector<size_t> get_size_per_disk(size_t size) const {
+		return std::vector<size_t>(get_num_files(), size);
+	}
+
+	virtual bool is_stale(int idx) const {
+		return stale[idx].load(std::memory_order_relaxed);
+	}
+
+	virtual void set_stale(int idx) {
+		stale[idx].store(true, std::memory_order_relaxed);
+	}
+
+	virtual file_mapper *clone() {
+		return new RAID1_mapper(get_name(), get_files(), STRIPE_BLOCK_SIZE);
+	}
+};
+
 class hash_mapper: public file_mapper
 {
 	static const int CONST_A = FILE_CONST_A;
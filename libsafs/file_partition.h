@@ -103,6 +103,41 @@ public:
 		assert(file_map[idx] >= 0);
 		return file_map[idx];
 	}
+
+	/*
+	 * The number of copies of data in the partition. The partition of
+	 * a mirrored file has multiple copies only if it contains all files.
+	 */
+	int get_num_copies() const {
+		assert(mapper);
+		if ((int) indices.size() == mapper->get_num_files())
+			return mapper->get_num_copies();
+		else
+			return 1;
+	}
+
+	/*
+	 * This maps a page to the file in the partition that stores its
+	 * `copy'-th copy. It returns -1 if the copy isn't in the partition.
+	 */
+	int map2copy(off_t pg_off, int copy) const {
+		assert(mapper);
+		return file_map[mapper->map2copy(pg_off, copy)];
+	}
+
+	/*
+	 * Whether the `copy'-th copy of a page may not have the latest data,
+	 * because a write to it failed. Reads avoid stale copies.
+	 */
+	bool is_stale_copy(off_t pg_off, int copy) const {
+		assert(mapper);
+		return mapper->is_stale(mapper->map2copy(pg_off, copy));
+	}
+
+	void set_stale_copy(off_t pg_off, int copy) const {
+		assert(mapper);
+		mapper->set_stale(mapper->map2copy(pg_off, copy));
+	}
 };
 
 }
@@ -868,6 +868,7 @@ global_cached_io::global_cached_io(thread *t, io_interface::ptr underlying,
 	this->underlying = underlying;
 	this->cache_size = cache->size();
 	global_cache = cache;
+	mrc = cache->get_mrc();
 	assert(processing_req.is_empty());
 
 	if (sched == NULL)
@@ -1354,6 +1355,8 @@ void global_cached_io::process_user_req(
 		} while (p == NULL);
 		processing_req.move_next();
 		num_pg_accesses++;
+		if (mrc)
+			mrc->access(pg_id);
 
 		/* 
 		 * If old_off is -1, it means search() didn't evict a page, i.e.,
@@ -1538,6 +1541,7 @@ void global_cached_io::access(io_request *requests, int num, io_status *status)
 		return;
 
 	ASSERT_EQ(get_thread(), thread::get_curr_thread());
+	trace_reqs(requests, num);
 
 	bool syncd = false;
 	std::vector<thread_safe_page *> dirty_pages;
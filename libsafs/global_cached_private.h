@@ -98,6 +98,8 @@ class global_cached_io: public io_interface
 
 	long cache_size;
 	page_cache::ptr global_cache;
+	// The MRC estimator of the global cache. It may be NULL.
+	miss_ratio_curve *mrc;
 	/* the underlying IO. */
 	io_interface::ptr underlying;
 	callback::ptr cb;
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of SAFSlib.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <limits.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include "hybrid_poll.h"
+#include "parameters.h"
+
+namespace safs
+{
+
+/*
+ * The weight of a new sample in the moving average.
+ */
+static const double WAIT_EWMA_WEIGHT = 0.125;
+
+hybrid_poller::hybrid_poller()
+{
+	mode = params.get_poll_mode();
+	max_spin_time = params.get_max_spin_time();
+	avg_wait = 0;
+	dev_wait = 0;
+	num_waits = 0;
+	num_spin_hits = 0;
+	tot_spin_time = 0;
+	tot_sleep_time = 0;
+}
+
+hybrid_poller::hybrid_poller(int mode, long max_spin_time)
+{
+	this->mode = mode;
+	this->max_spin_time = max_spin_time;
+	avg_wait = 0;
+	dev_wait = 0;
+	num_waits = 0;
+	num_spin_hits = 0;
+	tot_spin_time = 0;
+	tot_sleep_time = 0;
+}
+
+long hybrid_poller::get_spin_time() const
+{
+	switch (mode) {
+		case POLL_BLOCK:
+			return 0;
+		case POLL_SPIN:
+			return LONG_MAX;
+		default:
+			break;
+	}
+	// We spin a little longer than the average wait, so most of the waits
+	// can end while spinning. If the waits are too long, we don't spin.
+	if (avg_wait > max_spin_time)
+		return 0;
+	return std::min((long) ceil(avg_wait + 2 * dev_wait), max_spin_time);
+}
+
+void hybrid_poller::add_wait(long spin_time, long sleep_time, bool complete)
+{
+	num_waits++;
+	if (complete && sleep_time == 0)
+		num_spin_hits++;
+	tot_spin_time += spin_time;
+	tot_sleep_time += sleep_time;
+	if (!complete)
+		return;
+
+	double wait = spin_time + sleep_time;
+	// The first sample.
+	if (avg_wait == 0 && dev_wait == 0) {
+		avg_wait = wait;
+		dev_wait = wait / 2;
+	}
+	else {
+		dev_wait += WAIT_EWMA_WEIGHT * (fabs(wait - avg_wait) - dev_wait);
+		avg_wait += WAIT_EWMA_WEIGHT * (wait - avg_wait);
+	}
+}
+
+void hybrid_poller::merge_stat(const hybrid_poller &poller)
+{
+	num_waits += poller.num_waits;
+	num_spin_hits += poller.num_spin_hits;
+	tot_spin_time += poller.tot_spin_time;
+	tot_sleep_time += poller.tot_sleep_time;
+}
+
+void hybrid_poller::print_stat(const std::string &name) const
+{
+	if (num_waits == 0)
+		return;
+	printf("%s: %ld waits, %ld (%.1f%%) end while spinning, spin %ldus, sleep %ldus\n",
+			name.c_str(), num_waits, num_spin_hits,
+			100.0 * num_spin_hits / num_waits, tot_spin_time, tot_sleep_time);
+}
+
+}
@@ -0,0 +1,143 @@
+#ifndef __HYBRID_POLL_H__
+#define __HYBRID_POLL_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of SAFSlib.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stddef.h>
+
+#include <string>
+
+#include "common_c.h"
+
+namespace safs
+{
+
+/*
+ * How a thread waits for I/O completion.
+ */
+enum poll_mode_t
+{
+	// Always block until the thread is woken up.
+	POLL_BLOCK,
+	// Always spin.
+	POLL_SPIN,
+	// Spin for the expected wait time and block afterwards.
+	POLL_ADAPTIVE,
+};
+
+/*
+ * This decides how long a thread spins before it blocks to wait for
+ * I/O completion. In the adaptive mode, it estimates the wait time from
+ * recent waits. If a wait is likely to end within the max spin time,
+ * the thread spins to avoid the wake-up latency; otherwise, it blocks
+ * right away so it doesn't burn a CPU core.
+ * A poller is used by a single thread.
+ */
+class hybrid_poller
+{
+	int mode;
+	// in us
+	long max_spin_time;
+	// The moving average and the mean deviation of the wait time (in us).
+	double avg_wait;
+	double dev_wait;
+
+	size_t num_waits;
+	// The number of waits that end while the thread spins.
+	size_t num_spin_hits;
+	long tot_spin_time;
+	long tot_sleep_time;
+public:
+	hybrid_poller();
+	hybrid_poller(int mode, long max_spin_time);
+
+	/*
+	 * The time (in us) that the thread should spin before blocking.
+	 */
+	long get_spin_time() const;
+
+	/*
+	 * Record a wait that spins for `spin_time' and sleeps for `sleep_time'.
+	 * `complete' indicates whether the wait ends because of completed
+	 * requests. Only these waits are used to estimate the wait time.
+	 */
+	void add_wait(long spin_time, long sleep_time, bool complete);
+
+	/*
+	 * Wait for events. `poll' checks for events without blocking and
+	 * returns the number of events. `block' puts the thread to sleep until
+	 * it may have events. It returns the number of events found.
+	 */
+	template<class PollFunc, class BlockFunc>
+	int wait(PollFunc poll, BlockFunc block) {
+		long spin_time = get_spin_time();
+		long start = get_curr_us();
+		long curr = start;
+		int num = 0;
+		if (spin_time > 0) {
+			do {
+				num = poll();
+				curr = get_curr_us();
+			} while (num == 0 && curr - start < spin_time);
+			if (num > 0) {
+				add_wait(curr - start, 0, true);
+				return num;
+			}
+		}
+		long sleep_start = curr;
+		do {
+			block();
+			num = poll();
+		} while (num == 0);
+		add_wait(sleep_start - start, get_curr_us() - sleep_start, true);
+		return num;
+	}
+
+	/*
+	 * Add the statistics of another poller to this one.
+	 */
+	void merge_stat(const hybrid_poller &poller);
+
+	size_t get_num_waits() const {
+		return num_waits;
+	}
+
+	size_t get_num_spin_hits() const {
+		return num_spin_hits;
+	}
+
+	long get_spin_time_sum() const {
+		return tot_spin_time;
+	}
+
+	long get_sleep_time_sum() const {
+		return tot_sleep_time;
+	}
+
+	double get_avg_wait() const {
+		return avg_wait;
+	}
+
+	void print_stat(const std::string &name) const;
+};
+
+}
+
+#endif
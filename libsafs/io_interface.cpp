@@ -71,6 +71,7 @@ struct global_data_collection
 	cache_config::ptr cache_conf;
 	page_cache::ptr global_cache;
 	std::vector<int> io_cpus;
+	io_tracer::ptr tracer;
 #ifdef PART_IO
 	// For part_global_cached_io
 	part_io_process_table *table;
@@ -249,6 +250,11 @@ void init_io_system(config_map::ptr configs, bool with_cache)
 		global_data.global_cache = global_data.cache_conf->create_cache(
 				MAX_NUM_FLUSHES_PER_FILE *
 				global_data.raid_conf->get_num_disks());
+		if (params.get_mrc_sample_rate() > 0)
+			global_data.global_cache->set_mrc(miss_ratio_curve::create(
+						params.get_mrc_sample_rate(),
+						params.get_mrc_max_pages(),
+						params.get_mrc_granularity()));
 
 		// The remote IO will never be used. It's only used for creating
 		// more remote IOs for flushing dirty pages, so it doesn't matter
@@ -261,6 +267,8 @@ void init_io_system(config_map::ptr configs, bool with_cache)
 		global_data.global_cache->init(underlying);
 #endif
 	}
+	if (global_data.tracer == NULL && !params.get_io_trace_file().empty())
+		global_data.tracer = io_tracer::create(params.get_io_trace_file());
 #ifdef PART_IO
 	if (global_data.table == NULL && with_cache) {
 		if (params.get_num_nodes() > 1)
@@ -289,6 +297,13 @@ void destroy_io_system()
 	global_data.raid_conf.reset();
 	if (global_data.global_cache)
 		global_data.global_cache->sanity_check();
+	if (global_data.global_cache && global_data.global_cache->get_mrc()
+			&& !params.get_mrc_file().empty())
+		global_data.global_cache->get_mrc()->save(params.get_mrc_file());
+	if (global_data.tracer) {
+		global_data.tracer->close();
+		global_data.tracer.reset();
+	}
 #ifdef PART_IO
 	// TODO destroy part global cached io table.
 	if (global_data.table) {
@@ -738,6 +753,12 @@ file_io_factory::shared_ptr create_io_factory(const std::string &file_name,
 		default:
 			throw io_exception("a wrong access option");
 	}
+	// Only the requests from applications are traced, so we don't trace
+	// the I/O instances created by the factories inside SAFS.
+	if (global_data.tracer) {
+		factory->tracer = global_data.tracer;
+		factory->trace_file_idx = global_data.tracer->add_file(file_name);
+	}
 	return file_io_factory::shared_ptr(factory, destroy_io_factory());
 }
 
@@ -745,6 +766,8 @@ io_interface::ptr create_io(file_io_factory::shared_ptr factory, thread *t)
 {
 	io_interface::ptr io = factory->create_io(t);
 	io->set_owner(factory);
+	if (factory->tracer)
+		io->set_tracer(factory->tracer, factory->trace_file_idx);
 	return io;
 }
 
@@ -763,6 +786,7 @@ void print_io_summary()
 	size_t num_read_bytes = 0;
 	size_t num_writes = 0;
 	size_t num_write_bytes = 0;
+	hybrid_poller disk_poll_stat(POLL_BLOCK, 0);
 
 	sleep(1);
 	BOOST_FOREACH(disk_io_thread::ptr t, global_data.read_thread_set) {
@@ -771,10 +795,46 @@ void print_io_summary()
 			num_read_bytes += t->get_num_read_bytes();
 			num_writes += t->get_num_writes();
 			num_write_bytes += t->get_num_write_bytes();
+			disk_poll_stat.merge_stat(t->get_poller());
 		}
 	}
 	printf("It reads %ld bytes (in %ld reqs) and writes %ld bytes (in %ld reqs)\n",
 			num_read_bytes, num_reads, num_write_bytes, num_writes);
+	disk_poll_stat.print_stat("I/O threads");
+	remote_io::print_poll_stat();
+
+	if (global_data.global_cache && global_data.global_cache->get_mrc()) {
+		// Show how the hit ratio changes if the cache is resized.
+		std::vector<size_t> sizes;
+		for (int i = -2; i <= 2; i++) {
+			if (i < 0)
+				sizes.push_back(params.get_cache_size() >> (-i));
+			else
+				sizes.push_back(params.get_cache_size() << i);
+		}
+		global_data.global_cache->get_mrc()->print_stat(sizes);
+	}
+	io_throttle::print_stat();
+}
+
+void set_io_throttle(const std::string &name, size_t bytes_per_sec,
+		size_t ops_per_sec)
+{
+	io_throttle::set_limits(name, bytes_per_sec, ops_per_sec);
+}
+
+void add_to_throttle_group(const std::string &file_name,
+		const std::string &group)
+{
+	io_throttle::add_to_group(file_name, group);
+}
+
+std::vector<mrc_point> get_cache_mrc(const std::vector<size_t> &cache_sizes)
+{
+	if (global_data.global_cache == NULL
+			|| global_data.global_cache->get_mrc() == NULL)
+		return std::vector<mrc_point>();
+	return global_data.global_cache->get_mrc()->get_curve(cache_sizes);
 }
 
 ssize_t file_io_factory::get_file_size() const
@@ -800,6 +860,7 @@ io_interface::~io_interface()
 
 file_io_factory::file_io_factory(const std::string _name): name(_name)
 {
+	trace_file_idx = -1;
 	// It's possible that SAFS hasn't been initialized.
 	if (global_data.raid_conf) {
 		safs_file f(*global_data.raid_conf, name);
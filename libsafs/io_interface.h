@@ -33,6 +33,8 @@
 #include "io_request.h"
 #include "comm_exception.h"
 #include "safs_header.h"
+#include "miss_ratio_curve.h"
+#include "io_trace.h"
 
 namespace safs
 {
@@ -162,6 +164,10 @@ class io_interface
 	static atomic_integer io_counter;
 	// Keep the I/O factory alive.
 	std::shared_ptr<file_io_factory> io_factory;
+	// It records the requests issued by applications. Only the I/O
+	// instances created for applications have a tracer.
+	io_tracer::ptr tracer;
+	int trace_file_idx;
 
 protected:
 	io_interface(thread *t, const safs_header &header) {
@@ -169,6 +175,18 @@ protected:
 		this->curr = t;
 		this->io_idx = io_counter.inc(1) - 1;
 		max_num_pending_ios = params.get_max_num_pending_ios();
+		trace_file_idx = -1;
+	}
+
+	void trace_reqs(const io_request reqs[], int num) {
+		if (tracer)
+			tracer->record(trace_file_idx, get_thread()->get_id(), reqs, num);
+	}
+
+	void trace_access(off_t off, ssize_t size, int access_method) {
+		if (tracer)
+			tracer->record(trace_file_idx, get_thread()->get_id(), off, size,
+					access_method);
 	}
 
 public:
@@ -195,6 +213,15 @@ public:
 		this->io_factory = io_factory;
 	}
 
+	/*
+	 * This sets the tracer that records the requests issued to the I/O
+	 * instance. `file_idx' is the index of the file in the trace.
+	 */
+	void set_tracer(io_tracer::ptr tracer, int file_idx) {
+		this->tracer = tracer;
+		this->trace_file_idx = file_idx;
+	}
+
 	/**
 	 * This method get the thread that the I/O instance is associated with.
 	 * \return the thread.
@@ -444,6 +471,11 @@ class file_io_factory
 	 * \param io the I/O instance to be destroyed.
 	 */
 	virtual void destroy_io(io_interface &io) = 0;
+
+	// The tracer of the requests issued to the I/O instances created
+	// by the factory.
+	io_tracer::ptr tracer;
+	int trace_file_idx;
 public:
 	typedef std::shared_ptr<file_io_factory> shared_ptr;
 
@@ -505,6 +537,8 @@ public:
 	virtual ssize_t get_file_size() const;
 
 	friend io_interface::ptr create_io(file_io_factory::shared_ptr factory, thread *t);
+	friend file_io_factory::shared_ptr create_io_factory(
+			const std::string &file_name, const int access_option);
 	friend class io_interface;
 };
 
@@ -566,6 +600,38 @@ void print_io_thread_stat();
  */
 void print_io_summary();
 
+/**
+ * This function gets the predicted hit ratios of the page cache for
+ * the workload seen so far, if the miss-ratio curve estimation is enabled
+ * with `mrc_sample_rate'.
+ * \param cache_sizes the cache sizes (in bytes) to predict the hit ratio.
+ * \return the points on the miss-ratio curve. It's empty if the estimation
+ * is disabled.
+ */
+std::vector<mrc_point> get_cache_mrc(const std::vector<size_t> &cache_sizes);
+
+/**
+ * This function limits the bandwidth and IOPS of accessing a file or
+ * a group of files. The limits are shared by all threads that access
+ * the file and apply when requests are sent to the I/O threads.
+ * It can be called at any time and the new limits take effect immediately.
+ * \param name The name of a file or a throttle group.
+ * \param bytes_per_sec The max bandwidth. 0 means unlimited.
+ * \param ops_per_sec The max number of requests per second. 0 means unlimited.
+ */
+void set_io_throttle(const std::string &name, size_t bytes_per_sec,
+		size_t ops_per_sec);
+
+/**
+ * This function adds a file to a throttle group. All files in the group
+ * share the limits set on the group.
+ * It should be used before I/O instances of the file are created.
+ * \param file_name The file name.
+ * \param group The name of the throttle group.
+ */
+void add_to_throttle_group(const std::string &file_name,
+		const std::string &group);
+
 /**
  * The users can set the weight of a file. The file weight is used by
  * the page cache. The file with a higher weight can have its data in
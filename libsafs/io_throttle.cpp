@@ -0,0 +1,146 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of SAFSlib.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <boost/format.hpp>
+
+#include "log.h"
+#include "common.h"
+#include "io_throttle.h"
+
+namespace safs
+{
+
+/*
+ * A bucket can accumulate the tokens generated in this period of time
+ * (in seconds) when it's idle.
+ */
+static const double BURST_PERIOD = 0.1;
+
+void token_bucket::set_rate(double rate, long curr_us)
+{
+	// Bring the bucket up to date with the old rate.
+	take(0, curr_us);
+	this->rate = rate;
+	this->capacity = rate * BURST_PERIOD;
+	tokens = std::min(tokens, capacity);
+}
+
+long token_bucket::take(double num, long curr_us)
+{
+	if (rate == 0) {
+		tokens = 0;
+		last_update = curr_us;
+		return 0;
+	}
+	tokens = std::min(capacity,
+			tokens + (curr_us - last_update) * rate / 1000000);
+	last_update = curr_us;
+	tokens -= num;
+	if (tokens >= 0)
+		return 0;
+	else
+		return -tokens / rate * 1000000;
+}
+
+long io_throttle::acquire(size_t size)
+{
+	long curr = get_curr_us();
+	lock.lock();
+	long wait_bytes = bytes.take(size, curr);
+	long wait_ops = ops.take(1, curr);
+	lock.unlock();
+	return std::max(wait_bytes, wait_ops);
+}
+
+/*
+ * The throttles of files and throttle groups, and the throttle group
+ * a file belongs to. Throttles are never removed, so an I/O instance can
+ * keep a reference to its throttle.
+ */
+static pthread_mutex_t throttle_mutex = PTHREAD_MUTEX_INITIALIZER;
+static std::unordered_map<std::string, io_throttle::ptr> throttle_table;
+static std::unordered_map<std::string, std::string> throttle_groups;
+
+static io_throttle::ptr get_throttle_locked(const std::string &name)
+{
+	auto it = throttle_table.find(name);
+	if (it != throttle_table.end())
+		return it->second;
+	io_throttle::ptr throttle = io_throttle::ptr(new io_throttle(name));
+	throttle_table.insert(std::pair<std::string, io_throttle::ptr>(name,
+				throttle));
+	return throttle;
+}
+
+io_throttle::ptr io_throttle::get(const std::string &file_name)
+{
+	pthread_mutex_lock(&throttle_mutex);
+	auto it = throttle_groups.find(file_name);
+	io_throttle::ptr throttle = get_throttle_locked(
+			it == throttle_groups.end() ? file_name : it->second);
+	pthread_mutex_unlock(&throttle_mutex);
+	return throttle;
+}
+
+void io_throttle::set_limits(const std::string &name, size_t bytes_per_sec,
+		size_t ops_per_sec)
+{
+	pthread_mutex_lock(&throttle_mutex);
+	io_throttle::ptr throttle = get_throttle_locked(name);
+	pthread_mutex_unlock(&throttle_mutex);
+
+	long curr = get_curr_us();
+	throttle->lock.lock();
+	throttle->bytes.set_rate(bytes_per_sec, curr);
+	throttle->ops.set_rate(ops_per_sec, curr);
+	throttle->limited = bytes_per_sec > 0 || ops_per_sec > 0;
+	throttle->lock.unlock();
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"throttle %1%: %2% bytes/s, %3% ops/s") % name % bytes_per_sec
+		% ops_per_sec;
+}
+
+void io_throttle::add_to_group(const std::string &file_name,
+		const std::string &group)
+{
+	pthread_mutex_lock(&throttle_mutex);
+	throttle_groups[file_name] = group;
+	pthread_mutex_unlock(&throttle_mutex);
+}
+
+void io_throttle::print_stat()
+{
+	pthread_mutex_lock(&throttle_mutex);
+	for (auto it = throttle_table.begin(); it != throttle_table.end(); it++) {
+		io_throttle::ptr throttle = it->second;
+		if (throttle->get_num_throttled_reqs() == 0)
+			continue;
+		printf("throttle %s (%.0f bytes/s, %.0f ops/s) delays %ld times, %ld us in total\n",
+				throttle->get_name().c_str(), throttle->bytes.get_rate(),
+				throttle->ops.get_rate(), throttle->get_num_throttled_reqs(),
+				throttle->get_throttled_time());
+	}
+	pthread_mutex_unlock(&throttle_mutex);
+}
+
+}
@@ -0,0 +1,129 @@
+#ifndef __IO_THROTTLE_H__
+#define __IO_THROTTLE_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of SAFSlib.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+
+#include "concurrency.h"
+
+namespace safs
+{
+
+/*
+ * A token bucket that generates `rate' tokens per second. The bucket can
+ * go into debt, so a large request doesn't need to wait for the bucket
+ * to accumulate enough tokens. Instead, the requests after it wait until
+ * the debt is paid off.
+ */
+class token_bucket
+{
+	// 0 means unlimited.
+	double rate;
+	// The max number of tokens accumulated when the bucket is idle.
+	double capacity;
+	double tokens;
+	long last_update;	// in us
+public:
+	token_bucket() {
+		rate = 0;
+		capacity = 0;
+		tokens = 0;
+		last_update = 0;
+	}
+
+	void set_rate(double rate, long curr_us);
+
+	double get_rate() const {
+		return rate;
+	}
+
+	/*
+	 * Take tokens from the bucket. It returns the time (in us) until
+	 * the bucket is out of debt.
+	 */
+	long take(double num, long curr_us);
+};
+
+/*
+ * This limits the bandwidth and IOPS of accessing a file or a group of
+ * files. All I/O instances that access the file share the same throttle.
+ * The limits can be changed at any time.
+ */
+class io_throttle
+{
+	const std::string name;
+	spin_lock lock;
+	token_bucket bytes;
+	token_bucket ops;
+	volatile bool limited;
+
+	atomic_number<long> num_throttled_reqs;
+	atomic_number<long> throttled_time;	// in us
+public:
+	typedef std::shared_ptr<io_throttle> ptr;
+
+	io_throttle(const std::string &name): name(name) {
+		limited = false;
+	}
+
+	/*
+	 * Get the throttle of a file. If the file is in a throttle group,
+	 * it returns the throttle of the group.
+	 */
+	static ptr get(const std::string &file_name);
+	static void set_limits(const std::string &name, size_t bytes_per_sec,
+			size_t ops_per_sec);
+	static void add_to_group(const std::string &file_name,
+			const std::string &group);
+	static void print_stat();
+
+	const std::string &get_name() const {
+		return name;
+	}
+
+	bool is_limited() const {
+		return limited;
+	}
+
+	/*
+	 * Account a request of `size' bytes. It returns the time (in us)
+	 * the caller should wait before issuing more requests.
+	 */
+	long acquire(size_t size);
+
+	void add_throttled_time(long us) {
+		num_throttled_reqs.inc(1);
+		throttled_time.inc(us);
+	}
+
+	long get_num_throttled_reqs() const {
+		return num_throttled_reqs.get();
+	}
+
+	long get_throttled_time() const {
+		return throttled_time.get();
+	}
+};
+
+}
+
+#endif
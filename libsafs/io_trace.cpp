@@ -0,0 +1,256 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of SAFSlib.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "log.h"
+#include "common.h"
+#include "io_request.h"
+#include "io_trace.h"
+
+namespace safs
+{
+
+static const char TRACE_MAGIC[8] = "SAFSTRC";
+static const uint32_t TRACE_VERSION = 1;
+// The number of records buffered in a thread.
+static const size_t MAX_TRACE_BUF = 4096;
+
+io_tracer::io_tracer(FILE *f)
+{
+	this->f = f;
+	start_time = get_curr_us();
+	pthread_mutex_init(&mutex, NULL);
+	pthread_key_create(&buf_key, NULL);
+	num_records = 0;
+	closed = false;
+}
+
+io_tracer::ptr io_tracer::create(const std::string &file)
+{
+	FILE *f = fopen(file.c_str(), "w");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't open %1%: %2%")
+			% file % strerror(errno);
+		return ptr();
+	}
+	// The header is written again when the trace is closed.
+	io_trace_header header;
+	memset(&header, 0, sizeof(header));
+	if (fwrite(&header, sizeof(header), 1, f) != 1) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't write %1%: %2%")
+			% file % strerror(errno);
+		fclose(f);
+		return ptr();
+	}
+	return ptr(new io_tracer(f));
+}
+
+io_tracer::~io_tracer()
+{
+	close();
+	for (size_t i = 0; i < bufs.size(); i++)
+		delete bufs[i];
+	pthread_key_delete(buf_key);
+	pthread_mutex_destroy(&mutex);
+}
+
+std::vector<io_trace_record> *io_tracer::get_buf()
+{
+	std::vector<io_trace_record> *buf
+		= (std::vector<io_trace_record> *) pthread_getspecific(buf_key);
+	if (buf == NULL) {
+		buf = new std::vector<io_trace_record>();
+		buf->reserve(MAX_TRACE_BUF);
+		pthread_setspecific(buf_key, buf);
+		pthread_mutex_lock(&mutex);
+		bufs.push_back(buf);
+		pthread_mutex_unlock(&mutex);
+	}
+	return buf;
+}
+
+/*
+ * The caller needs to hold the lock.
+ */
+void io_tracer::write_records(std::vector<io_trace_record> &buf)
+{
+	if (buf.empty())
+		return;
+	size_t ret = fwrite(buf.data(), sizeof(buf[0]), buf.size(), f);
+	if (ret != buf.size())
+		BOOST_LOG_TRIVIAL(error) << "can't write I/O trace: "
+			<< strerror(errno);
+	num_records += ret;
+	buf.clear();
+}
+
+int io_tracer::add_file(const std::string &name)
+{
+	int idx = -1;
+	pthread_mutex_lock(&mutex);
+	for (size_t i = 0; i < files.size(); i++)
+		if (files[i] == name)
+			idx = i;
+	if (idx < 0 && files.size() < MAX_FILES) {
+		idx = files.size();
+		files.push_back(name);
+	}
+	pthread_mutex_unlock(&mutex);
+	if (idx < 0)
+		BOOST_LOG_TRIVIAL(warning) << boost::format(
+				"too many files in the I/O trace, %1% isn't traced") % name;
+	return idx;
+}
+
+void io_tracer::record(int file_idx, int thread_id, off_t off, size_t size,
+		int access_method)
+{
+	if (closed || file_idx < 0)
+		return;
+	std::vector<io_trace_record> *buf = get_buf();
+	io_trace_record rec;
+	rec.time = get_curr_us() - start_time;
+	rec.offset = off;
+	rec.size = size;
+	rec.thread_id = thread_id;
+	rec.file_idx = file_idx;
+	rec.flags = access_method == WRITE ? TRACE_WRITE : 0;
+	buf->push_back(rec);
+	if (buf->size() >= MAX_TRACE_BUF) {
+		pthread_mutex_lock(&mutex);
+		write_records(*buf);
+		pthread_mutex_unlock(&mutex);
+	}
+}
+
+void io_tracer::record(int file_idx, int thread_id, const io_request reqs[],
+		int num)
+{
+	if (closed || file_idx < 0)
+		return;
+	std::vector<io_trace_record> *buf = get_buf();
+	long time = get_curr_us() - start_time;
+	for (int i = 0; i < num; i++) {
+		// Flush requests don't access data.
+		if (reqs[i].is_flush())
+			continue;
+		io_trace_record rec;
+		rec.time = time;
+		rec.offset = reqs[i].get_offset();
+		rec.size = reqs[i].get_size();
+		rec.thread_id = thread_id;
+		rec.file_idx = file_idx;
+		rec.flags = 0;
+		if (reqs[i].get_access_method() == WRITE)
+			rec.flags |= TRACE_WRITE;
+		if (reqs[i].is_sync())
+			rec.flags |= TRACE_SYNC;
+		if (reqs[i].is_high_prio())
+			rec.flags |= TRACE_HIGH_PRIO;
+		buf->push_back(rec);
+	}
+	if (buf->size() >= MAX_TRACE_BUF) {
+		pthread_mutex_lock(&mutex);
+		write_records(*buf);
+		pthread_mutex_unlock(&mutex);
+	}
+}
+
+void io_tracer::close()
+{
+	pthread_mutex_lock(&mutex);
+	if (closed) {
+		pthread_mutex_unlock(&mutex);
+		return;
+	}
+	closed = true;
+	for (size_t i = 0; i < bufs.size(); i++)
+		write_records(*bufs[i]);
+	for (size_t i = 0; i < files.size(); i++) {
+		uint16_t len = files[i].length();
+		fwrite(&len, sizeof(len), 1, f);
+		fwrite(files[i].c_str(), len, 1, f);
+	}
+
+	io_trace_header header;
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.num_files = files.size();
+	header.num_records = num_records;
+	fseek(f, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, f);
+	fclose(f);
+	pthread_mutex_unlock(&mutex);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"write %1% records of %2% files to the I/O trace")
+		% num_records % files.size();
+}
+
+io_trace_reader::ptr io_trace_reader::open(const std::string &file)
+{
+	FILE *f = fopen(file.c_str(), "r");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't open %1%: %2%")
+			% file % strerror(errno);
+		return ptr();
+	}
+	ptr reader(new io_trace_reader(f));
+	io_trace_header &header = reader->header;
+	if (fread(&header, sizeof(header), 1, f) != 1
+			|| memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+			|| header.version != TRACE_VERSION) {
+		BOOST_LOG_TRIVIAL(error) << file << " isn't a valid I/O trace";
+		return ptr();
+	}
+
+	// The file table is after all records.
+	fseek(f, sizeof(header) + header.num_records * sizeof(io_trace_record),
+			SEEK_SET);
+	for (uint32_t i = 0; i < header.num_files; i++) {
+		uint16_t len;
+		char name[USHRT_MAX + 1];
+		if (fread(&len, sizeof(len), 1, f) != 1
+				|| fread(name, len, 1, f) != 1) {
+			BOOST_LOG_TRIVIAL(error) << file << " is truncated";
+			return ptr();
+		}
+		reader->files.push_back(std::string(name, len));
+	}
+	fseek(f, sizeof(header), SEEK_SET);
+	return reader;
+}
+
+size_t io_trace_reader::read(io_trace_record recs[], size_t num)
+{
+	num = std::min(num, header.num_records - num_read);
+	if (num == 0)
+		return 0;
+	size_t ret = fread(recs, sizeof(recs[0]), num, f);
+	num_read += ret;
+	return ret;
+}
+
+}
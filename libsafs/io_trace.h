@@ -0,0 +1,159 @@
+#ifndef __IO_TRACE_H__
+#define __IO_TRACE_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of SAFSlib.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace safs
+{
+
+class io_request;
+
+/*
+ * An I/O trace is a binary file with the following layout:
+ *	io_trace_header
+ *	io_trace_record * num_records
+ *	the file table: for each file, a 16-bit name length and the name.
+ * The records of a thread are stored in the order of issue, but the records
+ * of different threads may interleave in any order.
+ */
+struct io_trace_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t num_files;
+	uint64_t num_records;
+};
+
+enum {
+	TRACE_WRITE = 0x1,
+	TRACE_SYNC = 0x2,
+	TRACE_HIGH_PRIO = 0x4,
+};
+
+struct io_trace_record
+{
+	// The time (in us) since the trace starts.
+	uint64_t time;
+	uint64_t offset;
+	uint32_t size;
+	uint16_t thread_id;
+	// The index of the file in the file table.
+	uint8_t file_idx;
+	uint8_t flags;
+
+	bool is_write() const {
+		return flags & TRACE_WRITE;
+	}
+};
+
+/*
+ * This records the requests that applications issue to I/O instances.
+ * Each thread buffers its records locally and the buffer is written to
+ * the trace file when it's full, so tracing doesn't add much contention.
+ */
+class io_tracer
+{
+	static const size_t MAX_FILES = 256;
+
+	FILE *f;
+	long start_time;
+	pthread_mutex_t mutex;
+	pthread_key_t buf_key;
+	// All per-thread buffers, so we can write all records when the trace
+	// is closed.
+	std::vector<std::vector<io_trace_record> *> bufs;
+	std::vector<std::string> files;
+	size_t num_records;
+	volatile bool closed;
+
+	io_tracer(FILE *f);
+	std::vector<io_trace_record> *get_buf();
+	void write_records(std::vector<io_trace_record> &buf);
+public:
+	typedef std::shared_ptr<io_tracer> ptr;
+
+	static ptr create(const std::string &file);
+
+	~io_tracer();
+
+	/*
+	 * Add a file to the file table of the trace. It returns the index of
+	 * the file, or -1 if there are too many files.
+	 */
+	int add_file(const std::string &name);
+	void record(int file_idx, int thread_id, const io_request reqs[], int num);
+	void record(int file_idx, int thread_id, off_t off, size_t size,
+			int access_method);
+	/*
+	 * Write all records to the trace file and close it. The threads
+	 * shouldn't issue requests any more.
+	 */
+	void close();
+};
+
+/*
+ * This reads the records in an I/O trace sequentially.
+ */
+class io_trace_reader
+{
+	FILE *f;
+	io_trace_header header;
+	std::vector<std::string> files;
+	size_t num_read;
+
+	io_trace_reader(FILE *f) {
+		this->f = f;
+		num_read = 0;
+	}
+public:
+	typedef std::shared_ptr<io_trace_reader> ptr;
+
+	static ptr open(const std::string &file);
+
+	~io_trace_reader() {
+		fclose(f);
+	}
+
+	const std::vector<std::string> &get_files() const {
+		return files;
+	}
+
+	size_t get_num_records() const {
+		return header.num_records;
+	}
+
+	/*
+	 * Read the next `num' records. It returns the number of records read.
+	 */
+	size_t read(io_trace_record recs[], size_t num);
+};
+
+}
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of SAFSlib.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <algorithm>
+#include <boost/format.hpp>
+
+#include "log.h"
+#include "parameters.h"
+#include "miss_ratio_curve.h"
+
+namespace safs
+{
+
+/*
+ * The initial capacity of the logical time.
+ */
+static const size_t INIT_TIME_CAPACITY = 4096;
+
+miss_ratio_curve::miss_ratio_curve(double sample_rate, size_t max_pages,
+		size_t bucket_npages): max_pages(max_pages), bucket_npages(
+			std::max(bucket_npages, 1UL))
+{
+	assert(sample_rate > 0 && sample_rate <= 1);
+	threshold = std::max<uint64_t>(sample_rate * HASH_MODULUS, 1);
+	reset();
+}
+
+void miss_ratio_curve::reset()
+{
+	lock.lock();
+	last_access.clear();
+	time2page.clear();
+	time2page.resize(INIT_TIME_CAPACITY);
+	access_tree.clear();
+	access_tree.resize(INIT_TIME_CAPACITY + 1);
+	curr_time = 0;
+	hist.clear();
+	num_cold_accesses = 0;
+	num_accesses = 0;
+	num_sampled = 0;
+	lock.unlock();
+}
+
+void miss_ratio_curve::tree_add(size_t time, int v)
+{
+	for (size_t i = time + 1; i < access_tree.size(); i += i & (-i))
+		access_tree[i] += v;
+}
+
+/*
+ * The number of sampled pages whose last access is at or before `time'.
+ */
+size_t miss_ratio_curve::tree_sum(size_t time) const
+{
+	long sum = 0;
+	for (size_t i = time + 1; i > 0; i -= i & (-i))
+		sum += access_tree[i];
+	return sum;
+}
+
+/*
+ * When we run out of the logical time, we renumber the last accesses of
+ * the sampled pages, so the logical time only grows with the number of
+ * tracked pages instead of the number of accesses.
+ */
+void miss_ratio_curve::compact_time()
+{
+	std::vector<uint64_t> live;
+	live.reserve(last_access.size());
+	for (size_t t = 0; t < curr_time; t++) {
+		auto it = last_access.find(time2page[t]);
+		if (it != last_access.end() && it->second == t)
+			live.push_back(time2page[t]);
+	}
+	assert(live.size() == last_access.size());
+
+	size_t capacity = std::max(INIT_TIME_CAPACITY, live.size() * 2);
+	time2page.clear();
+	time2page.resize(capacity);
+	access_tree.clear();
+	access_tree.resize(capacity + 1);
+	for (size_t t = 0; t < live.size(); t++) {
+		last_access[live[t]] = t;
+		time2page[t] = live[t];
+		tree_add(t, 1);
+	}
+	curr_time = live.size();
+}
+
+/*
+ * Halve the sampling rate and drop the pages that aren't sampled any more.
+ * The accesses recorded in the histogram are already weighted by the old
+ * rate, so they don't need to be adjusted.
+ */
+void miss_ratio_curve::lower_rate()
+{
+	if (threshold <= 1)
+		return;
+	threshold = threshold / 2;
+	for (auto it = last_access.begin(); it != last_access.end();) {
+		if ((it->first & (HASH_MODULUS - 1)) >= threshold) {
+			tree_add(it->second, -1);
+			it = last_access.erase(it);
+		}
+		else
+			it++;
+	}
+}
+
+void miss_ratio_curve::add_distance(double dist, double weight)
+{
+	// We don't need to track the reuse distance larger than the max
+	// cache size. They are misses anyway.
+	size_t max_nbuckets = MAX_CACHE_SIZE / PAGE_SIZE / bucket_npages + 1;
+	size_t idx = std::min<size_t>(dist / bucket_npages, max_nbuckets - 1);
+	if (idx >= hist.size())
+		hist.resize(idx + 1);
+	hist[idx] += weight;
+}
+
+void miss_ratio_curve::record(uint64_t hash)
+{
+	lock.lock();
+	double rate = get_sample_rate();
+	double weight = 1 / rate;
+	num_accesses += weight;
+	num_sampled++;
+	if (curr_time == time2page.size())
+		compact_time();
+
+	auto it = last_access.find(hash);
+	if (it == last_access.end()) {
+		num_cold_accesses += weight;
+		last_access.insert(std::pair<uint64_t, size_t>(hash, curr_time));
+	}
+	else {
+		// The number of distinct sampled pages accessed after the last
+		// access to this page.
+		size_t prev = it->second;
+		size_t dist = last_access.size() - tree_sum(prev);
+		add_distance(dist / rate, weight);
+		tree_add(prev, -1);
+		it->second = curr_time;
+	}
+	time2page[curr_time] = hash;
+	tree_add(curr_time, 1);
+	curr_time++;
+
+	if (last_access.size() > max_pages)
+		lower_rate();
+	lock.unlock();
+}
+
+double miss_ratio_curve::get_hit_ratio(size_t cache_size) const
+{
+	lock.lock();
+	if (num_accesses == 0) {
+		lock.unlock();
+		return 0;
+	}
+	// A page is hit in a LRU cache if its reuse distance is smaller than
+	// the cache size. We interpolate in the bucket that contains the cache
+	// size.
+	double cache_npages = ((double) cache_size) / PAGE_SIZE;
+	double hits = 0;
+	for (size_t i = 0; i < hist.size(); i++) {
+		double start = i * bucket_npages;
+		if (start >= cache_npages)
+			break;
+		double end = start + bucket_npages;
+		if (end <= cache_npages)
+			hits += hist[i];
+		else
+			hits += hist[i] * (cache_npages - start) / bucket_npages;
+	}
+	double ret = hits / num_accesses;
+	lock.unlock();
+	return std::min(ret, 1.0);
+}
+
+std::vector<mrc_point> miss_ratio_curve::get_curve(
+		const std::vector<size_t> &sizes) const
+{
+	std::vector<mrc_point> curve(sizes.size());
+	for (size_t i = 0; i < sizes.size(); i++) {
+		curve[i].cache_size = sizes[i];
+		curve[i].hit_ratio = get_hit_ratio(sizes[i]);
+	}
+	return curve;
+}
+
+std::vector<mrc_point> miss_ratio_curve::get_curve(size_t max_cache_size,
+		int num_points) const
+{
+	assert(num_points > 0);
+	std::vector<size_t> sizes(num_points);
+	for (int i = 0; i < num_points; i++)
+		sizes[i] = max_cache_size / num_points * (i + 1);
+	return get_curve(sizes);
+}
+
+void miss_ratio_curve::print_stat(const std::vector<size_t> &sizes) const
+{
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"MRC: %1% sampled accesses, sample rate: %2%, working set: %3% bytes")
+		% num_sampled % get_sample_rate() % get_working_set_size();
+	std::vector<mrc_point> curve = get_curve(sizes);
+	for (size_t i = 0; i < curve.size(); i++)
+		BOOST_LOG_TRIVIAL(info) << boost::format(
+				"\tcache size: %1% bytes, predicted hit ratio: %2%")
+			% curve[i].cache_size % curve[i].hit_ratio;
+}
+
+bool miss_ratio_curve::save(const std::string &file) const
+{
+	FILE *f = fopen(file.c_str(), "w");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't open %1%: %2%")
+			% file % strerror(errno);
+		return false;
+	}
+	lock.lock();
+	fprintf(f, "%d %ld %lf %lf %lf %ld %ld\n", PAGE_SIZE, bucket_npages,
+			get_sample_rate(), num_accesses, num_cold_accesses, num_sampled,
+			hist.size());
+	for (size_t i = 0; i < hist.size(); i++)
+		fprintf(f, "%lf\n", hist[i]);
+	lock.unlock();
+	fclose(f);
+	return true;
+}
+
+miss_ratio_curve::ptr miss_ratio_curve::load(const std::string &file)
+{
+	FILE *f = fopen(file.c_str(), "r");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't open %1%: %2%")
+			% file % strerror(errno);
+		return ptr();
+	}
+	int page_size;
+	size_t bucket_npages, num_sampled, nbuckets;
+	double rate, num_accesses, num_cold_accesses;
+	int ret = fscanf(f, "%d %ld %lf %lf %lf %ld %ld", &page_size,
+			&bucket_npages, &rate, &num_accesses, &num_cold_accesses,
+			&num_sampled, &nbuckets);
+	if (ret != 7 || page_size != PAGE_SIZE || rate <= 0) {
+		BOOST_LOG_TRIVIAL(error) << file << " isn't a valid MRC file";
+		fclose(f);
+		return ptr();
+	}
+	ptr mrc = create(rate, 0, bucket_npages);
+	mrc->num_accesses = num_accesses;
+	mrc->num_cold_accesses = num_cold_accesses;
+	mrc->num_sampled = num_sampled;
+	mrc->hist.resize(nbuckets);
+	for (size_t i = 0; i < nbuckets; i++) {
+		if (fscanf(f, "%lf", &mrc->hist[i]) != 1) {
+			BOOST_LOG_TRIVIAL(error) << file << " is truncated";
+			fclose(f);
+			return ptr();
+		}
+	}
+	fclose(f);
+	return mrc;
+}
+
+}
@@ -0,0 +1,179 @@
+#ifndef __MISS_RATIO_CURVE_H__
+#define __MISS_RATIO_CURVE_H__
+
+/*
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of SAFSlib.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "concurrency.h"
+#include "io_request.h"
+
+namespace safs
+{
+
+/**
+ * A point on the miss-ratio curve.
+ */
+struct mrc_point
+{
+	// The cache size in bytes.
+	size_t cache_size;
+	// The predicted hit ratio of a LRU cache of the size.
+	double hit_ratio;
+};
+
+/**
+ * This estimates the miss-ratio curve of the page cache online with
+ * SHARDS-style spatial sampling. A page is sampled if the hash of its
+ * location is smaller than a threshold, so all accesses to a sampled page
+ * are tracked and the reuse distance among the sampled pages, scaled by
+ * the sampling rate, approximates the reuse distance in the whole workload.
+ *
+ * The estimator keeps at most `max_pages' sampled pages. When there are
+ * more, it lowers the sampling rate and drops the pages that are no longer
+ * sampled, so memory consumption is bounded regardless of the workload.
+ *
+ * Only sampled accesses need to take the lock, so the overhead on
+ * the page cache is a hash computation for most of page accesses.
+ */
+class miss_ratio_curve
+{
+	static const uint64_t HASH_MODULUS = 1UL << 24;
+
+	// A page is sampled if its hash is smaller than the threshold.
+	volatile uint64_t threshold;
+	// The max number of sampled pages tracked by the estimator.
+	const size_t max_pages;
+	// The granularity of the histogram of reuse distances (in pages).
+	const size_t bucket_npages;
+
+	mutable spin_lock lock;
+	// The logical time of the last access to a sampled page.
+	std::unordered_map<uint64_t, size_t> last_access;
+	// The page accessed at a logical time. It's only used for compacting
+	// the logical time.
+	std::vector<uint64_t> time2page;
+	// The Fenwick tree over the logical time. An entry is 1 if a page was
+	// last accessed at the time.
+	std::vector<int> access_tree;
+	size_t curr_time;
+
+	// The histogram of the scaled reuse distances. Each sampled access
+	// contributes 1 / sampling rate.
+	std::vector<double> hist;
+	double num_cold_accesses;
+	double num_accesses;
+	size_t num_sampled;
+
+	static uint64_t hash_page(const data_loc_t &pg_id) {
+		uint64_t v = (((uint64_t) pg_id.get_file_id()) << 48)
+			^ (pg_id.get_offset() >> LOG_PAGE_SIZE);
+		// The finalizer of MurmurHash3.
+		v ^= v >> 33;
+		v *= 0xff51afd7ed558ccdUL;
+		v ^= v >> 33;
+		v *= 0xc4ceb9fe1a85ec53UL;
+		v ^= v >> 33;
+		return v;
+	}
+
+	double get_sample_rate() const {
+		return ((double) threshold) / HASH_MODULUS;
+	}
+
+	void tree_add(size_t time, int v);
+	size_t tree_sum(size_t time) const;
+	void compact_time();
+	void lower_rate();
+	void add_distance(double dist, double weight);
+	void record(uint64_t hash);
+
+	miss_ratio_curve(double sample_rate, size_t max_pages,
+			size_t bucket_npages);
+public:
+	typedef std::shared_ptr<miss_ratio_curve> ptr;
+
+	/**
+	 * Create a MRC estimator.
+	 * \param sample_rate the initial rate of sampling pages.
+	 * \param max_pages the max number of sampled pages to track.
+	 * \param bucket_npages the granularity of the curve in pages.
+	 */
+	static ptr create(double sample_rate, size_t max_pages,
+			size_t bucket_npages) {
+		return ptr(new miss_ratio_curve(sample_rate, max_pages, bucket_npages));
+	}
+
+	/**
+	 * Load the histogram saved by save().
+	 */
+	static ptr load(const std::string &file);
+
+	/**
+	 * Record an access to a page from the workload.
+	 */
+	void access(const data_loc_t &pg_id) {
+		uint64_t hash = hash_page(pg_id);
+		if ((hash & (HASH_MODULUS - 1)) < threshold)
+			record(hash);
+	}
+
+	/**
+	 * The predicted hit ratio of a LRU cache with the specified size.
+	 * \param cache_size the cache size in bytes.
+	 */
+	double get_hit_ratio(size_t cache_size) const;
+
+	/**
+	 * Get the points on the miss-ratio curve for the specified cache sizes.
+	 */
+	std::vector<mrc_point> get_curve(const std::vector<size_t> &sizes) const;
+
+	/**
+	 * Get `num_points' points on the curve evenly distributed between
+	 * 0 and `max_cache_size'.
+	 */
+	std::vector<mrc_point> get_curve(size_t max_cache_size,
+			int num_points) const;
+
+	/**
+	 * The working set size, estimated from the number of distinct pages.
+	 */
+	size_t get_working_set_size() const {
+		return num_cold_accesses * PAGE_SIZE;
+	}
+
+	size_t get_num_sampled_accesses() const {
+		return num_sampled;
+	}
+
+	bool save(const std::string &file) const;
+	void reset();
+	void print_stat(const std::vector<size_t> &sizes) const;
+};
+
+}
+
+#endif
@@ -37,6 +37,13 @@ str2int RAID_options[] = {
 	{"RAID0", RAID0},
 	{"RAID5", RAID5},
 	{"HASH", HASH},
+	{"RAID1", RAID1},
+};
+
+str2int poll_modes[] = {
+	{"block", POLL_BLOCK},
+	{"spin", POLL_SPIN},
+	{"adaptive", POLL_ADAPTIVE},
 };
 
 str2int cache_types[] = {
@@ -70,10 +77,17 @@ sys_parameters::sys_parameters()
 	writable = true;
 	max_num_pending_ios = 1000;
 	huge_page_enabled = false;
-	busy_wait = false;
+	poll_mode = POLL_ADAPTIVE;
+	max_spin_time = 100;
 	// The number of I/O threads will be determined based on the number of SSDs.
 	num_io_threads = 0;
 	bind_io_thread = false;
+	mrc_sample_rate = 0;
+	mrc_max_pages = 64 * 1024;
+	// By default, the granularity is 16MB.
+	mrc_granularity = (16 * 1024 * 1024) / PAGE_SIZE;
+	hedge_percentile = 95;
+	hedge_min_delay = 200;
 }
 
 void sys_parameters::init(const std::map<std::string, std::string> &configs)
@@ -82,6 +96,8 @@ void sys_parameters::init(const std::map<std::string, std::string> &configs)
 			sizeof(cache_types) / sizeof(cache_types[0]));
 	str2int_map RAID_option_map(RAID_options,
 			sizeof(RAID_options) / sizeof(RAID_options[0]));
+	str2int_map poll_mode_map(poll_modes,
+			sizeof(poll_modes) / sizeof(poll_modes[0]));
 	std::map<std::string, std::string>::const_iterator it;
 
 	it = configs.find("RAID_block_size");
@@ -186,7 +202,19 @@ void sys_parameters::init(const std::map<std::string, std::string> &configs)
 
 	it = configs.find("busy_wait");
 	if (it != configs.end()) {
-		busy_wait = true;
+		poll_mode = POLL_SPIN;
+	}
+
+	it = configs.find("poll_mode");
+	if (it != configs.end()) {
+		poll_mode = poll_mode_map.map(it->second);
+		if (poll_mode < 0)
+			throw std::invalid_argument("can't find the right poll mode");
+	}
+
+	it = configs.find("max_spin_time");
+	if (it != configs.end()) {
+		max_spin_time = atol(it->second.c_str());
 	}
 
 	it = configs.find("num_io_threads");
@@ -198,6 +226,48 @@ void sys_parameters::init(const std::map<std::string, std::string> &configs)
 	if (it != configs.end()) {
 		bind_io_thread = true;
 	}
+
+	it = configs.find("mrc_sample_rate");
+	if (it != configs.end()) {
+		mrc_sample_rate = atof(it->second.c_str());
+		if (mrc_sample_rate < 0 || mrc_sample_rate > 1)
+			throw std::invalid_argument("the MRC sample rate should be in [0, 1]");
+	}
+
+	it = configs.find("mrc_max_pages");
+	if (it != configs.end()) {
+		mrc_max_pages = str2size(it->second);
+	}
+
+	it = configs.find("mrc_granularity");
+	if (it != configs.end()) {
+		mrc_granularity = str2size(it->second) / PAGE_SIZE;
+		if (mrc_granularity == 0)
+			mrc_granularity = 1;
+	}
+
+	it = configs.find("mrc_file");
+	if (it != configs.end()) {
+		mrc_file = it->second;
+	}
+
+	it = configs.find("hedge_percentile");
+	if (it != configs.end()) {
+		hedge_percentile = atof(it->second.c_str());
+		if (hedge_percentile < 0 || hedge_percentile >= 100)
+			throw std::invalid_argument(
+					"the hedge percentile should be in [0, 100)");
+	}
+
+	it = configs.find("hedge_min_delay");
+	if (it != configs.end()) {
+		hedge_min_delay = atol(it->second.c_str());
+	}
+
+	it = configs.find("io_trace_file");
+	if (it != configs.end()) {
+		io_trace_file = it->second;
+	}
 }
 
 void sys_parameters::print()
@@ -221,9 +291,17 @@ void sys_parameters::print()
 	BOOST_LOG_TRIVIAL(info) << "\twritable: " << writable;
 	BOOST_LOG_TRIVIAL(info) << "\tmax_num_pending_ios: " << max_num_pending_ios;
 	BOOST_LOG_TRIVIAL(info) << "\thuge_page_enabled: " << huge_page_enabled;
-	BOOST_LOG_TRIVIAL(info) << "\tbusy_wait: " << busy_wait;
+	BOOST_LOG_TRIVIAL(info) << "\tpoll_mode: " << poll_mode;
+	BOOST_LOG_TRIVIAL(info) << "\tmax_spin_time: " << max_spin_time;
 	BOOST_LOG_TRIVIAL(info) << "\tnum_io_threads: " << num_io_threads;
 	BOOST_LOG_TRIVIAL(info) << "\tbind_io_thread: " << bind_io_thread;
+	BOOST_LOG_TRIVIAL(info) << "\tmrc_sample_rate: " << mrc_sample_rate;
+	BOOST_LOG_TRIVIAL(info) << "\tmrc_max_pages: " << mrc_max_pages;
+	BOOST_LOG_TRIVIAL(info) << "\tmrc_granularity: " << mrc_granularity;
+	BOOST_LOG_TRIVIAL(info) << "\tmrc_file: " << mrc_file;
+	BOOST_LOG_TRIVIAL(info) << "\thedge_percentile: " << hedge_percentile;
+	BOOST_LOG_TRIVIAL(info) << "\thedge_min_delay: " << hedge_min_delay;
+	BOOST_LOG_TRIVIAL(info) << "\tio_trace_file: " << io_trace_file;
 }
 
 void sys_parameters::print_help()
@@ -232,6 +310,8 @@ void sys_parameters::print_help()
 			sizeof(cache_types) / sizeof(cache_types[0]));
 	str2int_map RAID_option_map(RAID_options,
 			sizeof(RAID_options) / sizeof(RAID_options[0]));
+	str2int_map poll_mode_map(poll_modes,
+			sizeof(poll_modes) / sizeof(poll_modes[0]));
 
 	std::cout << "system parameters: " << std::endl;
 	std::cout << "\tRAID_block_size: x(k, K, m, M, g, G)" << std::endl;
@@ -263,12 +343,29 @@ void sys_parameters::print_help()
 		<< std::endl;
 	std::cout << "\thuge_page_enabled: determine whether we use huge page for large chunk of memory"
 		<< std::endl;
-	std::cout << "\tbusy_wait: determine whether remote I/O busy wait for I/O completion"
+	std::cout << "\tbusy_wait: determine whether remote I/O busy wait for I/O completion (the same as poll_mode=spin)"
+		<< std::endl;
+	poll_mode_map.print("\tpoll_mode: ");
+	std::cout << "\tmax_spin_time: the max time (in us) that a thread spins before it blocks in the adaptive poll mode"
 		<< std::endl;
 	std::cout << "\tnum_io_threads: the number of threads per NUMA node for I/O processing."
 		<< std::endl;
 	std::cout << "\tbind_io_thread: determine whether to bind an I/O thread to a CPU core and use the core exclusivly."
 		<< std::endl;
+	std::cout << "\tmrc_sample_rate: the rate of sampling pages to estimate the miss-ratio curve of the page cache (0 disables it)"
+		<< std::endl;
+	std::cout << "\tmrc_max_pages: the max number of sampled pages tracked for the miss-ratio curve"
+		<< std::endl;
+	std::cout << "\tmrc_granularity: the granularity of the miss-ratio curve x(k, K, m, M, g, G)"
+		<< std::endl;
+	std::cout << "\tmrc_file: the file where the miss-ratio curve is saved when SAFS is destroyed"
+		<< std::endl;
+	std::cout << "\thedge_percentile: the latency percentile after which a read on a mirrored file is sent to the next copy, until all copies are read (0 disables hedged reads)"
+		<< std::endl;
+	std::cout << "\thedge_min_delay: the min delay (in us) before a read on a mirrored file is hedged"
+		<< std::endl;
+	std::cout << "\tio_trace_file: the file where the I/O requests issued by applications are traced"
+		<< std::endl;
 }
 
 }
@@ -27,6 +27,8 @@
 #include <string>
 #include <memory>
 
+#include "hybrid_poll.h"
+
 #define USE_GCLOCK
 
 #define MIN_BLOCK_SIZE 512
@@ -54,12 +56,34 @@ class sys_parameters
 	bool writable;
 	int max_num_pending_ios;
 	bool huge_page_enabled;
-	bool busy_wait;
+	// How threads wait for I/O completion. busy_wait is the same as
+	// the spin mode.
+	int poll_mode;
+	// The max time (in us) that a thread spins before it blocks in
+	// the adaptive mode.
+	long max_spin_time;
 	// The number of I/O threads per NUMA node.
 	int num_io_threads;
 	// Bind a I/O thread to a specific CPU core and ensure no other threads
 	// to use this core.
 	bool bind_io_thread;
+	// The rate of sampling pages for estimating the miss-ratio curve of
+	// the page cache. 0 means the estimation is disabled.
+	double mrc_sample_rate;
+	// The max number of sampled pages tracked by the MRC estimator.
+	size_t mrc_max_pages;
+	// The granularity of the miss-ratio curve in pages.
+	size_t mrc_granularity;
+	// The file where the MRC is saved when SAFS is destroyed.
+	std::string mrc_file;
+	// A read on a mirrored file is sent to the next copy if it doesn't
+	// complete by this percentile of the read latency after the last copy
+	// was issued. It's hedged until all copies are read.
+	double hedge_percentile;
+	// The min delay (in us) before a read is hedged.
+	long hedge_min_delay;
+	// The file where the requests issued by applications are traced.
+	std::string io_trace_file;
 public:
 	sys_parameters();
 
@@ -69,7 +93,15 @@ public:
 	void print_help();
 
 	bool is_busy_wait() const {
-		return busy_wait;
+		return poll_mode == POLL_SPIN;
+	}
+
+	int get_poll_mode() const {
+		return poll_mode;
+	}
+
+	long get_max_spin_time() const {
+		return max_spin_time;
 	}
 
 	// in pages
@@ -153,6 +185,35 @@ public:
 	bool is_bind_io_thread() const {
 		return bind_io_thread;
 	}
+
+	double get_mrc_sample_rate() const {
+		return mrc_sample_rate;
+	}
+
+	size_t get_mrc_max_pages() const {
+		return mrc_max_pages;
+	}
+
+	// in pages
+	size_t get_mrc_granularity() const {
+		return mrc_granularity;
+	}
+
+	const std::string &get_mrc_file() const {
+		return mrc_file;
+	}
+
+	double get_hedge_percentile() const {
+		return hedge_percentile;
+	}
+
+	long get_hedge_min_delay() const {
+		return hedge_min_delay;
+	}
+
+	const std::string &get_io_trace_file() const {
+		return io_trace_file;
+	}
 };
 
 extern sys_parameters params;
@@ -50,7 +50,9 @@ buffered_io::buffered_io(const logical_file_partition &partition_, thread *t,
 
 io_status buffered_io::access(char *buf, off_t offset, ssize_t size, int access_method) {
 	ASSERT_EQ(get_thread(), thread::get_curr_thread());
+	trace_access(offset, size, access_method);
 	int fd;
+	off_t orig_offset = offset;
 	if (fds.size() == 1)
 		fd = fds[0];
 	else {
@@ -61,8 +63,13 @@ io_status buffered_io::access(char *buf, off_t offset, ssize_t size, int access_
 	}
 	ssize_t ret;
 	// TODO I need to make sure all data is read or written to the file.
-	if (access_method == WRITE)
+	if (access_method == WRITE) {
 		ret = pwrite(fd, buf, size, offset);
+		// A write to a mirrored file has to update all copies.
+		off_t pg_off = orig_offset / PAGE_SIZE;
+		for (int i = 1; i < partition.get_num_copies() && ret >= 0; i++)
+			ret = pwrite(fds[partition.map2copy(pg_off, i)], buf, size, offset);
+	}
 	else
 		ret = pread(fd, buf, size, offset);
 	io_status status;
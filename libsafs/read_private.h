@@ -57,6 +57,17 @@ public:
 		return fds[idx];
 	}
 
+	/*
+	 * Get the fd of the file that stores the `copy'-th copy of the data
+	 * in a mirrored file. It returns -1 if the file isn't opened here.
+	 */
+	int get_copy_fd(long offset, int copy) {
+		int idx = partition.map2copy(offset / PAGE_SIZE, copy);
+		if (idx < 0)
+			return -1;
+		return fds[idx];
+	}
+
 	const std::vector<int> &get_fds() const {
 		return fds;
 	}
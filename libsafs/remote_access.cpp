@@ -97,11 +97,33 @@ remote_io::remote_io(const std::vector<disk_io_thread::ptr> &remotes,
 	}
 	cb = NULL;
 	this->block_mapper = mapper;
+	this->throttle = io_throttle::get(mapper->get_name());
+}
+
+/*
+ * The poll statistics of all destroyed remote I/O instances.
+ */
+static pthread_mutex_t poll_stat_mutex = PTHREAD_MUTEX_INITIALIZER;
+static hybrid_poller poll_stat(POLL_BLOCK, 0);
+
+static void merge_poll_stat(const hybrid_poller &poller)
+{
+	pthread_mutex_lock(&poll_stat_mutex);
+	poll_stat.merge_stat(poller);
+	pthread_mutex_unlock(&poll_stat_mutex);
+}
+
+void remote_io::print_poll_stat()
+{
+	pthread_mutex_lock(&poll_stat_mutex);
+	poll_stat.print_stat("application threads");
+	pthread_mutex_unlock(&poll_stat_mutex);
 }
 
 remote_io::~remote_io()
 {
 	cleanup();
+	merge_poll_stat(poller);
 	assert(senders.size() == low_prio_senders.size());
 	int num_senders = senders.size();
 	for (int i = 0; i < num_senders; i++) {
@@ -158,10 +180,29 @@ void remote_io::cleanup()
 		io_threads[i]->flush_requests();
 }
 
+/*
+ * We don't sleep if the wait is shorter than this (in us). The debt stays
+ * in the throttle, so the following requests will wait longer.
+ */
+static const long MIN_THROTTLE_WAIT = 1000;
+
+void remote_io::throttle_access(const io_request &req)
+{
+	long wait = throttle->acquire(req.get_size());
+	if (wait >= MIN_THROTTLE_WAIT) {
+		// Send the requests we have had, so the disks don't idle
+		// while we are waiting.
+		flush_requests();
+		usleep(wait);
+		throttle->add_throttled_time(wait);
+	}
+}
+
 void remote_io::access(io_request *requests, int num,
 		io_status *status)
 {
 	ASSERT_EQ(get_thread(), thread::get_curr_thread());
+	trace_reqs(requests, num);
 	num_issued_reqs.inc(num);
 
 	bool syncd = false;
@@ -195,6 +236,9 @@ void remote_io::access(io_request *requests, int num,
 			syncd = true;
 		}
 
+		if (throttle->is_limited())
+			throttle_access(requests[i]);
+
 		// If the request accesses one RAID block, it's simple.
 		if (requests[i].inside_RAID_block(get_block_size())) {
 			off_t pg_off = requests[i].get_offset() / PAGE_SIZE;
@@ -410,11 +454,13 @@ int remote_io::wait4complete(int num_to_complete)
 	num_to_complete = min(pending, num_to_complete);
 
 	process_all_completed_requests();
-	while (pending - num_pending_ios() < num_to_complete) {
-		if (!params.is_busy_wait())
-			get_thread()->wait();
-		process_all_completed_requests();
-	}
+	thread *curr = get_thread();
+	while (pending - num_pending_ios() < num_to_complete)
+		poller.wait([this]() {
+					return this->process_all_completed_requests();
+				}, [curr]() {
+					curr->wait();
+				});
 	return pending - num_pending_ios();
 }
 
@@ -436,7 +482,21 @@ class remote_io_select: public io_select
 	// an IO interface is destroyed.
 	std::vector<remote_io::ptr> ios;
 	std::set<remote_io::ptr> io_set;
+	hybrid_poller poller;
+
+	int process_all_completed_requests() {
+		int num_complete = 0;
+		for (size_t i = 0; i < ios.size(); i++) {
+			ios[i]->flush_requests();
+			num_complete += ios[i]->process_all_completed_requests();
+		}
+		return num_complete;
+	}
 public:
+	~remote_io_select() {
+		merge_poll_stat(poller);
+	}
+
 	virtual bool add_io(io_interface::ptr io);
 	virtual int num_pending_ios() const;
 	virtual int wait4complete(int num_to_complete);
@@ -479,14 +539,12 @@ int remote_io_select::wait4complete(int num_to_complete)
 
 	// If we need to process more I/O requests, we need to wait until
 	// I/O threads wake us up.
-	while (num_complete < num_to_complete) {
-		if (!params.is_busy_wait())
-			curr->wait();
-		for (size_t i = 0; i < ios.size(); i++) {
-			ios[i]->flush_requests();
-			num_complete += ios[i]->process_all_completed_requests();
-		}
-	}
+	while (num_complete < num_to_complete)
+		num_complete += poller.wait([this]() {
+					return this->process_all_completed_requests();
+				}, [curr]() {
+					curr->wait();
+				});
 	return num_complete;
 }
 
@@ -23,6 +23,7 @@
 #include "slab_allocator.h"
 #include "io_interface.h"
 #include "container.h"
+#include "io_throttle.h"
 
 namespace safs
 {
@@ -49,11 +50,17 @@ class remote_io: public io_interface
 	std::vector<std::shared_ptr<disk_io_thread> > io_threads;
 	callback::ptr cb;
 	std::shared_ptr<file_mapper> block_mapper;
+	// The throttle shared by all I/O instances of the file.
+	io_throttle::ptr throttle;
 	thread_safe_FIFO_queue<io_request> complete_queue;
 	slab_allocator &msg_allocator;
 
 	atomic_integer num_completed_reqs;
 	atomic_integer num_issued_reqs;
+	// It decides whether to spin or to block when waiting for completion.
+	hybrid_poller poller;
+
+	void throttle_access(const io_request &req);
 public:
 	typedef std::shared_ptr<remote_io> ptr;
 
@@ -110,6 +117,12 @@ public:
 	}
 
 	virtual io_select::ptr create_io_select() const;
+
+	/*
+	 * Print how long the threads spin and sleep to wait for the requests
+	 * of the destroyed I/O instances.
+	 */
+	static void print_poll_stat();
 };
 
 }
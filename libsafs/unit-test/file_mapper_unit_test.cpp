@@ -97,4 +97,39 @@ int main()
 	printf("hash mapper\n");
 	hash_mapper mapperh("", files, BLOCK_SIZE);
 	test_get_file_sizes(mapperh, BLOCK_SIZE);
+
+	printf("RAID1 mapper\n");
+	RAID1_mapper mapper1("", files, BLOCK_SIZE);
+	test_get_file_sizes(mapper1, BLOCK_SIZE);
+	assert(mapper1.get_num_copies() == num_files);
+	std::vector<int> num_blocks1(num_files);
+	for (int i = 0; i < 10000; i++) {
+		off_t off = i * BLOCK_SIZE;
+		block_identifier bid;
+		mapper1.map(off, bid);
+		assert(bid.idx == mapper1.map2file(off));
+		assert(bid.idx == mapper1.map2copy(off, 0));
+		assert(bid.off == off);
+		num_blocks1[bid.idx]++;
+		// All copies are in different files.
+		std::vector<bool> has_copy(num_files);
+		for (int j = 0; j < num_files; j++) {
+			int idx = mapper1.map2copy(off, j);
+			assert(!has_copy[idx]);
+			has_copy[idx] = true;
+		}
+	}
+	// The first copies are distributed to all files evenly.
+	for (int i = 0; i < num_files; i++)
+		assert(abs(num_blocks1[i] - 10000 / num_files) <= 1);
+
+	// Only the file that failed a write is stale.
+	for (int i = 0; i < num_files; i++)
+		assert(!mapper1.is_stale(i));
+	mapper1.set_stale(1);
+	for (int i = 0; i < num_files; i++)
+		assert(mapper1.is_stale(i) == (i == 1));
+	// Other mappers don't track stale files.
+	mapperh.set_stale(1);
+	assert(!mapperh.is_stale(1));
 }
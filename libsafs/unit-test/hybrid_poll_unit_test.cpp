@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <assert.h>
+#include <limits.h>
+
+#include "hybrid_poll.h"
+
+using namespace safs;
+
+void test_modes()
+{
+	printf("test poll modes\n");
+	hybrid_poller block(POLL_BLOCK, 100);
+	hybrid_poller spin(POLL_SPIN, 100);
+	for (int i = 0; i < 10; i++) {
+		block.add_wait(0, 10, true);
+		spin.add_wait(10, 0, true);
+	}
+	assert(block.get_spin_time() == 0);
+	assert(spin.get_spin_time() == LONG_MAX);
+	assert(spin.get_num_spin_hits() == 10);
+	assert(block.get_num_spin_hits() == 0);
+	assert(block.get_sleep_time_sum() == 100);
+	assert(spin.get_spin_time_sum() == 100);
+}
+
+void test_adaptive()
+{
+	printf("test adaptive polling\n");
+	hybrid_poller poller(POLL_ADAPTIVE, 100);
+	// We don't know anything about the wait time in the beginning.
+	assert(poller.get_spin_time() == 0);
+
+	// Requests complete quickly, so we should spin a little longer
+	// than the wait time.
+	for (int i = 0; i < 100; i++)
+		poller.add_wait(20, 0, true);
+	long spin_time = poller.get_spin_time();
+	printf("spin %ldus for 20us waits\n", spin_time);
+	assert(spin_time >= 20 && spin_time <= 100);
+
+	// Waits that time out don't change the estimation.
+	poller.add_wait(1000, 0, false);
+	assert(poller.get_spin_time() == spin_time);
+
+	// Requests complete slowly, so we shouldn't spin.
+	for (int i = 0; i < 100; i++)
+		poller.add_wait(0, 1000, true);
+	assert(poller.get_spin_time() == 0);
+
+	// Spinning resumes when requests complete quickly again.
+	for (int i = 0; i < 100; i++)
+		poller.add_wait(0, 30, true);
+	spin_time = poller.get_spin_time();
+	printf("spin %ldus for 30us waits\n", spin_time);
+	assert(spin_time >= 30 && spin_time <= 100);
+}
+
+void test_wait()
+{
+	printf("test waiting for events\n");
+	hybrid_poller poller(POLL_ADAPTIVE, 100);
+	int num_polls = 0;
+	int num_blocks = 0;
+	// The event is found after the thread is woken up.
+	int ret = poller.wait([&]() {
+				num_polls++;
+				return num_blocks > 0 ? 1 : 0;
+			}, [&]() {
+				num_blocks++;
+			});
+	assert(ret == 1);
+	assert(num_blocks == 1);
+	assert(poller.get_num_waits() == 1);
+
+	// The event is found while spinning.
+	for (int i = 0; i < 10; i++)
+		poller.add_wait(50, 0, true);
+	num_blocks = 0;
+	num_polls = 0;
+	ret = poller.wait([&]() {
+				num_polls++;
+				return num_polls >= 3 ? 2 : 0;
+			}, [&]() {
+				num_blocks++;
+			});
+	assert(ret == 2);
+	assert(num_blocks == 0);
+}
+
+int main()
+{
+	test_modes();
+	test_adaptive();
+	test_wait();
+}
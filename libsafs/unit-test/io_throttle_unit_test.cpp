@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "io_throttle.h"
+
+using namespace safs;
+
+void test_token_bucket()
+{
+	printf("test token bucket\n");
+	token_bucket bucket;
+	// An unlimited bucket never delays requests.
+	assert(bucket.take(1000000, 0) == 0);
+
+	// 1MB/s, so the bucket can hold 100KB.
+	bucket.set_rate(1024 * 1024, 0);
+	assert(bucket.take(1024, 0) > 0);
+	long curr = 1000000;
+	assert(bucket.take(100 * 1024, curr) == 0);
+	// The bucket is in debt of almost 1MB, which takes a second to pay off.
+	long wait = bucket.take(1024 * 1024, curr);
+	assert(wait > 900000 && wait <= 1000000);
+	assert(bucket.take(0, curr + wait + 1) == 0);
+
+	// The idle time can only accumulate tokens up to the capacity.
+	curr += 100 * 1000000L;
+	assert(bucket.take(100 * 1024, curr) == 0);
+	assert(bucket.take(4096, curr) > 0);
+}
+
+void test_throttle()
+{
+	printf("test throttle groups\n");
+	io_throttle::add_to_group("file1", "group");
+	io_throttle::add_to_group("file2", "group");
+	io_throttle::ptr t1 = io_throttle::get("file1");
+	io_throttle::ptr t2 = io_throttle::get("file2");
+	io_throttle::ptr t3 = io_throttle::get("file3");
+	assert(t1 == t2);
+	assert(t1 != t3);
+	assert(!t1->is_limited());
+	assert(t1->acquire(1024 * 1024) == 0);
+
+	// The limits can be changed after the throttle is used.
+	io_throttle::set_limits("group", 0, 100);
+	assert(t1->is_limited());
+	assert(!t3->is_limited());
+	long wait = 0;
+	for (int i = 0; i < 100; i++)
+		wait = t2->acquire(4096);
+	assert(wait > 0);
+	io_throttle::set_limits("group", 0, 0);
+	assert(!t1->is_limited());
+}
+
+int main()
+{
+	test_token_bucket();
+	test_throttle();
+}
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <assert.h>
+#include <unistd.h>
+
+#include "io_request.h"
+#include "io_trace.h"
+
+using namespace safs;
+
+const int NUM_RECORDS = 10000;
+
+void test_trace()
+{
+	std::string file = "/tmp/test.trace";
+	io_tracer::ptr tracer = io_tracer::create(file);
+	assert(tracer);
+	int idx0 = tracer->add_file("file0");
+	int idx1 = tracer->add_file("file1");
+	assert(idx0 == 0 && idx1 == 1);
+	assert(tracer->add_file("file0") == 0);
+	for (int i = 0; i < NUM_RECORDS; i++)
+		tracer->record(i % 2, 3, ((off_t) i) * 4096, 4096,
+				i % 3 == 0 ? WRITE : READ);
+	tracer->close();
+
+	io_trace_reader::ptr reader = io_trace_reader::open(file);
+	assert(reader);
+	assert(reader->get_num_records() == (size_t) NUM_RECORDS);
+	assert(reader->get_files().size() == 2);
+	assert(reader->get_files()[1] == "file1");
+	std::vector<io_trace_record> recs(1000);
+	int num_read = 0;
+	long prev_time = 0;
+	size_t num;
+	while ((num = reader->read(recs.data(), recs.size())) > 0) {
+		for (size_t i = 0; i < num; i++) {
+			int j = num_read + i;
+			assert(recs[i].offset == ((size_t) j) * 4096);
+			assert(recs[i].size == 4096);
+			assert(recs[i].thread_id == 3);
+			assert(recs[i].file_idx == j % 2);
+			assert(recs[i].is_write() == (j % 3 == 0));
+			assert((long) recs[i].time >= prev_time);
+			prev_time = recs[i].time;
+		}
+		num_read += num;
+	}
+	assert(num_read == NUM_RECORDS);
+	printf("read %d records from the trace\n", num_read);
+	unlink(file.c_str());
+}
+
+int main()
+{
+	test_trace();
+}
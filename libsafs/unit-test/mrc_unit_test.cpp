@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "miss_ratio_curve.h"
+
+using namespace safs;
+
+const int NUM_PAGES = 8192;
+const int NUM_ROUNDS = 20;
+
+/*
+ * Access the pages in a loop. A LRU cache can't hit any page unless
+ * it can hold all pages.
+ */
+void run_loop(miss_ratio_curve &mrc)
+{
+	for (int i = 0; i < NUM_ROUNDS; i++)
+		for (int j = 0; j < NUM_PAGES; j++)
+			mrc.access(data_loc_t(0, ((off_t) j) * PAGE_SIZE));
+}
+
+void check_loop(const miss_ratio_curve &mrc, double err)
+{
+	double expected = 1 - 1.0 / NUM_ROUNDS;
+	size_t ws_size = ((size_t) NUM_PAGES) * PAGE_SIZE;
+	printf("working set: %ld, expected: %ld\n", mrc.get_working_set_size(),
+			ws_size);
+	assert(fabs(((double) mrc.get_working_set_size()) / ws_size - 1) < err);
+	double small_hit = mrc.get_hit_ratio(ws_size / 2);
+	double large_hit = mrc.get_hit_ratio(ws_size * 2);
+	printf("hit ratio of a small cache: %f, of a large cache: %f\n",
+			small_hit, large_hit);
+	assert(small_hit < err);
+	assert(fabs(large_hit - expected) < err);
+}
+
+void test_exact()
+{
+	printf("test full sampling\n");
+	miss_ratio_curve::ptr mrc = miss_ratio_curve::create(1, NUM_PAGES * 2, 16);
+	run_loop(*mrc);
+	assert(mrc->get_num_sampled_accesses() == (size_t) NUM_PAGES * NUM_ROUNDS);
+	check_loop(*mrc, 0.01);
+
+	// A page accessed twice in a row is always a hit.
+	mrc->reset();
+	for (int i = 0; i < NUM_PAGES; i++) {
+		mrc->access(data_loc_t(1, ((off_t) i) * PAGE_SIZE));
+		mrc->access(data_loc_t(1, ((off_t) i) * PAGE_SIZE));
+	}
+	assert(fabs(mrc->get_hit_ratio(16 * PAGE_SIZE) - 0.5) < 0.01);
+}
+
+void test_sampling()
+{
+	printf("test spatial sampling\n");
+	miss_ratio_curve::ptr mrc = miss_ratio_curve::create(0.1, NUM_PAGES, 16);
+	run_loop(*mrc);
+	assert(mrc->get_num_sampled_accesses() < (size_t) NUM_PAGES * NUM_ROUNDS / 5);
+	check_loop(*mrc, 0.2);
+}
+
+void test_bounded()
+{
+	printf("test bounded memory\n");
+	// The estimator has to lower the sampling rate to track
+	// at most 256 pages.
+	miss_ratio_curve::ptr mrc = miss_ratio_curve::create(1, 256, 16);
+	run_loop(*mrc);
+	check_loop(*mrc, 0.3);
+}
+
+void test_save_load()
+{
+	printf("test save and load\n");
+	miss_ratio_curve::ptr mrc = miss_ratio_curve::create(1, NUM_PAGES * 2, 16);
+	run_loop(*mrc);
+	std::string file = "/tmp/test.mrc";
+	bool ret = mrc->save(file);
+	assert(ret);
+	miss_ratio_curve::ptr loaded = miss_ratio_curve::load(file);
+	assert(loaded);
+	std::vector<mrc_point> curve1 = mrc->get_curve(
+			((size_t) NUM_PAGES) * PAGE_SIZE * 2, 8);
+	std::vector<mrc_point> curve2 = loaded->get_curve(
+			((size_t) NUM_PAGES) * PAGE_SIZE * 2, 8);
+	assert(curve1.size() == curve2.size());
+	for (size_t i = 0; i < curve1.size(); i++) {
+		assert(curve1[i].cache_size == curve2[i].cache_size);
+		assert(fabs(curve1[i].hit_ratio - curve2[i].hit_ratio) < 1e-4);
+	}
+	unlink(file.c_str());
+}
+
+int main()
+{
+	test_exact();
+	test_sampling();
+	test_bounded();
+	test_save_load();
+}
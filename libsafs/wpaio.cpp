@@ -107,6 +107,9 @@ int aio_ctx_impl::io_wait(struct timespec* to, int num)
   } while (ret == -EINTR);
   if (ret < 0)
 	  throw std::system_error(std::make_error_code((std::errc) ret), "io_wait");
+  // io_getevents may time out without any completed requests.
+  if (n == 0)
+	  return 0;
 
   struct iocb *iocbs[n];
   long res[n];
@@ -29,6 +29,8 @@
 #include "safs_file.h"
 #include "file_mapper.h"
 #include "RAID_config.h"
+#include "miss_ratio_curve.h"
+#include "container.h"
 
 using namespace safs;
 
@@ -487,6 +489,279 @@ void comm_rename(int argc, char *argv[])
 				new_name.c_str());
 }
 
+void comm_show_mrc(int argc, char *argv[])
+{
+	if (argc < 1) {
+		fprintf(stderr, "mrc mrc_file [max_cache_size] [num_points]\n");
+		fprintf(stderr, "mrc_file is saved by a SAFS application with mrc_file\n");
+		return;
+	}
+
+	miss_ratio_curve::ptr mrc = miss_ratio_curve::load(argv[0]);
+	if (mrc == NULL)
+		return;
+
+	// By default, we show the curve up to the working set size, beyond
+	// which the hit ratio doesn't increase any more.
+	size_t max_cache_size = mrc->get_working_set_size();
+	if (argc >= 2)
+		max_cache_size = str2size(argv[1]);
+	int num_points = 16;
+	if (argc >= 3)
+		num_points = atoi(argv[2]);
+	if (max_cache_size == 0 || num_points <= 0) {
+		fprintf(stderr, "the MRC is empty\n");
+		return;
+	}
+
+	printf("%ld sampled accesses, working set: %ld bytes\n",
+			mrc->get_num_sampled_accesses(), mrc->get_working_set_size());
+	std::vector<mrc_point> curve = mrc->get_curve(max_cache_size, num_points);
+	printf("cache size (bytes)\thit ratio\n");
+	for (size_t i = 0; i < curve.size(); i++)
+		printf("%ld\t%.4f\n", curve[i].cache_size, curve[i].hit_ratio);
+}
+
+class replay_callback: public callback
+{
+public:
+	int invoke(io_request *rqs[], int num) {
+		for (int i = 0; i < num; i++)
+			free(rqs[i]->get_buf());
+		return 0;
+	}
+};
+
+/*
+ * This thread replays the requests issued by a thread in the trace.
+ * The records are read from the trace in chunks and passed to the thread
+ * through a bounded queue, so we don't need to keep the entire trace
+ * in memory.
+ */
+class replay_thread: public thread
+{
+	static const int MAX_PENDING_REQS = 64;
+	static const int MAX_QUEUED_RECS = 64 * 1024;
+	static const int FETCH_SIZE = 1024;
+
+	const std::vector<file_io_factory::shared_ptr> &factories;
+	blocking_FIFO_queue<io_trace_record> queue;
+	bool timed;
+	bool replay_writes;
+	// Direct I/O requires the requests to be aligned to MIN_BLOCK_SIZE.
+	bool aligned_only;
+	long start_time;
+	size_t num_reqs;
+	size_t num_bytes;
+	size_t num_skipped_writes;
+	size_t num_skipped_unaligned;
+
+	static bool is_end(const io_trace_record &rec) {
+		return rec.size == 0;
+	}
+public:
+	replay_thread(const std::vector<file_io_factory::shared_ptr> &factories,
+			int node_id, bool timed, bool replay_writes, bool aligned_only,
+			long start_time): thread("replay_thread", node_id),
+			factories(factories), queue(node_id, "replay_queue", FETCH_SIZE,
+					MAX_QUEUED_RECS) {
+		this->timed = timed;
+		this->replay_writes = replay_writes;
+		this->aligned_only = aligned_only;
+		this->start_time = start_time;
+		num_reqs = 0;
+		num_bytes = 0;
+		num_skipped_writes = 0;
+		num_skipped_unaligned = 0;
+	}
+
+	/*
+	 * Add records to the thread. It blocks if the thread has too many
+	 * records to replay.
+	 */
+	void add(std::vector<io_trace_record> &recs) {
+		queue.add(recs.data(), recs.size());
+	}
+
+	/*
+	 * Tell the thread there are no more records.
+	 */
+	void add_end() {
+		io_trace_record rec;
+		memset(&rec, 0, sizeof(rec));
+		queue.add(&rec, 1);
+	}
+
+	size_t get_num_reqs() const {
+		return num_reqs;
+	}
+
+	size_t get_num_bytes() const {
+		return num_bytes;
+	}
+
+	size_t get_num_skipped_writes() const {
+		return num_skipped_writes;
+	}
+
+	size_t get_num_skipped_unaligned() const {
+		return num_skipped_unaligned;
+	}
+
+	void run();
+};
+
+void replay_thread::run()
+{
+	std::vector<io_interface::ptr> ios(factories.size());
+	for (size_t i = 0; i < factories.size(); i++) {
+		ios[i] = create_io(factories[i], this);
+		ios[i]->set_callback(callback::ptr(new replay_callback()));
+	}
+
+	std::vector<io_trace_record> recs(FETCH_SIZE);
+	bool end = false;
+	while (!end) {
+		int num = queue.fetch(recs.data(), recs.size());
+		for (int i = 0; i < num; i++) {
+			const io_trace_record &rec = recs[i];
+			if (is_end(rec)) {
+				end = true;
+				break;
+			}
+			if (rec.is_write() && !replay_writes) {
+				num_skipped_writes++;
+				continue;
+			}
+			if (aligned_only && (rec.offset % MIN_BLOCK_SIZE
+						|| rec.size % MIN_BLOCK_SIZE)) {
+				num_skipped_unaligned++;
+				continue;
+			}
+			if (timed) {
+				long delay = start_time + (long) rec.time - get_curr_us();
+				if (delay > 0)
+					usleep(delay);
+			}
+			io_interface::ptr io = ios[rec.file_idx];
+			char *buf = (char *) valloc(rec.size);
+			if (rec.is_write())
+				memset(buf, 0, rec.size);
+			data_loc_t loc(io->get_file_id(), rec.offset);
+			io_request req(buf, loc, rec.size, rec.is_write() ? WRITE : READ);
+			io->access(&req, 1);
+			num_reqs++;
+			num_bytes += rec.size;
+			if (io->num_pending_ios() > MAX_PENDING_REQS)
+				io->wait4complete(1);
+		}
+	}
+	for (size_t i = 0; i < ios.size(); i++) {
+		while (ios[i]->num_pending_ios() > 0)
+			ios[i]->wait4complete(ios[i]->num_pending_ios());
+		ios[i]->cleanup();
+	}
+	stop();
+}
+
+void comm_replay(int argc, char *argv[])
+{
+	if (argc < 1) {
+		fprintf(stderr, "replay trace_file [timed] [writes] [direct]\n");
+		fprintf(stderr, "trace_file is recorded by a SAFS application with io_trace_file\n");
+		fprintf(stderr, "timed: replay requests with the original timing; by default, requests are replayed as fast as possible\n");
+		fprintf(stderr, "writes: replay writes (with zeros); by default, writes are skipped\n");
+		fprintf(stderr, "direct: bypass the page cache; requests that aren't aligned to %d bytes are skipped\n",
+				MIN_BLOCK_SIZE);
+		return;
+	}
+
+	bool timed = false;
+	bool replay_writes = false;
+	int access_option = GLOBAL_CACHE_ACCESS;
+	for (int i = 1; i < argc; i++) {
+		std::string opt = argv[i];
+		if (opt == "timed")
+			timed = true;
+		else if (opt == "writes")
+			replay_writes = true;
+		else if (opt == "direct")
+			access_option = REMOTE_ACCESS;
+		else {
+			fprintf(stderr, "unknown option: %s\n", argv[i]);
+			return;
+		}
+	}
+
+	io_trace_reader::ptr reader = io_trace_reader::open(argv[0]);
+	if (reader == NULL)
+		return;
+
+	init_io_system(configs, access_option == GLOBAL_CACHE_ACCESS);
+	std::vector<file_io_factory::shared_ptr> factories;
+	for (size_t i = 0; i < reader->get_files().size(); i++)
+		factories.push_back(create_io_factory(reader->get_files()[i],
+					access_option));
+	printf("replay %ld requests of %ld files\n", reader->get_num_records(),
+			factories.size());
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	long start_us = get_curr_us();
+	// Each thread in the trace is replayed by its own thread. A thread
+	// starts to replay as soon as its first records are read.
+	std::map<int, replay_thread *> threads;
+	std::map<int, std::vector<io_trace_record> > thread_recs;
+	std::vector<io_trace_record> recs(4096);
+	size_t num;
+	while ((num = reader->read(recs.data(), recs.size())) > 0) {
+		for (size_t i = 0; i < num; i++)
+			thread_recs[recs[i].thread_id].push_back(recs[i]);
+		for (auto it = thread_recs.begin(); it != thread_recs.end(); it++) {
+			if (it->second.empty())
+				continue;
+			auto tit = threads.find(it->first);
+			if (tit == threads.end()) {
+				int node_id = threads.size() % params.get_num_nodes();
+				tit = threads.insert(std::pair<int, replay_thread *>(
+							it->first, new replay_thread(factories, node_id,
+								timed, replay_writes,
+								access_option == REMOTE_ACCESS,
+								start_us))).first;
+				tit->second->start();
+			}
+			tit->second->add(it->second);
+			it->second.clear();
+		}
+	}
+	for (auto it = threads.begin(); it != threads.end(); it++)
+		it->second->add_end();
+
+	size_t num_reqs = 0;
+	size_t num_bytes = 0;
+	size_t num_skipped = 0;
+	size_t num_unaligned = 0;
+	for (auto it = threads.begin(); it != threads.end(); it++) {
+		it->second->join();
+		num_reqs += it->second->get_num_reqs();
+		num_bytes += it->second->get_num_bytes();
+		num_skipped += it->second->get_num_skipped_writes();
+		num_unaligned += it->second->get_num_skipped_unaligned();
+		delete it->second;
+	}
+	gettimeofday(&end, NULL);
+	double secs = time_diff(start, end);
+	printf("replay %ld requests (%ld bytes) in %ld threads in %.3f seconds, %.0f reqs/s, %.3f MB/s, skip %ld writes\n",
+			num_reqs, num_bytes, threads.size(), secs, num_reqs / secs,
+			num_bytes / secs / 1024 / 1024, num_skipped);
+	if (num_unaligned > 0)
+		printf("skip %ld requests that aren't aligned for direct I/O\n",
+				num_unaligned);
+	print_io_summary();
+	factories.clear();
+	destroy_io_system();
+}
+
 typedef void (*command_func_t)(int argc, char *argv[]);
 
 struct command
@@ -516,6 +791,10 @@ struct command commands[] = {
 		"info file_name: show the information of an SAFS file"},
 	{"rename", comm_rename,
 		"rename file_name new_name: rename an SAFS file"},
+	{"mrc", comm_show_mrc,
+		"mrc mrc_file [max_cache_size] [num_points]: show the predicted cache hit ratios"},
+	{"replay", comm_replay,
+		"replay trace_file [timed] [writes] [direct]: replay an I/O trace"},
 };
 
 int get_num_commands()